@@ -0,0 +1,172 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core/Entity System/Entity.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Rendering/CFDTexturePacker.h"
+#include "Utility/Time/Stopwatch.h"
+
+/*
+Times every solver kernel and the texture repack on its own, for grids of 16 to 256 in 2D and 3D on one thread and on every hardware thread.
+Each benchmark reports two counters:
+	- ns_per_voxel, time per visible cell (N^dims), or per edge cell for the boundary kernel.
+	- GB_per_s, the bytes the kernel has to move at the least divided by its time, see CFDGrid::getKernelBytes.
+These are the numbers to quote before and after a change to a kernel. Run with --benchmark_filter to pick kernels and sizes, for example
+	CFDKernelBenchmarks --benchmark_filter="diffusion/64/3"
+*/
+
+using namespace CFD;
+
+namespace
+{
+	const int gridSizes[] = { 16, 32, 64, 128, 256 };
+
+	// Fills the current and previous arrays of every field with a smooth repeatable pattern, small enough that repeated runs stay finite.
+	void fillFields(CFDGrid* grid)
+	{
+		CFDData* voxels = grid->getAllVoxelData();
+		VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+
+		for (int f = 0; f < 4; ++f)
+		{
+			float scale = (f == 0) ? 1.0f : 0.01f;
+			for (int i = 0; i < fields[f]->getArraySize(); ++i)
+			{
+				float value = scale * float((i * 7 + f * 13) % 101) / 101.0f;
+				fields[f]->setCurrentValue(i, value);
+				fields[f]->setPreviousValue(i, value * 0.5f);
+			}
+		}
+	}
+
+	// Sets the counters every benchmark reports from the total time its kernel ran.
+	void setCounters(benchmark::State& state, double seconds, double cells, double bytes)
+	{
+		double iterations = double(state.iterations());
+		if (iterations <= 0.0 || seconds <= 0.0)
+			return;
+
+		state.counters["ns_per_voxel"] = seconds * 1.0e9 / (iterations * cells);
+		state.counters["GB_per_s"] = bytes * iterations / seconds / 1.0e9;
+	}
+
+	void runKernelBenchmark(benchmark::State& state, SolverKernel kernel)
+	{
+		int N = int(state.range(0));
+		int dimensions = int(state.range(1));
+		int threads = int(state.range(2));
+
+		Entity owner = Entity("Benchmark");
+		CFDGrid* grid = owner.addComponent<CFDGrid>();
+		grid->setThreadCount(threads);
+
+		if (!grid->setGrid(N, dimensions))
+		{
+			state.SkipWithError("Could not allocate the grid");
+			owner.removeComponent<CFDGrid>();
+			return;
+		}
+
+		fillFields(grid);
+
+		double seconds = 0.0;
+		for (auto _ : state)
+		{
+			Stopwatch timer;
+			grid->runKernel(kernel);
+			double elapsed = timer.getElapsedSeconds();
+
+			state.SetIterationTime(elapsed);
+			seconds += elapsed;
+		}
+
+		size_t densityBytes = getFieldStorageBytes(grid->getDensityStorage());
+		size_t velocityBytes = getFieldStorageBytes(grid->getVelocityStorage());
+		setCounters(state, seconds, CFDGrid::getKernelCells(kernel, N, dimensions), CFDGrid::getKernelBytes(kernel, N, dimensions, densityBytes, velocityBytes));
+
+		owner.removeComponent<CFDGrid>();
+	}
+
+	void runTextureRepackBenchmark(benchmark::State& state)
+	{
+		int N = int(state.range(0));
+		int dimensions = int(state.range(1));
+
+		Entity owner = Entity("Benchmark");
+		CFDGrid* grid = owner.addComponent<CFDGrid>();
+
+		if (!grid->setGrid(N, dimensions))
+		{
+			state.SkipWithError("Could not allocate the grid");
+			owner.removeComponent<CFDGrid>();
+			return;
+		}
+
+		fillFields(grid);
+
+		size_t cells = size_t(N) * size_t(N) * size_t(dimensions > 2 ? N : 1);
+		std::vector<float> density(cells);
+		std::vector<Vector4> velocity(cells);
+		std::vector<float> scratch(cells);
+
+		double seconds = 0.0;
+		for (auto _ : state)
+		{
+			Stopwatch timer;
+			CFDTexturePacker::pack(grid->getAllVoxelData(), cells, density.data(), velocity.data(), scratch.data());
+			benchmark::DoNotOptimize(velocity.data());
+			double elapsed = timer.getElapsedSeconds();
+
+			state.SetIterationTime(elapsed);
+			seconds += elapsed;
+		}
+
+		// Reads the four fields and writes the density and velocity staging.
+		double fieldBytes = double(getFieldStorageBytes(grid->getDensityStorage())) + 3.0 * double(getFieldStorageBytes(grid->getVelocityStorage()));
+		setCounters(state, seconds, double(cells), double(cells) * (fieldBytes + sizeof(float) + sizeof(Vector4)));
+
+		owner.removeComponent<CFDGrid>();
+	}
+
+	// Adds every size and dimension, once on a single thread and once on every hardware thread.
+	void addArguments(benchmark::internal::Benchmark* benchmark, bool threaded)
+	{
+		int hardwareThreads = std::max<int>(1, int(std::thread::hardware_concurrency()));
+
+		benchmark->ArgNames({ "N", "dims", "threads" });
+		for (int N : gridSizes)
+		{
+			for (int dimensions = 2; dimensions <= 3; ++dimensions)
+			{
+				benchmark->Args({ N, dimensions, 1 });
+				if (threaded && hardwareThreads > 1)
+					benchmark->Args({ N, dimensions, hardwareThreads });
+			}
+		}
+
+		benchmark->UseManualTime()->Unit(benchmark::kMicrosecond);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const SolverKernel kernels[] = { SolverKernel::Reset, SolverKernel::UpdateFromPrevious, SolverKernel::Diffusion,
+		SolverKernel::Advection, SolverKernel::MassConservation, SolverKernel::Boundary };
+
+	for (SolverKernel kernel : kernels)
+		addArguments(benchmark::RegisterBenchmark(getSolverKernelName(kernel), runKernelBenchmark, kernel), true);
+
+	// The repack runs on the render thread alone, so it is only timed on one.
+	addArguments(benchmark::RegisterBenchmark("textureRepack", runTextureRepackBenchmark), false);
+
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+
+	benchmark::RunSpecifiedBenchmarks();
+	benchmark::Shutdown();
+	return 0;
+}
@@ -29,9 +29,97 @@
 #include "Core/Components/CFD/Grid/CFDGrid.h"
 #include "Core/Components/CFD/Grid/CFDGrid.cpp"
 
+#include "Core/Components/CFD/Emitter/CFDEmitter.h"
+#include "Core/Components/CFD/Emitter/CFDEmitter.cpp"
+
+#include "Core/Components/CFD/Precision/PrecisionReport.h"
+#include "Core/Components/CFD/Precision/PrecisionReport.cpp"
+
+#include "Core/Components/CFD/Checkpoint/CFDCheckpoint.h"
+#include "Core/Components/CFD/Checkpoint/CFDCheckpoint.cpp"
+
+#include "Core/Components/CFD/Recording/CFDRecorder.h"
+#include "Core/Components/CFD/Recording/CFDRecorder.cpp"
+
+#include "Core/Components/CFD/Recording/CFDPlayback.h"
+#include "Core/Components/CFD/Recording/CFDPlayback.cpp"
+
+#include "Core/Components/CFD/Recording/CFDInputLog.h"
+#include "Core/Components/CFD/Recording/CFDInputLog.cpp"
+
+#include "Core/Components/CFD/Export/CFDVtkExporter.h"
+#include "Core/Components/CFD/Export/CFDVtkExporter.cpp"
+
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Core/Components/CFD/Scene/CFDScene.cpp"
+#include "Core/Components/CFD/Turbulence/CurlNoise.h"
+#include "Core/Components/CFD/Turbulence/CurlNoise.cpp"
+#include "Core/Components/CFD/Validation/CFDReferenceKernels.h"
+#include "Core/Components/CFD/Validation/CFDReferenceKernels.cpp"
+#include "Core/Components/CFD/Validation/CFDKernelCheck.h"
+#include "Core/Components/CFD/Validation/CFDKernelCheck.cpp"
+#include "Core/Components/CFD/Scenarios/CFDScenarioLibrary.h"
+#include "Core/Components/CFD/Scenarios/CFDScenarioLibrary.cpp"
+
+#include "Core/Components/CFD/Batch/CFDBatch.h"
+#include "Core/Components/CFD/Batch/CFDBatch.cpp"
+
+#include "Core/Components/CFD/Batch/CFDScaling.h"
+#include "Core/Components/CFD/Batch/CFDScaling.cpp"
+#include "Core/Components/CFD/Batch/CFDRoofline.h"
+#include "Core/Components/CFD/Batch/CFDRoofline.cpp"
+#include "Core/Components/CFD/Batch/CFDRegression.h"
+#include "Core/Components/CFD/Batch/CFDRegression.cpp"
+
+#include "Core/Components/CFD/Recording/CFDRecordingReader.h"
+#include "Core/Components/CFD/Recording/CFDRecordingReader.cpp"
+
+#include "Core/Components/CFD/Recording/SequenceCodec.h"
+#include "Core/Components/CFD/Recording/SequenceCodec.cpp"
+
 #include "Utility/Math/Math.h"
 #include "Utility/Math/Math.cpp"
 
+#include "Utility/Math/HalfFloat.h"
+#include "Utility/Math/HalfFloat.cpp"
+
+#include "Utility/Memory/Arena.h"
+#include "Utility/Memory/Arena.cpp"
+
+#include "Utility/Memory/ProcessMemory.h"
+#include "Utility/Memory/ProcessMemory.cpp"
+
+#include "Utility/Threading/ThreadPool.h"
+#include "Utility/Threading/ThreadPool.cpp"
+
+#include "Utility/Profiling/MachineProbe.h"
+#include "Utility/Profiling/MachineProbe.cpp"
+#include "Utility/Profiling/PerfCounters.h"
+#include "Utility/Profiling/PerfCounters.cpp"
+#include "Utility/Profiling/Trace.h"
+#include "Utility/Profiling/Trace.cpp"
+
+#include "Utility/File/MappedFile.h"
+#include "Utility/File/MappedFile.cpp"
+
+#include "Utility/File/AtomicFile.h"
+#include "Utility/File/AtomicFile.cpp"
+
+#include "Utility/Compression/ByteShuffle.h"
+#include "Utility/Compression/ByteShuffle.cpp"
+
+#include "Utility/Compression/Deflate.h"
+#include "Utility/Compression/Deflate.cpp"
+
+#include "Utility/Compression/LZ.h"
+#include "Utility/Compression/LZ.cpp"
+
+#include "Utility/Compression/Wavelet.h"
+#include "Utility/Compression/Wavelet.cpp"
+
+#include "Utility/Config/IniFile.h"
+#include "Utility/Config/IniFile.cpp"
+
 #include "Dependencies\UI\IMGUI\imgui.h"
 #include "Dependencies\UI\IMGUI\imgui.cpp"
 
@@ -391,4 +479,554 @@ TEST(CFDSim, velocity3D) {
 		Math::compareFloat(expectedZ, valueZ, 0.00001f));
 
 	EXPECT_TRUE(value) << "Expected: (" << expectedX << "," << expectedY << "," << expectedZ << ") Value: (" << valueX << "," << valueY << "," << valueZ << ")";
-}
\ No newline at end of file
+}
+
+TEST(CFDGrid, arenaAlignedAndReused) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	EXPECT_TRUE(grid->setGrid(10, 3)) << "Failed to allocate a 10^3 grid!";
+
+	CFD::CFDData* voxels = grid->getAllVoxelData();
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(voxels->density->getCurrentArray()) % Arena::Alignment, 0u) << "Density is not cache line aligned!";
+	EXPECT_EQ(reinterpret_cast<uintptr_t>(voxels->velocityZ->getPreviousArray()) % Arena::Alignment, 0u) << "VelocityZ is not cache line aligned!";
+
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(2, 2, 2), 204);
+
+	// A smaller grid fits in the existing block so it should be reused and re-zeroed.
+	EXPECT_TRUE(grid->setGrid(5, 3)) << "Failed to allocate a 5^3 grid!";
+	EXPECT_EQ(grid->getArena().getBlockAllocations(), 1) << "Arena was reallocated for a grid that fits!";
+	EXPECT_EQ(grid->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2)), 0.0f) << "Reused arena was not cleared!";
+	EXPECT_EQ(int(grid->getArena().getLayout().size()), 10) << "Arena layout is missing fields or staging buffers!";
+}
+
+TEST(CFDGrid, setGridOverBudgetRejected) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setMemoryBudget(1024 * 1024);
+	EXPECT_TRUE(grid->setGrid(10, 3)) << "A grid within budget was rejected!";
+
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(2, 2, 2), 204);
+
+	EXPECT_FALSE(grid->setGrid(512, 3)) << "A grid far over budget was accepted!";
+	EXPECT_FALSE(grid->getLastSetGridReport().withinBudget()) << "Rejected grid report is within budget!";
+	EXPECT_EQ(grid->getGridWidth(), 10) << "Rejected grid replaced the current grid!";
+	EXPECT_EQ(int(grid->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2))), 204) << "Rejected grid cleared the current fields!";
+	EXPECT_EQ(grid->getMemoryReport().getTotal(), grid->getArena().getUsed()) << "Memory report does not match what was allocated!";
+}
+
+TEST(CFDGrid, resizePreservesState) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(8, 2);
+	grid->setThreadCount(2);
+
+	// Fill a block in the middle of the domain.
+	for (int y = 2; y < 6; ++y)
+		for (int x = 2; x < 6; ++x)
+			grid->getAllVoxelData()->density->setCurrentValue(Vector3(x, y, 0), 1.0f);
+
+	EXPECT_TRUE(grid->resize(16)) << "Resize within budget failed!";
+	EXPECT_EQ(grid->getGridWidth(), 16) << "Resize did not change the grid size!";
+
+	float total = 0.0f;
+	for (int y = 0; y < 16; ++y)
+		for (int x = 0; x < 16; ++x)
+			total += grid->getAllVoxelData()->density->getCurrentValue(Vector3(x, y, 0));
+
+	// Twice the resolution in 2D covers the block with four times the voxels.
+	EXPECT_NEAR(total, 16.0f * 4.0f, 0.5f) << "Upsampling did not preserve the density!";
+	EXPECT_NEAR(grid->getAllVoxelData()->density->getCurrentValue(Vector3(8, 8, 0)), 1.0f, 0.001f) << "Upsampling moved the block!";
+
+	EXPECT_TRUE(grid->resize(8)) << "Resizing back down failed!";
+	EXPECT_EQ(grid->getAllVoxelData()->density->getCurrentValue(Vector3(3, 3, 0)), 1.0f) << "Box downsampling changed an interior value!";
+	EXPECT_EQ(grid->getArena().getBlockAllocations(), 1) << "Resizing reallocated instead of reusing the resize buffers!";
+
+	grid->setMemoryBudget(1024);
+	EXPECT_FALSE(grid->resize(64)) << "A resize over budget was accepted!";
+	EXPECT_EQ(grid->getGridWidth(), 8) << "Rejected resize replaced the current grid!";
+}
+
+TEST(CFDGrid, checkpointRoundTrip) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->setDiffusionRate(0.25f);
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(2, 2, 2), 204);
+	grid->getAllVoxelData()->velocityY->setPreviousValue(Vector3(3, 4, 5), -7);
+
+	std::string error;
+	ASSERT_TRUE(CFD::CFDCheckpoint::save(grid, "checkpointRoundTrip.cfdckpt", &error)) << error;
+
+	CFD::CFDGrid* restored = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDCheckpoint::load(restored, "checkpointRoundTrip.cfdckpt", &error)) << error;
+
+	EXPECT_TRUE(restored->isMapped()) << "Checkpoint was copied rather than mapped!";
+	EXPECT_EQ(restored->getGridWidth(), 10) << "Checkpoint did not restore the grid size!";
+	EXPECT_EQ(restored->getDiffusionRate(), 0.25f) << "Checkpoint did not restore the parameters!";
+	EXPECT_EQ(restored->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2)), 204.0f) << "Checkpoint did not restore the current density!";
+	EXPECT_EQ(restored->getAllVoxelData()->velocityY->getPreviousValue(Vector3(3, 4, 5)), -7.0f) << "Checkpoint did not restore the previous velocity!";
+
+	// Stepping writes into the private mapping, the file on disk has to stay as it was saved.
+	restored->Start();
+	restored->Update(0.016f);
+
+	CFD::CFDGrid* reloaded = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDCheckpoint::load(reloaded, "checkpointRoundTrip.cfdckpt", &error)) << error;
+	EXPECT_EQ(reloaded->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2)), 204.0f) << "Stepping a restored grid modified the checkpoint!";
+
+	std::vector<char> garbage(sizeof(CFD::CheckpointHeader), 'x');
+	FILE* file = fopen("checkpointGarbage.cfdckpt", "wb");
+	fwrite(garbage.data(), 1, garbage.size(), file);
+	fclose(file);
+
+	CFD::CheckpointHeader header;
+	EXPECT_FALSE(CFD::CFDCheckpoint::readHeader("checkpointGarbage.cfdckpt", header)) << "A non checkpoint file was accepted!";
+}
+
+TEST(CFDGrid, lossyCheckpointWithinErrorBound) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->Start();
+	grid->addDensity(Vector3(5, 5, 5), 100);
+	grid->addVelocity(Vector3(5, 5, 5), Vector3(5, 5, 5));
+
+	for (int i = 0; i < 3; ++i)
+		grid->Update(0.016f);
+
+	WaveletSettings settings;
+	settings.maxError = 0.01f;
+
+	std::string error;
+	ASSERT_TRUE(CFD::CFDCheckpoint::save(grid, "lossyCheckpoint.cfdckpt", &error, &settings)) << error;
+
+	CFD::CheckpointHeader header;
+	ASSERT_TRUE(CFD::CFDCheckpoint::readHeader("lossyCheckpoint.cfdckpt", header, &error)) << error;
+	EXPECT_LT(header.fields[0].bytes, uint64_t(grid->getAllVoxelData()->density->getArraySize()) * sizeof(float)) << "Lossy field did not compress!";
+
+	CFD::CFDGrid* restored = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDCheckpoint::load(restored, "lossyCheckpoint.cfdckpt", &error)) << error;
+	EXPECT_FALSE(restored->isMapped()) << "A compressed checkpoint cannot be mapped!";
+
+	CFD::VoxelData* saved[] = { grid->getAllVoxelData()->density, grid->getAllVoxelData()->velocityX };
+	CFD::VoxelData* loaded[] = { restored->getAllVoxelData()->density, restored->getAllVoxelData()->velocityX };
+	for (int field = 0; field < 2; ++field)
+	{
+		float largestError = 0.0f;
+		for (int i = 0; i < saved[field]->getArraySize(); ++i)
+		{
+			largestError = std::max<float>(largestError, std::fabs(saved[field]->getCurrentValue(i) - loaded[field]->getCurrentValue(i)));
+			largestError = std::max<float>(largestError, std::fabs(saved[field]->getPreviousValue(i) - loaded[field]->getPreviousValue(i)));
+		}
+
+		// The bound holds before the decoded value is rounded back to a float.
+		EXPECT_LE(largestError, settings.maxError * 1.0001f) << "Field " << field << " exceeded the error bound!";
+	}
+}
+
+TEST(CFDGrid, recorderRoundTrip) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->Start();
+
+	CFD::CFDRecorder* recorder = object.addComponent<CFD::CFDRecorder>();
+	recorder->setRecordVelocity(true);
+	recorder->setBackPressure(CFD::RecorderBackPressure::Block);
+	ASSERT_TRUE(recorder->start(grid, "recorderRoundTrip.cfdrec")) << "Recorder failed to start!";
+
+	grid->addDensity(Vector3(5, 5, 5), 100);
+	grid->addVelocity(Vector3(5, 5, 5), Vector3(5, 5, 5));
+
+	for (int i = 0; i < 5; ++i)
+		grid->Update(0.016f);
+
+	std::vector<float> lastDensity(grid->getAllVoxelData()->density->getArraySize());
+	memcpy(lastDensity.data(), grid->getAllVoxelData()->density->getCurrentRawArray(), lastDensity.size() * sizeof(float));
+
+	ASSERT_TRUE(recorder->stop()) << "Recording was not written!";
+
+	CFD::RecorderStats stats = recorder->getStats();
+	EXPECT_EQ(stats.framesWritten, 5u) << "Blocking recorder lost frames!";
+	EXPECT_EQ(stats.framesDropped, 0u) << "Blocking recorder dropped frames!";
+	EXPECT_GT(stats.getCompressionRatio(), 1.0) << "Recording did not compress!";
+
+	CFD::CFDRecordingReader reader;
+	ASSERT_TRUE(reader.open("recorderRoundTrip.cfdrec")) << "Recording could not be opened!";
+	ASSERT_EQ(reader.getFrameCount(), 5) << "Recording has the wrong number of frames!";
+
+	std::vector<float> recordedDensity(lastDensity.size());
+	ASSERT_TRUE(reader.readField(4, 0, recordedDensity.data())) << "Recorded frame could not be decoded!";
+	EXPECT_EQ(recordedDensity, lastDensity) << "Recorded density does not match the simulation!";
+}
+
+TEST(CFDGrid, recordingSeeksThroughKeyframes) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->setRandomVelocityMinMax(0);
+	grid->Start();
+
+	CFD::CFDRecorder* recorder = object.addComponent<CFD::CFDRecorder>();
+	recorder->setBackPressure(CFD::RecorderBackPressure::Block);
+	recorder->setKeyframeInterval(3);
+	recorder->setBrickSize(4);
+	ASSERT_TRUE(recorder->start(grid, "recordingSeeksThroughKeyframes.cfdrec")) << "Recorder failed to start!";
+
+	grid->addDensity(Vector3(2, 2, 2), 100);
+
+	std::vector<std::vector<float>> densities;
+	for (int i = 0; i < 7; ++i)
+	{
+		grid->Update(0.016f);
+
+		const float* density = static_cast<const float*>(grid->getAllVoxelData()->density->getCurrentRawArray());
+		densities.emplace_back(density, density + grid->getAllVoxelData()->density->getArraySize());
+	}
+
+	ASSERT_TRUE(recorder->stop()) << "Recording was not written!";
+	EXPECT_EQ(recorder->getStats().keyframesWritten, 3u) << "Keyframes were not written on the interval!";
+
+	CFD::CFDRecordingReader reader;
+	ASSERT_TRUE(reader.open("recordingSeeksThroughKeyframes.cfdrec")) << "Recording could not be opened!";
+	ASSERT_EQ(reader.getFrameCount(), 7) << "Recording has the wrong number of frames!";
+	EXPECT_EQ(reader.getKeyframeCount(), 3) << "Keyframe index is incomplete!";
+
+	// Seek backwards and forwards so frames are reached both from keyframes and from the frame before.
+	std::vector<float> decoded(densities[0].size());
+	int order[] = { 5, 1, 2, 6, 0, 4, 3 };
+	for (int frame : order)
+	{
+		ASSERT_TRUE(reader.readField(frame, 0, decoded.data())) << "Frame " << frame << " could not be decoded!";
+		EXPECT_EQ(decoded, densities[frame]) << "Frame " << frame << " decoded incorrectly!";
+		EXPECT_LE(reader.getLastDecodeCount(), 3) << "Seeking decoded past the nearest keyframe!";
+	}
+}
+
+TEST(CFDGrid, playbackScrubsRecording) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->setRandomVelocityMinMax(0);
+	grid->Start();
+
+	CFD::CFDRecorder* recorder = object.addComponent<CFD::CFDRecorder>();
+	recorder->setBackPressure(CFD::RecorderBackPressure::Block);
+	recorder->setKeyframeInterval(4);
+	ASSERT_TRUE(recorder->start(grid, "playbackScrubsRecording.cfdrec")) << "Recorder failed to start!";
+
+	grid->addDensity(Vector3(5, 5, 5), 100);
+
+	std::vector<std::vector<float>> densities;
+	for (int i = 0; i < 10; ++i)
+	{
+		grid->Update(0.016f);
+
+		const float* density = grid->getAllVoxelData()->density->getCurrentArray();
+		densities.emplace_back(density, density + grid->getAllVoxelData()->density->getArraySize());
+	}
+
+	ASSERT_TRUE(recorder->stop()) << "Recording was not written!";
+
+	// Play back into a grid of a different size, which has to be matched to the recording.
+	GameObject viewer = GameObject();
+	CFD::CFDGrid* playbackGrid = viewer.addComponent<CFD::CFDGrid>();
+	playbackGrid->setGrid(6, 3);
+	playbackGrid->Start();
+
+	CFD::CFDPlayback* playback = viewer.addComponent<CFD::CFDPlayback>();
+	playback->setBlocking(true);
+	playback->setPrefetchCount(3);
+	ASSERT_TRUE(playback->open("playbackScrubsRecording.cfdrec")) << "Recording could not be opened for playback!";
+	ASSERT_EQ(playback->getFrameCount(), 10) << "Playback has the wrong number of frames!";
+
+	for (int i = 0; i < 4; ++i)
+	{
+		playbackGrid->Update(0.016f);
+
+		ASSERT_EQ(playback->getPresentedFrame(), i) << "Playback skipped a frame!";
+		const float* density = playbackGrid->getAllVoxelData()->density->getCurrentArray();
+		EXPECT_TRUE(std::equal(densities[i].begin(), densities[i].end(), density)) << "Frame " << i << " played back incorrectly!";
+	}
+
+	EXPECT_EQ(playbackGrid->getGridWidth(), 10) << "Playback did not resize the grid to the recording!";
+
+	playback->setPlaying(false);
+	int scrubOrder[] = { 8, 1, 6, 9 };
+	for (int frame : scrubOrder)
+	{
+		playback->seek(frame);
+		playbackGrid->Update(0.016f);
+
+		ASSERT_EQ(playback->getPresentedFrame(), frame) << "Scrubbing presented the wrong frame!";
+		const float* density = playbackGrid->getAllVoxelData()->density->getCurrentArray();
+		EXPECT_TRUE(std::equal(densities[frame].begin(), densities[frame].end(), density)) << "Frame " << frame << " scrubbed incorrectly!";
+	}
+
+	playback->close();
+}
+
+TEST(CFDGrid, vtkExportMatchesGrid) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	grid->setRandomVelocityMinMax(0);
+	grid->Start();
+
+	grid->addDensity(Vector3(5, 5, 5), 100);
+	for (int i = 0; i < 3; ++i)
+		grid->Update(0.016f);
+
+	// Density as the grid addresses it, without the padding at the end of the array.
+	std::vector<float> expected;
+	for (int z = 0; z < 10; ++z)
+		for (int y = 0; y < 10; ++y)
+			for (int x = 0; x < 10; ++x)
+				expected.push_back(grid->getAllVoxelData()->density->getCurrentValue(Vector3(float(x), float(y), float(z))));
+
+	CFD::CFDVtkExporter exporter;
+	for (bool compress : { false, true })
+	{
+		CFD::VtkExportSettings settings;
+		settings.compress = compress;
+		settings.blockBytes = 1200;
+		ASSERT_TRUE(exporter.start(grid, "vtkExportMatchesGrid.vti", settings)) << "Export failed to start!";
+		ASSERT_TRUE(exporter.finish()) << "Export was not written!";
+
+		MappedFile file;
+		ASSERT_TRUE(file.open("vtkExportMatchesGrid.vti")) << "Exported file is missing!";
+
+		std::string contents(reinterpret_cast<const char*>(file.getData()), file.getSize());
+		EXPECT_NE(contents.find("WholeExtent=\"0 10 0 10 0 10\""), std::string::npos) << "Extent does not match the grid!";
+		EXPECT_NE(contents.find("NumberOfComponents=\"3\""), std::string::npos) << "Velocity was not exported!";
+
+		// Density is the first array, straight after the underscore that opens the appended data.
+		size_t appended = contents.find('_', contents.find("<AppendedData"));
+		ASSERT_NE(appended, std::string::npos) << "Appended data is missing!";
+		const unsigned char* data = file.getData() + appended + 1;
+
+		std::vector<float> density(expected.size());
+		if (!compress)
+		{
+			uint64_t bytes;
+			memcpy(&bytes, data, sizeof(bytes));
+			ASSERT_EQ(bytes, expected.size() * sizeof(float)) << "Ghost cells were not stripped!";
+			memcpy(density.data(), data + sizeof(bytes), size_t(bytes));
+		}
+		else
+		{
+			uint64_t blockHeader[3];
+			memcpy(blockHeader, data, sizeof(blockHeader));
+			ASSERT_EQ(blockHeader[0], (expected.size() * sizeof(float) + 1199) / 1200) << "Wrong number of compressed blocks!";
+
+			const unsigned char* block = data + (3 + blockHeader[0]) * sizeof(uint64_t);
+			unsigned char* destination = reinterpret_cast<unsigned char*>(density.data());
+			for (uint64_t i = 0; i < blockHeader[0]; ++i)
+			{
+				uint64_t compressedBytes;
+				memcpy(&compressedBytes, data + (3 + i) * sizeof(uint64_t), sizeof(compressedBytes));
+
+				size_t blockBytes = (i + 1 == blockHeader[0] && blockHeader[2] != 0) ? size_t(blockHeader[2]) : size_t(blockHeader[1]);
+				ASSERT_TRUE(Deflate::decompress(block, size_t(compressedBytes), destination, blockBytes)) << "Block " << i << " is not a valid zlib stream!";
+
+				block += compressedBytes;
+				destination += blockBytes;
+			}
+		}
+
+		EXPECT_TRUE(std::equal(expected.begin(), expected.end(), density.begin())) << "Exported density does not match the grid!";
+	}
+}
+
+TEST(CFDGrid, sceneFileConfiguresGrid) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	const char* sceneText =
+		"[grid]\n"
+		"size = 12\n"
+		"dimensions = 3\n"
+		"densityStorage = fp16\n"
+		"\n"
+		"[solver]\n"
+		"diffusionRate = 0.25\n"
+		"threads = 2\n"
+		"\n"
+		"; Two emitters, each in its own section.\n"
+		"[emitter]\n"
+		"shape = box\n"
+		"position = 6, 2, 6\n"
+		"rate = 50\n"
+		"\n"
+		"[emitter]\n"
+		"position = 3 3 3\n"
+		"velocity = 0, 1, 0\n";
+
+	CFD::SceneDescription scene;
+	std::string error;
+	ASSERT_TRUE(CFD::CFDScene::parse(sceneText, "test.ini", scene, &error)) << error;
+	ASSERT_EQ(scene.emitters.size(), 2u) << "Emitter sections were not all read!";
+	EXPECT_EQ(scene.emitters[0].shape, CFD::EmitterShape::Box);
+	EXPECT_EQ(scene.emitters[1].shape, CFD::EmitterShape::Sphere) << "Emitter defaults were not kept!";
+
+	// Written back out, the scene has to read in the same.
+	CFD::SceneDescription reread;
+	ASSERT_TRUE(CFD::CFDScene::parse(CFD::CFDScene::toString(scene), "written.ini", reread, &error)) << error;
+	EXPECT_EQ(CFD::CFDScene::toString(reread), CFD::CFDScene::toString(scene)) << "Scene did not survive being written out!";
+
+	GameObject object = GameObject();
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDScene::apply(scene, grid, &error)) << error;
+
+	EXPECT_EQ(grid->getGridWidth(), 12);
+	EXPECT_EQ(grid->getDimensions(), 3);
+	EXPECT_EQ(grid->getDensityStorage(), CFD::FieldStorage::Float16);
+	EXPECT_FLOAT_EQ(grid->getDiffusionRate(), 0.25f);
+	EXPECT_EQ(grid->getThreadCount(), 2);
+	EXPECT_TRUE(grid->getSimulating()) << "Applying a scene did not start the simulation!";
+	EXPECT_EQ(object.getAllComponents<CFD::CFDEmitter>().size(), 2u) << "Scene emitters were not added!";
+
+	grid->Update(0.016f);
+	EXPECT_GT(grid->getVoxel(Vector3(6, 2, 6)).density, 0.0f) << "Scene emitter did not emit!";
+
+	// Typos are errors that point at the line, rather than being skipped.
+	EXPECT_FALSE(CFD::CFDScene::parse("[grid]\nsize = 12\nviscosity = 0.1\n", "typo.ini", scene, &error));
+	EXPECT_EQ(error, "typo.ini:3: unknown key 'viscosity' in [grid]");
+}
+
+TEST(CFDGrid, halfPrecisionDensity) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(10, 3);
+	size_t fullBytes = grid->getMemoryReport().getTotal();
+
+	grid->setDensityStorage(CFD::FieldStorage::Float16);
+	grid->setGrid(10, 3);
+
+	EXPECT_EQ(grid->getAllVoxelData()->density->getStorage(), CFD::FieldStorage::Float16) << "Density storage was not applied!";
+	EXPECT_EQ(grid->getAllVoxelData()->velocityX->getStorage(), CFD::FieldStorage::Float32) << "Velocity storage changed with density!";
+	EXPECT_LT(grid->getMemoryReport().getTotal(), fullBytes) << "fp16 density did not reduce the footprint!";
+
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(2, 2, 2), 204.0f);
+	EXPECT_EQ(grid->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2)), 204.0f) << "fp16 storage did not round trip an exact value!";
+
+	CFD::PrecisionReport report = CFD::PrecisionComparison::run(5, 2, CFD::FieldStorage::Float16, CFD::FieldStorage::Float32, 20);
+	for (const CFD::FieldError& field : report.fields)
+	{
+		EXPECT_LT(field.getRelativeError(), 0.01f) << field.name << " drifted too far from fp32: " << report.toString();
+	}
+}
+
+/*------- Emitter Tests ------*/
+
+TEST(CFDEmitter, footprintCachedUntilMoved) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	int size = 10;
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(size, 2);
+	grid->Start();
+
+	CFD::CFDEmitter* emitter = object.addComponent<CFD::CFDEmitter>();
+	emitter->setShape(CFD::EmitterShape::Sphere);
+	emitter->setPosition(Vector3(5, 5, 0));
+	emitter->setSize(Vector3(2, 2, 2));
+	emitter->setRate(10.0f);
+
+	for (int i = 0; i < 5; ++i)
+	{
+		grid->Update(0.016f);
+	}
+
+	EXPECT_EQ(emitter->getStats().rebuildCount, 1) << "Emitter footprint was rebuilt without the emitter moving!";
+	EXPECT_EQ(emitter->getStats().stepsEmitted, 5) << "Emitter was not rasterised once per step!";
+	EXPECT_GT(emitter->getStats().footprintVoxels, 1) << "Sphere emitter footprint only covers a single voxel!";
+	EXPECT_EQ(int(grid->getEmitters().size()), 1) << "Grid did not pick up the emitter on its GameObject!";
+
+	emitter->setPosition(Vector3(2, 2, 0));
+	grid->Update(0.016f);
+
+	EXPECT_EQ(emitter->getStats().rebuildCount, 2) << "Emitter footprint was not rebuilt after the emitter moved!";
+}
+
+TEST(CFDEmitter, lifetimeExpires) {
+
+	D3D* device = D3D::getInstance();
+	device->InitDevice();
+
+	GameObject object = GameObject();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setGrid(5, 2);
+	grid->Start();
+
+	CFD::CFDEmitter* emitter = object.addComponent<CFD::CFDEmitter>();
+	emitter->setShape(CFD::EmitterShape::Point);
+	emitter->setPosition(Vector3(2, 2, 0));
+	emitter->setRate(10.0f);
+	emitter->setLifetime(grid->getTimeStep() * 3);
+
+	for (int i = 0; i < 10; ++i)
+	{
+		grid->Update(0.016f);
+	}
+
+	EXPECT_FALSE(emitter->isAlive()) << "Emitter is still alive after its lifetime!";
+	EXPECT_EQ(emitter->getStats().stepsEmitted, 3) << "Emitter emitted outside of its lifetime!";
+}
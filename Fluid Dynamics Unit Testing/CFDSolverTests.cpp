@@ -0,0 +1,994 @@
+#include "pch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core/Entity System/Entity.h"
+#include "Core/Components/CFD/Batch/CFDBatch.h"
+#include "Core/Components/CFD/Batch/CFDScaling.h"
+#include "Core/Components/CFD/Batch/CFDRoofline.h"
+#include "Core/Components/CFD/Batch/CFDRegression.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Emitter/CFDEmitter.h"
+#include "Core/Components/CFD/Checkpoint/CFDCheckpoint.h"
+#include "Core/Components/CFD/Precision/PrecisionReport.h"
+#include "Core/Components/CFD/Recording/CFDInputLog.h"
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Core/Components/CFD/Turbulence/CurlNoise.h"
+#include "Core/Components/CFD/Validation/CFDKernelCheck.h"
+#include "Core/Components/CFD/Scenarios/CFDScenarioLibrary.h"
+#include "Utility/Math/Philox.h"
+#include "Utility/Profiling/PerfCounters.h"
+#include "Utility/Profiling/Trace.h"
+
+/*
+These tests only use the solver library, no device or window is created so they also run in the portable CMake build.
+In the Visual Studio test project the definitions come from the sources CFDGridTests.cpp compiles in.
+*/
+
+namespace
+{
+	float totalDensity(CFD::CFDGrid* grid)
+	{
+		int cells = grid->getGridWidth() * grid->getGridHeight() * ((grid->getDimensions() > 2) ? grid->getGridDepth() : 1);
+
+		float total = 0.0f;
+		for (int i = 0; i < cells; ++i)
+			total += grid->getAllVoxelData()->density->getCurrentValue(i);
+
+		return total;
+	}
+}
+
+/*------- Headless Solver Tests ------*/
+
+TEST(CFDSolver, stepsWithoutDevice) {
+
+	Entity object = Entity();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(grid->setGrid(12, 3));
+	grid->Start();
+
+	CFD::CFDEmitter* emitter = object.addComponent<CFD::CFDEmitter>();
+	emitter->setPosition(Vector3(6.0f, 3.0f, 6.0f));
+	emitter->setRate(100.0f);
+
+	for (int i = 0; i < 5; ++i)
+		grid->Update(0.016f);
+
+	EXPECT_EQ(grid->getStepCount(), 5u) << "Grid did not step without a device!";
+	EXPECT_GT(totalDensity(grid), 0.0f) << "Emitter added no density without a device!";
+}
+
+TEST(CFDSolver, memoryReportHasNoTextureStaging) {
+
+	Entity object = Entity();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(grid->setGrid(10, 3));
+
+	// Staging for the textures belongs to the renderer, the grid only accounts for the fields it owns.
+	EXPECT_EQ(grid->getMemoryReport().getTotal(), grid->getArena().getUsed()) << "Memory report does not match what was allocated!";
+	EXPECT_EQ(grid->getMemoryReport().toString().find("staging"), std::string::npos) << "Grid still reports texture staging buffers!";
+}
+
+TEST(CFDSolver, setGridBudgetCoversViewBuffers) {
+
+	Entity object = Entity();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setMemoryBudget(1024 * 1024);
+	ASSERT_TRUE(grid->setGrid(10, 3));
+	grid->Start();
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(2, 2, 2), 204);
+
+	// The fields of a 20^3 grid fit the budget on their own, the buffers drawing it do not.
+	grid->setViewMemoryEstimator([](int size, int, MemoryReport& report) { report.addEntry("View", size_t(size) * size * size * 1024); });
+	EXPECT_FALSE(grid->setGrid(20, 3)) << "A grid whose view buffers are over budget was accepted!";
+	EXPECT_NE(grid->getLastSetGridReport().toString().find("View"), std::string::npos) << "Rejected report does not list the view buffers!";
+	EXPECT_EQ(grid->getGridWidth(), 10) << "Rejected grid replaced the current grid!";
+	EXPECT_EQ(int(grid->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2))), 204) << "Rejected grid cleared the current fields!";
+
+	// A grid that needs a bigger block gets it before the current one goes, and the old block is handed back.
+	grid->setViewMemoryEstimator(nullptr);
+	EXPECT_TRUE(grid->setGrid(20, 3)) << "A bigger grid within budget was rejected!";
+	EXPECT_EQ(grid->getMemoryReport().getTotal(), grid->getArena().getUsed()) << "The old block was kept after growing the grid!";
+	EXPECT_EQ(grid->getAllVoxelData()->density->getCurrentValue(Vector3(2, 2, 2)), 0.0f) << "The new grid was not cleared!";
+
+	grid->Update(0.1f);
+	EXPECT_EQ(grid->getStepCount(), 1u) << "The grown grid did not step!";
+}
+
+TEST(CFDSolver, mappedCheckpointSteps) {
+
+	Entity object = Entity();
+
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(grid->setGrid(8, 2));
+	grid->getAllVoxelData()->density->setCurrentValue(Vector3(4.0f, 4.0f, 0.0f), 50.0f);
+
+	// Random velocity and turbulence are drawn from the seed and step, and queued sources are added every step, so all have to survive the checkpoint.
+	CFD::TurbulenceSettings turbulence;
+	turbulence.enabled = true;
+	turbulence.amplitude = 2.0f;
+	turbulence.octaves = 3;
+	grid->setRandomSeed(1234);
+	grid->setRandomVelocityMinMax(3);
+	grid->addDensity(Vector3(2.0f, 2.0f, 0.0f), 5.0f);
+	grid->setTurbulence(turbulence);
+	grid->Start();
+
+	for (int i = 0; i < 4; ++i)
+		grid->Update(0.016f);
+
+	std::string error;
+	ASSERT_TRUE(CFD::CFDCheckpoint::save(grid, "solverCheckpoint.cfdckpt", &error)) << error;
+
+	CFD::CFDGrid* restored = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDCheckpoint::load(restored, "solverCheckpoint.cfdckpt", &error)) << error;
+
+	EXPECT_TRUE(restored->isMapped()) << "Checkpoint was copied rather than mapped!";
+	EXPECT_EQ(restored->getArena().getUsed(), 0u) << "A mapped grid should not need the arena!";
+	EXPECT_EQ(restored->getRandomSeed(), 1234u) << "Checkpoint lost the random seed!";
+	EXPECT_EQ(restored->getStepCount(), 4u) << "Checkpoint lost the step count!";
+	EXPECT_TRUE(restored->getTurbulence().enabled) << "Checkpoint lost the turbulence!";
+	EXPECT_EQ(restored->getTurbulence().octaves, 3) << "Checkpoint lost the turbulence octaves!";
+
+	restored->Start();
+	for (int i = 0; i < 3; ++i)
+	{
+		grid->Update(0.016f);
+		restored->Update(0.016f);
+	}
+
+	EXPECT_EQ(restored->getStepCount(), 7u) << "Mapped grid did not step!";
+
+	// The restored run carries on exactly where the original is.
+	CFD::CFDData* original = grid->getAllVoxelData();
+	CFD::CFDData* resumed = restored->getAllVoxelData();
+	CFD::VoxelData* originalFields[] = { original->density, original->velocityX, original->velocityY, original->velocityZ };
+	CFD::VoxelData* resumedFields[] = { resumed->density, resumed->velocityX, resumed->velocityY, resumed->velocityZ };
+	for (int f = 0; f < 4; ++f)
+	{
+		size_t bytes = size_t(originalFields[f]->getArraySize()) * sizeof(float);
+		EXPECT_EQ(memcmp(originalFields[f]->getCurrentArray(), resumedFields[f]->getCurrentArray(), bytes), 0) << "Field " << f << " of the restored run diverged from the original!";
+	}
+
+	remove("solverCheckpoint.cfdckpt");
+}
+
+TEST(CFDSolver, sceneRunsHeadless) {
+
+	const char* sceneText =
+		"[grid]\n"
+		"size = 10\n"
+		"dimensions = 2\n"
+		"\n"
+		"[emitter]\n"
+		"position = 5, 2, 0\n"
+		"rate = 40\n"
+		"velocity = 0, 2, 0\n";
+
+	CFD::SceneDescription scene;
+	std::string error;
+	ASSERT_TRUE(CFD::CFDScene::parse(sceneText, "headless.ini", scene, &error)) << error;
+
+	Entity object = Entity();
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(CFD::CFDScene::apply(scene, grid, &error)) << error;
+
+	for (int i = 0; i < 3; ++i)
+		grid->Update(0.016f);
+
+	EXPECT_TRUE(grid->getSimulating());
+	EXPECT_GT(totalDensity(grid), 0.0f) << "Scene emitter added no density!";
+}
+
+TEST(CFDSolver, batchRunWritesOutputs) {
+
+	CFD::SceneDescription scene;
+	scene.size = 8;
+	scene.steps = 4;
+	scene.vtkEvery = 2;
+	scene.vtkPath = "batchRun.vti";
+	scene.checkpointPath = "batchRun.cfdckpt";
+	scene.emitters.push_back(CFD::SceneEmitter());
+	scene.emitters[0].position = Vector3(4.0f, 2.0f, 0.0f);
+	scene.emitters[0].rate = 30.0f;
+
+	CFD::BatchOptions options;
+	options.log = nullptr;
+
+	CFD::BatchReport report;
+	std::string error;
+	ASSERT_TRUE(CFD::CFDBatch::run(scene, "batchRun", report, options, &error)) << error;
+
+	EXPECT_EQ(report.steps, 4u);
+	EXPECT_EQ(report.stepMs.size(), 4u) << "Every step should be timed!";
+	EXPECT_GT(report.getStepsPerSecond(), 0.0);
+	EXPECT_DOUBLE_EQ(report.getVoxelUpdatesPerSecond(), report.getStepsPerSecond() * 64.0) << "Voxel updates should count the visible cells!";
+
+	std::vector<std::string> expected = { "batchRun_000002.vti", "batchRun_000004.vti", "batchRun.cfdckpt" };
+	EXPECT_EQ(report.outputs, expected) << "Outputs were not written at the expected steps!";
+
+	for (const std::string& path : expected)
+	{
+		FILE* file = fopen(path.c_str(), "rb");
+		EXPECT_TRUE(file != nullptr) << path << " was not written!";
+		if (file != nullptr)
+			fclose(file);
+		remove(path.c_str());
+	}
+
+	std::string json = report.toJson();
+	EXPECT_NE(json.find("\"steps\": 4,"), std::string::npos) << "Report is missing the step count!";
+	EXPECT_NE(json.find("\"outputs\": [\"batchRun_000002.vti\""), std::string::npos) << "Report is missing the outputs!";
+
+	scene.steps = 0;
+	EXPECT_FALSE(CFD::CFDBatch::run(scene, "batchRun", report, options)) << "A run without a step count should be rejected!";
+
+	EXPECT_EQ(CFD::CFDBatch::getNumberedPath("out/smoke.vti", 12), "out/smoke_000012.vti");
+	EXPECT_EQ(CFD::CFDBatch::getNumberedPath("out.d/smoke", 3), "out.d/smoke_000003");
+}
+
+TEST(CFDSolver, threadCountDoesNotChangeResults) {
+
+	// Only the pointwise kernels are split across threads, so any thread count has to give the same bits as one.
+	std::vector<float> fields[2];
+	int threadCounts[] = { 1, 4 };
+
+	for (int run = 0; run < 2; ++run)
+	{
+		Entity object = Entity();
+
+		CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+		grid->setThreadCount(threadCounts[run]);
+		ASSERT_TRUE(grid->setGrid(10, 3));
+		grid->setViscocity(0.001f);
+		grid->Start();
+
+		grid->addDensity(Vector3(5.0f, 3.0f, 5.0f), 80.0f);
+		grid->addVelocity(Vector3(5.0f, 3.0f, 5.0f), Vector3(1.0f, 2.0f, 0.5f));
+
+		for (int i = 0; i < 6; ++i)
+			grid->Update(0.016f);
+
+		CFD::CFDData* voxels = grid->getAllVoxelData();
+		CFD::VoxelData* data[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+		for (CFD::VoxelData* field : data)
+			for (int i = 0; i < field->getArraySize(); ++i)
+				fields[run].push_back(field->getCurrentValue(i));
+	}
+
+	ASSERT_EQ(fields[0].size(), fields[1].size());
+	EXPECT_EQ(memcmp(fields[0].data(), fields[1].data(), fields[0].size() * sizeof(float)), 0) << "Threaded step differs from the serial step!";
+}
+
+TEST(CFDSolver, resizeThreadCountDoesNotChangeResults) {
+
+	// Resampling splits destination rows across the pool, in 2D as well as 3D.
+	for (int dimensions = 2; dimensions <= 3; ++dimensions)
+	{
+		std::vector<float> fields[2];
+		int threadCounts[] = { 1, 4 };
+
+		for (int run = 0; run < 2; ++run)
+		{
+			Entity object = Entity();
+
+			CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+			grid->setThreadCount(threadCounts[run]);
+			ASSERT_TRUE(grid->setGrid(9, dimensions));
+			grid->Start();
+
+			grid->addDensity(Vector3(4.0f, 3.0f, (dimensions > 2) ? 4.0f : 0.0f), 80.0f);
+			grid->addVelocity(Vector3(4.0f, 3.0f, (dimensions > 2) ? 4.0f : 0.0f), Vector3(1.0f, 2.0f, 0.5f));
+			for (int i = 0; i < 3; ++i)
+				grid->Update(0.016f);
+
+			ASSERT_TRUE(grid->resize(17, CFD::ResampleFilter::Trilinear));
+			ASSERT_TRUE(grid->resize(11, CFD::ResampleFilter::Box));
+
+			CFD::CFDData* voxels = grid->getAllVoxelData();
+			CFD::VoxelData* data[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+			for (CFD::VoxelData* field : data)
+				for (int i = 0; i < field->getArraySize(); ++i)
+					fields[run].push_back(field->getCurrentValue(i));
+		}
+
+		ASSERT_EQ(fields[0].size(), fields[1].size());
+		EXPECT_EQ(memcmp(fields[0].data(), fields[1].data(), fields[0].size() * sizeof(float)), 0) << "Threaded " << dimensions << "D resize differs from the serial resize!";
+		EXPECT_GT(*std::max_element(fields[0].begin(), fields[0].end()), 0.0f) << dimensions << "D resize lost the density!";
+	}
+}
+
+TEST(CFDSolver, scalingRunsEveryThreadCount) {
+
+	CFD::SceneDescription scene;
+	scene.size = 8;
+
+	CFD::ScalingOptions options;
+	options.mode = CFD::ScalingMode::Weak;
+	options.threadCounts = { 4, 2, 2 };
+	options.steps = 2;
+	options.warmupSteps = 0;
+	options.log = nullptr;
+
+	std::vector<CFD::ScalingResult> results;
+	std::string error;
+	ASSERT_TRUE(CFD::CFDScaling::run(scene, options, results, &error)) << error;
+
+	// The single thread baseline is always added and runs first, repeated counts only run once.
+	ASSERT_EQ(results.size(), 3u);
+	EXPECT_EQ(results[0].threads, 1);
+	EXPECT_EQ(results[1].threads, 2);
+	EXPECT_EQ(results[2].threads, 4);
+	EXPECT_DOUBLE_EQ(results[0].speedup, 1.0);
+	EXPECT_DOUBLE_EQ(results[0].efficiency, 1.0);
+
+	// Weak scaling keeps the cells per thread the same.
+	EXPECT_EQ(results[1].size, 11);
+	EXPECT_EQ(results[2].size, 16);
+	EXPECT_EQ(CFD::CFDScaling::getWeakScalingSize(16, 8, 3), 32);
+
+	for (const CFD::ScalingResult& result : results)
+	{
+		EXPECT_GT(result.bandwidthGBs, 0.0);
+		EXPECT_GT(result.phaseMs.velocityMs, 0.0) << "Phase times were not recorded!";
+	}
+
+	std::string csv = CFD::CFDScaling::toCsv(results);
+	EXPECT_EQ(csv.find("mode,size,dimensions,threads,pinning,"), 0u) << "CSV is missing its header!";
+	EXPECT_NE(csv.find("\nweak,16,2,4,none,2,"), std::string::npos) << "CSV is missing the four thread run!";
+}
+
+TEST(CFDSolver, traceExportsChromeEvents) {
+
+	Trace::clear();
+	Trace::setEnabled(true);
+
+	{
+		Trace::Zone zone("testZone");
+	}
+
+	// Every thread records into its own buffer, which only keeps the newest events.
+	std::thread worker([]()
+	{
+		Trace::setThreadName("Trace \"worker\"");
+		for (size_t i = 0; i < Trace::eventsPerThread + 5; ++i)
+			Trace::record("workerZone", Trace::now(), Trace::now());
+	});
+	worker.join();
+
+	if (Trace::isCompiledIn())
+	{
+		Entity object = Entity();
+		CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+		ASSERT_TRUE(grid->setGrid(6, 2));
+		grid->Start();
+		grid->Update(0.016f);
+	}
+
+	Trace::setEnabled(false);
+
+	{
+		Trace::Zone zone("disabledZone");
+	}
+
+	EXPECT_GE(Trace::getEventCount(), Trace::eventsPerThread + 1) << "Events were lost!";
+	EXPECT_LE(Trace::getEventCount(), Trace::eventsPerThread + 1 + (Trace::isCompiledIn() ? Trace::eventsPerThread : 0)) << "Ring buffer kept too many events!";
+
+	std::string json = Trace::getChromeTraceJson();
+	EXPECT_EQ(json.find("{\"displayTimeUnit\": \"ms\", \"traceEvents\": ["), 0u);
+	EXPECT_NE(json.find("{\"name\": \"testZone\", \"cat\": \"cfd\", \"ph\": \"X\", \"ts\": "), std::string::npos) << "Zone was not exported!";
+	EXPECT_NE(json.find("\"args\": {\"name\": \"Trace \\\"worker\\\"\"}"), std::string::npos) << "Thread name was not exported!";
+	EXPECT_EQ(json.find("disabledZone"), std::string::npos) << "Zone was recorded while tracing was disabled!";
+
+	if (Trace::isCompiledIn())
+	{
+		EXPECT_NE(json.find("CFDGrid::updateDiffusion"), std::string::npos) << "Solver zones were not recorded!";
+	}
+
+	Trace::clear();
+	EXPECT_EQ(Trace::getEventCount(), 0u);
+}
+
+TEST(CFDSolver, perfCountersDegradeGracefully) {
+
+	// Opened before the grid so its workers are counted, where the platform has no counters the run must still succeed with empty samples.
+	PerfCounters counters;
+	bool open = counters.open();
+	EXPECT_FALSE(counters.getStatus().empty());
+	EXPECT_EQ(open, counters.isOpen());
+
+	Entity object = Entity();
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(grid->setGrid(12, 3));
+	grid->setPerfCounters(&counters);
+	grid->Start();
+	grid->Update(0.016f);
+
+	const CFD::StepCounters& step = grid->getLastStepCounters();
+	PerfSample total = step.getTotal();
+
+	for (int i = 0; i < int(CFD::CounterPhase::Count); ++i)
+		EXPECT_GE(step.ms[i], 0.0);
+	EXPECT_GT(step.ms[int(CFD::CounterPhase::Diffusion)], 0.0) << "Diffusion was not timed!";
+
+	for (int i = 0; i < int(PerfCounter::Count); ++i)
+	{
+		PerfCounter counter = PerfCounter(i);
+		EXPECT_EQ(total.has(counter), open && step.counts[int(CFD::CounterPhase::Diffusion)].has(counter));
+		if (!total.has(counter))
+		{
+			EXPECT_EQ(total.get(counter), 0u) << PerfCounters::getName(counter) << " counted while unavailable!";
+		}
+	}
+
+	if (open && total.has(PerfCounter::Instructions))
+	{
+		EXPECT_GT(step.counts[int(CFD::CounterPhase::Diffusion)].get(PerfCounter::Instructions), 0u) << "Diffusion counted no instructions!";
+	}
+
+	// Without counters the grid stops reading them.
+	grid->setPerfCounters(nullptr);
+	grid->Update(0.016f);
+	EXPECT_TRUE(std::isfinite(grid->getLastStepTimings().getTotalMs()));
+
+	CFD::SceneDescription scene;
+	scene.size = 8;
+	scene.steps = 2;
+
+	CFD::BatchOptions options;
+	options.writeOutputs = false;
+	options.log = nullptr;
+	options.perfCounters = true;
+
+	CFD::BatchReport report;
+	ASSERT_TRUE(CFD::CFDBatch::run(scene, "counters", report, options));
+	EXPECT_FALSE(report.counterStatus.empty());
+	EXPECT_EQ(report.stepCounters.size(), report.countersOpen ? 2u : 0u);
+	EXPECT_NE(report.toJson().find("\"counters\": {"), std::string::npos);
+	EXPECT_NE(report.toString().find("Counters:"), std::string::npos);
+}
+
+TEST(CFDSolver, rooflineCoversEveryKernel) {
+
+	// A small probe keeps the test quick, the numbers only need to be consistent rather than a true measure of the machine.
+	ThreadPool pool(2);
+	MachinePeaks peaks = MachineProbe::measure(pool, 1024 * 1024, 1);
+	EXPECT_EQ(peaks.threads, 2);
+	EXPECT_GT(peaks.getBandwidthGBs(), 0.0);
+	EXPECT_GT(peaks.gflops, 0.0);
+
+	Entity object = Entity();
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	grid->setThreadCount(2);
+	ASSERT_TRUE(grid->setGrid(16, 3));
+
+	CFD::RooflineReport report = CFD::CFDRoofline::run(*grid, peaks, 2);
+	ASSERT_EQ(report.kernels.size(), 6u);
+	EXPECT_EQ(report.threads, 2);
+
+	for (const CFD::RooflineKernel& kernel : report.kernels)
+	{
+		EXPECT_GT(kernel.bytes, 0.0) << CFD::getSolverKernelName(kernel.kernel);
+		EXPECT_GT(kernel.ms, 0.0) << CFD::getSolverKernelName(kernel.kernel);
+		EXPECT_GE(report.getPercentOfPeak(kernel), 0.0);
+		EXPECT_LE(report.getAttainableGFLOPs(kernel.getIntensity()), peaks.gflops);
+	}
+
+	// Only the kernels that do arithmetic have an intensity.
+	EXPECT_EQ(report.kernels[0].flops, 0.0);
+	EXPECT_GT(report.kernels[2].getIntensity(), 0.0);
+	EXPECT_DOUBLE_EQ(grid->getStepFlops(), 4.0 * (report.kernels[1].flops + report.kernels[2].flops + report.kernels[3].flops) + 2.0 * report.kernels[4].flops);
+
+	EXPECT_NE(report.toString().find("massConservation"), std::string::npos);
+	EXPECT_EQ(report.toJson().find("null"), std::string::npos) << "Report has a non finite number!";
+}
+
+TEST(CFDSolver, turbulenceIsReproducible) {
+
+	// Random123 known answers, so the generator gives the same bits everywhere.
+	const uint32_t counter[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+	const uint32_t key[2] = { 0xa4093822, 0x299f31d0 };
+	Philox::Block block = Philox::generate(counter, key);
+	EXPECT_EQ(block.values[0], 0xd16cfe09u);
+	EXPECT_EQ(block.values[1], 0x94fdccebu);
+	EXPECT_EQ(block.values[2], 0x5001e420u);
+	EXPECT_EQ(block.values[3], 0x24126ea1u);
+
+	EXPECT_EQ(Philox::toRange(0u, -3, 3), -3);
+	EXPECT_EQ(Philox::toRange(0xffffffffu, -3, 3), 3);
+	EXPECT_LT(Philox::toUnitFloat(0xffffffffu), 1.0f);
+
+	// Same seed on different thread counts gives the same bits, a different seed a different run.
+	const uint64_t seeds[] = { 7, 7, 8 };
+	const int threadCounts[] = { 1, 4, 1 };
+	std::vector<float> fields[3];
+
+	for (int run = 0; run < 3; ++run)
+	{
+		Entity object = Entity();
+
+		CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+		grid->setThreadCount(threadCounts[run]);
+		ASSERT_TRUE(grid->setGrid(10, 3));
+		grid->setRandomVelocityMinMax(5);
+		grid->setRandomSeed(seeds[run]);
+		grid->Start();
+
+		for (int i = 0; i < 6; ++i)
+			grid->Update(0.016f);
+
+		CFD::VoxelData* velocityX = grid->getAllVoxelData()->velocityX;
+		for (int i = 0; i < velocityX->getArraySize(); ++i)
+			fields[run].push_back(velocityX->getCurrentValue(i));
+	}
+
+	EXPECT_EQ(memcmp(fields[0].data(), fields[1].data(), fields[0].size() * sizeof(float)), 0) << "Turbulence depends on the thread count!";
+	EXPECT_NE(memcmp(fields[0].data(), fields[2].data(), fields[0].size() * sizeof(float)), 0) << "Seed has no effect!";
+}
+
+TEST(CFDSolver, curlNoiseIsDivergenceFree) {
+
+	const int N = 16;
+	CFD::TurbulenceSettings settings;
+	settings.enabled = true;
+	settings.amplitude = 2.0f;
+	settings.frequency = 2.0f;
+	settings.octaves = 3;
+
+	// Same field for any thread count.
+	std::vector<float> fields[2];
+	const int threadCounts[] = { 1, 4 };
+
+	for (int run = 0; run < 2; ++run)
+	{
+		Entity object = Entity();
+		CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+		grid->setThreadCount(threadCounts[run]);
+		ASSERT_TRUE(grid->setGrid(N, 3));
+
+		CFD::CurlNoise noise;
+		noise.apply(grid->getAllVoxelData(), N, 3, 11, 1.3f, settings, grid->getThreadPool());
+		EXPECT_EQ(noise.getStats().activeRows, N * N);
+
+		CFD::CFDData* voxels = grid->getAllVoxelData();
+		auto at = [&](CFD::VoxelData* field, int x, int y, int z) { return double(field->getCurrentValue(N * N * z + N * y + x)); };
+
+		// Central difference divergence cancels away from the edges, against velocities of order the amplitude.
+		double largestDivergence = 0.0;
+		double largestSpeed = 0.0;
+		for (int z = 1; z < N - 1; ++z)
+		{
+			for (int y = 1; y < N - 1; ++y)
+			{
+				for (int x = 1; x < N - 1; ++x)
+				{
+					double divergence = (at(voxels->velocityX, x + 1, y, z) - at(voxels->velocityX, x - 1, y, z))
+						+ (at(voxels->velocityY, x, y + 1, z) - at(voxels->velocityY, x, y - 1, z))
+						+ (at(voxels->velocityZ, x, y, z + 1) - at(voxels->velocityZ, x, y, z - 1));
+
+					largestDivergence = std::max(largestDivergence, fabs(divergence));
+					largestSpeed = std::max(largestSpeed, fabs(at(voxels->velocityX, x, y, z)));
+				}
+			}
+		}
+
+		EXPECT_GT(largestSpeed, 0.1) << "Turbulence added nothing!";
+		EXPECT_LT(largestDivergence, 1.0e-4 * largestSpeed) << "Turbulence is not divergence free!";
+
+		for (int i = 0; i < voxels->velocityY->getArraySize(); ++i)
+			fields[run].push_back(voxels->velocityY->getCurrentValue(i));
+	}
+
+	EXPECT_EQ(memcmp(fields[0].data(), fields[1].data(), fields[0].size() * sizeof(float)), 0) << "Turbulence depends on the thread count!";
+
+	// Limited to active regions only rows holding density are stirred.
+	Entity object = Entity();
+	CFD::CFDGrid* grid = object.addComponent<CFD::CFDGrid>();
+	ASSERT_TRUE(grid->setGrid(N, 2));
+	grid->getAllVoxelData()->density->setPreviousValue(N * 5 + 3, 1.0f);
+
+	settings.activeThreshold = 0.5f;
+	CFD::CurlNoise noise;
+	noise.apply(grid->getAllVoxelData(), N, 2, 11, 0.0f, settings, grid->getThreadPool());
+	EXPECT_EQ(noise.getStats().activeRows, 1);
+	EXPECT_DOUBLE_EQ(noise.getStats().getActiveFraction(), 1.0 / N);
+
+	CFD::VoxelData* velocityX = grid->getAllVoxelData()->velocityX;
+	for (int y = 0; y < N; ++y)
+	{
+		float largest = 0.0f;
+		for (int x = 0; x < N; ++x)
+			largest = std::max(largest, fabsf(velocityX->getCurrentValue(N * y + x)));
+
+		if (y == 5)
+			EXPECT_GT(largest, 0.0f) << "Active row was not stirred!";
+		else
+			EXPECT_EQ(largest, 0.0f) << "Inactive row " << y << " was stirred!";
+	}
+}
+
+TEST(CFDSolver, goldenComparisonUsesTolerances)
+{
+	EXPECT_EQ(CFD::CFDRegression::getUlpDistance(1.0f, 1.0f), 0u);
+	EXPECT_EQ(CFD::CFDRegression::getUlpDistance(1.0f, nextafterf(1.0f, 2.0f)), 1u);
+	EXPECT_EQ(CFD::CFDRegression::getUlpDistance(0.0f, -0.0f), 0u);
+	EXPECT_EQ(CFD::CFDRegression::getUlpDistance(nextafterf(0.0f, 1.0f), nextafterf(0.0f, -1.0f)), 2u) << "Distance does not cross zero!";
+	EXPECT_EQ(CFD::CFDRegression::getUlpDistance(1.0f, NAN), UINT32_MAX);
+
+	CFD::GoldenScenario scenario;
+	scenario.maxUlps = 2;
+	scenario.relativeTolerance = 1.0e-3f;
+	scenario.absoluteTolerance = 1.0e-6f;
+
+	std::vector<float> expected = { 1.0f, 100.0f, 0.0f, 5.0f, 2.0f };
+	std::vector<float> actual = { nextafterf(1.0f, 2.0f), 100.05f, 5.0e-7f, 5.1f, NAN };
+
+	CFD::GoldenFieldResult result = CFD::CFDRegression::compare("density", expected, actual, scenario);
+	EXPECT_EQ(result.cells, expected.size());
+	EXPECT_EQ(result.failures, 2u) << "Only the value 2% out and the NaN should fail!";
+	EXPECT_EQ(result.worstIndex, 4u);
+	EXPECT_NEAR(result.maxRelativeError, 0.02f, 1.0e-4f);
+
+	// Round trips through a golden file bit for bit.
+	CFD::GoldenFields fields;
+	fields.size = 2;
+	fields.dimensions = 2;
+	fields.density = { 0.0f, 1.0f, -2.5f, 3.0e-30f };
+	fields.velocityX = { 1.0f, 2.0f, 3.0f, 4.0f };
+	fields.velocityY = { -1.0f, -2.0f, -3.0f, -4.0f };
+	fields.velocityZ = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	std::string error;
+	ASSERT_TRUE(CFD::CFDRegression::writeGolden("regression_test.golden", fields, &error)) << error;
+
+	CFD::GoldenFields loaded;
+	ASSERT_TRUE(CFD::CFDRegression::readGolden("regression_test.golden", loaded, &error)) << error;
+	EXPECT_EQ(loaded.size, 2);
+	EXPECT_EQ(loaded.dimensions, 2);
+	EXPECT_EQ(memcmp(loaded.density.data(), fields.density.data(), sizeof(float) * 4), 0);
+	EXPECT_EQ(memcmp(loaded.velocityY.data(), fields.velocityY.data(), sizeof(float) * 4), 0);
+
+	fields.velocityZ.pop_back();
+	EXPECT_FALSE(CFD::CFDRegression::writeGolden("regression_test.golden", fields, &error)) << "Ragged fields were written!";
+	EXPECT_FALSE(CFD::CFDRegression::readGolden("missing.golden", loaded, &error));
+
+	remove("regression_test.golden");
+}
+
+TEST(CFDSolver, kernelsMatchReference)
+{
+	struct Setup { int size; int dimensions; CFD::FieldStorage density; CFD::FieldStorage velocity; };
+	const Setup setups[] =
+	{
+		{ 17, 3, CFD::FieldStorage::Float32, CFD::FieldStorage::Float32 },
+		{ 24, 2, CFD::FieldStorage::Float32, CFD::FieldStorage::Float32 },
+		{ 12, 3, CFD::FieldStorage::Float16, CFD::FieldStorage::BFloat16 },
+	};
+
+	for (const Setup& setup : setups)
+	{
+		CFD::KernelCheckOptions options;
+		options.size = setup.size;
+		options.dimensions = setup.dimensions;
+		options.densityStorage = setup.density;
+		options.velocityStorage = setup.velocity;
+		options.seed = 7;
+
+		// Odd thread counts split the slabs unevenly, which is where a threaded kernel goes wrong first.
+		options.threads = 3;
+
+		std::vector<CFD::KernelCheckResult> results = CFD::CFDKernelCheck::checkAll(options);
+		ASSERT_EQ(results.size(), 6u);
+
+		for (const CFD::KernelCheckResult& result : results)
+		{
+			EXPECT_EQ(result.fields.size(), 8u);
+			EXPECT_TRUE(result.passed()) << CFD::CFDKernelCheck::toString(results);
+		}
+	}
+}
+
+TEST(CFDSolver, halfArraysMatchScalarConversions)
+{
+	// Every half, the array conversion may run on F16C picked at runtime and has to give the same bits as the scalar one.
+	std::vector<uint16_t> halfs(65536);
+	for (size_t i = 0; i < halfs.size(); ++i)
+		halfs[i] = uint16_t(i);
+
+	std::vector<float> widened(halfs.size());
+	HalfFloat::halfToFloatArray(halfs.data(), widened.data(), halfs.size());
+
+	size_t widenMismatches = 0;
+	for (size_t i = 0; i < halfs.size(); ++i)
+	{
+		// The instructions quiet signalling NaNs, so NaNs only have to stay NaNs.
+		float expected = HalfFloat::halfToFloat(halfs[i]);
+		bool same = (expected != expected) ? (widened[i] != widened[i]) : (memcmp(&expected, &widened[i], sizeof(float)) == 0);
+		widenMismatches += same ? 0 : 1;
+	}
+
+	// Floats either side of every half, so both rounding directions and the ties are covered.
+	std::vector<float> floats;
+	for (float value : widened)
+	{
+		if (value == value)
+		{
+			floats.push_back(std::nextafter(value, -INFINITY));
+			floats.push_back(value);
+			floats.push_back(std::nextafter(value, INFINITY));
+		}
+	}
+
+	std::vector<uint16_t> narrowed(floats.size());
+	HalfFloat::floatToHalfArray(floats.data(), narrowed.data(), floats.size());
+
+	size_t narrowMismatches = 0;
+	for (size_t i = 0; i < floats.size(); ++i)
+		narrowMismatches += (narrowed[i] != HalfFloat::floatToHalf(floats[i])) ? 1 : 0;
+
+	EXPECT_EQ(widenMismatches, 0u) << "Array widening does not match the scalar conversion, hardware conversion " << HalfFloat::hasHardwareConversion();
+	EXPECT_EQ(narrowMismatches, 0u) << "Array narrowing does not match the scalar conversion, hardware conversion " << HalfFloat::hasHardwareConversion();
+
+	// The sweeps convert a value at a time with the instructions written out, those have to agree with the scalar conversions too.
+	if (HalfFloat::hasHardwareConversion())
+	{
+		size_t hardwareMismatches = 0;
+		for (size_t i = 0; i < halfs.size(); ++i)
+		{
+			float expected = HalfFloat::halfToFloat(halfs[i]);
+			float actual = HalfFloat::halfToFloatHardware(halfs[i]);
+			bool same = (expected != expected) ? (actual != actual) : (memcmp(&expected, &actual, sizeof(float)) == 0);
+			hardwareMismatches += same ? 0 : 1;
+		}
+
+		for (float value : floats)
+		{
+			float expected = HalfFloat::halfToFloat(HalfFloat::floatToHalf(value));
+			float rounded = HalfFloat::roundToHalfHardware(value);
+			bool same = (HalfFloat::floatToHalfHardware(value) == HalfFloat::floatToHalf(value)) && memcmp(&expected, &rounded, sizeof(float)) == 0;
+			hardwareMismatches += same ? 0 : 1;
+		}
+
+		EXPECT_EQ(hardwareMismatches, 0u) << "Single value hardware conversions do not match the scalar conversions!";
+	}
+}
+
+TEST(CFDSolver, precisionReportTimesSteps)
+{
+	CFD::PrecisionReport report = CFD::PrecisionComparison::run(12, 3, CFD::FieldStorage::Float16, CFD::FieldStorage::Float16, 5);
+
+	EXPECT_GT(report.referenceStepMs, 0.0);
+	EXPECT_GT(report.testStepMs, 0.0);
+	EXPECT_LE(report.testStepMs, report.testMs) << "The median step cannot take longer than every step together!";
+	EXPECT_GT(report.getSlowdown(), 0.0);
+	EXPECT_NE(report.toString().find("fp32"), std::string::npos) << report.toString();
+}
+
+TEST(CFDSolver, canonicalScenariosRunByName)
+{
+	CFD::CanonicalScenario scenario;
+	EXPECT_FALSE(CFD::CFDScenarioLibrary::findScenario("nonsense", scenario));
+	ASSERT_TRUE(CFD::CFDScenarioLibrary::findScenario("TAYLORGREEN", scenario));
+	EXPECT_EQ(scenario, CFD::CanonicalScenario::TaylorGreen);
+
+	CFD::ScenarioSettings settings;
+	settings.size = 16;
+	settings.threads = 2;
+
+	for (int i = 0; i < int(CFD::CanonicalScenario::Count); ++i)
+	{
+		CFD::CanonicalScenario named;
+		ASSERT_TRUE(CFD::CFDScenarioLibrary::findScenario(CFD::getCanonicalScenarioName(CFD::CanonicalScenario(i)), named));
+		EXPECT_EQ(named, CFD::CanonicalScenario(i));
+
+		// Before any step the fields are the known answer, so every error is zero.
+		Entity owner = Entity("Scenario");
+		CFD::CFDGrid* grid = owner.addComponent<CFD::CFDGrid>();
+		std::string error;
+		ASSERT_TRUE(CFD::CFDScenarioLibrary::instantiate(named, grid, settings, &error)) << error;
+
+		std::vector<CFD::ScenarioError> errors = CFD::CFDScenarioLibrary::measure(named, grid, 0);
+		EXPECT_FALSE(errors.empty());
+		for (const CFD::ScenarioError& measured : errors)
+			EXPECT_NEAR(measured.value, 0.0, 1.0e-4) << CFD::getCanonicalScenarioName(named) << " " << measured.name;
+
+		while (owner.getComponent<CFD::CFDEmitter>() != nullptr)
+			owner.removeComponent<CFD::CFDEmitter>();
+
+		owner.removeComponent<CFD::CFDGrid>();
+
+		// A short run reports its steps and a finite error for each measure.
+		settings.steps = 2;
+		CFD::ScenarioResult result = CFD::CFDScenarioLibrary::run(named, settings);
+		EXPECT_TRUE(result.problem.empty()) << result.problem;
+		EXPECT_EQ(result.stepMs.size(), 2u);
+		EXPECT_EQ(result.errors.size(), errors.size());
+		for (const CFD::ScenarioError& measured : result.errors)
+			EXPECT_TRUE(std::isfinite(measured.value)) << CFD::getCanonicalScenarioName(named) << " " << measured.name;
+
+		settings.steps = 0;
+	}
+
+	// The vortex ring is a 3D flow.
+	settings.dimensions = 2;
+	CFD::ScenarioResult flat = CFD::CFDScenarioLibrary::run(CFD::CanonicalScenario::VortexRing, settings);
+	EXPECT_FALSE(flat.problem.empty());
+}
+
+TEST(CFDSolver, inputLogDetachesFromGrid)
+{
+	CFD::SceneDescription scene;
+	scene.size = 8;
+	scene.dimensions = 2;
+
+	Entity session = Entity("Session");
+	CFD::CFDGrid* grid = session.addComponent<CFD::CFDGrid>();
+	std::string error;
+	ASSERT_TRUE(CFD::CFDScene::apply(scene, grid, &error)) << error;
+
+	// A log destroyed while recording lets go of the grid.
+	{
+		CFD::CFDInputLog log;
+		ASSERT_TRUE(log.startRecording(grid, &error)) << error;
+		EXPECT_EQ(grid->getInputLog(), &log);
+	}
+
+	EXPECT_EQ(grid->getInputLog(), nullptr) << "A destroyed log was left attached to the grid!";
+	grid->Update(grid->getTimeStep());
+
+	// A size the grid rejects changes nothing, so it is not replayed.
+	CFD::CFDInputLog log;
+	ASSERT_TRUE(log.startRecording(grid, &error)) << error;
+	size_t budget = grid->getMemoryBudget();
+	grid->setMemoryBudget(1);
+	EXPECT_FALSE(grid->setGrid(64, 3));
+	EXPECT_FALSE(grid->resize(64));
+	grid->setMemoryBudget(budget);
+	EXPECT_EQ(log.getEvents().size(), 0u) << "A rejected setGrid or resize was recorded!";
+	ASSERT_TRUE(grid->setGrid(10, 2));
+	ASSERT_EQ(log.getEvents().size(), 1u) << "A rejected setGrid was recorded!";
+	EXPECT_EQ(log.getEvents()[0].value, 10);
+
+	// A grid destroyed while recording stops the log.
+	session.removeComponent<CFD::CFDGrid>();
+	EXPECT_FALSE(log.isRecording()) << "A destroyed grid left its log recording!";
+	log.stop();
+}
+
+TEST(CFDSolver, inputLogReplaysSession)
+{
+	CFD::SceneDescription scene;
+	scene.size = 12;
+	scene.dimensions = 3;
+	scene.threads = 2;
+	scene.randomSeed = 5;
+
+	CFD::SceneEmitter source;
+	source.position = Vector3(6.0f, 2.0f, 6.0f);
+	source.velocity = Vector3(0.0f, 2.0f, 0.0f);
+	source.rate = 20.0f;
+	source.lifetime = 0.5f;
+	scene.emitters.push_back(source);
+
+	Entity session = Entity("Session");
+	CFD::CFDGrid* grid = session.addComponent<CFD::CFDGrid>();
+	std::string error;
+	ASSERT_TRUE(CFD::CFDScene::apply(scene, grid, &error)) << error;
+
+	// Steps taken before recording are thrown away, the recording starts the grid again from its scene.
+	grid->addDensity(Vector3(3, 3, 3), 100.0f);
+	grid->Update(grid->getTimeStep());
+
+	CFD::CFDInputLog log;
+	ASSERT_TRUE(log.startRecording(grid, &error)) << error;
+
+	CFD::TurbulenceSettings turbulence;
+	turbulence.enabled = true;
+	turbulence.amplitude = 3.0f;
+
+	grid->Update(grid->getTimeStep());
+	grid->addDensity(Vector3(4, 5, 6), 50.0f);
+	grid->addVelocity(Vector3(4, 5, 6), Vector3(1.0f, -2.0f, 3.0f));
+	grid->setDiffusionRate(0.25f);
+	grid->setDiffusionRate(0.25f);
+	grid->Update(grid->getTimeStep());
+	grid->setRandomVelocityMinMax(3);
+	grid->setTurbulence(turbulence);
+	grid->Update(grid->getTimeStep());
+	grid->Update(grid->getTimeStep());
+	grid->setViscocity(0.1f);
+	grid->resize(14);
+	grid->Update(grid->getTimeStep());
+	grid->addDensity(Vector3(7, 7, 7), 10.0f);
+	grid->Update(grid->getTimeStep());
+
+	log.stop();
+
+	// Setting a value it already has is not an input, and the random velocity the grid adds itself is not logged.
+	ASSERT_EQ(log.getEvents().size(), 8u);
+	EXPECT_EQ(log.getSteps(), 6u);
+	EXPECT_EQ(log.getEvents()[0].type, CFD::InputEventType::AddDensity);
+	EXPECT_EQ(log.getEvents()[0].step, 1u);
+	EXPECT_EQ(log.getEvents()[6].type, CFD::InputEventType::Resize);
+	EXPECT_EQ(log.getEvents()[6].value, 14);
+
+	ASSERT_TRUE(log.save("inputLog.cfdinput", &error)) << error;
+
+	CFD::CFDInputLog loaded;
+	ASSERT_TRUE(loaded.load("inputLog.cfdinput", &error)) << error;
+	ASSERT_EQ(loaded.getEvents().size(), log.getEvents().size());
+	EXPECT_EQ(loaded.getSteps(), log.getSteps());
+	EXPECT_EQ(loaded.getScene().emitters.size(), 1u);
+	for (size_t i = 0; i < log.getEvents().size(); ++i)
+	{
+		EXPECT_EQ(loaded.getEvents()[i].type, log.getEvents()[i].type);
+		EXPECT_EQ(loaded.getEvents()[i].step, log.getEvents()[i].step);
+	}
+
+	// A replay on a grid of its own ends on the same fields, bit for bit.
+	Entity replay = Entity("Replay");
+	CFD::CFDGrid* replayed = replay.addComponent<CFD::CFDGrid>();
+	replayed->setThreadCount(3);
+	ASSERT_TRUE(loaded.startReplay(replayed, &error)) << error;
+
+	for (uint64_t i = 0; i < loaded.getSteps(); ++i)
+		replayed->Update(replayed->getTimeStep());
+
+	EXPECT_TRUE(loaded.isFinished());
+	loaded.stop();
+
+	ASSERT_EQ(replayed->getGridWidth(), 14);
+	EXPECT_EQ(replayed->getDiffusionRate(), 0.25f);
+	EXPECT_EQ(replayed->getRandomVelocityMinMax(), 3);
+	EXPECT_TRUE(replayed->getTurbulence().enabled);
+
+	CFD::CFDData* expected = grid->getAllVoxelData();
+	CFD::CFDData* actual = replayed->getAllVoxelData();
+	CFD::VoxelData* expectedFields[] = { expected->density, expected->velocityX, expected->velocityY, expected->velocityZ };
+	CFD::VoxelData* actualFields[] = { actual->density, actual->velocityX, actual->velocityY, actual->velocityZ };
+	for (int field = 0; field < 4; ++field)
+	{
+		for (int i = 0; i < expectedFields[field]->getArraySize(); ++i)
+			ASSERT_EQ(actualFields[field]->getCurrentValue(i), expectedFields[field]->getCurrentValue(i)) << "field " << field << " index " << i;
+	}
+
+	// A log cut short is refused rather than replayed in part.
+	FILE* file = fopen("inputLog.cfdinput", "r+b");
+	ASSERT_NE(file, nullptr);
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fclose(file);
+
+	std::vector<char> bytes(size_t(length) - 3);
+	file = fopen("inputLog.cfdinput", "rb");
+	ASSERT_EQ(fread(bytes.data(), 1, bytes.size(), file), bytes.size());
+	fclose(file);
+	file = fopen("inputLog.cfdinput", "wb");
+	fwrite(bytes.data(), 1, bytes.size(), file);
+	fclose(file);
+
+	CFD::CFDInputLog truncated;
+	EXPECT_FALSE(truncated.load("inputLog.cfdinput", &error));
+
+	for (Entity* owner : { &session, &replay })
+	{
+		while (owner->getComponent<CFD::CFDEmitter>() != nullptr)
+			owner->removeComponent<CFD::CFDEmitter>();
+
+		while (owner->getComponent<CFD::CFDRecorder>() != nullptr)
+			owner->removeComponent<CFD::CFDRecorder>();
+
+		owner->removeComponent<CFD::CFDGrid>();
+	}
+
+	remove("inputLog.cfdinput");
+}
@@ -0,0 +1,298 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "Core/Components/CFD/Batch/CFDBatch.h"
+#include "Core/Components/CFD/Recording/CFDInputLog.h"
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Core/Components/CFD/Validation/CFDKernelCheck.h"
+#include "Utility/Config/IniFile.h"
+#include "Utility/Profiling/Trace.h"
+
+// Headless entry point, runs a scene for a fixed number of steps and reports how long it took.
+// Everything about the simulation comes from the scene file, the flags only override the parts that vary between runs of a study.
+
+namespace
+{
+	void printUsage()
+	{
+		printf(
+			"Usage: CFDBatch [scene.ini] [options]\n"
+			"\n"
+			"Runs a scene without a window or GPU and writes the outputs named in its [output] section.\n"
+			"\n"
+			"Options:\n"
+			"  --steps <K>         Steps to take, overrides steps in [solver].\n"
+			"  --size <N>          Grid size, overrides size in [grid].\n"
+			"  --dimensions <2|3>  Overrides dimensions in [grid].\n"
+			"  --threads <T>       Solver threads, zero uses every hardware thread.\n"
+			"  --report <path>     Writes the JSON report here, '-' prints it instead. Defaults to batch_report.json.\n"
+			"  --no-output         Skips the checkpoint and VTK outputs, for timing runs.\n"
+			"  --counters          Reads hardware counters around each solver phase, Linux only.\n"
+			"  --roofline          Measures memory bandwidth and compute peaks and reports every kernel against them.\n"
+			"  --probe-mb <MB>     Size of each bandwidth probe array, defaults to 64.\n"
+			"  --check-kernels     Checks every solver kernel against its reference on random fields at the scene's size and exits.\n"
+			"  --max-ulps <U>      Difference the kernel check lets through, defaults to 0 for identical results.\n"
+			"  --trace <path>      Records tracing zones and writes them as Chrome trace JSON, needs a build with tracing.\n"
+			"  --replay <log>      Replays an input log recorded in the app, starting from its scene and taking its steps.\n"
+			"  --quiet             Only prints the summary.\n"
+			"  --help              Prints this message.\n");
+	}
+
+	// Reads the integer after a flag. Returns false and describes the problem if it is missing or not a number.
+	bool readInt(int argc, char** argv, int& i, int& value, std::string& error)
+	{
+		if (i + 1 >= argc || !IniFile::parseInt(argv[i + 1], value))
+		{
+			error = std::string(argv[i]) + " expects a whole number";
+			return false;
+		}
+
+		i++;
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string scenePath;
+	std::string reportPath = "batch_report.json";
+	std::string tracePath;
+	std::string replayPath;
+	int steps = -1;
+	int size = -1;
+	int dimensions = -1;
+	int threads = -1;
+	bool writeOutputs = true;
+	bool quiet = false;
+	bool counters = false;
+	bool roofline = false;
+	int probeMegabytes = -1;
+	bool checkKernels = false;
+	int maxUlps = 0;
+
+	std::string error;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool parsed = true;
+
+		if (strcmp(argv[i], "--steps") == 0)
+			parsed = readInt(argc, argv, i, steps, error);
+		else if (strcmp(argv[i], "--size") == 0)
+			parsed = readInt(argc, argv, i, size, error);
+		else if (strcmp(argv[i], "--dimensions") == 0)
+			parsed = readInt(argc, argv, i, dimensions, error);
+		else if (strcmp(argv[i], "--threads") == 0)
+			parsed = readInt(argc, argv, i, threads, error);
+		else if (strcmp(argv[i], "--report") == 0)
+		{
+			if (i + 1 < argc)
+				reportPath = argv[++i];
+			else
+			{
+				error = "--report expects a path";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--trace") == 0)
+		{
+			if (i + 1 < argc)
+				tracePath = argv[++i];
+			else
+			{
+				error = "--trace expects a path";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--replay") == 0)
+		{
+			if (i + 1 < argc)
+				replayPath = argv[++i];
+			else
+			{
+				error = "--replay expects a path";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--no-output") == 0)
+			writeOutputs = false;
+		else if (strcmp(argv[i], "--counters") == 0)
+			counters = true;
+		else if (strcmp(argv[i], "--roofline") == 0)
+			roofline = true;
+		else if (strcmp(argv[i], "--probe-mb") == 0)
+			parsed = readInt(argc, argv, i, probeMegabytes, error);
+		else if (strcmp(argv[i], "--check-kernels") == 0)
+			checkKernels = true;
+		else if (strcmp(argv[i], "--max-ulps") == 0)
+			parsed = readInt(argc, argv, i, maxUlps, error);
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argv[i][0] != '-' && scenePath.empty())
+			scenePath = argv[i];
+		else
+		{
+			error = std::string("Unknown option ") + argv[i];
+			parsed = false;
+		}
+
+		if (!parsed)
+		{
+			fprintf(stderr, "%s\n\n", error.c_str());
+			printUsage();
+			return 2;
+		}
+	}
+
+	// A replay has to start from the scene the log was recorded from, only the step count and threads may change.
+	CFD::CFDInputLog inputLog;
+	if (!replayPath.empty() && (!scenePath.empty() || size >= 0 || dimensions >= 0))
+	{
+		fprintf(stderr, "--replay takes the scene from the log, leave out the scene file, --size and --dimensions\n");
+		return 2;
+	}
+
+	CFD::SceneDescription scene;
+	if (!replayPath.empty())
+	{
+		if (!inputLog.load(replayPath, &error))
+		{
+			fprintf(stderr, "%s\n", error.c_str());
+			return 1;
+		}
+
+		scene = inputLog.getScene();
+		scene.steps = int(inputLog.getSteps());
+		scenePath = replayPath;
+	}
+	else if (!scenePath.empty() && !CFD::CFDScene::load(scenePath, scene, &error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	if (steps >= 0)
+		scene.steps = steps;
+	if (size >= 0)
+		scene.size = size;
+	if (dimensions >= 0)
+		scene.dimensions = dimensions;
+	if (threads >= 0)
+		scene.threads = threads;
+
+	if (scene.dimensions != 2 && scene.dimensions != 3)
+	{
+		fprintf(stderr, "Dimensions must be 2 or 3\n");
+		return 2;
+	}
+
+	// A quick check for kernel authors, it needs no steps and leaves no outputs behind.
+	if (checkKernels)
+	{
+		CFD::KernelCheckOptions checkOptions;
+		checkOptions.size = scene.size;
+		checkOptions.dimensions = scene.dimensions;
+		checkOptions.threads = scene.threads;
+		checkOptions.densityStorage = scene.densityStorage;
+		checkOptions.velocityStorage = scene.velocityStorage;
+		checkOptions.diffusionRate = scene.diffusionRate;
+		checkOptions.seed = uint64_t(scene.randomSeed);
+		checkOptions.maxUlps = maxUlps;
+
+		std::vector<CFD::KernelCheckResult> results = CFD::CFDKernelCheck::checkAll(checkOptions);
+		printf("%s", CFD::CFDKernelCheck::toString(results).c_str());
+
+		for (const CFD::KernelCheckResult& result : results)
+		{
+			if (!result.passed())
+				return 1;
+		}
+
+		return 0;
+	}
+
+	if (!tracePath.empty() && !Trace::isCompiledIn())
+	{
+		fprintf(stderr, "--trace needs a build with tracing, configure with -DCFD_ENABLE_TRACING=ON\n");
+		return 2;
+	}
+
+	// When the report goes to stdout everything else goes to stderr, so the output can be piped straight into a JSON reader.
+	FILE* console = (reportPath == "-") ? stderr : stdout;
+
+	CFD::BatchOptions options;
+	options.writeOutputs = writeOutputs;
+	options.log = quiet ? nullptr : console;
+	options.perfCounters = counters;
+	options.roofline = roofline;
+	if (probeMegabytes > 0)
+		options.probeArrayBytes = size_t(probeMegabytes) * 1024 * 1024;
+
+	if (!replayPath.empty())
+	{
+		options.replay = &inputLog;
+		if (!quiet)
+			fprintf(console, "%s\n", inputLog.toString().c_str());
+	}
+
+	if (!tracePath.empty())
+	{
+		CFD_TRACE_THREAD_NAME("Main");
+		Trace::setEnabled(true);
+	}
+
+	CFD::BatchReport report;
+	bool succeeded = CFD::CFDBatch::run(scene, scenePath.empty() ? "defaults" : scenePath, report, options, &error);
+
+	// Missing counters only lose detail, the run still stands on its timings.
+	if (counters && !report.countersOpen)
+		fprintf(stderr, "Hardware counters unavailable: %s\n", report.counterStatus.c_str());
+
+	if (report.steps > 0)
+		fprintf(console, "\n%s", report.toString().c_str());
+
+	if (!tracePath.empty())
+	{
+		Trace::setEnabled(false);
+
+		std::string traceError;
+		if (Trace::writeChromeTrace(tracePath, &traceError))
+			fprintf(console, "Wrote trace:       %s (%zu events)\n", tracePath.c_str(), Trace::getEventCount());
+		else
+		{
+			fprintf(stderr, "%s\n", traceError.c_str());
+			succeeded = false;
+		}
+	}
+
+	if (reportPath == "-")
+	{
+		printf("%s", report.toJson().c_str());
+	}
+	else
+	{
+		FILE* file = fopen(reportPath.c_str(), "wb");
+		std::string json = report.toJson();
+		if (file == nullptr || fwrite(json.data(), 1, json.size(), file) != json.size())
+		{
+			fprintf(stderr, "Could not write the report to %s\n", reportPath.c_str());
+			succeeded = false;
+		}
+
+		if (file != nullptr)
+			fclose(file);
+	}
+
+	if (!succeeded)
+	{
+		if (!error.empty())
+			fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Batch/CFDRegression.h"
+#include "Utility/Config/IniFile.h"
+
+// Headless regression suite, runs every scenario in a golden manifest and fails if a field strays from its golden values or a step
+// runs over its time budget. With --bless it stores the current fields as the new golden values instead.
+
+namespace
+{
+	void printUsage()
+	{
+		printf(
+			"Usage: CFDRegression [options]\n"
+			"\n"
+			"Runs the scenarios in a golden manifest and compares their fields and step times against the stored goldens.\n"
+			"\n"
+			"Options:\n"
+			"  --golden <dir>          Directory holding manifest.ini, the scenes and the golden fields. Defaults to the current directory.\n"
+			"  --scenario <name>       Only runs the named scenario, may be passed more than once.\n"
+			"  --budget-scale <x>      Multiplies every time budget, for debug or instrumented builds. Zero skips the budgets.\n"
+			"  --bless                 Writes the fields of each run as its new golden values instead of comparing them.\n"
+			"  --help                  Prints this message.\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string directory;
+	std::vector<std::string> only;
+	float budgetScale = 1.0f;
+	bool blessing = false;
+
+	std::string error;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool parsed = true;
+
+		if (strcmp(argv[i], "--golden") == 0 || strcmp(argv[i], "--scenario") == 0)
+		{
+			if (i + 1 < argc)
+			{
+				if (strcmp(argv[i], "--golden") == 0)
+					directory = argv[++i];
+				else
+					only.push_back(argv[++i]);
+			}
+			else
+			{
+				error = std::string(argv[i]) + " expects a value";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--budget-scale") == 0)
+		{
+			if (i + 1 < argc && IniFile::parseFloat(argv[i + 1], budgetScale) && budgetScale >= 0.0f)
+				i++;
+			else
+			{
+				error = "--budget-scale expects a number of at least 0";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--bless") == 0)
+			blessing = true;
+		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printUsage();
+			return 0;
+		}
+		else
+		{
+			error = std::string("Unknown option ") + argv[i];
+			parsed = false;
+		}
+
+		if (!parsed)
+		{
+			fprintf(stderr, "%s\n\n", error.c_str());
+			printUsage();
+			return 2;
+		}
+	}
+
+	std::vector<CFD::GoldenScenario> scenarios;
+	if (!CFD::CFDRegression::loadManifest(directory, scenarios, &error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	for (const std::string& name : only)
+	{
+		bool listed = false;
+		for (const CFD::GoldenScenario& scenario : scenarios)
+			listed = listed || scenario.name == name;
+
+		if (!listed)
+		{
+			fprintf(stderr, "No scenario named '%s' in %s\n", name.c_str(), CFD::CFDRegression::getManifestPath(directory).c_str());
+			return 2;
+		}
+	}
+
+	int run = 0;
+	int failed = 0;
+	for (const CFD::GoldenScenario& scenario : scenarios)
+	{
+		bool selected = only.empty();
+		for (const std::string& name : only)
+			selected = selected || scenario.name == name;
+
+		if (!selected)
+			continue;
+
+		run++;
+		if (blessing)
+		{
+			CFD::GoldenFields fields;
+			double medianStepMs = 0.0;
+			if (CFD::CFDRegression::bless(scenario, directory, fields, medianStepMs, &error))
+			{
+				printf("blessed  %-20s %d^%d, %d steps, median step %.3f ms\n", scenario.name.c_str(), fields.size, fields.dimensions, scenario.steps, medianStepMs);
+			}
+			else
+			{
+				fprintf(stderr, "%s: %s\n", scenario.name.c_str(), error.c_str());
+				failed++;
+			}
+		}
+		else
+		{
+			CFD::GoldenResult result = CFD::CFDRegression::check(scenario, directory, budgetScale);
+			printf("%s", result.toString().c_str());
+
+			if (!result.passed())
+				failed++;
+		}
+	}
+
+	printf("\n%d of %d scenarios %s\n", run - failed, run, blessing ? "blessed" : "passed");
+	return (failed == 0) ? 0 : 1;
+}
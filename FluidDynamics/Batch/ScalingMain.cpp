@@ -0,0 +1,209 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Batch/CFDScaling.h"
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Utility/Config/IniFile.h"
+
+// Scaling study entry point, runs the full step of a scene over a range of thread counts and grid sizes and writes the results as CSV.
+
+namespace
+{
+	void printUsage()
+	{
+		printf(
+			"Usage: CFDScaling [scene.ini] [options]\n"
+			"\n"
+			"Times the full simulation step on 1 to every hardware thread and writes speedup, efficiency,\n"
+			"bandwidth and per phase times to CSV.\n"
+			"\n"
+			"Options:\n"
+			"  --mode <strong|weak>             Strong keeps the grid fixed, weak grows it with the thread count. Defaults to strong.\n"
+			"  --threads <T,T,...>              Thread counts to run, defaults to powers of two up to every hardware thread.\n"
+			"  --sizes <N,N,...>                Grid sizes, for weak scaling the size on one thread. Defaults to the scene's size.\n"
+			"  --dimensions <2|3>               Overrides dimensions in [grid].\n"
+			"  --steps <K>                      Timed steps per run, defaults to 20.\n"
+			"  --warmup <K>                     Untimed steps per run before timing, defaults to 2.\n"
+			"  --pin <none|compact|spread>      Ties threads to hardware threads. Defaults to none.\n"
+			"  --csv <path>                     Writes the CSV here, '-' prints it instead. Defaults to scaling.csv.\n"
+			"  --quiet                          Only writes the CSV.\n"
+			"  --help                           Prints this message.\n");
+	}
+
+	// Reads the integer after a flag. Returns false and describes the problem if it is missing or not a number.
+	bool readInt(int argc, char** argv, int& i, int& value, std::string& error)
+	{
+		if (i + 1 >= argc || !IniFile::parseInt(argv[i + 1], value))
+		{
+			error = std::string(argv[i]) + " expects a whole number";
+			return false;
+		}
+
+		i++;
+		return true;
+	}
+
+	// Reads the comma separated positive integers after a flag. Returns false and describes the problem if any is missing or not a number.
+	bool readIntList(int argc, char** argv, int& i, std::vector<int>& values, std::string& error)
+	{
+		error = std::string(argv[i]) + " expects a comma separated list of positive whole numbers";
+		if (i + 1 >= argc)
+			return false;
+
+		values.clear();
+		std::string list = argv[++i];
+		size_t start = 0;
+		while (start <= list.size())
+		{
+			size_t comma = list.find(',', start);
+			if (comma == std::string::npos)
+				comma = list.size();
+
+			int value = 0;
+			if (!IniFile::parseInt(list.substr(start, comma - start), value) || value <= 0)
+				return false;
+
+			values.push_back(value);
+			start = comma + 1;
+		}
+
+		error.clear();
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string scenePath;
+	std::string csvPath = "scaling.csv";
+	int dimensions = -1;
+	bool quiet = false;
+
+	CFD::ScalingOptions options;
+
+	std::string error;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool parsed = true;
+
+		if (strcmp(argv[i], "--mode") == 0 && i + 1 < argc)
+		{
+			std::string mode = argv[++i];
+			if (mode == "strong")
+				options.mode = CFD::ScalingMode::Strong;
+			else if (mode == "weak")
+				options.mode = CFD::ScalingMode::Weak;
+			else
+			{
+				error = "--mode expects strong or weak";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--threads") == 0)
+			parsed = readIntList(argc, argv, i, options.threadCounts, error);
+		else if (strcmp(argv[i], "--sizes") == 0)
+			parsed = readIntList(argc, argv, i, options.sizes, error);
+		else if (strcmp(argv[i], "--dimensions") == 0)
+			parsed = readInt(argc, argv, i, dimensions, error);
+		else if (strcmp(argv[i], "--steps") == 0)
+			parsed = readInt(argc, argv, i, options.steps, error);
+		else if (strcmp(argv[i], "--warmup") == 0)
+			parsed = readInt(argc, argv, i, options.warmupSteps, error);
+		else if (strcmp(argv[i], "--pin") == 0 && i + 1 < argc)
+		{
+			std::string pin = argv[++i];
+			if (pin == "none")
+				options.pinning = ThreadPinning::None;
+			else if (pin == "compact")
+				options.pinning = ThreadPinning::Compact;
+			else if (pin == "spread")
+				options.pinning = ThreadPinning::Spread;
+			else
+			{
+				error = "--pin expects none, compact or spread";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--csv") == 0)
+		{
+			if (i + 1 < argc)
+				csvPath = argv[++i];
+			else
+			{
+				error = "--csv expects a path";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--quiet") == 0)
+			quiet = true;
+		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argv[i][0] != '-' && scenePath.empty())
+			scenePath = argv[i];
+		else
+		{
+			error = std::string("Unknown option or missing value ") + argv[i];
+			parsed = false;
+		}
+
+		if (!parsed)
+		{
+			fprintf(stderr, "%s\n\n", error.c_str());
+			printUsage();
+			return 2;
+		}
+	}
+
+	CFD::SceneDescription scene;
+	if (!scenePath.empty() && !CFD::CFDScene::load(scenePath, scene, &error))
+	{
+		fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	if (dimensions >= 0)
+		scene.dimensions = dimensions;
+
+	if (scene.dimensions != 2 && scene.dimensions != 3)
+	{
+		fprintf(stderr, "Dimensions must be 2 or 3\n");
+		return 2;
+	}
+
+	// When the CSV goes to stdout the progress goes to stderr, so the output can be piped straight into a plotting script.
+	options.log = quiet ? nullptr : ((csvPath == "-") ? stderr : stdout);
+
+	std::vector<CFD::ScalingResult> results;
+	bool succeeded = CFD::CFDScaling::run(scene, options, results, &error);
+
+	std::string csv = CFD::CFDScaling::toCsv(results);
+	if (csvPath == "-")
+	{
+		printf("%s", csv.c_str());
+	}
+	else
+	{
+		FILE* file = fopen(csvPath.c_str(), "wb");
+		if (file == nullptr || fwrite(csv.data(), 1, csv.size(), file) != csv.size())
+		{
+			fprintf(stderr, "Could not write the results to %s\n", csvPath.c_str());
+			succeeded = false;
+		}
+
+		if (file != nullptr)
+			fclose(file);
+	}
+
+	if (!succeeded)
+	{
+		if (!error.empty())
+			fprintf(stderr, "%s\n", error.c_str());
+		return 1;
+	}
+
+	return 0;
+}
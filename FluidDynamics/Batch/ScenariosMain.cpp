@@ -0,0 +1,165 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Scenarios/CFDScenarioLibrary.h"
+#include "Utility/Config/IniFile.h"
+
+// Headless runner for the canonical scenarios, reports the step time of each alongside its error against the known answer.
+
+namespace
+{
+	void printUsage()
+	{
+		printf(
+			"Usage: CFDScenarios [options]\n"
+			"\n"
+			"Runs the built in scenarios and reports how long their steps took and how far the result is from the known answer.\n"
+			"\n"
+			"Options:\n"
+			"  --scenario <name>       Only runs the named scenario, may be passed more than once. Defaults to every scenario.\n"
+			"  --size <n>              Grid width. Defaults to 32.\n"
+			"  --dimensions <2|3>      Defaults to 3. The vortex ring is skipped in 2D.\n"
+			"  --steps <n>             Steps every scenario takes, defaults to each scenario's own.\n"
+			"  --threads <n>           Threads to run on, defaults to every hardware thread.\n"
+			"  --json <path>           Also writes the results as JSON here, '-' prints them instead of the table.\n"
+			"  --list                  Lists the scenarios and what each is measured against.\n"
+			"  --help                  Prints this message.\n");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	CFD::ScenarioSettings settings;
+	std::vector<CFD::CanonicalScenario> selected;
+	std::string jsonPath;
+
+	std::string error;
+	for (int i = 1; i < argc; ++i)
+	{
+		bool parsed = true;
+
+		if (strcmp(argv[i], "--scenario") == 0)
+		{
+			CFD::CanonicalScenario scenario;
+			if (i + 1 < argc && CFD::CFDScenarioLibrary::findScenario(argv[i + 1], scenario))
+			{
+				selected.push_back(scenario);
+				i++;
+			}
+			else
+			{
+				error = (i + 1 < argc) ? std::string("No scenario named ") + argv[i + 1] + ", --list shows them" : "--scenario expects a name";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--size") == 0 || strcmp(argv[i], "--steps") == 0 || strcmp(argv[i], "--threads") == 0)
+		{
+			int value = 0;
+			int minimum = (strcmp(argv[i], "--size") == 0) ? 4 : 0;
+			if (i + 1 < argc && IniFile::parseInt(argv[i + 1], value) && value >= minimum)
+			{
+				if (strcmp(argv[i], "--size") == 0)
+					settings.size = value;
+				else if (strcmp(argv[i], "--steps") == 0)
+					settings.steps = value;
+				else
+					settings.threads = value;
+
+				i++;
+			}
+			else
+			{
+				error = std::string(argv[i]) + " expects a whole number of at least " + std::to_string(minimum);
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--dimensions") == 0)
+		{
+			if (i + 1 < argc && IniFile::parseInt(argv[i + 1], settings.dimensions) && (settings.dimensions == 2 || settings.dimensions == 3))
+				i++;
+			else
+			{
+				error = "--dimensions expects 2 or 3";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--json") == 0)
+		{
+			if (i + 1 < argc)
+				jsonPath = argv[++i];
+			else
+			{
+				error = "--json expects a path";
+				parsed = false;
+			}
+		}
+		else if (strcmp(argv[i], "--list") == 0)
+		{
+			for (int s = 0; s < int(CFD::CanonicalScenario::Count); ++s)
+				printf("  %-12s %s\n", CFD::getCanonicalScenarioName(CFD::CanonicalScenario(s)), CFD::CFDScenarioLibrary::getDescription(CFD::CanonicalScenario(s)));
+
+			return 0;
+		}
+		else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0)
+		{
+			printUsage();
+			return 0;
+		}
+		else
+		{
+			error = std::string("Unknown option ") + argv[i];
+			parsed = false;
+		}
+
+		if (!parsed)
+		{
+			fprintf(stderr, "%s\n\n", error.c_str());
+			printUsage();
+			return 2;
+		}
+	}
+
+	if (selected.empty())
+	{
+		// Every scenario that fits the grid, the vortex ring is only asked for explicitly in 2D where it reports why it cannot run.
+		for (int s = 0; s < int(CFD::CanonicalScenario::Count); ++s)
+		{
+			if (CFD::CanonicalScenario(s) != CFD::CanonicalScenario::VortexRing || settings.dimensions == 3)
+				selected.push_back(CFD::CanonicalScenario(s));
+		}
+	}
+
+	// When the JSON goes to stdout the table goes to stderr, so the output can be piped straight into a JSON reader.
+	FILE* console = (jsonPath == "-") ? stderr : stdout;
+
+	std::vector<CFD::ScenarioResult> results;
+	bool succeeded = true;
+	for (CFD::CanonicalScenario scenario : selected)
+	{
+		results.push_back(CFD::CFDScenarioLibrary::run(scenario, settings));
+		succeeded = succeeded && results.back().problem.empty();
+	}
+
+	fprintf(console, "%s", CFD::CFDScenarioLibrary::toString(results).c_str());
+
+	std::string json = CFD::CFDScenarioLibrary::toJson(results);
+	if (jsonPath == "-")
+	{
+		printf("%s", json.c_str());
+	}
+	else if (!jsonPath.empty())
+	{
+		FILE* file = fopen(jsonPath.c_str(), "wb");
+		if (file == nullptr || fwrite(json.data(), 1, json.size(), file) != json.size())
+		{
+			fprintf(stderr, "Could not write the results to %s\n", jsonPath.c_str());
+			succeeded = false;
+		}
+
+		if (file != nullptr)
+			fclose(file);
+	}
+
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,432 @@
+#include "CFDBatch.h"
+#include "Core/Components/CFD/Checkpoint/CFDCheckpoint.h"
+#include "Core/Components/CFD/Export/CFDVtkExporter.h"
+#include "Core/Components/CFD/Recording/CFDInputLog.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Memory/ProcessMemory.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace CFD;
+
+namespace
+{
+	// Escapes a string for use inside JSON quotes.
+	std::string jsonString(const std::string& text)
+	{
+		std::string escaped = "\"";
+		for (char c : text)
+		{
+			switch (c)
+			{
+			case '"': escaped += "\\\""; break;
+			case '\\': escaped += "\\\\"; break;
+			case '\n': escaped += "\\n"; break;
+			case '\r': escaped += "\\r"; break;
+			case '\t': escaped += "\\t"; break;
+			default:
+				if ((unsigned char)c < 0x20)
+				{
+					char code[8];
+					snprintf(code, sizeof(code), "\\u%04x", (unsigned)(unsigned char)c);
+					escaped += code;
+				}
+				else
+				{
+					escaped += c;
+				}
+			}
+		}
+
+		return escaped + "\"";
+	}
+
+	// Formats a number for JSON, which has no representation for infinities or NaN.
+	std::string jsonNumber(double value)
+	{
+		if (!std::isfinite(value))
+			return "null";
+
+		char number[32];
+		snprintf(number, sizeof(number), "%.6g", value);
+		return number;
+	}
+
+	// Formats the counts of every available event as JSON members, unavailable ones are null.
+	std::string jsonCounts(const PerfSample& sample)
+	{
+		std::string members;
+		for (int i = 0; i < int(PerfCounter::Count); ++i)
+		{
+			PerfCounter counter = PerfCounter(i);
+			members += std::string(i > 0 ? ", " : "") + jsonString(PerfCounters::getName(counter)) + ": ";
+			members += sample.has(counter) ? std::to_string(sample.get(counter)) : "null";
+		}
+
+		return members;
+	}
+
+	// Removes every component the run added, the entity does not own them.
+	void destroyComponents(Entity& owner)
+	{
+		while (owner.getComponent<CFDEmitter>() != nullptr)
+			owner.removeComponent<CFDEmitter>();
+
+		while (owner.getComponent<CFDRecorder>() != nullptr)
+			owner.removeComponent<CFDRecorder>();
+
+		owner.removeComponent<CFDGrid>();
+	}
+}
+
+double CFD::BatchReport::getStepSeconds() const
+{
+	double totalMs = 0.0;
+	for (double ms : stepMs)
+		totalMs += ms;
+
+	return totalMs / 1000.0;
+}
+
+double CFD::BatchReport::getStepsPerSecond() const
+{
+	double seconds = getStepSeconds();
+	return seconds > 0.0 ? double(steps) / seconds : 0.0;
+}
+
+double CFD::BatchReport::getVoxelUpdatesPerSecond() const
+{
+	double cells = double(size) * double(size) * double(dimensions > 2 ? size : 1);
+	return getStepsPerSecond() * cells;
+}
+
+double CFD::BatchReport::getStepPercentileMs(double percentile) const
+{
+	if (stepMs.empty())
+		return 0.0;
+
+	std::vector<double> sorted = stepMs;
+	std::sort(sorted.begin(), sorted.end());
+
+	size_t index = size_t(std::min<double>(double(sorted.size() - 1), std::max<double>(0.0, percentile / 100.0 * double(sorted.size() - 1) + 0.5)));
+	return sorted[index];
+}
+
+std::string CFD::BatchReport::toString() const
+{
+	std::string summary;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Scene:             %s\n", sceneName.c_str());
+	summary += line;
+	snprintf(line, sizeof(line), "Grid:              %d^%d, %d threads, density %s, velocity %s\n", size, dimensions, threads,
+		getFieldStorageName(densityStorage), getFieldStorageName(velocityStorage));
+	summary += line;
+	snprintf(line, sizeof(line), "Steps:             %llu in %.3f s (%.3f s total, %.1f ms setup, %.1f ms output)\n",
+		(unsigned long long)steps, getStepSeconds(), totalSeconds, setupMs, outputMs);
+	summary += line;
+	snprintf(line, sizeof(line), "Step time:         min %.3f ms, median %.3f ms, p95 %.3f ms, max %.3f ms\n",
+		getStepPercentileMs(0.0), getStepPercentileMs(50.0), getStepPercentileMs(95.0), getStepPercentileMs(100.0));
+	summary += line;
+	snprintf(line, sizeof(line), "Throughput:        %.2f steps/s, %.3f Mvoxel-updates/s\n", getStepsPerSecond(), getVoxelUpdatesPerSecond() / 1.0e6);
+	summary += line;
+	snprintf(line, sizeof(line), "Peak RSS:          %.1f MB\n", double(peakResidentBytes) / (1024.0 * 1024.0));
+	summary += line;
+
+	if (framesRecorded > 0 || framesDropped > 0)
+	{
+		snprintf(line, sizeof(line), "Recording:         %llu frames written, %llu dropped\n", (unsigned long long)framesRecorded, (unsigned long long)framesDropped);
+		summary += line;
+	}
+
+	if (!counterStatus.empty())
+	{
+		summary += "Counters:          " + counterStatus + "\n";
+
+		if (countersOpen)
+		{
+			snprintf(line, sizeof(line), "  %-20s %10s %8s %14s %6s %10s %10s %10s\n", "phase", "ms", "share", "instructions", "IPC", "LLC/ki", "dTLB/ki", "branch/ki");
+			summary += line;
+
+			double stepMs = 0.0;
+			for (double ms : counterTotals.ms)
+				stepMs += ms;
+
+			for (int i = 0; i <= int(CounterPhase::Count); ++i)
+			{
+				bool total = (i == int(CounterPhase::Count));
+				PerfSample sample = total ? counterTotals.getTotal() : counterTotals.counts[i];
+				double ms = total ? stepMs : counterTotals.ms[i];
+
+				snprintf(line, sizeof(line), "  %-20s %10.3f %7.1f%% %14llu %6.2f %10.3f %10.3f %10.3f\n", total ? "step" : getCounterPhaseName(CounterPhase(i)),
+					ms, stepMs > 0.0 ? 100.0 * ms / stepMs : 0.0, (unsigned long long)sample.get(PerfCounter::Instructions), sample.getIPC(),
+					sample.getPerKiloInstruction(PerfCounter::LLCMisses), sample.getPerKiloInstruction(PerfCounter::DTLBMisses),
+					sample.getPerKiloInstruction(PerfCounter::BranchMisses));
+				summary += line;
+			}
+		}
+	}
+
+	if (hasRoofline)
+		summary += roofline.toString();
+
+	for (const std::string& output : outputs)
+		summary += "Wrote:             " + output + "\n";
+
+	return summary;
+}
+
+std::string CFD::BatchReport::toJson() const
+{
+	std::string json = "{\n";
+
+	json += "  \"scene\": " + jsonString(sceneName) + ",\n";
+	json += "  \"size\": " + std::to_string(size) + ",\n";
+	json += "  \"dimensions\": " + std::to_string(dimensions) + ",\n";
+	json += "  \"threads\": " + std::to_string(threads) + ",\n";
+	json += "  \"densityStorage\": " + jsonString(getFieldStorageName(densityStorage)) + ",\n";
+	json += "  \"velocityStorage\": " + jsonString(getFieldStorageName(velocityStorage)) + ",\n";
+	json += "  \"steps\": " + std::to_string(steps) + ",\n";
+	json += "  \"setupMs\": " + jsonNumber(setupMs) + ",\n";
+	json += "  \"outputMs\": " + jsonNumber(outputMs) + ",\n";
+	json += "  \"stepSeconds\": " + jsonNumber(getStepSeconds()) + ",\n";
+	json += "  \"totalSeconds\": " + jsonNumber(totalSeconds) + ",\n";
+	json += "  \"stepsPerSecond\": " + jsonNumber(getStepsPerSecond()) + ",\n";
+	json += "  \"voxelUpdatesPerSecond\": " + jsonNumber(getVoxelUpdatesPerSecond()) + ",\n";
+	json += "  \"stepMsMin\": " + jsonNumber(getStepPercentileMs(0.0)) + ",\n";
+	json += "  \"stepMsMedian\": " + jsonNumber(getStepPercentileMs(50.0)) + ",\n";
+	json += "  \"stepMsP95\": " + jsonNumber(getStepPercentileMs(95.0)) + ",\n";
+	json += "  \"stepMsMax\": " + jsonNumber(getStepPercentileMs(100.0)) + ",\n";
+	json += "  \"peakResidentBytes\": " + std::to_string(peakResidentBytes) + ",\n";
+	json += "  \"framesRecorded\": " + std::to_string(framesRecorded) + ",\n";
+	json += "  \"framesDropped\": " + std::to_string(framesDropped) + ",\n";
+
+	json += "  \"outputs\": [";
+	for (size_t i = 0; i < outputs.size(); ++i)
+		json += (i > 0 ? ", " : "") + jsonString(outputs[i]);
+	json += "],\n";
+
+	json += "  \"stepMs\": [";
+	for (size_t i = 0; i < stepMs.size(); ++i)
+		json += (i > 0 ? ", " : "") + jsonNumber(stepMs[i]);
+	json += "]";
+
+	if (!counterStatus.empty())
+	{
+		json += ",\n  \"counters\": {\n";
+		json += "    \"open\": " + std::string(countersOpen ? "true" : "false") + ",\n";
+		json += "    \"status\": " + jsonString(counterStatus) + ",\n";
+
+		json += "    \"phases\": [";
+		for (int i = 0; i < int(CounterPhase::Count) && countersOpen; ++i)
+		{
+			json += std::string(i > 0 ? "," : "") + "\n      {\"name\": " + jsonString(getCounterPhaseName(CounterPhase(i)));
+			json += ", \"ms\": " + jsonNumber(counterTotals.ms[i]) + ", " + jsonCounts(counterTotals.counts[i]) + "}";
+		}
+		json += countersOpen ? "\n    ],\n" : "],\n";
+
+		json += "    \"steps\": [";
+		for (size_t i = 0; i < stepCounters.size(); ++i)
+			json += std::string(i > 0 ? "," : "") + "\n      {" + jsonCounts(stepCounters[i]) + "}";
+		json += stepCounters.empty() ? "]\n" : "\n    ]\n";
+
+		json += "  }";
+	}
+
+	if (hasRoofline)
+		json += ",\n  \"roofline\": " + roofline.toJson();
+
+	json += "\n";
+
+	json += "}\n";
+	return json;
+}
+
+bool CFD::CFDBatch::run(const SceneDescription& scene, const std::string& sceneName, BatchReport& report, const BatchOptions& options, std::string* error)
+{
+	Stopwatch totalTimer;
+
+	report = BatchReport();
+	report.sceneName = sceneName;
+
+	if (scene.steps <= 0)
+	{
+		if (error != nullptr)
+			*error = "A batch run needs a step count, set steps in [solver] or pass one in";
+		return false;
+	}
+
+	// Opened before the grid exists, the counters only follow threads started after them and the grid starts its workers on creation.
+	PerfCounters counters;
+	if (options.perfCounters)
+	{
+		report.countersOpen = counters.open();
+		report.counterStatus = counters.getStatus();
+		if (report.countersOpen)
+			report.stepCounters.reserve(size_t(scene.steps));
+	}
+
+	Entity owner = Entity("Batch");
+	CFDGrid* grid = owner.addComponent<CFDGrid>();
+	if (report.countersOpen)
+		grid->setPerfCounters(&counters);
+
+	Stopwatch setupTimer;
+	if (!CFDScene::apply(scene, grid, error))
+	{
+		destroyComponents(owner);
+		return false;
+	}
+	report.setupMs = setupTimer.getElapsedMilliseconds();
+
+	if (options.replay != nullptr)
+		options.replay->beginReplay(grid);
+
+	report.size = grid->getGridWidth();
+	report.dimensions = grid->getDimensions();
+	report.threads = grid->getThreadCount();
+	report.densityStorage = grid->getDensityStorage();
+	report.velocityStorage = grid->getVelocityStorage();
+	report.stepMs.reserve(size_t(scene.steps));
+
+	CFDVtkExporter exporter;
+	exporter.setThreadCount(scene.threads);
+
+	VtkExportSettings exportSettings;
+	exportSettings.compress = scene.vtkCompress;
+	exportSettings.exportVelocity = scene.vtkVelocity;
+	exportSettings.spacing = scene.vtkSpacing;
+
+	std::string failure;
+
+	// Exports run on the exporter's thread while the grid keeps stepping, only the snapshot and the wait for the previous export count against the loop.
+	auto exportStep = [&](uint64_t step)
+	{
+		Stopwatch outputTimer;
+		std::string path = (scene.vtkEvery > 0) ? getNumberedPath(scene.vtkPath, step) : scene.vtkPath;
+
+		if (exporter.getPath().size() > 0 && !exporter.finish() && failure.empty())
+			failure = "Could not write " + exporter.getPath();
+
+		if (exporter.start(grid, path, exportSettings))
+			report.outputs.push_back(path);
+		else if (failure.empty())
+			failure = "Could not start exporting to " + path;
+
+		report.outputMs += outputTimer.getElapsedMilliseconds();
+	};
+
+	for (int i = 0; i < scene.steps && failure.empty(); ++i)
+	{
+		Stopwatch stepTimer;
+		grid->Update(grid->getTimeStep());
+		double ms = stepTimer.getElapsedMilliseconds();
+
+		report.stepMs.push_back(ms);
+		report.steps++;
+
+		if (report.countersOpen)
+		{
+			const StepCounters& stepCounters = grid->getLastStepCounters();
+			for (int phase = 0; phase < int(CounterPhase::Count); ++phase)
+			{
+				report.counterTotals.counts[phase] += stepCounters.counts[phase];
+				report.counterTotals.ms[phase] += stepCounters.ms[phase];
+			}
+
+			PerfSample step = stepCounters.getTotal();
+			report.stepCounters.push_back(step);
+
+			if (options.log != nullptr)
+				fprintf(options.log, "step %d/%d  %.3f ms  IPC %.2f  LLC %.2f/ki  dTLB %.2f/ki  branch %.2f/ki\n", i + 1, scene.steps, ms, step.getIPC(),
+					step.getPerKiloInstruction(PerfCounter::LLCMisses), step.getPerKiloInstruction(PerfCounter::DTLBMisses),
+					step.getPerKiloInstruction(PerfCounter::BranchMisses));
+		}
+		else if (options.log != nullptr)
+		{
+			fprintf(options.log, "step %d/%d  %.3f ms\n", i + 1, scene.steps, ms);
+		}
+
+		bool lastStep = (i + 1 == scene.steps);
+		if (options.writeOutputs && (lastStep || (scene.vtkEvery > 0 && (i + 1) % scene.vtkEvery == 0)))
+			exportStep(grid->getStepCount());
+	}
+
+	if (options.replay != nullptr)
+		options.replay->stop();
+
+	if (options.writeOutputs)
+	{
+		Stopwatch outputTimer;
+
+		if (exporter.getPath().size() > 0 && !exporter.finish() && failure.empty())
+			failure = "Could not write " + exporter.getPath();
+
+		std::string checkpointError;
+		if (failure.empty())
+		{
+			if (CFDCheckpoint::save(grid, scene.checkpointPath, &checkpointError))
+				report.outputs.push_back(scene.checkpointPath);
+			else
+				failure = checkpointError;
+		}
+
+		report.outputMs += outputTimer.getElapsedMilliseconds();
+	}
+
+	CFDRecorder* recorder = owner.getComponent<CFDRecorder>();
+	if (recorder != nullptr && recorder->isRecording())
+	{
+		std::string recordingPath = recorder->getPath();
+		bool recorded = recorder->stop();
+
+		RecorderStats stats = recorder->getStats();
+		report.framesRecorded = stats.framesWritten;
+		report.framesDropped = stats.framesDropped;
+
+		if (recorded)
+			report.outputs.push_back(recordingPath);
+		else if (failure.empty())
+			failure = "Could not write " + recordingPath;
+	}
+
+	// Last, running the kernels on their own changes the fields the outputs above were written from.
+	if (options.roofline && failure.empty())
+	{
+		if (options.log != nullptr)
+			fprintf(options.log, "measuring machine peaks and kernel rates\n");
+
+		MachinePeaks peaks = MachineProbe::measure(grid->getThreadPool(), options.probeArrayBytes);
+		report.roofline = CFDRoofline::run(*grid, peaks);
+		report.hasRoofline = true;
+	}
+
+	destroyComponents(owner);
+
+	report.peakResidentBytes = ProcessMemory::getPeakResidentBytes();
+	report.totalSeconds = totalTimer.getElapsedSeconds();
+
+	if (!failure.empty())
+	{
+		if (error != nullptr)
+			*error = failure;
+		return false;
+	}
+
+	return true;
+}
+
+std::string CFD::CFDBatch::getNumberedPath(const std::string& path, uint64_t step)
+{
+	char number[32];
+	snprintf(number, sizeof(number), "_%06llu", (unsigned long long)step);
+
+	// Only a dot after the last directory separator starts an extension.
+	size_t separator = path.find_last_of("/\\");
+	size_t dot = path.find_last_of('.');
+	if (dot == std::string::npos || (separator != std::string::npos && dot < separator))
+		return path + number;
+
+	return path.substr(0, dot) + number + path.substr(dot);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Batch/CFDRoofline.h"
+
+namespace CFD
+{
+	// How a batch run reports and what it writes, the simulation itself is described by the scene.
+	struct BatchOptions
+	{
+		bool writeOutputs = true;			// Writes the checkpoint and VTK files named in the scene's [output] section.
+		FILE* log = stdout;					// Per step timings and progress are printed here, nullptr runs silently.
+		bool perfCounters = false;			// Reads hardware counters around each solver phase, where the platform has them.
+		bool roofline = false;				// Measures the machine peaks and places every kernel on a roofline once stepping is done.
+		size_t probeArrayBytes = MachineProbe::defaultArrayBytes;	// Size of each array of the bandwidth probe.
+		CFDInputLog* replay = nullptr;		// Replays its inputs into the steps, the scene should be the one the log starts from.
+	};
+
+	// Timings and outputs of a batch run.
+	struct BatchReport
+	{
+		std::string sceneName;
+		int size = 0;
+		int dimensions = 0;
+		int threads = 0;
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+
+		uint64_t steps = 0;
+		std::vector<double> stepMs;			// Time each call to CFDGrid::Update took.
+		double setupMs = 0.0;				// Time spent allocating the grid and applying the scene.
+		double outputMs = 0.0;				// Time the stepping loop spent starting exports and waiting on them.
+		double totalSeconds = 0.0;			// Wall clock time of the whole run, setup and outputs included.
+		size_t peakResidentBytes = 0;
+
+		uint64_t framesRecorded = 0;
+		uint64_t framesDropped = 0;
+		std::vector<std::string> outputs;	// Every file the run wrote.
+
+		bool countersOpen = false;			// True if hardware counters were read, the fields below are empty otherwise.
+		std::string counterStatus;			// What counted, or why nothing did.
+		StepCounters counterTotals;			// Counts and time of each phase summed over every step.
+		std::vector<PerfSample> stepCounters;	// Counts of each whole step.
+
+		bool hasRoofline = false;
+		RooflineReport roofline;			// Kernel rates against the machine peaks, with the run's grid size, storage and threads.
+
+		// Returns the time spent stepping in seconds, outputs excluded.
+		double getStepSeconds() const;
+
+		// Returns simulation steps per second of stepping.
+		double getStepsPerSecond() const;
+
+		// Returns visible cells advanced per second of stepping.
+		double getVoxelUpdatesPerSecond() const;
+
+		// Returns the passed in percentile of the step times in milliseconds.
+		double getStepPercentileMs(double percentile) const;
+
+		// Returns a human readable summary of the run.
+		std::string toString() const;
+
+		// Returns the run as a JSON object, per step timings included.
+		std::string toJson() const;
+	};
+
+	// Runs a scene for a fixed number of steps without a window or device, for scripted runs, parameter studies and performance tracking.
+	// The grid is stepped through CFDGrid::Update exactly as the app steps it, so emitters and recording behave the same.
+	class CFDBatch
+	{
+	public:
+
+		// Applies the scene to a fresh grid and takes scene.steps steps, writing the outputs the scene asks for.
+		// Returns false and describes the problem if the scene could not be applied or an output could not be written.
+		static bool run(const SceneDescription& scene, const std::string& sceneName, BatchReport& report, const BatchOptions& options = BatchOptions(), std::string* error = nullptr);
+
+		// Returns the passed in path with the step number inserted before its extension, used when a run exports more than once.
+		static std::string getNumberedPath(const std::string& path, uint64_t step);
+	};
+}
@@ -0,0 +1,392 @@
+#include "CFDRegression.h"
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Config/IniFile.h"
+#include "Utility/File/AtomicFile.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace CFD;
+
+namespace
+{
+	const char GoldenMagic[8] = { 'C', 'F', 'D', 'G', 'O', 'L', 'D', '\0' };
+	const uint32_t GoldenVersion = 1;
+	const uint32_t GoldenEndianMarker = 0x01020304;
+	const uint32_t GoldenFieldCount = 4;
+
+	// Fixed header at the start of a golden file, the fields follow it in GoldenFields order.
+	struct GoldenHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t endianMarker;
+		int32_t size;
+		int32_t dimensions;
+		uint32_t fieldCount;
+		uint32_t reserved;
+		uint64_t cells;
+	};
+
+	bool goldenProblem(std::string* error, const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+
+		return false;
+	}
+
+	// Copies the current values of the simulated cells out of a field.
+	void takeField(VoxelData* field, size_t cells, std::vector<float>& values)
+	{
+		values.resize(cells);
+		for (size_t i = 0; i < cells; ++i)
+			values[i] = field->getCurrentValue(int(i));
+	}
+
+	void removeRegressionComponents(Entity& owner)
+	{
+		while (owner.getComponent<CFDEmitter>() != nullptr)
+			owner.removeComponent<CFDEmitter>();
+
+		while (owner.getComponent<CFDRecorder>() != nullptr)
+			owner.removeComponent<CFDRecorder>();
+
+		owner.removeComponent<CFDGrid>();
+	}
+}
+
+std::string CFD::GoldenResult::toString() const
+{
+	std::string summary;
+	char line[512];
+
+	const char* verdict = passed() ? "pass" : "FAIL";
+	if (!problem.empty())
+	{
+		snprintf(line, sizeof(line), "%s  %-20s %s\n", verdict, scenario.name.c_str(), problem.c_str());
+		return line;
+	}
+
+	if (allowedMs > 0.0)
+		snprintf(line, sizeof(line), "%s  %-20s %d steps, median step %.3f ms of %.3f ms budget%s\n", verdict, scenario.name.c_str(), scenario.steps,
+			medianStepMs, allowedMs, withinBudget ? "" : ", OVER BUDGET");
+	else
+		snprintf(line, sizeof(line), "%s  %-20s %d steps, median step %.3f ms, no budget\n", verdict, scenario.name.c_str(), scenario.steps, medianStepMs);
+	summary += line;
+
+	for (const GoldenFieldResult& field : fields)
+	{
+		if (field.failures == 0)
+			continue;
+
+		snprintf(line, sizeof(line), "      %-10s %zu of %zu cells out of tolerance, max %u ulps, max abs %.3g, max rel %.3g, worst cell %zu expected %.9g got %.9g\n",
+			field.name.c_str(), field.failures, field.cells, field.maxUlps, field.maxAbsoluteError, field.maxRelativeError, field.worstIndex,
+			field.worstExpected, field.worstActual);
+		summary += line;
+	}
+
+	return summary;
+}
+
+bool CFD::CFDRegression::loadManifest(const std::string& directory, std::vector<GoldenScenario>& scenarios, std::string* error)
+{
+	IniFile file;
+	if (!file.load(getManifestPath(directory), error))
+		return false;
+
+	scenarios.clear();
+	for (const IniSection& section : file.getSections())
+	{
+		if (section.name != "scenario")
+			return goldenProblem(error, file.describe(section.line, "unknown section [" + section.name + "], the manifest only holds [scenario] sections"));
+
+		GoldenScenario scenario;
+		for (const IniValue& value : section.values)
+		{
+			bool parsed = true;
+			std::string expected;
+
+			if (value.key == "name" || value.key == "scene")
+			{
+				parsed = !value.value.empty();
+				expected = "a non empty string";
+				(value.key == "name" ? scenario.name : scenario.scenePath) = value.value;
+			}
+			else if (value.key == "steps" || value.key == "maxUlps")
+			{
+				int parsedValue = 0;
+				parsed = IniFile::parseInt(value.value, parsedValue) && parsedValue >= (value.key == "steps" ? 1 : 0);
+				expected = (value.key == "steps") ? "a whole number of at least 1" : "a whole number of at least 0";
+				(value.key == "steps" ? scenario.steps : scenario.maxUlps) = parsedValue;
+			}
+			else if (value.key == "relativeTolerance" || value.key == "absoluteTolerance" || value.key == "budgetMs")
+			{
+				float parsedValue = 0.0f;
+				parsed = IniFile::parseFloat(value.value, parsedValue) && parsedValue >= 0.0f;
+				expected = "a number of at least 0";
+
+				if (value.key == "relativeTolerance")
+					scenario.relativeTolerance = parsedValue;
+				else if (value.key == "absoluteTolerance")
+					scenario.absoluteTolerance = parsedValue;
+				else
+					scenario.budgetMs = parsedValue;
+			}
+			else
+			{
+				return goldenProblem(error, file.describe(value.line, "unknown key '" + value.key + "' in [scenario]"));
+			}
+
+			if (!parsed)
+				return goldenProblem(error, file.describe(value.line, "'" + value.key + "' must be " + expected + ", not '" + value.value + "'"));
+		}
+
+		if (scenario.name.empty() || scenario.scenePath.empty() || scenario.steps <= 0)
+			return goldenProblem(error, file.describe(section.line, "a [scenario] needs a name, a scene and steps"));
+
+		for (const GoldenScenario& other : scenarios)
+		{
+			if (other.name == scenario.name)
+				return goldenProblem(error, file.describe(section.line, "scenario '" + scenario.name + "' is listed twice"));
+		}
+
+		scenarios.push_back(scenario);
+	}
+
+	if (scenarios.empty())
+		return goldenProblem(error, getManifestPath(directory) + ": lists no scenarios");
+
+	return true;
+}
+
+bool CFD::CFDRegression::runScenario(const GoldenScenario& scenario, const std::string& directory, GoldenFields& fields, double& medianStepMs, std::string* error)
+{
+	SceneDescription scene;
+	if (!CFDScene::load(joinPath(directory, scenario.scenePath), scene, error))
+		return false;
+
+	// Goldens check the solver, a scene asking to record would only leave files behind.
+	scene.record = false;
+
+	Entity owner = Entity("Regression");
+	CFDGrid* grid = owner.addComponent<CFDGrid>();
+	if (!CFDScene::apply(scene, grid, error))
+	{
+		removeRegressionComponents(owner);
+		return false;
+	}
+
+	std::vector<double> stepMs;
+	stepMs.reserve(size_t(scenario.steps));
+	for (int i = 0; i < scenario.steps; ++i)
+	{
+		Stopwatch stepTimer;
+		grid->Update(grid->getTimeStep());
+		stepMs.push_back(stepTimer.getElapsedMilliseconds());
+	}
+
+	// The median rather than the mean, so a single step lost to the scheduler does not fail the budget.
+	std::sort(stepMs.begin(), stepMs.end());
+	medianStepMs = stepMs[stepMs.size() / 2];
+
+	int N = grid->getGridWidth();
+	fields.size = N;
+	fields.dimensions = grid->getDimensions();
+
+	size_t cells = size_t(N) * size_t(N) * size_t(fields.dimensions > 2 ? N : 1);
+	CFDData* voxels = grid->getAllVoxelData();
+	takeField(voxels->density, cells, fields.density);
+	takeField(voxels->velocityX, cells, fields.velocityX);
+	takeField(voxels->velocityY, cells, fields.velocityY);
+	takeField(voxels->velocityZ, cells, fields.velocityZ);
+
+	removeRegressionComponents(owner);
+	return true;
+}
+
+GoldenResult CFD::CFDRegression::check(const GoldenScenario& scenario, const std::string& directory, double budgetScale)
+{
+	GoldenResult result;
+	result.scenario = scenario;
+
+	GoldenFields golden;
+	if (!readGolden(getGoldenPath(directory, scenario.name), golden, &result.problem))
+		return result;
+
+	GoldenFields actual;
+	if (!runScenario(scenario, directory, actual, result.medianStepMs, &result.problem))
+		return result;
+
+	if (actual.size != golden.size || actual.dimensions != golden.dimensions)
+	{
+		result.problem = "ran at " + std::to_string(actual.size) + "^" + std::to_string(actual.dimensions) + " but the golden fields are " +
+			std::to_string(golden.size) + "^" + std::to_string(golden.dimensions) + ", bless it again if the scene changed on purpose";
+		return result;
+	}
+
+	result.fields.push_back(compare("density", golden.density, actual.density, scenario));
+	result.fields.push_back(compare("velocityX", golden.velocityX, actual.velocityX, scenario));
+	result.fields.push_back(compare("velocityY", golden.velocityY, actual.velocityY, scenario));
+	result.fields.push_back(compare("velocityZ", golden.velocityZ, actual.velocityZ, scenario));
+
+	result.withinTolerance = true;
+	for (const GoldenFieldResult& field : result.fields)
+		result.withinTolerance = result.withinTolerance && field.failures == 0;
+
+	result.allowedMs = scenario.budgetMs * budgetScale;
+	result.withinBudget = (result.allowedMs <= 0.0) || (result.medianStepMs <= result.allowedMs);
+	return result;
+}
+
+bool CFD::CFDRegression::bless(const GoldenScenario& scenario, const std::string& directory, GoldenFields& fields, double& medianStepMs, std::string* error)
+{
+	return runScenario(scenario, directory, fields, medianStepMs, error) && writeGolden(getGoldenPath(directory, scenario.name), fields, error);
+}
+
+GoldenFieldResult CFD::CFDRegression::compare(const std::string& name, const std::vector<float>& expected, const std::vector<float>& actual, const GoldenScenario& scenario)
+{
+	GoldenFieldResult result;
+	result.name = name;
+	result.cells = std::min(expected.size(), actual.size());
+
+	// Cells only one side has can never match.
+	result.failures = std::max(expected.size(), actual.size()) - result.cells;
+
+	uint32_t worstUlps = 0;
+	bool worstFailed = false;
+	for (size_t i = 0; i < result.cells; ++i)
+	{
+		float reference = expected[i];
+		float value = actual[i];
+
+		uint32_t ulps = getUlpDistance(reference, value);
+		float absoluteError = fabsf(value - reference);
+		float relativeError = (reference != 0.0f) ? absoluteError / fabsf(reference) : (absoluteError > 0.0f ? INFINITY : 0.0f);
+
+		bool failed = (ulps > uint32_t(scenario.maxUlps)) && !(absoluteError <= scenario.absoluteTolerance || relativeError <= scenario.relativeTolerance);
+
+		result.maxUlps = std::max(result.maxUlps, ulps);
+		if (!std::isnan(absoluteError))
+			result.maxAbsoluteError = std::max(result.maxAbsoluteError, absoluteError);
+		if (reference != 0.0f && !std::isnan(relativeError))
+			result.maxRelativeError = std::max(result.maxRelativeError, relativeError);
+
+		if (failed)
+			result.failures++;
+
+		// A failing cell is always worth more than one that passed, however far the passing one strayed.
+		if ((failed && !worstFailed) || (failed == worstFailed && ulps > worstUlps) || i == 0)
+		{
+			worstFailed = failed;
+			worstUlps = ulps;
+			result.worstIndex = i;
+			result.worstExpected = reference;
+			result.worstActual = value;
+		}
+	}
+
+	return result;
+}
+
+uint32_t CFD::CFDRegression::getUlpDistance(float a, float b)
+{
+	uint32_t bitsA;
+	uint32_t bitsB;
+	memcpy(&bitsA, &a, sizeof(bitsA));
+	memcpy(&bitsB, &b, sizeof(bitsB));
+
+	if (bitsA == bitsB)
+		return 0;
+
+	if (std::isnan(a) || std::isnan(b))
+		return UINT32_MAX;
+
+	// Maps the sign and magnitude bits onto a line where neighbouring floats are neighbouring integers, with both zeros at the same point.
+	auto toOrdered = [](uint32_t bits) { return (bits & 0x80000000u) ? -int64_t(bits & 0x7FFFFFFFu) : int64_t(bits); };
+
+	int64_t distance = toOrdered(bitsA) - toOrdered(bitsB);
+	return uint32_t(std::min<int64_t>(distance < 0 ? -distance : distance, int64_t(UINT32_MAX)));
+}
+
+bool CFD::CFDRegression::readGolden(const std::string& path, GoldenFields& fields, std::string* error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return goldenProblem(error, "Could not open " + path + ", run CFDRegression --bless to create it");
+
+	GoldenHeader header = {};
+	bool readHeader = fread(&header, sizeof(header), 1, file) == 1;
+
+	std::string problem;
+	if (!readHeader || memcmp(header.magic, GoldenMagic, sizeof(GoldenMagic)) != 0)
+		problem = path + " is not a golden fields file";
+	else if (header.endianMarker != GoldenEndianMarker)
+		problem = path + " was written on a machine of the other byte order";
+	else if (header.version != GoldenVersion)
+		problem = path + " is version " + std::to_string(header.version) + ", this build reads version " + std::to_string(GoldenVersion);
+	else if (header.fieldCount != GoldenFieldCount || header.size <= 0 || (header.dimensions != 2 && header.dimensions != 3) ||
+		header.cells != uint64_t(header.size) * uint64_t(header.size) * uint64_t(header.dimensions > 2 ? header.size : 1))
+		problem = path + " has a malformed header";
+
+	if (problem.empty())
+	{
+		fields.size = header.size;
+		fields.dimensions = header.dimensions;
+
+		std::vector<float>* values[] = { &fields.density, &fields.velocityX, &fields.velocityY, &fields.velocityZ };
+		for (std::vector<float>* field : values)
+		{
+			field->resize(size_t(header.cells));
+			if (problem.empty() && fread(field->data(), sizeof(float), field->size(), file) != field->size())
+				problem = path + " is truncated";
+		}
+	}
+
+	fclose(file);
+	return problem.empty() || goldenProblem(error, problem);
+}
+
+bool CFD::CFDRegression::writeGolden(const std::string& path, const GoldenFields& fields, std::string* error)
+{
+	GoldenHeader header = {};
+	memcpy(header.magic, GoldenMagic, sizeof(GoldenMagic));
+	header.version = GoldenVersion;
+	header.endianMarker = GoldenEndianMarker;
+	header.size = fields.size;
+	header.dimensions = fields.dimensions;
+	header.fieldCount = GoldenFieldCount;
+	header.cells = fields.density.size();
+
+	const std::vector<float>* values[] = { &fields.density, &fields.velocityX, &fields.velocityY, &fields.velocityZ };
+	for (const std::vector<float>* field : values)
+	{
+		if (field->size() != header.cells)
+			return goldenProblem(error, "Every golden field must hold the same number of cells");
+	}
+
+	AtomicFile file;
+	if (!file.open(path))
+		return goldenProblem(error, "Could not create " + path);
+
+	bool written = file.write(&header, sizeof(header));
+	for (const std::vector<float>* field : values)
+		written = written && file.write(field->data(), field->size() * sizeof(float));
+
+	if (!written || !file.commit())
+		return goldenProblem(error, "Could not write " + path);
+
+	return true;
+}
+
+std::string CFD::CFDRegression::joinPath(const std::string& directory, const std::string& file)
+{
+	bool absolute = (!file.empty() && (file[0] == '/' || file[0] == '\\')) || (file.size() > 1 && file[1] == ':');
+	if (directory.empty() || absolute)
+		return file;
+
+	char last = directory.back();
+	return (last == '/' || last == '\\') ? directory + file : directory + "/" + file;
+}
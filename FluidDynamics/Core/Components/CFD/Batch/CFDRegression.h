@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace CFD
+{
+	// A canonical scenario from the golden manifest, with the tolerances and time budget its run is held to.
+	struct GoldenScenario
+	{
+		std::string name;					// Also names the golden fields, <name>.golden next to the manifest.
+		std::string scenePath;				// Scene file the run starts from, relative to the manifest.
+		int steps = 0;
+		int maxUlps = 4;					// A value within this many representable floats of the golden one passes.
+		float relativeTolerance = 0.0f;		// Otherwise it passes within this share of the golden value,
+		float absoluteTolerance = 0.0f;		// or within this distance, for values near zero where a share means nothing.
+		double budgetMs = 0.0;				// Median step time allowed, zero does not check the time.
+	};
+
+	// Fields a golden run is compared on, the current values of the simulated cells after the last step.
+	struct GoldenFields
+	{
+		int size = 0;
+		int dimensions = 0;
+		std::vector<float> density;
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> velocityZ;
+	};
+
+	// How far one field of a run strayed from its golden values.
+	struct GoldenFieldResult
+	{
+		std::string name;
+		size_t cells = 0;
+		size_t failures = 0;				// Values outside every tolerance.
+		uint32_t maxUlps = 0;
+		float maxAbsoluteError = 0.0f;
+		float maxRelativeError = 0.0f;
+		size_t worstIndex = 0;				// Cell with the largest ULP distance among the failures, or overall if none failed.
+		float worstExpected = 0.0f;
+		float worstActual = 0.0f;
+	};
+
+	// Outcome of running one scenario against its golden fields.
+	struct GoldenResult
+	{
+		GoldenScenario scenario;
+		bool withinTolerance = false;
+		bool withinBudget = false;
+		double medianStepMs = 0.0;
+		double allowedMs = 0.0;				// Budget after scaling, zero if the scenario has none.
+		std::vector<GoldenFieldResult> fields;
+		std::string problem;				// Set if the scenario could not be run or compared at all.
+
+		bool passed() const { return problem.empty() && withinTolerance && withinBudget; }
+
+		// Returns a human readable summary, with a line per field that failed.
+		std::string toString() const;
+	};
+
+	// Regression suite of seeded scenarios whose fields after a fixed number of steps must match stored golden values.
+	// The manifest is an INI file with one [scenario] section per scenario. Each run is also timed, the median step must fit the
+	// scenario's budget, so a change that keeps the results but slows the solver down fails as well.
+	class CFDRegression
+	{
+	public:
+
+		// Reads the manifest in the passed in directory. Returns false and describes the first problem if it could not be read.
+		static bool loadManifest(const std::string& directory, std::vector<GoldenScenario>& scenarios, std::string* error = nullptr);
+
+		// Runs the scenario and takes the fields after its last step, along with the median step time.
+		static bool runScenario(const GoldenScenario& scenario, const std::string& directory, GoldenFields& fields, double& medianStepMs, std::string* error = nullptr);
+
+		// Runs the scenario and compares it against its golden fields. Budgets are multiplied by budgetScale, for slower builds.
+		static GoldenResult check(const GoldenScenario& scenario, const std::string& directory, double budgetScale = 1.0);
+
+		// Runs the scenario and stores its fields as the new golden values.
+		static bool bless(const GoldenScenario& scenario, const std::string& directory, GoldenFields& fields, double& medianStepMs, std::string* error = nullptr);
+
+		// Compares a field against its golden values under the scenario's tolerances.
+		static GoldenFieldResult compare(const std::string& name, const std::vector<float>& expected, const std::vector<float>& actual, const GoldenScenario& scenario);
+
+		// Returns how many representable floats lie between the two values, the maximum if either is NaN unless both are the same NaN.
+		static uint32_t getUlpDistance(float a, float b);
+
+		// Golden fields are raw floats after a short header, in the writer's byte order. A reader of the other order refuses them.
+		static bool readGolden(const std::string& path, GoldenFields& fields, std::string* error = nullptr);
+		static bool writeGolden(const std::string& path, const GoldenFields& fields, std::string* error = nullptr);
+
+		// Returns the manifest path in the passed in directory.
+		static std::string getManifestPath(const std::string& directory) { return joinPath(directory, "manifest.ini"); }
+
+		// Returns the golden fields path of a scenario in the passed in directory.
+		static std::string getGoldenPath(const std::string& directory, const std::string& name) { return joinPath(directory, name + ".golden"); }
+
+		// Returns the file relative to the directory, or the file itself if it is already absolute.
+		static std::string joinPath(const std::string& directory, const std::string& file);
+	};
+}
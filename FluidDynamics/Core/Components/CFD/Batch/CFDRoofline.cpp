@@ -0,0 +1,136 @@
+#include "CFDRoofline.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace CFD;
+
+namespace
+{
+	// Formats a number for the roofline JSON, which has no representation for infinities or NaN.
+	std::string rooflineNumber(double value)
+	{
+		if (!std::isfinite(value))
+			return "null";
+
+		char number[32];
+		snprintf(number, sizeof(number), "%.6g", value);
+		return number;
+	}
+}
+
+double CFD::RooflineReport::getAttainableGFLOPs(double intensity) const
+{
+	return std::min(peaks.gflops, intensity * peaks.getBandwidthGBs());
+}
+
+double CFD::RooflineReport::getPercentOfPeak(const RooflineKernel& kernel) const
+{
+	if (kernel.flops <= 0.0)
+		return (peaks.getBandwidthGBs() > 0.0) ? 100.0 * kernel.getGBs() / peaks.getBandwidthGBs() : 0.0;
+
+	double attainable = getAttainableGFLOPs(kernel.getIntensity());
+	return (attainable > 0.0) ? 100.0 * kernel.getGFLOPs() / attainable : 0.0;
+}
+
+std::string CFD::RooflineReport::toString() const
+{
+	std::string summary;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Roofline:          %d^%d, %d threads, density %s, velocity %s\n", size, dimensions, threads,
+		getFieldStorageName(densityStorage), getFieldStorageName(velocityStorage));
+	summary += line;
+	summary += peaks.toString();
+
+	snprintf(line, sizeof(line), "  %-20s %10s %10s %10s %10s %8s %9s\n", "kernel", "ms", "flops/B", "GB/s", "GFLOP/s", "% peak", "bound");
+	summary += line;
+
+	for (const RooflineKernel& kernel : kernels)
+	{
+		snprintf(line, sizeof(line), "  %-20s %10.3f %10.3f %10.2f %10.2f %7.1f%% %9s\n", getSolverKernelName(kernel.kernel), kernel.ms,
+			kernel.getIntensity(), kernel.getGBs(), kernel.getGFLOPs(), getPercentOfPeak(kernel), isBandwidthBound(kernel) ? "bandwidth" : "compute");
+		summary += line;
+	}
+
+	return summary;
+}
+
+std::string CFD::RooflineReport::toJson() const
+{
+	std::string json = "{\n";
+
+	json += "    \"size\": " + std::to_string(size) + ",\n";
+	json += "    \"dimensions\": " + std::to_string(dimensions) + ",\n";
+	json += "    \"threads\": " + std::to_string(threads) + ",\n";
+	json += "    \"copyGBs\": " + rooflineNumber(peaks.copyGBs) + ",\n";
+	json += "    \"scaleGBs\": " + rooflineNumber(peaks.scaleGBs) + ",\n";
+	json += "    \"addGBs\": " + rooflineNumber(peaks.addGBs) + ",\n";
+	json += "    \"triadGBs\": " + rooflineNumber(peaks.triadGBs) + ",\n";
+	json += "    \"peakGFLOPs\": " + rooflineNumber(peaks.gflops) + ",\n";
+	json += "    \"ridgeIntensity\": " + rooflineNumber(peaks.getRidgeIntensity()) + ",\n";
+
+	json += "    \"kernels\": [";
+	for (size_t i = 0; i < kernels.size(); ++i)
+	{
+		const RooflineKernel& kernel = kernels[i];
+		json += std::string(i > 0 ? "," : "") + "\n      {\"name\": \"" + getSolverKernelName(kernel.kernel) + "\"";
+		json += ", \"ms\": " + rooflineNumber(kernel.ms);
+		json += ", \"bytes\": " + rooflineNumber(kernel.bytes);
+		json += ", \"flops\": " + rooflineNumber(kernel.flops);
+		json += ", \"intensity\": " + rooflineNumber(kernel.getIntensity());
+		json += ", \"GBs\": " + rooflineNumber(kernel.getGBs());
+		json += ", \"GFLOPs\": " + rooflineNumber(kernel.getGFLOPs());
+		json += ", \"percentOfPeak\": " + rooflineNumber(getPercentOfPeak(kernel));
+		json += ", \"bound\": \"" + std::string(isBandwidthBound(kernel) ? "bandwidth" : "compute") + "\"}";
+	}
+	json += kernels.empty() ? "]\n" : "\n    ]\n";
+
+	json += "  }";
+	return json;
+}
+
+RooflineReport CFD::CFDRoofline::run(CFDGrid& grid, const MachinePeaks& peaks, int repeats)
+{
+	RooflineReport report;
+	report.size = grid.getGridWidth();
+	report.dimensions = grid.getDimensions();
+	report.threads = grid.getThreadCount();
+	report.densityStorage = grid.getDensityStorage();
+	report.velocityStorage = grid.getVelocityStorage();
+	report.peaks = peaks;
+
+	size_t densityBytes = getFieldStorageBytes(report.densityStorage);
+	size_t velocityBytes = getFieldStorageBytes(report.velocityStorage);
+
+	const SolverKernel kernels[] = { SolverKernel::Reset, SolverKernel::UpdateFromPrevious, SolverKernel::Diffusion,
+		SolverKernel::Advection, SolverKernel::MassConservation, SolverKernel::Boundary };
+
+	for (SolverKernel kernel : kernels)
+	{
+		RooflineKernel result;
+		result.kernel = kernel;
+
+		// runKernel works on the density for every kernel but mass conservation, which only touches the velocity.
+		size_t fieldBytes = (kernel == SolverKernel::MassConservation) ? velocityBytes : densityBytes;
+		result.bytes = CFDGrid::getKernelBytes(kernel, report.size, report.dimensions, fieldBytes, velocityBytes);
+		result.flops = CFDGrid::getKernelFlops(kernel, report.size, report.dimensions);
+
+		// One untimed run so the first timed one does not pay for starting the pool's workers or faulting pages in.
+		grid.runKernel(kernel);
+
+		for (int repeat = 0; repeat < std::max(repeats, 1); ++repeat)
+		{
+			Stopwatch timer;
+			grid.runKernel(kernel);
+			double ms = timer.getElapsedMilliseconds();
+
+			result.ms = (repeat == 0) ? ms : std::min(result.ms, ms);
+		}
+
+		report.kernels.push_back(result);
+	}
+
+	return report;
+}
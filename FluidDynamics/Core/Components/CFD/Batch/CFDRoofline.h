@@ -0,0 +1,60 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Profiling/MachineProbe.h"
+
+namespace CFD
+{
+	// Work and best time of a single kernel run.
+	struct RooflineKernel
+	{
+		SolverKernel kernel = SolverKernel::Reset;
+		double bytes = 0.0;					// Least bytes moved, see CFDGrid::getKernelBytes.
+		double flops = 0.0;					// See CFDGrid::getKernelFlops.
+		double ms = 0.0;					// Best time over the repeats.
+
+		double getGBs() const { return (ms > 0.0) ? bytes / (ms / 1000.0) / 1.0e9 : 0.0; }
+		double getGFLOPs() const { return (ms > 0.0) ? flops / (ms / 1000.0) / 1.0e9 : 0.0; }
+
+		// Returns flops per byte moved.
+		double getIntensity() const { return (bytes > 0.0) ? flops / bytes : 0.0; }
+	};
+
+	// Attained rates of every solver kernel against the machine's ceilings.
+	struct RooflineReport
+	{
+		int size = 0;
+		int dimensions = 0;
+		int threads = 0;
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+		MachinePeaks peaks;
+		std::vector<RooflineKernel> kernels;
+
+		// Returns the GFLOP/s the roofline allows at the passed in intensity, the lower of the compute and bandwidth ceilings.
+		double getAttainableGFLOPs(double intensity) const;
+
+		// Returns the share of the roofline a kernel reaches. A kernel that does no flops is measured against the bandwidth ceiling alone.
+		double getPercentOfPeak(const RooflineKernel& kernel) const;
+
+		// Returns true if the kernel sits left of the ridge point, where bandwidth rather than compute is its ceiling.
+		bool isBandwidthBound(const RooflineKernel& kernel) const { return kernel.getIntensity() < peaks.getRidgeIntensity(); }
+
+		// Returns a human readable table of the report.
+		std::string toString() const;
+
+		// Returns the report as a JSON object.
+		std::string toJson() const;
+	};
+
+	// Times every solver kernel on a grid and places it on a roofline of the measured machine peaks.
+	// Diffusion and mass conservation run their sweeps on one thread, so against the peaks of several threads they are expected to fall short.
+	class CFDRoofline
+	{
+	public:
+
+		// Runs every kernel repeats times on the grid through CFDGrid::runKernel, keeping the best time. The grid's fields are changed.
+		static RooflineReport run(CFDGrid& grid, const MachinePeaks& peaks, int repeats = 5);
+	};
+}
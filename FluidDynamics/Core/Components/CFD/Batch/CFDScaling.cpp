@@ -0,0 +1,211 @@
+#include "CFDScaling.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace CFD;
+
+namespace
+{
+	// Removes every component applying the scene added, the entity does not own them.
+	void removeRunComponents(Entity& owner)
+	{
+		while (owner.getComponent<CFDEmitter>() != nullptr)
+			owner.removeComponent<CFDEmitter>();
+
+		while (owner.getComponent<CFDRecorder>() != nullptr)
+			owner.removeComponent<CFDRecorder>();
+
+		owner.removeComponent<CFDGrid>();
+	}
+
+	// Returns the visible cells of a grid.
+	double getCells(int size, int dimensions)
+	{
+		return double(size) * double(size) * double(dimensions > 2 ? size : 1);
+	}
+
+	// Returns the scene at the passed in size and thread count, emitters moved and grown with the grid so every size sees the same flow.
+	SceneDescription getRunScene(const SceneDescription& scene, int size, int threads)
+	{
+		SceneDescription runScene = scene;
+		runScene.size = size;
+		runScene.threads = threads;
+		runScene.record = false;
+
+		float scale = (scene.size > 0) ? float(size) / float(scene.size) : 1.0f;
+		for (SceneEmitter& emitter : runScene.emitters)
+		{
+			emitter.position = emitter.position * scale;
+			emitter.size = emitter.size * scale;
+		}
+
+		return runScene;
+	}
+
+	// Appends a number to a CSV row.
+	void addNumber(std::string& row, double value, const char* format = "%.6g")
+	{
+		char number[32];
+		snprintf(number, sizeof(number), format, value);
+		row += ",";
+		row += number;
+	}
+}
+
+bool CFD::CFDScaling::run(const SceneDescription& scene, const ScalingOptions& options, std::vector<ScalingResult>& results, std::string* error)
+{
+	if (options.steps <= 0)
+	{
+		if (error != nullptr)
+			*error = "A scaling run needs at least one timed step";
+		return false;
+	}
+
+	// The single thread run is the baseline every other count is measured against, so it always runs and always runs first.
+	std::vector<int> threadCounts = options.threadCounts.empty() ? getDefaultThreadCounts() : options.threadCounts;
+	threadCounts.erase(std::remove_if(threadCounts.begin(), threadCounts.end(), [](int threads) { return threads <= 1; }), threadCounts.end());
+	std::sort(threadCounts.begin(), threadCounts.end());
+	threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+	threadCounts.insert(threadCounts.begin(), 1);
+
+	std::vector<int> sizes = options.sizes.empty() ? std::vector<int>(1, scene.size) : options.sizes;
+
+	for (int baseSize : sizes)
+	{
+		double baselineMs = 0.0;
+		double baselineCells = 0.0;
+
+		for (int threads : threadCounts)
+		{
+			int size = (options.mode == ScalingMode::Weak) ? getWeakScalingSize(baseSize, threads, scene.dimensions) : baseSize;
+			SceneDescription runScene = getRunScene(scene, size, threads);
+
+			Entity owner = Entity("Scaling");
+			CFDGrid* grid = owner.addComponent<CFDGrid>();
+			grid->getThreadPool().setPinning(options.pinning);
+
+			// The calling thread runs the first range of every loop, so it is pinned alongside the workers.
+			if (options.pinning != ThreadPinning::None)
+				ThreadPool::pinCurrentThread(grid->getThreadPool().getPinnedHardwareThread(0));
+
+			if (!CFDScene::apply(runScene, grid, error))
+			{
+				removeRunComponents(owner);
+				return false;
+			}
+
+			for (int i = 0; i < options.warmupSteps; ++i)
+				grid->Update(grid->getTimeStep());
+
+			std::vector<double> stepMs;
+			stepMs.reserve(size_t(options.steps));
+
+			ScalingResult result;
+			for (int i = 0; i < options.steps; ++i)
+			{
+				Stopwatch stepTimer;
+				grid->Update(grid->getTimeStep());
+				stepMs.push_back(stepTimer.getElapsedMilliseconds());
+
+				const StepTimings& timings = grid->getLastStepTimings();
+				result.phaseMs.resetMs += timings.resetMs / options.steps;
+				result.phaseMs.sourcesMs += timings.sourcesMs / options.steps;
+				result.phaseMs.velocityMs += timings.velocityMs / options.steps;
+				result.phaseMs.densityMs += timings.densityMs / options.steps;
+				result.phaseMs.recordMs += timings.recordMs / options.steps;
+			}
+
+			std::sort(stepMs.begin(), stepMs.end());
+
+			result.mode = options.mode;
+			result.size = grid->getGridWidth();
+			result.dimensions = grid->getDimensions();
+			result.threads = grid->getThreadCount();
+			result.pinning = options.pinning;
+			result.steps = options.steps;
+			result.stepMsMedian = stepMs[stepMs.size() / 2];
+			result.stepMsMin = stepMs.front();
+
+			double cells = getCells(result.size, result.dimensions);
+			if (threads == 1)
+			{
+				baselineMs = result.stepMsMedian;
+				baselineCells = cells;
+			}
+
+			// Weak scaling does more work with every thread, so the speedup counts the work done per unit of time rather than the time alone.
+			double workRatio = (options.mode == ScalingMode::Weak && baselineCells > 0.0) ? cells / baselineCells : 1.0;
+			result.speedup = (result.stepMsMedian > 0.0) ? baselineMs / result.stepMsMedian * workRatio : 0.0;
+			result.efficiency = result.speedup / double(result.threads);
+			result.bandwidthGBs = (result.stepMsMedian > 0.0) ? grid->getStepBytes() / (result.stepMsMedian / 1000.0) / 1.0e9 : 0.0;
+
+			removeRunComponents(owner);
+			results.push_back(result);
+
+			if (options.log != nullptr)
+			{
+				fprintf(options.log, "%s %d^%d on %2d threads: %9.3f ms/step, speedup %6.2f, efficiency %5.1f%%, %7.2f GB/s\n",
+					getModeName(result.mode), result.size, result.dimensions, result.threads, result.stepMsMedian,
+					result.speedup, result.efficiency * 100.0, result.bandwidthGBs);
+			}
+		}
+	}
+
+	return true;
+}
+
+int CFD::CFDScaling::getWeakScalingSize(int baseSize, int threads, int dimensions)
+{
+	double growth = std::pow(double(std::max<int>(threads, 1)), 1.0 / double(dimensions > 2 ? 3 : 2));
+	return std::max<int>(1, int(std::lround(baseSize * growth)));
+}
+
+std::vector<int> CFD::CFDScaling::getDefaultThreadCounts()
+{
+	int hardwareThreads = ThreadPool::getHardwareThreadCount();
+
+	std::vector<int> counts;
+	for (int threads = 1; threads < hardwareThreads; threads *= 2)
+		counts.push_back(threads);
+	counts.push_back(hardwareThreads);
+
+	return counts;
+}
+
+std::string CFD::CFDScaling::toCsv(const std::vector<ScalingResult>& results)
+{
+	std::string csv = "mode,size,dimensions,threads,pinning,steps,step_ms_median,step_ms_min,speedup,efficiency,bandwidth_gbs,"
+		"reset_ms,sources_ms,velocity_ms,density_ms,record_ms\n";
+
+	for (const ScalingResult& result : results)
+	{
+		std::string row = getModeName(result.mode);
+		row += "," + std::to_string(result.size);
+		row += "," + std::to_string(result.dimensions);
+		row += "," + std::to_string(result.threads);
+		row += std::string(",") + ThreadPool::getPinningName(result.pinning);
+		row += "," + std::to_string(result.steps);
+
+		addNumber(row, result.stepMsMedian);
+		addNumber(row, result.stepMsMin);
+		addNumber(row, result.speedup, "%.4f");
+		addNumber(row, result.efficiency, "%.4f");
+		addNumber(row, result.bandwidthGBs, "%.4f");
+		addNumber(row, result.phaseMs.resetMs);
+		addNumber(row, result.phaseMs.sourcesMs);
+		addNumber(row, result.phaseMs.velocityMs);
+		addNumber(row, result.phaseMs.densityMs);
+		addNumber(row, result.phaseMs.recordMs);
+
+		csv += row + "\n";
+	}
+
+	return csv;
+}
+
+const char* CFD::CFDScaling::getModeName(ScalingMode mode)
+{
+	return (mode == ScalingMode::Weak) ? "weak" : "strong";
+}
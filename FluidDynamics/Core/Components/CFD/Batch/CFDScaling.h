@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Utility/Threading/ThreadPool.h"
+
+namespace CFD
+{
+	// Strong scaling keeps the grid fixed as threads are added, weak scaling grows it so every thread keeps the same number of cells.
+	enum class ScalingMode
+	{
+		Strong = 0,
+		Weak,
+	};
+
+	// What a scaling study runs, the rest of the simulation is described by the scene.
+	struct ScalingOptions
+	{
+		ScalingMode mode = ScalingMode::Strong;
+		std::vector<int> threadCounts;		// Empty runs 1, 2, 4 ... up to every hardware thread.
+		std::vector<int> sizes;				// Grid sizes for strong scaling, or the size on one thread for weak scaling. Empty uses the scene's size.
+		int steps = 20;						// Timed steps per run.
+		int warmupSteps = 2;				// Untimed steps per run before timing starts.
+		ThreadPinning pinning = ThreadPinning::None;
+		FILE* log = stdout;					// Progress is printed here, nullptr runs silently.
+	};
+
+	// Timings of a single thread count and grid size.
+	struct ScalingResult
+	{
+		ScalingMode mode = ScalingMode::Strong;
+		int size = 0;
+		int dimensions = 0;
+		int threads = 0;
+		ThreadPinning pinning = ThreadPinning::None;
+		int steps = 0;
+
+		double stepMsMedian = 0.0;
+		double stepMsMin = 0.0;
+		double speedup = 0.0;				// Time on one thread over this time, for weak scaling scaled by the growth in cells.
+		double efficiency = 0.0;			// Speedup over threads, one is perfect scaling.
+		double bandwidthGBs = 0.0;			// Least bytes a step moves over the median step time, see CFDGrid::getStepBytes.
+		StepTimings phaseMs;				// Mean time of each phase per step.
+	};
+
+	// Runs the full CFDGrid::Update step over a range of thread counts and grid sizes to find where the solver stops scaling.
+	class CFDScaling
+	{
+	public:
+
+		// Runs every thread count for every size, appending one result each. The single thread run of a size is always taken first as the baseline.
+		// Returns false and describes the problem if a grid could not be set up.
+		static bool run(const SceneDescription& scene, const ScalingOptions& options, std::vector<ScalingResult>& results, std::string* error = nullptr);
+
+		// Returns the grid size that gives threads times the cells of baseSize, rounded to the nearest size.
+		static int getWeakScalingSize(int baseSize, int threads, int dimensions);
+
+		// Returns the thread counts a study runs when none are given, powers of two up to every hardware thread and that count itself.
+		static std::vector<int> getDefaultThreadCounts();
+
+		// Returns the results as CSV with a header row.
+		static std::string toCsv(const std::vector<ScalingResult>& results);
+
+		// Returns a display name for the passed in mode.
+		static const char* getModeName(ScalingMode mode);
+	};
+}
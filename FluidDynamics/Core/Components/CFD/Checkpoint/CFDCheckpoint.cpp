@@ -0,0 +1,354 @@
+#include "CFDCheckpoint.h"
+#include "Utility/File/AtomicFile.h"
+#include "Utility/File/MappedFile.h"
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+using namespace CFD;
+
+const char CFDCheckpoint::Magic[8] = { 'C', 'F', 'D', 'C', 'K', 'P', 'T', '\0' };
+
+namespace
+{
+	const char* CheckpointFieldNames[CFDCheckpoint::FieldCount] =
+	{
+		"Density Current", "Density Previous",
+		"VelocityX Current", "VelocityX Previous",
+		"VelocityY Current", "VelocityY Previous",
+		"VelocityZ Current", "VelocityZ Previous",
+	};
+
+	uint64_t alignOffset(uint64_t offset, uint64_t alignment)
+	{
+		return ((offset + alignment - 1) / alignment) * alignment;
+	}
+
+	bool fail(std::string* error, const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+
+		return false;
+	}
+}
+
+bool CFD::CFDCheckpoint::save(CFDGrid* grid, const std::string& path, std::string* error, const WaveletSettings* lossy)
+{
+	CFDData* voxels = grid->getAllVoxelData();
+	if (voxels == nullptr)
+		return fail(error, "Grid has no data to checkpoint.");
+
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+
+	CheckpointHeader header = {};
+	memcpy(header.magic, Magic, sizeof(header.magic));
+	header.version = Version;
+	header.headerBytes = sizeof(CheckpointHeader);
+	header.endianMarker = EndianMarker;
+	header.N = grid->getGridWidth();
+	header.dimensions = grid->getDimensions();
+	header.totalN = voxels->density->getArraySize();
+	header.diffusionRate = grid->getDiffusionRate();
+	header.viscocity = grid->getViscocity();
+	header.timeStep = grid->getTimeStep();
+	header.randomVelocityMinMax = grid->getRandomVelocityMinMax();
+	header.payloadAlignment = PayloadAlignment;
+	header.fieldCount = FieldCount;
+
+	const TurbulenceSettings& turbulence = grid->getTurbulence();
+	header.randomSeed = grid->getRandomSeed();
+	header.stepCount = grid->getStepCount();
+	header.turbulenceEnabled = turbulence.enabled ? 1 : 0;
+	header.turbulenceOctaves = turbulence.octaves;
+	header.turbulenceAmplitude = turbulence.amplitude;
+	header.turbulenceFrequency = turbulence.frequency;
+	header.turbulenceEvolution = turbulence.evolution;
+	header.turbulenceActiveThreshold = turbulence.activeThreshold;
+
+	// Sources are added again on every step, so they are state of the run just like the fields.
+	std::vector<CheckpointSource> sources;
+	for (const QueueItem<float>& density : grid->getQueuedDensities())
+	{
+		sources.push_back({ { density.pos.x, density.pos.y, density.pos.z }, { density.value, 0.0f, 0.0f } });
+	}
+
+	for (const QueueItem<Vector3>& velocity : grid->getQueuedVelocities())
+	{
+		sources.push_back({ { velocity.pos.x, velocity.pos.y, velocity.pos.z }, { velocity.value.x, velocity.value.y, velocity.value.z } });
+	}
+
+	header.sourcesOffset = sizeof(CheckpointHeader);
+	header.densitySourceCount = uint32_t(grid->getQueuedDensities().size());
+	header.velocitySourceCount = uint32_t(grid->getQueuedVelocities().size());
+
+	// Compressed payloads are encoded up front so the offset of every payload after them is known.
+	std::vector<std::vector<unsigned char>> encoded(FieldCount);
+	std::vector<float> values;
+
+	// Lay the payloads out back to back, each starting on its own page.
+	const void* payloads[FieldCount];
+	uint64_t offset = alignOffset(header.sourcesOffset + sources.size() * sizeof(CheckpointSource), PayloadAlignment);
+	for (uint32_t i = 0; i < FieldCount; ++i)
+	{
+		VoxelData* field = fields[i / 2];
+		CheckpointField& entry = header.fields[i];
+
+		strncpy(entry.name, CheckpointFieldNames[i], sizeof(entry.name) - 1);
+		entry.storage = uint32_t(field->getStorage());
+		entry.codec = uint32_t(lossy != nullptr ? CheckpointCodec::Wavelet : CheckpointCodec::None);
+		entry.offset = offset;
+		entry.bytes = uint64_t(getFieldStorageBytes(field->getStorage())) * uint64_t(field->getArraySize());
+
+		payloads[i] = (i % 2 == 0) ? field->getCurrentRawArray() : field->getPreviousRawArray();
+
+		if (lossy != nullptr)
+		{
+			values.resize(size_t(field->getArraySize()));
+			widenFieldArray(field->getStorage(), payloads[i], values.data(), values.size());
+
+			encoded[i].resize(Wavelet::compressBound(values.size()));
+			entry.bytes = Wavelet::compress(values.data(), header.N, header.N, header.totalN, *lossy, encoded[i].data(), encoded[i].size(), &grid->getThreadPool());
+			if (entry.bytes == 0)
+				return fail(error, "Failed compressing " + std::string(CheckpointFieldNames[i]));
+
+			payloads[i] = encoded[i].data();
+		}
+
+		offset = alignOffset(offset + entry.bytes, PayloadAlignment);
+	}
+
+	header.fileBytes = offset;
+
+	AtomicFile file;
+	if (!file.open(path))
+		return fail(error, "Could not create " + AtomicFile::getTemporaryPath(path));
+
+	bool written = file.write(&header, sizeof(header)) && (sources.empty() || file.write(sources.data(), sources.size() * sizeof(CheckpointSource)));
+	for (uint32_t i = 0; i < FieldCount && written; ++i)
+	{
+		written = file.pad(size_t(PayloadAlignment)) && file.write(payloads[i], size_t(header.fields[i].bytes));
+	}
+
+	written = written && file.pad(size_t(PayloadAlignment));
+
+	if (!written)
+	{
+		file.abort();
+		return fail(error, "Failed writing checkpoint " + path);
+	}
+
+	if (!file.commit())
+		return fail(error, "Failed to move checkpoint into place at " + path);
+
+	return true;
+}
+
+bool CFD::CFDCheckpoint::load(CFDGrid* grid, const std::string& path, std::string* error)
+{
+	MappedFile mapping;
+	if (!mapping.open(path))
+		return fail(error, "Could not map " + path);
+
+	if (mapping.getSize() < sizeof(CheckpointHeader))
+		return fail(error, path + " is too small to be a checkpoint.");
+
+	CheckpointHeader header;
+	memcpy(&header, mapping.getData(), sizeof(header));
+
+	if (!validateHeader(header, mapping.getSize(), error))
+		return false;
+
+	// Whatever follows an older, shorter header is payload padding rather than settings.
+	if (header.headerBytes < sizeof(CheckpointHeader))
+		memset(reinterpret_cast<unsigned char*>(&header) + header.headerBytes, 0, sizeof(CheckpointHeader) - header.headerBytes);
+
+	for (uint32_t i = 0; i < FieldCount; ++i)
+	{
+		if (header.fields[i].codec != uint32_t(CheckpointCodec::None))
+		{
+			if (!decodeFields(grid, header, mapping.getData(), path, error))
+				return false;
+
+			restoreSettings(grid, header, mapping.getData());
+			return true;
+		}
+	}
+
+	// Point the fields straight at the mapped payloads, nothing is parsed or copied.
+	void* arrays[FieldCount];
+	for (uint32_t i = 0; i < FieldCount; ++i)
+	{
+		arrays[i] = mapping.getData() + header.fields[i].offset;
+	}
+
+	FieldStorage densityStorage = FieldStorage(header.fields[0].storage);
+	FieldStorage velocityStorage = FieldStorage(header.fields[2].storage);
+	CFDData* data = new CFDData(header.N, header.totalN, densityStorage, velocityStorage, arrays);
+
+	// The grid keeps the mapping open, so the sources can still be read from it.
+	const unsigned char* file = mapping.getData();
+	grid->setMappedGrid(header.N, header.dimensions, data, std::move(mapping));
+
+	restoreSettings(grid, header, file);
+	return true;
+}
+
+void CFD::CFDCheckpoint::restoreSettings(CFDGrid* grid, const CheckpointHeader& header, const unsigned char* file)
+{
+	grid->setDiffusionRate(header.diffusionRate);
+	grid->setViscocity(header.viscocity);
+	grid->setRandomVelocityMinMax(header.randomVelocityMinMax);
+
+	// Turbulence and random velocity are drawn from the seed and step, so the run carries on where it was saved.
+	TurbulenceSettings turbulence;
+	if (header.version >= 3)
+	{
+		turbulence.enabled = header.turbulenceEnabled != 0;
+		turbulence.octaves = header.turbulenceOctaves;
+		turbulence.amplitude = header.turbulenceAmplitude;
+		turbulence.frequency = header.turbulenceFrequency;
+		turbulence.evolution = header.turbulenceEvolution;
+		turbulence.activeThreshold = header.turbulenceActiveThreshold;
+	}
+
+	grid->setRandomSeed(header.randomSeed);
+	grid->setTurbulence(turbulence);
+	grid->setStepCount(header.stepCount);
+
+	std::vector<QueueItem<float>> densities(header.densitySourceCount);
+	std::vector<QueueItem<Vector3>> velocities(header.velocitySourceCount);
+	const unsigned char* sources = file + header.sourcesOffset;
+	for (uint32_t i = 0; i < header.densitySourceCount + header.velocitySourceCount; ++i)
+	{
+		CheckpointSource source;
+		memcpy(&source, sources + i * sizeof(CheckpointSource), sizeof(source));
+
+		Vector3 position = Vector3(source.position[0], source.position[1], source.position[2]);
+		if (i < header.densitySourceCount)
+			densities[i] = QueueItem<float>(position, source.value[0]);
+		else
+			velocities[i - header.densitySourceCount] = QueueItem<Vector3>(position, Vector3(source.value[0], source.value[1], source.value[2]));
+	}
+
+	grid->setQueuedSources(densities, velocities);
+}
+
+bool CFD::CFDCheckpoint::decodeFields(CFDGrid* grid, const CheckpointHeader& header, const unsigned char* file, const std::string& path, std::string* error)
+{
+	grid->setDensityStorage(FieldStorage(header.fields[0].storage));
+	grid->setVelocityStorage(FieldStorage(header.fields[2].storage));
+
+	if (!grid->setGrid(header.N, header.dimensions))
+		return fail(error, "The grid in " + path + " does not fit the memory budget.");
+
+	CFDData* voxels = grid->getAllVoxelData();
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	std::vector<float> values(size_t(header.totalN));
+
+	for (uint32_t i = 0; i < FieldCount; ++i)
+	{
+		const CheckpointField& entry = header.fields[i];
+		VoxelData* field = fields[i / 2];
+		void* destination = (i % 2 == 0) ? field->getCurrentRawArray() : field->getPreviousRawArray();
+
+		if (entry.codec == uint32_t(CheckpointCodec::None))
+		{
+			memcpy(destination, file + entry.offset, size_t(entry.bytes));
+			continue;
+		}
+
+		if (!Wavelet::decompress(file + entry.offset, size_t(entry.bytes), values.data(), header.N, header.N, header.totalN, &grid->getThreadPool()))
+			return fail(error, "Checkpoint field " + std::string(CheckpointFieldNames[i]) + " is corrupt.");
+
+		narrowFieldArray(field->getStorage(), values.data(), destination, values.size());
+	}
+
+	if (grid->getSimulating())
+		grid->Start();
+
+	return true;
+}
+
+bool CFD::CFDCheckpoint::readHeader(const std::string& path, CheckpointHeader& header, std::string* error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return fail(error, "Could not open " + path);
+
+	bool read = fread(&header, sizeof(header), 1, file) == 1;
+	fseek(file, 0, SEEK_END);
+	long fileBytes = ftell(file);
+	fclose(file);
+
+	if (!read || fileBytes < 0)
+		return fail(error, path + " is too small to be a checkpoint.");
+
+	if (!validateHeader(header, size_t(fileBytes), error))
+		return false;
+
+	if (header.headerBytes < sizeof(CheckpointHeader))
+		memset(reinterpret_cast<unsigned char*>(&header) + header.headerBytes, 0, sizeof(CheckpointHeader) - header.headerBytes);
+
+	return true;
+}
+
+bool CFD::CFDCheckpoint::validateHeader(const CheckpointHeader& header, size_t fileBytes, std::string* error)
+{
+	if (memcmp(header.magic, Magic, sizeof(header.magic)) != 0)
+		return fail(error, "Not a checkpoint file.");
+
+	if (header.version < MinVersion || header.version > Version || header.headerBytes != getHeaderBytes(header.version))
+		return fail(error, "Unsupported checkpoint version " + std::to_string(header.version) + ".");
+
+	if (header.endianMarker != EndianMarker)
+		return fail(error, "Checkpoint was written on a machine with a different byte order.");
+
+	if (header.payloadAlignment < Arena::Alignment || (header.payloadAlignment & (header.payloadAlignment - 1)) != 0)
+		return fail(error, "Checkpoint payloads are not aligned.");
+
+	if (header.N <= 0 || (header.dimensions != 2 && header.dimensions != 3) || header.fieldCount != FieldCount)
+		return fail(error, "Checkpoint describes an invalid grid.");
+
+	uint64_t sideSize = uint64_t(header.N) + 2;
+	if (uint64_t(header.totalN) != sideSize * sideSize * sideSize)
+		return fail(error, "Checkpoint array size does not match its grid size.");
+
+	if (header.fileBytes > fileBytes)
+		return fail(error, "Checkpoint is truncated.");
+
+	// The sources sit between the header and the first payload, older headers end before their count.
+	uint64_t sourceBytes = (header.version >= 3) ? (uint64_t(header.densitySourceCount) + uint64_t(header.velocitySourceCount)) * sizeof(CheckpointSource) : 0;
+	if (sourceBytes > 0 && (header.sourcesOffset < header.headerBytes || header.sourcesOffset + sourceBytes > header.fields[0].offset))
+		return fail(error, "Checkpoint sources are out of bounds.");
+
+	for (uint32_t i = 0; i < FieldCount; ++i)
+	{
+		const CheckpointField& field = header.fields[i];
+
+		if (field.storage > uint32_t(FieldStorage::BFloat16) || field.storage != header.fields[i & ~1u].storage)
+			return fail(error, "Checkpoint field has an unknown storage format.");
+
+		// Every velocity component must share a format, as the grid only tracks one.
+		if (i >= 2 && field.storage != header.fields[2].storage)
+			return fail(error, "Checkpoint velocity components use different storage formats.");
+
+		if (field.codec > uint32_t(CheckpointCodec::Wavelet) || (header.version < 2 && field.codec != uint32_t(CheckpointCodec::None)))
+			return fail(error, "Checkpoint field " + std::to_string(i) + " has an unknown codec.");
+
+		// Compressed payloads can be any size, raw ones are exactly the array.
+		uint64_t expectedBytes = uint64_t(getFieldStorageBytes(FieldStorage(field.storage))) * uint64_t(header.totalN);
+		bool sized = (field.codec == uint32_t(CheckpointCodec::None)) ? field.bytes == expectedBytes : field.bytes > 0;
+		if (!sized || field.offset % header.payloadAlignment != 0 || field.offset + field.bytes > header.fileBytes)
+			return fail(error, "Checkpoint field " + std::to_string(i) + " is out of bounds.");
+	}
+
+	return true;
+}
+
+size_t CFD::CFDCheckpoint::getHeaderBytes(uint32_t version)
+{
+	return (version >= 3) ? sizeof(CheckpointHeader) : offsetof(CheckpointHeader, randomSeed);
+}
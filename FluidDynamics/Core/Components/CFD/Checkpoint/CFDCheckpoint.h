@@ -0,0 +1,108 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Compression/Wavelet.h"
+
+namespace CFD
+{
+	// How a field payload is written in a checkpoint.
+	enum class CheckpointCodec : uint32_t
+	{
+		None = 0,		// Raw array in its storage format, mapped straight into the grid.
+		Wavelet,		// Lossy wavelet stream, decoded into a freshly allocated grid on load.
+	};
+
+	// Location and format of one field array inside a checkpoint.
+	struct CheckpointField
+	{
+		char name[24];
+		uint32_t storage;		// FieldStorage the payload is written in.
+		uint32_t codec;			// CheckpointCodec of the payload, always None in version 1.
+		uint64_t offset;		// Bytes from the start of the file, always a multiple of the payload alignment.
+		uint64_t bytes;			// Size of the payload as written.
+	};
+
+	// One queued source in a checkpoint, a density source only uses the first value.
+	struct CheckpointSource
+	{
+		float position[3];
+		float value[3];
+	};
+
+	// Fixed size header at the start of every checkpoint, followed by the queued sources and the page aligned field payloads.
+	struct CheckpointHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerBytes;
+		uint32_t endianMarker;
+		int32_t N;
+		int32_t dimensions;
+		int32_t totalN;
+		float diffusionRate;
+		float viscocity;
+		float timeStep;
+		int32_t randomVelocityMinMax;
+		uint64_t payloadAlignment;
+		uint64_t fileBytes;
+		uint32_t fieldCount;
+		uint32_t reserved;
+		CheckpointField fields[8];
+
+		// Version 3 on, so a restored run draws the same random velocity and turbulence and adds the same sources as the one that was saved.
+		// Older headers end before these and load at step zero on seed zero without turbulence or sources.
+		uint64_t randomSeed;
+		uint64_t stepCount;
+		uint32_t turbulenceEnabled;
+		int32_t turbulenceOctaves;
+		float turbulenceAmplitude;
+		float turbulenceFrequency;
+		float turbulenceEvolution;
+		float turbulenceActiveThreshold;
+		uint64_t sourcesOffset;				// Bytes from the start of the file to the density sources, followed by the velocity sources.
+		uint32_t densitySourceCount;
+		uint32_t velocitySourceCount;
+	};
+
+	// Versioned binary snapshot of a grid that can be mapped straight back into a running simulation.
+	class CFDCheckpoint
+	{
+	public:
+		static const char Magic[8];
+		static const uint32_t Version = 3;
+		static const uint32_t MinVersion = 1;
+		static const uint32_t EndianMarker = 0x01020304;
+
+		// Alignment of every field payload, a page so the mapped arrays start on a page boundary.
+		static const uint64_t PayloadAlignment = 4096;
+
+		// Number of arrays in a checkpoint, the current and previous array of density and each velocity component.
+		static const uint32_t FieldCount = 8;
+
+		// Writes the grid to the passed in path through a temporary file, the previous checkpoint survives a failed write.
+		// Passing wavelet settings writes every field lossy within their error bound, such checkpoints are decoded rather than mapped on load.
+		static bool save(CFDGrid* grid, const std::string& path, std::string* error = nullptr, const WaveletSettings* lossy = nullptr);
+
+		// Maps the passed in checkpoint and points the grid fields into it, the grid can step straight away.
+		// Compressed checkpoints are decoded into a newly allocated grid instead.
+		static bool load(CFDGrid* grid, const std::string& path, std::string* error = nullptr);
+
+		// Reads and validates the header of the passed in checkpoint without mapping the payloads.
+		static bool readHeader(const std::string& path, CheckpointHeader& header, std::string* error = nullptr);
+
+		// Checks the passed in header describes a checkpoint of the passed in file size this version can load.
+		static bool validateHeader(const CheckpointHeader& header, size_t fileBytes, std::string* error = nullptr);
+
+		// Returns the size of the header a checkpoint of the passed in version was written with.
+		static size_t getHeaderBytes(uint32_t version);
+
+	private:
+
+		// Sets the simulation settings and queued sources of the grid from the checkpoint, after its fields are in place.
+		static void restoreSettings(CFDGrid* grid, const CheckpointHeader& header, const unsigned char* file);
+
+		// Allocates the grid and decodes every compressed field of a mapped checkpoint into it.
+		static bool decodeFields(CFDGrid* grid, const CheckpointHeader& header, const unsigned char* file, const std::string& path, std::string* error);
+	};
+}
@@ -0,0 +1,133 @@
+#include "CFDEmitter.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Time/Stopwatch.h"
+#include <cmath>
+
+using namespace CFD;
+
+CFDEmitter::CFDEmitter()
+{
+	this->setType(ComponentTypes::CFDEmitter);
+	this->setRenderable(false);
+}
+
+CFDEmitter::~CFDEmitter()
+{
+}
+
+void CFD::CFDEmitter::setPosition(const Vector3& val)
+{
+	if (val.x != position.x || val.y != position.y || val.z != position.z)
+	{
+		position = val;
+		footprintDirty = true;
+	}
+}
+
+void CFD::CFDEmitter::setSize(const Vector3& val)
+{
+	if (val.x != size.x || val.y != size.y || val.z != size.z)
+	{
+		size = val;
+		footprintDirty = true;
+	}
+}
+
+void CFD::CFDEmitter::rasterise(CFDData* voxels, int N, int dimensions, float timeStep)
+{
+	if (voxels == nullptr || !isAlive())
+	{
+		stats.lastRasteriseMs = 0.0;
+		return;
+	}
+
+	Stopwatch timer;
+
+	if (footprintDirty || footprintN != N || footprintDimensions != dimensions)
+	{
+		rebuildFootprint(voxels, N, dimensions);
+	}
+
+	if (!footprint.empty())
+	{
+		// Spread the emitted density over the footprint so the shape doesnt change the total emitted.
+		const float densityPerVoxel = (rate * timeStep) / float(footprint.size());
+		const bool hasDensity = densityPerVoxel != 0.0f;
+
+		// Velocity is scaled by the step like density, so the momentum put in doesnt depend on the frame rate.
+		const Vector3 velocityPerStep = velocity * timeStep;
+		const bool hasVelocity = velocityPerStep.x != 0.0f || velocityPerStep.y != 0.0f || velocityPerStep.z != 0.0f;
+
+		for (const int index : footprint)
+		{
+			if (hasDensity)
+				voxels->density->increaseCurrentValue(index, densityPerVoxel);
+
+			if (hasVelocity)
+			{
+				voxels->velocityX->increaseCurrentValue(index, velocityPerStep.x);
+				voxels->velocityY->increaseCurrentValue(index, velocityPerStep.y);
+				voxels->velocityZ->increaseCurrentValue(index, velocityPerStep.z);
+			}
+		}
+	}
+
+	age += timeStep;
+
+	stats.lastRasteriseMs = timer.getElapsedMilliseconds();
+	stats.totalRasteriseMs += stats.lastRasteriseMs;
+	stats.stepsEmitted++;
+}
+
+void CFD::CFDEmitter::rebuildFootprint(CFDData* voxels, int N, int dimensions)
+{
+	Stopwatch timer;
+
+	footprint.clear();
+
+	// Work out the bounds of the shape clamped to the simulated region of the grid.
+	Vector3 extents = (shape == EmitterShape::Point) ? Vector3(0.0f, 0.0f, 0.0f) : size;
+	int minX = Math::clamp(int(floorf(position.x - extents.x + 0.5f)), 0, N - 1);
+	int maxX = Math::clamp(int(floorf(position.x + extents.x + 0.5f)), 0, N - 1);
+	int minY = Math::clamp(int(floorf(position.y - extents.y + 0.5f)), 0, N - 1);
+	int maxY = Math::clamp(int(floorf(position.y + extents.y + 0.5f)), 0, N - 1);
+	int minZ = 0;
+	int maxZ = 0;
+
+	if (dimensions > 2)
+	{
+		minZ = Math::clamp(int(floorf(position.z - extents.z + 0.5f)), 0, N - 1);
+		maxZ = Math::clamp(int(floorf(position.z + extents.z + 0.5f)), 0, N - 1);
+	}
+
+	for (int z = minZ; z <= maxZ; ++z)
+	{
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				if (shape == EmitterShape::Sphere)
+				{
+					float dx = (x - position.x) / std::max<float>(size.x, 0.5f);
+					float dy = (y - position.y) / std::max<float>(size.y, 0.5f);
+					float dz = (dimensions > 2) ? (z - position.z) / std::max<float>(size.z, 0.5f) : 0.0f;
+
+					if (dx * dx + dy * dy + dz * dz > 1.0f)
+						continue;
+				}
+
+				int index = voxels->density->getIndex(Vector3(x, y, z));
+				if (index != -1)
+					footprint.push_back(index);
+			}
+		}
+	}
+
+	footprintDirty = false;
+	footprintN = N;
+	footprintDimensions = dimensions;
+
+	stats.footprintVoxels = int(footprint.size());
+	stats.rebuildCount++;
+	stats.lastRebuildMs = timer.getElapsedMilliseconds();
+}
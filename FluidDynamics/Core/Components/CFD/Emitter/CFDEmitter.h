@@ -0,0 +1,100 @@
+#pragma once
+#include "Core/Entity System/Component.h"
+#include "Utility/Math/Math.h"
+#include <vector>
+
+namespace CFD
+{
+	struct CFDData;
+
+	// Shape of the volume an emitter injects into.
+	enum class EmitterShape
+	{
+		Point = 0,
+		Sphere,
+		Box,
+	};
+
+	// Cost accounting for a single emitter, refreshed every simulation step.
+	struct EmitterStats
+	{
+		double lastRasteriseMs = 0.0;	// Time spent injecting into the grid last step.
+		double lastRebuildMs = 0.0;		// Time spent rebuilding the footprint the last time it was invalidated.
+		double totalRasteriseMs = 0.0;	// Time spent injecting into the grid since the emitter was created.
+		int footprintVoxels = 0;		// Number of voxels currently covered by the emitter.
+		int rebuildCount = 0;			// Number of times the footprint has been rebuilt.
+		int stepsEmitted = 0;			// Number of simulation steps the emitter has injected into.
+	};
+
+	// Continuous source of density and velocity, attached to a GameObject next to a CFDGrid.
+	class CFDEmitter : public Component
+	{
+	public:
+		CFDEmitter();
+		~CFDEmitter();
+
+		// Sets the shape of the emission volume.
+		void setShape(EmitterShape val) { if (shape != val) { shape = val; footprintDirty = true; } }
+		EmitterShape getShape() { return shape; }
+
+		// Sets the centre of the emitter in voxel coordinates.
+		void setPosition(const Vector3& val);
+		Vector3 getPosition() { return position; }
+
+		// Sets the radius (sphere) or half extents (box) of the emitter in voxels.
+		void setSize(const Vector3& val);
+		Vector3 getSize() { return size; }
+
+		// Sets the density injected per second of simulation time, spread across the footprint.
+		void setRate(float val) { rate = val; }
+		float getRate() { return rate; }
+
+		// Sets the velocity added to every voxel in the footprint per second, scaled by the timestep each step.
+		void setVelocity(const Vector3& val) { velocity = val; }
+		Vector3 getVelocity() { return velocity; }
+
+		// Sets how long the emitter emits for in simulation seconds, zero or less emits forever.
+		void setLifetime(float val) { lifetime = val; }
+		float getLifetime() { return lifetime; }
+
+		// Returns how long the emitter has been emitting for in simulation seconds.
+		float getAge() { return age; }
+
+		// Restarts the emitters lifetime.
+		void resetAge() { age = 0.0f; }
+
+		// Returns whether the emitter is still within its lifetime.
+		bool isAlive() { return lifetime <= 0.0f || age < lifetime; }
+
+		// Returns the cost accounting for the emitter.
+		const EmitterStats& getStats() { return stats; }
+
+		// Injects the emitters density and velocity into the current frame of the passed in data.
+		void rasterise(CFDData* voxels, int N, int dimensions, float timeStep);
+
+		// Returns the cached footprint as flat voxel indices.
+		const std::vector<int>& getFootprint() { return footprint; }
+
+	private:
+
+		// Rebuilds the cached list of voxels covered by the emitter.
+		void rebuildFootprint(CFDData* voxels, int N, int dimensions);
+
+		EmitterShape shape = EmitterShape::Sphere;
+		Vector3 position;
+		Vector3 size = Vector3(1.0f, 1.0f, 1.0f);
+		Vector3 velocity;
+		float rate = 0.0f;
+		float lifetime = 0.0f;
+		float age = 0.0f;
+
+		// ------ Footprint Cache.
+
+		std::vector<int> footprint;
+		bool footprintDirty = true;
+		int footprintN = 0;
+		int footprintDimensions = 0;
+
+		EmitterStats stats;
+	};
+}
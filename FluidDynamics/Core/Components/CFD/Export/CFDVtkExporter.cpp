@@ -0,0 +1,300 @@
+#include "CFDVtkExporter.h"
+#include "Utility/Compression/Deflate.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+using namespace CFD;
+
+namespace
+{
+	// Written in place of every array offset and patched once the arrays are written, wide enough for any 64 bit offset.
+	const char OffsetPlaceholder[] = "00000000000000000000";
+
+	bool isLittleEndian()
+	{
+		uint16_t value = 1;
+		unsigned char first;
+		memcpy(&first, &value, 1);
+		return first == 1;
+	}
+}
+
+CFDVtkExporter::CFDVtkExporter() : exporting(false)
+{
+}
+
+CFDVtkExporter::~CFDVtkExporter()
+{
+	finish();
+}
+
+bool CFD::CFDVtkExporter::start(CFDGrid* grid, const std::string& filePath, const VtkExportSettings& exportSettings)
+{
+	if (exporting)
+		return false;
+
+	finish();
+
+	CFDData* voxels = grid->getAllVoxelData();
+	if (voxels == nullptr || grid->getGridWidth() <= 0)
+		return false;
+
+	N = grid->getGridWidth();
+	dimensions = grid->getDimensions();
+	cellCount = size_t(N) * size_t(N) * size_t(dimensions > 2 ? N : 1);
+
+	if (cellCount > size_t(voxels->density->getArraySize()))
+		return false;
+
+	settings = exportSettings;
+
+	// Blocks hold whole velocity cells, so a block never splits the components of a cell.
+	const size_t cellBytes = 3 * sizeof(float);
+	settings.blockBytes = std::max<size_t>(cellBytes, settings.blockBytes - settings.blockBytes % cellBytes);
+
+	if (!file.open(filePath))
+		return false;
+
+	path = filePath;
+
+	// Only the copy happens on the calling thread, so the simulation can step again as soon as this returns.
+	Stopwatch snapshotTimer;
+
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	int fieldCount = settings.exportVelocity ? 4 : 1;
+	for (int i = 0; i < fieldCount; ++i)
+	{
+		snapshot[i].storage = fields[i]->getStorage();
+		snapshot[i].values.resize(getFieldStorageBytes(snapshot[i].storage) * cellCount);
+		memcpy(snapshot[i].values.data(), fields[i]->getCurrentRawArray(), snapshot[i].values.size());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats = VtkExportStats();
+		stats.snapshotMs = snapshotTimer.getElapsedMilliseconds();
+	}
+
+	succeeded = false;
+	exporting = true;
+	writer = std::thread(&CFDVtkExporter::writeFile, this);
+	return true;
+}
+
+bool CFD::CFDVtkExporter::finish()
+{
+	if (writer.joinable())
+		writer.join();
+
+	return succeeded;
+}
+
+VtkExportStats CFD::CFDVtkExporter::getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
+
+void CFD::CFDVtkExporter::writeFile()
+{
+	std::string header = buildHeader();
+
+	Stopwatch writeTimer;
+	bool written = file.write(header.data(), header.size());
+	double writeMs = writeTimer.getElapsedMilliseconds();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.writeMs += writeMs;
+	}
+
+	// Offsets count from the byte after the underscore that opens the appended data.
+	size_t appendedStart = file.getPosition();
+	std::vector<uint64_t> offsets;
+
+	const SnapshotField* density[] = { &snapshot[0] };
+	offsets.push_back(file.getPosition() - appendedStart);
+	written = written && writeArray(density, 1);
+
+	if (settings.exportVelocity)
+	{
+		const SnapshotField* velocity[] = { &snapshot[1], &snapshot[2], &snapshot[3] };
+		offsets.push_back(file.getPosition() - appendedStart);
+		written = written && writeArray(velocity, 3);
+	}
+
+	const char footer[] = "\n  </AppendedData>\n</VTKFile>\n";
+	written = written && file.write(footer, sizeof(footer) - 1);
+
+	size_t placeholder = 0;
+	for (uint64_t offset : offsets)
+	{
+		char digits[sizeof(OffsetPlaceholder)];
+		snprintf(digits, sizeof(digits), "%020llu", (unsigned long long)offset);
+
+		placeholder = header.find(OffsetPlaceholder, placeholder);
+		written = written && file.writeAt(placeholder, digits, sizeof(OffsetPlaceholder) - 1);
+		placeholder += sizeof(OffsetPlaceholder) - 1;
+	}
+
+	size_t fileBytes = file.getPosition();
+
+	if (written)
+		written = file.commit();
+	else
+		file.abort();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.writtenBytes = written ? fileBytes : 0;
+	}
+
+	succeeded = written;
+	exporting = false;
+}
+
+bool CFD::CFDVtkExporter::writeArray(const SnapshotField* const* fields, int components)
+{
+	const size_t totalValues = cellCount * size_t(components);
+	const size_t blockValueCount = settings.blockBytes / sizeof(float);
+	const size_t blockCount = (totalValues + blockValueCount - 1) / blockValueCount;
+
+	// Compressed arrays open with the block count, block sizes and the compressed size of every block, which are only known once written.
+	size_t headerPosition = file.getPosition();
+	std::vector<uint64_t> arrayHeader;
+	if (settings.compress)
+	{
+		arrayHeader.assign(3 + blockCount, 0);
+		arrayHeader[0] = blockCount;
+		arrayHeader[1] = blockValueCount * sizeof(float);
+		arrayHeader[2] = (totalValues % blockValueCount) * sizeof(float);
+	}
+	else
+	{
+		arrayHeader.assign(1, totalValues * sizeof(float));
+	}
+
+	bool written = file.write(arrayHeader.data(), arrayHeader.size() * sizeof(uint64_t));
+
+	// One block per thread at a time, so memory stays bounded however large the grid is.
+	int batchSize = encodePool.getThreadCount();
+	blockValues.resize(batchSize);
+	blockEncoded.resize(batchSize);
+	blockSizes.resize(batchSize);
+	for (int i = 0; i < batchSize; ++i)
+	{
+		blockValues[i].resize(blockValueCount);
+		if (settings.compress)
+			blockEncoded[i].resize(Deflate::compressBound(blockValueCount * sizeof(float)));
+	}
+
+	double encodeMs = 0.0;
+	double writeMs = 0.0;
+
+	for (size_t first = 0; first < blockCount && written; first += size_t(batchSize))
+	{
+		int count = int(std::min<size_t>(size_t(batchSize), blockCount - first));
+
+		Stopwatch encodeTimer;
+		encodePool.parallelFor(0, count, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+			{
+				size_t firstValue = (first + size_t(i)) * blockValueCount;
+				size_t valueCount = std::min<size_t>(blockValueCount, totalValues - firstValue);
+				fillBlock(fields, components, firstValue, valueCount, blockValues[i].data());
+
+				if (settings.compress)
+					blockSizes[i] = Deflate::compress(blockValues[i].data(), valueCount * sizeof(float), blockEncoded[i].data(), blockEncoded[i].size());
+				else
+					blockSizes[i] = valueCount * sizeof(float);
+			}
+		});
+		encodeMs += encodeTimer.getElapsedMilliseconds();
+
+		Stopwatch writeTimer;
+		for (int i = 0; i < count && written; ++i)
+		{
+			const void* block = settings.compress ? static_cast<const void*>(blockEncoded[i].data()) : static_cast<const void*>(blockValues[i].data());
+			written = blockSizes[i] > 0 && file.write(block, blockSizes[i]);
+
+			if (settings.compress)
+				arrayHeader[3 + first + size_t(i)] = blockSizes[i];
+		}
+		writeMs += writeTimer.getElapsedMilliseconds();
+	}
+
+	if (settings.compress)
+		written = written && file.writeAt(headerPosition, arrayHeader.data(), arrayHeader.size() * sizeof(uint64_t));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.encodeMs += encodeMs;
+	stats.writeMs += writeMs;
+	stats.rawBytes += totalValues * sizeof(float);
+
+	return written;
+}
+
+void CFD::CFDVtkExporter::fillBlock(const SnapshotField* const* fields, int components, size_t firstValue, size_t valueCount, float* destination)
+{
+	size_t firstCell = firstValue / size_t(components);
+	size_t cells = valueCount / size_t(components);
+
+	for (int c = 0; c < components; ++c)
+	{
+		size_t valueBytes = getFieldStorageBytes(fields[c]->storage);
+		const unsigned char* source = fields[c]->values.data() + firstCell * valueBytes;
+
+		if (components == 1)
+		{
+			widenFieldArray(fields[c]->storage, source, destination, cells);
+			continue;
+		}
+
+		// Widened a chunk at a time on the stack, then scattered into every component-th value.
+		float chunk[256];
+		for (size_t i = 0; i < cells; i += 256)
+		{
+			size_t chunkCells = std::min<size_t>(256, cells - i);
+			widenFieldArray(fields[c]->storage, source + i * valueBytes, chunk, chunkCells);
+
+			for (size_t k = 0; k < chunkCells; ++k)
+				destination[(i + k) * size_t(components) + size_t(c)] = chunk[k];
+		}
+	}
+}
+
+std::string CFD::CFDVtkExporter::buildHeader()
+{
+	char line[512];
+	int depth = (dimensions > 2) ? N : 0;
+
+	std::string xml = "<?xml version=\"1.0\"?>\n";
+
+	snprintf(line, sizeof(line), "<VTKFile type=\"ImageData\" version=\"1.0\" byte_order=\"%s\" header_type=\"UInt64\"%s>\n",
+		isLittleEndian() ? "LittleEndian" : "BigEndian", settings.compress ? " compressor=\"vtkZLibDataCompressor\"" : "");
+	xml += line;
+
+	snprintf(line, sizeof(line), "  <ImageData WholeExtent=\"0 %d 0 %d 0 %d\" Origin=\"%.9g %.9g %.9g\" Spacing=\"%.9g %.9g %.9g\">\n",
+		N, N, depth, settings.origin[0], settings.origin[1], settings.origin[2], settings.spacing, settings.spacing, settings.spacing);
+	xml += line;
+
+	snprintf(line, sizeof(line), "    <Piece Extent=\"0 %d 0 %d 0 %d\">\n", N, N, depth);
+	xml += line;
+
+	xml += settings.exportVelocity ? "      <CellData Scalars=\"density\" Vectors=\"velocity\">\n" : "      <CellData Scalars=\"density\">\n";
+	xml += std::string("        <DataArray type=\"Float32\" Name=\"density\" format=\"appended\" offset=\"") + OffsetPlaceholder + "\"/>\n";
+
+	if (settings.exportVelocity)
+		xml += std::string("        <DataArray type=\"Float32\" Name=\"velocity\" NumberOfComponents=\"3\" format=\"appended\" offset=\"") + OffsetPlaceholder + "\"/>\n";
+
+	xml += "      </CellData>\n";
+	xml += "    </Piece>\n";
+	xml += "  </ImageData>\n";
+	xml += "  <AppendedData encoding=\"raw\">\n";
+	xml += "   _";
+
+	return xml;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/File/AtomicFile.h"
+#include "Utility/Threading/ThreadPool.h"
+
+namespace CFD
+{
+	// What an export writes and where the grid sits in the world.
+	struct VtkExportSettings
+	{
+		bool compress = true;				// zlib compresses the arrays in independent blocks, as vtkZLibDataCompressor does.
+		bool exportVelocity = true;			// Writes velocity as a three component array alongside density.
+		float origin[3] = { 0, 0, 0 };		// World position of the first corner of the grid.
+		float spacing = 1.0f;				// Width of a cell in world units.
+		size_t blockBytes = 1 << 20;		// Uncompressed size of each compressed block, rounded down to whole velocity cells.
+	};
+
+	// Timing and size accounting for the last export.
+	struct VtkExportStats
+	{
+		double snapshotMs = 0.0;		// Time the caller spent copying the fields, the only part that holds up the simulation.
+		double encodeMs = 0.0;			// Time spent converting and compressing blocks across the pool.
+		double writeMs = 0.0;			// Time spent writing to disk.
+		uint64_t rawBytes = 0;			// Bytes of the exported arrays before compression.
+		uint64_t writtenBytes = 0;		// Size of the file.
+
+		// Returns how many times smaller the file is than the arrays it holds.
+		double getCompressionRatio() const { return writtenBytes > 0 ? double(rawBytes) / double(writtenBytes) : 0.0; }
+
+		// Returns the array megabytes the writer gets through per second of encoding and writing.
+		double getWriterMBps() const { return (encodeMs + writeMs) > 0.0 ? (double(rawBytes) / (1024.0 * 1024.0)) / ((encodeMs + writeMs) / 1000.0) : 0.0; }
+	};
+
+	// Writes the grid as a VTK ImageData file (.vti) that ParaView opens directly, with the arrays as appended raw binary.
+	// Cells are written in the order the grid addresses them, x fastest, leaving out the padding at the end of the field arrays.
+	// The caller only copies the fields, converting, compressing and writing happen on a background thread that streams the file out block by block.
+	class CFDVtkExporter
+	{
+	public:
+		CFDVtkExporter();
+		~CFDVtkExporter();
+
+		CFDVtkExporter(const CFDVtkExporter&) = delete;
+		CFDVtkExporter& operator=(const CFDVtkExporter&) = delete;
+
+		// Copies the current frame of the grid and starts writing it to the passed in path, the file only appears once it is complete.
+		// Returns false if the previous export is still writing, the grid is empty, or the file could not be created.
+		bool start(CFDGrid* grid, const std::string& path, const VtkExportSettings& settings = VtkExportSettings());
+
+		// Waits for the export in progress to finish. Returns whether the last export was written.
+		bool finish();
+
+		// Returns whether an export is still writing.
+		bool isExporting() { return exporting; }
+
+		// Sets the number of threads blocks are encoded across, zero uses every hardware thread.
+		void setThreadCount(int val) { encodePool.setThreadCount(val); }
+		int getThreadCount() { return encodePool.getThreadCount(); }
+
+		// Returns a snapshot of the accounting of the last export.
+		VtkExportStats getStats();
+
+		// Returns the path the last export was written to.
+		const std::string& getPath() { return path; }
+
+	private:
+
+		// A field array as copied from the grid.
+		struct SnapshotField
+		{
+			FieldStorage storage;
+			std::vector<unsigned char> values;
+		};
+
+		// Writer thread body.
+		void writeFile();
+
+		// Writes one array of the appended data, converting and compressing it a batch of blocks at a time.
+		bool writeArray(const SnapshotField* const* fields, int components);
+
+		// Fills a block of an array with float values, interleaving the components of multi component arrays.
+		void fillBlock(const SnapshotField* const* fields, int components, size_t firstValue, size_t valueCount, float* destination);
+
+		// Returns the XML the appended data is preceded by, with a placeholder for every array offset.
+		std::string buildHeader();
+
+		std::string path;
+		VtkExportSettings settings;
+		int N = 0;
+		int dimensions = 0;
+		size_t cellCount = 0;
+		SnapshotField snapshot[4];
+		bool succeeded = false;
+
+		std::atomic<bool> exporting;
+		std::thread writer;
+
+		std::mutex mutex;
+		VtkExportStats stats;
+
+		// ------ Writer thread state.
+
+		AtomicFile file;
+		ThreadPool encodePool;
+		std::vector<std::vector<float>> blockValues;
+		std::vector<std::vector<unsigned char>> blockEncoded;
+		std::vector<size_t> blockSizes;
+	};
+}
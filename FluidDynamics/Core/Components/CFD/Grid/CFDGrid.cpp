@@ -1,148 +1,450 @@
 #include "CFDGrid.h"
+#include "Core/Components/CFD/Emitter/CFDEmitter.h"
+#include "Core/Components/CFD/Recording/CFDInputLog.h"
+#include "Core/Components/CFD/Recording/CFDPlayback.h"
+#include "Core/Components/CFD/Recording/CFDRecorder.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Math/Philox.h"
+#include "Utility/Time/Stopwatch.h"
+#include <cstring>
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <utility>
 
 using namespace CFD;
 
 CFDGrid::CFDGrid() : N(0), totalN(0)
 {
+	this->setType(ComponentTypes::CFDGrid);
 }
 
 CFDGrid::~CFDGrid()
 {
+	// A log still recording or replaying would otherwise call back into a destroyed grid.
+	if (inputLog != nullptr)
+		inputLog->stop();
+
+	delete voxels;
 }
 
-void CFDGrid::Start()
+bool CFDGrid::setGrid(const int size, const int dim)
 {
-	simulating = true;
+	// Check the footprint before touching the current grid so a rejected size leaves the simulation running.
+	lastSetGridReport = estimateMemory(size, dim);
+	if (size <= 0 || !lastSetGridReport.withinBudget())
+	{
+		if (logging)
+			printf("Rejected grid of size %d, it does not fit the memory budget: \n%s", size, lastSetGridReport.toString().c_str());
+		return false;
+	}
 
-	D3D* direct3D = D3D::getInstance();
-
-	D3D11_TEXTURE3D_DESC texDesc = {};
-	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE3D_DESC));
-	texDesc.Width = N;
-	texDesc.Height = N;
-	texDesc.Depth = (dimensions > 2) ? N : 1;
-	texDesc.MipLevels = 1;
-	texDesc.Format = DXGI_FORMAT_R32_FLOAT;
-	texDesc.Usage = D3D11_USAGE_DEFAULT;
-	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-	if (FAILED(direct3D->device->CreateTexture3D(&texDesc, nullptr, &voxelDensTex)))
-		throw;
-
-	D3D11_SHADER_RESOURCE_VIEW_DESC texViewDesc = {};
-	ZeroMemory(&texViewDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
-	texViewDesc.Format = texDesc.Format;
-	texViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
-	texViewDesc.Texture2D.MipLevels = texDesc.MipLevels;
-	texViewDesc.Texture2D.MostDetailedMip = 0;
-
-	direct3D->device->CreateShaderResourceView(voxelDensTex, &texViewDesc, &voxelDensView);
-
-	texDesc = {};
-	ZeroMemory(&texDesc, sizeof(D3D11_TEXTURE3D_DESC));
-	texDesc.Width = N;
-	texDesc.Height = N;
-	texDesc.Depth = (dimensions > 2) ? N : 1;
-	texDesc.MipLevels = 1;
-	texDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-	texDesc.Usage = D3D11_USAGE_DEFAULT;
-	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-	if (FAILED(direct3D->device->CreateTexture3D(&texDesc, nullptr, &voxelVeloTex)))
-		throw;
-
-	texViewDesc = {};
-	ZeroMemory(&texViewDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
-	texViewDesc.Format = texDesc.Format;
-	texViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
-	texViewDesc.Texture2D.MipLevels = texDesc.MipLevels;
-	texViewDesc.Texture2D.MostDetailedMip = 0;
-
-	if (FAILED(direct3D->device->CreateShaderResourceView(voxelVeloTex, &texViewDesc, &voxelVeloView)))
-		throw;
-
-	// Create Sampler
-	D3D11_SAMPLER_DESC sampDesc;
-	ZeroMemory(&sampDesc, sizeof(sampDesc));
-	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
-	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
-	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
-	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
-	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
-	sampDesc.MinLOD = 0;
-	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
-	direct3D->device->CreateSamplerState(&sampDesc, &sampler);
-
-}
-
-static int frame;
-void CFDGrid::Update(float deltaTime)
+	int newTotalN = int(pow((size + 2), 3));
+	size_t requiredBytes = CFDData::getArenaBytes(newTotalN, densityStorage, velocityStorage);
+
+	// Every field comes from one block, so a grid that fits is re-initialised in place. Anything bigger is allocated in the
+	// spare block first, so a failed allocation leaves the current grid running.
+	if (!arena.canReuse(requiredBytes))
+	{
+		resizeArena.release();
+		if (!resizeArena.reserve(requiredBytes))
+		{
+			if (logging)
+				printf("Failed to allocate %zu bytes for a grid of size %d! \n", requiredBytes, size);
+			return false;
+		}
+
+		arena.swap(resizeArena);
+	}
+
+	if(voxels != nullptr)
+	{
+		delete voxels;
+		voxels = nullptr;
+
+		queuedDensities.clear();
+		queuedVelocities.clear();
+	}
+
+	// A fresh grid has nothing to resample, so the resize buffers, or the block just swapped out, can go back to the OS.
+	resizeArena.release();
+	mappedFields.close();
+
+	N = size;
+	dimensions = dim;
+	totalN = newTotalN;
+	stepCount = 0;
+	lastStepTimings = StepTimings();
+	lastStepCounters = StepCounters();
+
+	// Cannot fail, the block was checked or allocated above.
+	arena.reserve(requiredBytes);
+
+	voxels = new CFDData(N, totalN, arena, densityStorage, velocityStorage);
+
+	// Only a grid that was actually replaced is replayed, a rejected size changed nothing.
+	if (inputLog != nullptr)
+		inputLog->recordSetGrid(size, dim);
+
+	return true;
+}
+
+void CFDGrid::setMappedGrid(const int size, const int dim, CFDData* data, MappedFile&& mapping)
 {
-	UNREFERENCED_PARAMETER(deltaTime);
+	delete voxels;
+	voxels = data;
+
+	queuedDensities.clear();
+	queuedVelocities.clear();
+
+	// The fields stay in the mapping, so neither block is needed.
+	arena.release();
+	resizeArena.release();
+	mappedFields = std::move(mapping);
+
+	N = size;
+	dimensions = dim;
+	totalN = int(pow((N + 2), 3));
+	stepCount = 0;
+	lastStepTimings = StepTimings();
+	lastStepCounters = StepCounters();
+	densityStorage = data->density->getStorage();
+	velocityStorage = data->velocityX->getStorage();
+}
 
-	if(simulating)
+bool CFDGrid::resize(const int newSize, ResampleFilter filter)
+{
+	if (voxels == nullptr)
+		return setGrid(newSize, dimensions);
+
+	if (newSize == N)
+		return true;
+
+	Stopwatch timer;
+
+	// Both grids are alive while resampling, so the peak is the new grid on top of the current one.
+	lastSetGridReport = estimateMemory(newSize, dimensions);
+	lastSetGridReport.addEntry("Current grid (kept during resize)", arena.getUsed());
+	if (newSize <= 0 || !lastSetGridReport.withinBudget())
 	{
-		resetValuesForCurrentFrame();
+		if (logging)
+			printf("Rejected resize to %d, it does not fit the memory budget: \n%s", newSize, lastSetGridReport.toString().c_str());
+		return false;
+	}
 
-		updateForces();
+	int newTotalN = int(pow((newSize + 2), 3));
+	FieldStorage currentDensityStorage = voxels->density->getStorage();
+	FieldStorage currentVelocityStorage = voxels->velocityX->getStorage();
 
-		addRandomVelocity();
+	size_t requiredBytes = CFDData::getArenaBytes(newTotalN, currentDensityStorage, currentVelocityStorage);
+	if (!resizeArena.reserve(requiredBytes))
+	{
+		if (logging)
+			printf("Failed to allocate %zu bytes to resize to %d! \n", requiredBytes, newSize);
+		return false;
+	}
+
+	CFDData* resized = new CFDData(newSize, newTotalN, resizeArena, currentDensityStorage, currentVelocityStorage);
+
+	VoxelData* sourceFields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	VoxelData* destinationFields[] = { resized->density, resized->velocityX, resized->velocityY, resized->velocityZ };
+
+	for (int i = 0; i < 4; ++i)
+	{
+		resampleField(sourceFields[i], destinationFields[i], N, newSize, false, filter);
+		resampleField(sourceFields[i], destinationFields[i], N, newSize, true, filter);
+	}
 
-		velocityStep(0.1f);
-		densityStep(0.1f);
+	// Keep queued sources at the same relative position in the domain.
+	float scale = float(newSize) / float(N);
+	for (auto& dens : queuedDensities)
+	{
+		dens.pos = dens.pos * scale;
 	}
+
+	for (auto& velo : queuedVelocities)
+	{
+		velo.pos = velo.pos * scale;
+	}
+
+	Entity* owner = static_cast<Entity*>(getParent());
+	if (owner != nullptr)
+	{
+		for (CFDEmitter* emitter : owner->getAllComponents<CFDEmitter>())
+		{
+			emitter->setPosition(emitter->getPosition() * scale);
+			emitter->setSize(emitter->getSize() * scale);
+		}
+	}
+
+	delete voxels;
+	mappedFields.close();
+	voxels = resized;
+
+	// The old block becomes the resize buffer for the next resize.
+	arena.swap(resizeArena);
+	resizeArena.reset();
+
+	N = newSize;
+	totalN = newTotalN;
+
+	// Only a resize that went through is replayed, whether one fits depends on the machine.
+	if (inputLog != nullptr)
+		inputLog->recordResize(newSize, int(filter));
+
+	lastResizeTime = timer.getElapsedMilliseconds();
+	return true;
 }
 
-void CFDGrid::Render()
+void CFDGrid::resampleField(VoxelData* source, VoxelData* destination, int sourceN, int destinationN, bool previous, ResampleFilter filter)
 {
-	if (simulating)
+	if (filter == ResampleFilter::Auto)
+		filter = (destinationN < sourceN) ? ResampleFilter::Box : ResampleFilter::Trilinear;
+
+	const bool is3D = dimensions > 2;
+	const float ratio = float(sourceN) / float(destinationN);
+
+	auto read = [&](int x, int y, int z)
+	{
+		int index = sourceN * sourceN * z + sourceN * y + x;
+		return previous ? source->getPreviousValue(index) : source->getCurrentValue(index);
+	};
+
+	auto write = [&](int x, int y, int z, float value)
+	{
+		int index = destinationN * destinationN * z + destinationN * y + x;
+		if (previous)
+			destination->setPreviousValue(index, value);
+		else
+			destination->setCurrentValue(index, value);
+	};
+
+	// Maps a destination cell centre back into source coordinates, returning the lower cell and the blend towards the upper one.
+	auto sourceCoordinate = [&](int d, int& lower, int& upper, float& t)
 	{
-		D3D* direct3D = D3D::getInstance();
+		float position = Math::clamp((d + 0.5f) * ratio - 0.5f, 0.0f, float(sourceN - 1));
+		lower = int(position);
+		upper = std::min<int>(lower + 1, sourceN - 1);
+		t = position - float(lower);
+	};
+
+	// Returns the range of source cells covered by a destination cell.
+	auto sourceRange = [&](int d, int& lower, int& upper)
+	{
+		lower = std::min<int>(int(d * ratio), sourceN - 1);
+		upper = Math::clamp(int((d + 1) * ratio), lower + 1, sourceN);
+	};
 
-		// Move density data into proper texture format.
-		int index = 0;
-		for (int z = 0; z < N; ++z)
+	// Every destination row only reads the source, so rows are split across the pool. A 2D grid only has the rows of slice zero.
+	int rowCount = is3D ? destinationN * destinationN : destinationN;
+	threadPool.parallelFor(0, rowCount, [&](int rowBegin, int rowEnd)
+	{
+		for (int row = rowBegin; row < rowEnd; ++row)
 		{
-			for (int y = 0; y < N; ++y)
-			{
-				for (int x = 0; x < N; ++x)
-				{
-					densityTextureData[index] = voxels->density->getCurrentValue(Vector3(x, y, z));
+			int z = row / destinationN;
+			int y = row % destinationN;
 
-					float xVelo, yVelo, zVelo;
-					xVelo = voxels->velocityX->getCurrentValue(Vector3(x, y, z));
-					yVelo = voxels->velocityY->getCurrentValue(Vector3(x, y, z));
-					zVelo = voxels->velocityZ->getCurrentValue(Vector3(x, y, z));
+			for (int x = 0; x < destinationN; ++x)
+			{
+				float value = 0.0f;
 
-					velocityTextureData[index] = Vector4(xVelo, yVelo, zVelo, 0);
-					index++;
+				if (filter == ResampleFilter::Trilinear)
+				{
+					int x0, x1, y0, y1, z0 = 0, z1 = 0;
+					float tx, ty, tz = 0.0f;
+					sourceCoordinate(x, x0, x1, tx);
+					sourceCoordinate(y, y0, y1, ty);
+					if (is3D)
+						sourceCoordinate(z, z0, z1, tz);
+
+					float front = Math::lerp(Math::lerp(read(x0, y0, z0), read(x1, y0, z0), tx), Math::lerp(read(x0, y1, z0), read(x1, y1, z0), tx), ty);
+					float back = is3D ? Math::lerp(Math::lerp(read(x0, y0, z1), read(x1, y0, z1), tx), Math::lerp(read(x0, y1, z1), read(x1, y1, z1), tx), ty) : front;
+					value = Math::lerp(front, back, tz);
 				}
+				else
+				{
+					int xBegin, xEnd, yBegin, yEnd, zBegin = 0, zEnd = 1;
+					sourceRange(x, xBegin, xEnd);
+					sourceRange(y, yBegin, yEnd);
+					if (is3D)
+						sourceRange(z, zBegin, zEnd);
+
+					float sum = 0.0f;
+					for (int sz = zBegin; sz < zEnd; ++sz)
+						for (int sy = yBegin; sy < yEnd; ++sy)
+							for (int sx = xBegin; sx < xEnd; ++sx)
+								sum += read(sx, sy, sz);
+
+					value = sum / float((xEnd - xBegin) * (yEnd - yBegin) * (zEnd - zBegin));
+				}
+
+				write(x, y, z, value);
 			}
 		}
+	});
+}
+
+MemoryReport CFDGrid::getMemoryReport()
+{
+	MemoryReport report = estimateMemory(N, dimensions);
+
+	if (resizeArena.getCapacity() > 0)
+		report.addEntry("Resize buffers", resizeArena.getCapacity());
+
+	return report;
+}
+
+MemoryReport CFDGrid::estimateMemory(const int size, const int dim)
+{
+	MemoryReport report = MemoryReport(memoryBudget);
+
+	// Fields are always allocated with a one voxel border in all three axes.
+	size_t voxelCount = (size > 0) ? size_t(size + 2) * size_t(size + 2) * size_t(size + 2) : 0;
+	size_t densityBytes = Arena::alignSize(getFieldStorageBytes(densityStorage) * voxelCount);
+	size_t velocityBytes = Arena::alignSize(getFieldStorageBytes(velocityStorage) * voxelCount);
+
+	report.addEntry(std::string("Density (curr + prev, ") + getFieldStorageName(densityStorage) + ")", 2 * densityBytes);
+	report.addEntry(std::string("VelocityX (curr + prev, ") + getFieldStorageName(velocityStorage) + ")", 2 * velocityBytes);
+	report.addEntry(std::string("VelocityY (curr + prev, ") + getFieldStorageName(velocityStorage) + ")", 2 * velocityBytes);
+	report.addEntry(std::string("VelocityZ (curr + prev, ") + getFieldStorageName(velocityStorage) + ")", 2 * velocityBytes);
+
+	if (viewMemoryEstimator && size > 0)
+		viewMemoryEstimator(size, dim, report);
+
+	return report;
+}
+
+void CFDGrid::Start()
+{
+	simulating = true;
+}
+
+void CFDGrid::Update(float deltaTime)
+{
+	CFD_TRACE_SCOPE("CFDGrid::Update");
+
+	(void)deltaTime;
+
+	if(simulating)
+	{
+		// An open recording replaces the solver, the fields are overwritten with the recorded frame instead.
+		if (updatePlayback())
+			return;
+
+		if (inputLog != nullptr)
+			inputLog->beginStep();
+
+		if (perfCounters != nullptr)
+			lastStepCounters = StepCounters();
+
+		Stopwatch phaseTimer;
+
+		resetValuesForCurrentFrame();
+		lastStepTimings.resetMs = phaseTimer.getElapsedMilliseconds();
+		phaseTimer.reset();
+
+		updateForces();
+
+		updateEmitters();
+
+		addRandomVelocity();
+
+		addTurbulence();
+		lastStepTimings.sourcesMs = phaseTimer.getElapsedMilliseconds();
+		phaseTimer.reset();
+
+		velocityStep(timeStep);
+		lastStepTimings.velocityMs = phaseTimer.getElapsedMilliseconds();
+		phaseTimer.reset();
 
-		direct3D->immediateContext->UpdateSubresource(voxelDensTex, 0, nullptr, densityTextureData, sizeof(float) * N, (dimensions > 2) ? UINT(pow(sizeof(float), dimensions)) : 0);
+		densityStep(timeStep);
+		lastStepTimings.densityMs = phaseTimer.getElapsedMilliseconds();
+		phaseTimer.reset();
 
-		direct3D->immediateContext->UpdateSubresource(voxelVeloTex, 0, nullptr, velocityTextureData, sizeof(Vector4) * N, (dimensions > 2) ? UINT(pow(sizeof(Vector4), dimensions)) : 0);
+		updateRecorders();
+		lastStepTimings.recordMs = phaseTimer.getElapsedMilliseconds();
+		stepCount++;
 
-		direct3D->immediateContext->PSSetSamplers(0, 1, &sampler);
-		direct3D->immediateContext->PSSetShaderResources(0, 1, &voxelDensView);
-		direct3D->immediateContext->PSSetShaderResources(1, 1, &voxelVeloView);
+		if (inputLog != nullptr)
+			inputLog->endStep();
 	}
 }
 
 void CFD::CFDGrid::addDensity(const Vector3& pos, const float val)
 {
+	if (inputLog != nullptr)
+		inputLog->recordAddDensity(pos, val);
+
 	queuedDensities.emplace_back(QueueItem<float>(pos, val));
 }
 
 void CFD::CFDGrid::addVelocity(const Vector3& pos, const Vector3& val)
 {
+	if (inputLog != nullptr)
+		inputLog->recordAddVelocity(pos, val);
+
 	queuedVelocities.emplace_back(QueueItem<Vector3>(pos, val));
 }
 
+// The UI sets its values every frame, so only calls that change something are logged.
+
+void CFD::CFDGrid::setDiffusionRate(float val)
+{
+	if (inputLog != nullptr && val != diffusionRate)
+		inputLog->recordDiffusionRate(val);
+
+	diffusionRate = val;
+}
+
+void CFD::CFDGrid::setViscocity(float val)
+{
+	if (inputLog != nullptr && val != viscocity)
+		inputLog->recordViscocity(val);
+
+	viscocity = val;
+}
+
+void CFD::CFDGrid::setRandomVelocityMinMax(int val)
+{
+	if (inputLog != nullptr && val != randomVelocityMinMax)
+		inputLog->recordRandomVelocityMinMax(val);
+
+	randomVelocityMinMax = val;
+}
+
+void CFD::CFDGrid::setQueuedSources(const std::vector<QueueItem<float>>& densities, const std::vector<QueueItem<Vector3>>& velocities)
+{
+	queuedDensities = densities;
+	queuedVelocities = velocities;
+}
+
+void CFD::CFDGrid::setRandomSeed(uint64_t val)
+{
+	if (inputLog != nullptr && val != randomSeed)
+		inputLog->recordRandomSeed(val);
+
+	randomSeed = val;
+}
+
+void CFD::CFDGrid::setTurbulence(const TurbulenceSettings& val)
+{
+	bool changed = val.enabled != turbulence.enabled || val.amplitude != turbulence.amplitude || val.frequency != turbulence.frequency ||
+		val.octaves != turbulence.octaves || val.evolution != turbulence.evolution || val.activeThreshold != turbulence.activeThreshold;
+
+	if (inputLog != nullptr && changed)
+		inputLog->recordTurbulence(val);
+
+	turbulence = val;
+}
+
+void CFD::CFDGrid::setDimensions(int val)
+{
+	if (inputLog != nullptr && val != dimensions)
+		inputLog->recordDimensions(val);
+
+	dimensions = val;
+}
+
 CFDVoxel CFD::CFDGrid::getVoxel(const Vector3& pos)
 {
 	CFDVoxel vox = CFDVoxel();
@@ -159,39 +461,63 @@ CFDVoxel CFD::CFDGrid::getVoxel(const Vector3& pos)
 
 void CFD::CFDGrid::resetValuesForCurrentFrame()
 {
-	for(int x = 0; x <= N; ++x)
+	CFD_TRACE_SCOPE("CFDGrid::resetValuesForCurrentFrame");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Reset)], lastStepCounters.ms[int(CounterPhase::Reset)]);
+
+	// Positions 0 to N in every axis cover one contiguous run of indices, so it is cleared as a run that splits cleanly across threads.
+	int count = N * N * N + N * N + N + 1;
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	threadPool.parallelFor(0, count, [&](int rangeBegin, int rangeEnd)
 	{
-		for (int y = 0; y <= N; ++y)
+		// Zero has every bit clear in all storage formats, so the run is cleared without converting anything.
+		for (VoxelData* field : fields)
 		{
-			for (int z = 0; z <= N; ++z)
-			{
-				voxels->density->setCurrentValue(Vector3(x, y, z), 0);
-				voxels->velocityY->setCurrentValue(Vector3(x, y, z), 0);
-				voxels->velocityX->setCurrentValue(Vector3(x, y, z), 0);
-				voxels->velocityZ->setCurrentValue(Vector3(x, y, z), 0);
-			}
+			size_t valueBytes = getFieldStorageBytes(field->getStorage());
+			memset(static_cast<unsigned char*>(field->getCurrentRawArray()) + size_t(rangeBegin) * valueBytes, 0, size_t(rangeEnd - rangeBegin) * valueBytes);
 		}
-	}
+	});
 }
 
 void CFD::CFDGrid::addRandomVelocity()
 {
+	CFD_TRACE_SCOPE("CFDGrid::addRandomVelocity");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Sources)], lastStepCounters.ms[int(CounterPhase::Sources)]);
+
 	if(randomVelocityMinMax > 0)
 	{
-		int randomX = Math::random(0, getGridWidth());
-		int randomY = Math::random(0, getGridHeight());
-		int randomZ = Math::random(0, getGridHeight());
+		// One impulse a step, its position and strength are the first two blocks of the step's counter.
+		Philox random = Philox(randomSeed);
+		Philox::Block position = random.generate(stepCount, 0);
+		Philox::Block strength = random.generate(stepCount, 1);
+
+		int randomX = Philox::toRange(position.values[0], 0, getGridWidth());
+		int randomY = Philox::toRange(position.values[1], 0, getGridHeight());
+		int randomZ = Philox::toRange(position.values[2], 0, getGridHeight());
+
+		int randomValX = Philox::toRange(strength.values[0], -randomVelocityMinMax, randomVelocityMinMax);
+		int randomValY = Philox::toRange(strength.values[1], -randomVelocityMinMax, randomVelocityMinMax);
+		int randomValZ = Philox::toRange(strength.values[2], -randomVelocityMinMax, randomVelocityMinMax);
+
+		// Queued directly rather than through addVelocity, it is drawn again on a replay so it is not an input.
+		queuedVelocities.emplace_back(QueueItem<Vector3>(Vector3(randomX, randomY, (dimensions > 2) ? randomZ : 0),
+			Vector3(randomValX, randomValY, (dimensions > 2) ? randomValZ : 0)));
+	}
+}
 
-		int randomValX = Math::random(-randomVelocityMinMax, randomVelocityMinMax);
-		int randomValY = Math::random(-randomVelocityMinMax, randomVelocityMinMax);
-		int randomValZ = Math::random(-randomVelocityMinMax, randomVelocityMinMax);
+void CFD::CFDGrid::addTurbulence()
+{
+	CFD_TRACE_SCOPE("CFDGrid::addTurbulence");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Sources)], lastStepCounters.ms[int(CounterPhase::Sources)]);
 
-		addVelocity(Vector3(randomX, randomY, (dimensions > 2) ? randomZ : 0), Vector3(randomValX, randomValY, (dimensions > 2) ? randomValZ : 0));
-	}
+	if (turbulence.enabled)
+		curlNoise.apply(voxels, N, dimensions, randomSeed, float(double(stepCount) * timeStep), turbulence, threadPool);
 }
 
 void CFD::CFDGrid::updateForces()
 {
+	CFD_TRACE_SCOPE("CFDGrid::updateForces");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Sources)], lastStepCounters.ms[int(CounterPhase::Sources)]);
+
 	for(const auto& dens : queuedDensities)
 	{
 		voxels->density->setCurrentValue(dens.pos, voxels->density->getPreviousValue(dens.pos) + dens.value);
@@ -205,8 +531,178 @@ void CFD::CFDGrid::updateForces()
 	}
 }
 
+void CFD::CFDGrid::updateEmitters()
+{
+	CFD_TRACE_SCOPE("CFDGrid::updateEmitters");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Sources)], lastStepCounters.ms[int(CounterPhase::Sources)]);
+
+	Stopwatch timer;
+
+	emitters.clear();
+
+	Entity* owner = static_cast<Entity*>(getParent());
+	if (owner != nullptr)
+	{
+		emitters = owner->getAllComponents<CFDEmitter>();
+	}
+
+	for (CFDEmitter* emitter : emitters)
+	{
+		if (emitter->getUpdatable())
+		{
+			emitter->rasterise(voxels, N, dimensions, timeStep);
+		}
+	}
+
+	emitterRasteriseTime = timer.getElapsedMilliseconds();
+}
+
+void CFD::CFDGrid::updateRecorders()
+{
+	CFD_TRACE_SCOPE("CFDGrid::updateRecorders");
+	PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Record)], lastStepCounters.ms[int(CounterPhase::Record)]);
+
+	Entity* owner = static_cast<Entity*>(getParent());
+	if (owner == nullptr)
+		return;
+
+	for (CFDRecorder* recorder : owner->getAllComponents<CFDRecorder>())
+	{
+		if (recorder->getUpdatable() && recorder->isRecording())
+		{
+			recorder->submit(this, stepCount);
+		}
+	}
+}
+
+bool CFD::CFDGrid::updatePlayback()
+{
+	CFD_TRACE_SCOPE("CFDGrid::updatePlayback");
+
+	Entity* owner = static_cast<Entity*>(getParent());
+	if (owner == nullptr)
+		return false;
+
+	for (CFDPlayback* playback : owner->getAllComponents<CFDPlayback>())
+	{
+		if (playback->getUpdatable() && playback->isOpen())
+		{
+			playback->present(this);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CFD::CFDGrid::runKernel(SolverKernel kernel)
+{
+	if (voxels == nullptr)
+		return;
+
+	switch (kernel)
+	{
+	case SolverKernel::Reset:
+		resetValuesForCurrentFrame();
+		break;
+	case SolverKernel::UpdateFromPrevious:
+		updateFromPreviousFrame(voxels->density, timeStep);
+		break;
+	case SolverKernel::Diffusion:
+		updateDiffusion(voxels->density, 0, diffusionRate, timeStep);
+		break;
+	case SolverKernel::Advection:
+		updateAdvection(voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ, 0, timeStep);
+		break;
+	case SolverKernel::MassConservation:
+		updateMassConservation(voxels->velocityX, voxels->velocityY, voxels->velocityZ, timeStep);
+		break;
+	case SolverKernel::Boundary:
+		updateCurrentDataBoundary(voxels->density, 0);
+		updatePreviousDataBoundary(voxels->density, 0);
+		break;
+	}
+}
+
+double CFD::CFDGrid::getKernelCells(SolverKernel kernel, int size, int dims)
+{
+	if (kernel == SolverKernel::Boundary)
+		return 4.0 * size + 4.0;
+
+	return double(size) * double(size) * double(dims > 2 ? size : 1);
+}
+
+double CFD::CFDGrid::getKernelBytes(SolverKernel kernel, int size, int dims, size_t fieldBytes, size_t velocityBytes)
+{
+	double cells = getKernelCells(kernel, size, dims);
+	double field = double(fieldBytes);
+	double velocity = double(velocityBytes);
+
+	switch (kernel)
+	{
+	case SolverKernel::Reset:
+		return cells * (field + 3.0 * velocity);					// Writes the current array of every field.
+	case SolverKernel::UpdateFromPrevious:
+		return cells * 3.0 * field;									// Reads previous, reads and writes current.
+	case SolverKernel::Diffusion:
+		return cells * 20.0 * 3.0 * field;							// 20 sweeps reading current and previous and writing current.
+	case SolverKernel::Advection:
+		return cells * (dims * velocity + 2.0 * field);				// Velocity at the cell, the previous field and the result.
+	case SolverKernel::MassConservation:
+		return cells * (5.0 + 20.0 * 3.0 + 7.0) * velocity;			// Divergence, 20 pressure sweeps and the gradient subtraction.
+	default:
+		return cells * 2.0 * 2.0 * field;							// Current and previous arrays, one read and one write each.
+	}
+}
+
+double CFD::CFDGrid::getStepBytes()
+{
+	size_t density = getFieldStorageBytes(densityStorage);
+	size_t velocity = getFieldStorageBytes(velocityStorage);
+
+	// Mirrors densityStep and velocityStep, the boundaries are part of the kernels that set them.
+	double bytes = getKernelBytes(SolverKernel::Reset, N, dimensions, density, velocity);
+	bytes += getKernelBytes(SolverKernel::UpdateFromPrevious, N, dimensions, density, velocity) + 3.0 * getKernelBytes(SolverKernel::UpdateFromPrevious, N, dimensions, velocity, velocity);
+	bytes += getKernelBytes(SolverKernel::Diffusion, N, dimensions, density, velocity) + 3.0 * getKernelBytes(SolverKernel::Diffusion, N, dimensions, velocity, velocity);
+	bytes += getKernelBytes(SolverKernel::Advection, N, dimensions, density, velocity) + 3.0 * getKernelBytes(SolverKernel::Advection, N, dimensions, velocity, velocity);
+	bytes += 2.0 * getKernelBytes(SolverKernel::MassConservation, N, dimensions, velocity, velocity);
+	return bytes;
+}
+
+double CFD::CFDGrid::getKernelFlops(SolverKernel kernel, int size, int dims)
+{
+	double cells = getKernelCells(kernel, size, dims);
+	bool threeD = (dims > 2);
+
+	switch (kernel)
+	{
+	case SolverKernel::UpdateFromPrevious:
+		return cells * 2.0;											// One multiply-add.
+	case SolverKernel::Diffusion:
+		return cells * 20.0 * (threeD ? 8.0 : 6.0);					// Neighbour sum, scale by k, add previous and divide by c, per sweep.
+	case SolverKernel::Advection:
+		return cells * (threeD ? 17.0 : 13.0);						// Backtrace of all three axes, a lerp per axis used and their sum.
+	case SolverKernel::MassConservation:
+		return cells * (7.0 + 20.0 * (threeD ? 8.0 : 6.0) + 12.0);	// Divergence, the pressure sweeps and the gradient subtraction.
+	default:
+		return 0.0;													// Reset and the boundaries only move data.
+	}
+}
+
+double CFD::CFDGrid::getStepFlops()
+{
+	// Mirrors getStepBytes, every field of a step goes through the same kernels.
+	double flops = 4.0 * getKernelFlops(SolverKernel::UpdateFromPrevious, N, dimensions);
+	flops += 4.0 * getKernelFlops(SolverKernel::Diffusion, N, dimensions);
+	flops += 4.0 * getKernelFlops(SolverKernel::Advection, N, dimensions);
+	flops += 2.0 * getKernelFlops(SolverKernel::MassConservation, N, dimensions);
+	return flops;
+}
+
 void CFD::CFDGrid::densityStep(float deltaTime)
 {
+	CFD_TRACE_SCOPE("CFDGrid::densityStep");
+
 	updateFromPreviousFrame(voxels->density, deltaTime);
 
 	voxels->density->swapCurrAndPrevArrays();
@@ -220,6 +716,8 @@ void CFD::CFDGrid::densityStep(float deltaTime)
 
 void CFD::CFDGrid::velocityStep(float deltaTime)
 {
+	CFD_TRACE_SCOPE("CFDGrid::velocityStep");
+
 	updateFromPreviousFrame(voxels->velocityX, deltaTime);
 	updateFromPreviousFrame(voxels->velocityY, deltaTime);
 	updateFromPreviousFrame(voxels->velocityZ, deltaTime);
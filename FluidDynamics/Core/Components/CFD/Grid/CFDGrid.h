@@ -1,13 +1,215 @@
 #pragma once
 #include "Core/Entity System/Component.h"
+#include <cfloat>
+#include <algorithm>
+#include <cmath>
+#include <functional>
 #include <vector>
-#include <DirectXMath.h>
-#include <d3d11.h>
-#include "Utility/Direct3D/Headers/D3D.h"
 #include "Utility/Math/Math.h"
+#include "Utility/Math/HalfFloat.h"
+#include "Utility/Memory/Arena.h"
+#include "Utility/File/MappedFile.h"
+#include "Utility/Memory/MemoryReport.h"
+#include "Utility/Threading/ThreadPool.h"
+#include "Utility/Profiling/Trace.h"
+#include "Utility/Profiling/PerfCounters.h"
+#include "Core/Components/CFD/Turbulence/CurlNoise.h"
 
 namespace CFD
 {
+	class CFDEmitter;
+	class CFDInputLog;
+
+	// Format the current and previous arrays of a field are stored in, all computation is done in 32 bit floats.
+	enum class FieldStorage
+	{
+		Float32 = 0,
+		Float16,
+		BFloat16,
+	};
+
+	// Returns the bytes used to store a single value in the passed in format.
+	inline size_t getFieldStorageBytes(FieldStorage storage) { return (storage == FieldStorage::Float32) ? sizeof(float) : sizeof(uint16_t); }
+
+	// Returns a display name for the passed in format.
+	inline const char* getFieldStorageName(FieldStorage storage)
+	{
+		switch (storage)
+		{
+		case FieldStorage::Float16: return "fp16";
+		case FieldStorage::BFloat16: return "bf16";
+		default: return "fp32";
+		}
+	}
+
+	// Widens count values stored in the passed in format to floats.
+	inline void widenFieldArray(FieldStorage storage, const void* source, float* destination, size_t count)
+	{
+		switch (storage)
+		{
+		case FieldStorage::Float16: HalfFloat::halfToFloatArray(static_cast<const uint16_t*>(source), destination, count); break;
+		case FieldStorage::BFloat16: HalfFloat::bfloat16ToFloatArray(static_cast<const uint16_t*>(source), destination, count); break;
+		default: memcpy(destination, source, count * sizeof(float)); break;
+		}
+	}
+
+	// Narrows count floats into the passed in storage format.
+	inline void narrowFieldArray(FieldStorage storage, const float* source, void* destination, size_t count)
+	{
+		switch (storage)
+		{
+		case FieldStorage::Float16: HalfFloat::floatToHalfArray(source, static_cast<uint16_t*>(destination), count); break;
+		case FieldStorage::BFloat16: HalfFloat::floatToBFloat16Array(source, static_cast<uint16_t*>(destination), count); break;
+		default: memcpy(destination, source, count * sizeof(float)); break;
+		}
+	}
+
+	// Conversions of one storage format, picked once per kernel so its loops do not branch on the format of every value.
+	template<FieldStorage Storage>
+	struct FieldStorageTraits;
+
+	template<>
+	struct FieldStorageTraits<FieldStorage::Float32>
+	{
+		typedef float Value;
+		static float widen(float value) { return value; }
+		static float narrow(float value) { return value; }
+		static float round(float value) { return value; }
+	};
+
+	template<>
+	struct FieldStorageTraits<FieldStorage::Float16>
+	{
+		typedef uint16_t Value;
+		static float widen(uint16_t value) { return HalfFloat::halfToFloat(value); }
+		static uint16_t narrow(float value) { return HalfFloat::floatToHalf(value); }
+		static float round(float value) { return HalfFloat::halfToFloat(HalfFloat::floatToHalf(value)); }
+	};
+
+	template<>
+	struct FieldStorageTraits<FieldStorage::BFloat16>
+	{
+		typedef uint16_t Value;
+		static float widen(uint16_t value) { return HalfFloat::bfloat16ToFloat(value); }
+		static uint16_t narrow(float value) { return HalfFloat::floatToBFloat16(value); }
+		static float round(float value) { return HalfFloat::bfloat16ToFloat(HalfFloat::floatToBFloat16(value)); }
+	};
+
+	// fp16 conversions with the F16C instructions on a build not compiled for them, for kernels that convert a value at a time.
+	// Only used once HalfFloat::hasHardwareConversion returned true.
+	struct HardwareHalfTraits
+	{
+		typedef uint16_t Value;
+		static float widen(uint16_t value) { return HalfFloat::halfToFloatHardware(value); }
+		static uint16_t narrow(float value) { return HalfFloat::floatToHalfHardware(value); }
+		static float round(float value) { return HalfFloat::roundToHalfHardware(value); }
+	};
+
+	// Values of one array of a field in a known storage format. Out of range indices read as zero and are not written, like VoxelData.
+	template<FieldStorage Storage, typename Traits = FieldStorageTraits<Storage>>
+	struct FieldArray
+	{
+		typedef typename Traits::Value Value;
+
+		FieldArray(void* array, int arraySize) : values(static_cast<Value*>(array)), arraySize(arraySize) {};
+
+		float load(int index) const { return (index < 0 || index > arraySize) ? 0.0f : Traits::widen(values[index]); }
+
+		// Returns the value as it now reads back, rounded to the storage format without reading it back.
+		float store(int index, float value)
+		{
+			if (index < 0 || index > arraySize)
+				return 0.0f;
+
+			values[index] = Traits::narrow(value);
+			return Traits::round(value);
+		}
+
+		Value* values;
+		int arraySize;
+	};
+
+	// Stages of a simulation step that can be run on their own, used to time each kernel in isolation.
+	enum class SolverKernel
+	{
+		Reset = 0,
+		UpdateFromPrevious,
+		Diffusion,
+		Advection,
+		MassConservation,
+		Boundary,
+	};
+
+	// Returns a display name for the passed in kernel.
+	inline const char* getSolverKernelName(SolverKernel kernel)
+	{
+		switch (kernel)
+		{
+		case SolverKernel::Reset: return "reset";
+		case SolverKernel::UpdateFromPrevious: return "updateFromPrevious";
+		case SolverKernel::Diffusion: return "diffusion";
+		case SolverKernel::Advection: return "advection";
+		case SolverKernel::MassConservation: return "massConservation";
+		default: return "boundary";
+		}
+	}
+
+	// Time each phase of a simulation step took in milliseconds.
+	struct StepTimings
+	{
+		double resetMs = 0.0;			// Clearing the current frame.
+		double sourcesMs = 0.0;			// Queued forces, emitters and random velocity.
+		double velocityMs = 0.0;
+		double densityMs = 0.0;
+		double recordMs = 0.0;			// Handing the step to recorders.
+
+		double getTotalMs() const { return resetMs + sourcesMs + velocityMs + densityMs + recordMs; }
+	};
+
+	// Parts of a step hardware counters are read around.
+	enum class CounterPhase
+	{
+		Reset = 0,
+		Sources,				// Queued forces, emitters and random velocity.
+		UpdateFromPrevious,
+		Diffusion,
+		Advection,
+		MassConservation,
+		Record,
+		Count,
+	};
+
+	// Returns a display name for the passed in phase.
+	inline const char* getCounterPhaseName(CounterPhase phase)
+	{
+		switch (phase)
+		{
+		case CounterPhase::Reset: return "reset";
+		case CounterPhase::Sources: return "sources";
+		case CounterPhase::UpdateFromPrevious: return "updateFromPrevious";
+		case CounterPhase::Diffusion: return "diffusion";
+		case CounterPhase::Advection: return "advection";
+		case CounterPhase::MassConservation: return "massConservation";
+		default: return "record";
+		}
+	}
+
+	// Hardware counts and time of every phase of a step, summed over every call the phase made.
+	struct StepCounters
+	{
+		PerfSample counts[int(CounterPhase::Count)];
+		double ms[int(CounterPhase::Count)] = {};
+
+		// Returns the counts of the whole step.
+		PerfSample getTotal() const
+		{
+			PerfSample total;
+			for (const PerfSample& phase : counts)
+				total += phase;
+			return total;
+		}
+	};
+
 	// Holds the previous and current data for a energy in the simulation
 	struct VoxelData
 	{
@@ -19,6 +221,7 @@ namespace CFD
 			arraySize = totalSize;
 			curr = new float[arraySize];
 			prev = new float[arraySize];
+			ownsMemory = true;
 
 			for(int i = 0; i < arraySize; ++i)
 			{
@@ -27,10 +230,43 @@ namespace CFD
 			}
 		}
 
+		// Wraps externally owned arrays, such as ones carved out of an arena.
+		VoxelData(int sideSize, int totalSize, float* currBuffer, float* prevBuffer)
+		{
+			N = sideSize;
+			arraySize = totalSize;
+			curr = currBuffer;
+			prev = prevBuffer;
+			ownsMemory = false;
+		}
+
+		// Wraps externally owned arrays stored in the passed in format.
+		VoxelData(int sideSize, int totalSize, FieldStorage format, void* currBuffer, void* prevBuffer)
+		{
+			N = sideSize;
+			arraySize = totalSize;
+			storage = format;
+			ownsMemory = false;
+
+			if (storage == FieldStorage::Float32)
+			{
+				curr = static_cast<float*>(currBuffer);
+				prev = static_cast<float*>(prevBuffer);
+			}
+			else
+			{
+				currPacked = static_cast<uint16_t*>(currBuffer);
+				prevPacked = static_cast<uint16_t*>(prevBuffer);
+			}
+		}
+
 		~VoxelData()
 		{
-			delete[] curr;
-			delete[] prev;
+			if (ownsMemory)
+			{
+				delete[] curr;
+				delete[] prev;
+			}
 		}
 
 		// Increases the current value at the passed in position.
@@ -58,7 +294,7 @@ namespace CFD
 
 			if(index != -1)
 			{
-				curr[getIndex(pos)] = val;
+				storeValue(curr, currPacked, index, val);
 			}
 			else
 			{
@@ -73,7 +309,7 @@ namespace CFD
 		{
 			if (index <= arraySize)
 			{
-				curr[index] = val;
+				storeValue(curr, currPacked, index, val);
 			}
 			else
 			{
@@ -90,7 +326,7 @@ namespace CFD
 
 			if (index != -1)
 			{
-				return curr[index];
+				return loadValue(curr, currPacked, index);
 			}
 			else
 			{
@@ -106,7 +342,7 @@ namespace CFD
 		{
 			if (index <= arraySize)
 			{
-				return curr[index];
+				return loadValue(curr, currPacked, index);
 			}
 			else
 			{
@@ -124,7 +360,7 @@ namespace CFD
 
 			if (index != -1)
 			{
-				prev[getIndex(pos)] = val;
+				storeValue(prev, prevPacked, index, val);
 			}
 			else
 			{
@@ -139,7 +375,7 @@ namespace CFD
 		{
 			if (index <= arraySize)
 			{
-				prev[index] = val;
+				storeValue(prev, prevPacked, index, val);
 			}
 			else
 			{
@@ -156,7 +392,7 @@ namespace CFD
 
 			if (index != -1)
 			{
-				return prev[index];
+				return loadValue(prev, prevPacked, index);
 			}
 			else
 			{
@@ -172,7 +408,7 @@ namespace CFD
 		{
 			if (index <= arraySize)
 			{
-				return prev[index];
+				return loadValue(prev, prevPacked, index);
 			}
 			else
 			{
@@ -183,25 +419,81 @@ namespace CFD
 			}
 		}
 
-		// Returns the current array.
+		// Returns the current array, nullptr when the field is stored in 16 bits.
 		float* getCurrentArray() { return curr; }
 
-		// Returns the previous array.
+		// Returns the previous array, nullptr when the field is stored in 16 bits.
 		float* getPreviousArray() { return prev; }
 
+		// Returns the current array in its storage format.
+		void* getCurrentRawArray() { return (storage == FieldStorage::Float32) ? static_cast<void*>(curr) : static_cast<void*>(currPacked); }
+
+		// Returns the previous array in its storage format.
+		void* getPreviousRawArray() { return (storage == FieldStorage::Float32) ? static_cast<void*>(prev) : static_cast<void*>(prevPacked); }
+
+		// Returns the format the arrays are stored in.
+		FieldStorage getStorage() { return storage; }
+
+		// Returns count values of the current or previous array from index on as floats. A 32 bit array in range is returned in place,
+		// anything else is widened into scratch with one array conversion. Values out of range read as zero.
+		const float* readRow(bool previous, int index, int count, float* scratch)
+		{
+			const float* full = previous ? prev : curr;
+			if (full != nullptr && index >= 0 && index + count - 1 <= arraySize)
+				return full + index;
+
+			int begin = std::max<int>(0, -index);
+			int end = std::min<int>(count, arraySize + 1 - index);
+			if (begin >= end)
+			{
+				std::fill(scratch, scratch + count, 0.0f);
+				return scratch;
+			}
+
+			std::fill(scratch, scratch + begin, 0.0f);
+			std::fill(scratch + end, scratch + count, 0.0f);
+
+			if (full != nullptr)
+				std::copy(full + index + begin, full + index + end, scratch + begin);
+			else
+				widenFieldArray(storage, (previous ? prevPacked : currPacked) + index + begin, scratch + begin, size_t(end - begin));
+
+			return scratch;
+		}
+
+		// Returns where count values of the current or previous array from index on are written, in place for a 32 bit array and
+		// scratch otherwise. Pass the result to writeRow once the values are set. The whole run must be in range.
+		float* beginRow(bool previous, int index, float* scratch)
+		{
+			float* full = previous ? prev : curr;
+			return (full != nullptr) ? full + index : scratch;
+		}
+
+		// Narrows a run of values set through beginRow into the array with one array conversion, nothing to do for 32 bit arrays.
+		void writeRow(bool previous, int index, int count, const float* values)
+		{
+			if (storage != FieldStorage::Float32)
+				narrowFieldArray(storage, values, (previous ? prevPacked : currPacked) + index, size_t(count));
+		}
+
+		// Returns the number of values in each array.
+		int getArraySize() { return arraySize; }
+
 		// Swaps the current and previous array pointers.
 		void swapCurrAndPrevArrays() 
 		{
 			float* tmp = prev;
 			prev = curr;
 			curr = tmp;
+
+			uint16_t* tmpPacked = prevPacked;
+			prevPacked = currPacked;
+			currPacked = tmpPacked;
 		};
 		
 		// Toggles logging of errors.
 		void setLogging(bool value) { logging = value; }
 
-	private:
-
 		// Returns the index in a 1D array from the passed in position.
 		int getIndex(const Vector3& voxelPos) {
 			int index = int(N * N * voxelPos.z + voxelPos.y * N + voxelPos.x);
@@ -211,13 +503,43 @@ namespace CFD
 			return  index;
 		};
 
+	private:
+
+		// Reads a value from whichever array matches the storage format, widening to a float.
+		float loadValue(const float* full, const uint16_t* packed, const int index)
+		{
+			switch (storage)
+			{
+			case FieldStorage::Float16: return HalfFloat::halfToFloat(packed[index]);
+			case FieldStorage::BFloat16: return HalfFloat::bfloat16ToFloat(packed[index]);
+			default: return full[index];
+			}
+		}
+
+		// Writes a value into whichever array matches the storage format, narrowing from a float.
+		void storeValue(float* full, uint16_t* packed, const int index, const float val)
+		{
+			switch (storage)
+			{
+			case FieldStorage::Float16: packed[index] = HalfFloat::floatToHalf(val); break;
+			case FieldStorage::BFloat16: packed[index] = HalfFloat::floatToBFloat16(val); break;
+			default: full[index] = val; break;
+			}
+		}
+
 		int N;
 
 		int arraySize = 0;
 
+		FieldStorage storage = FieldStorage::Float32;
+
 		float* curr = nullptr;
 		float* prev = nullptr;
 
+		uint16_t* currPacked = nullptr;
+		uint16_t* prevPacked = nullptr;
+
+		bool ownsMemory = false;
 		bool logging = false;
 	};
 
@@ -232,6 +554,43 @@ namespace CFD
 			velocityZ = new VoxelData(sizeSize, totalSize);
 		};
 
+		// Carves the current and previous arrays of every field out of the passed in arena, in the passed in storage formats.
+		CFDData(const int sizeSize, const int totalSize, Arena& arena, FieldStorage densityStorage = FieldStorage::Float32, FieldStorage velocityStorage = FieldStorage::Float32)
+		{
+			size_t densityBytes = getFieldStorageBytes(densityStorage) * totalSize;
+			size_t velocityBytes = getFieldStorageBytes(velocityStorage) * totalSize;
+
+			// Allocated one statement at a time so the arena layout follows this order.
+			void* densityCurr = arena.allocate(densityBytes, "Density Current");
+			void* densityPrev = arena.allocate(densityBytes, "Density Previous");
+			void* velocityXCurr = arena.allocate(velocityBytes, "VelocityX Current");
+			void* velocityXPrev = arena.allocate(velocityBytes, "VelocityX Previous");
+			void* velocityYCurr = arena.allocate(velocityBytes, "VelocityY Current");
+			void* velocityYPrev = arena.allocate(velocityBytes, "VelocityY Previous");
+			void* velocityZCurr = arena.allocate(velocityBytes, "VelocityZ Current");
+			void* velocityZPrev = arena.allocate(velocityBytes, "VelocityZ Previous");
+
+			density = new VoxelData(sizeSize, totalSize, densityStorage, densityCurr, densityPrev);
+			velocityX = new VoxelData(sizeSize, totalSize, velocityStorage, velocityXCurr, velocityXPrev);
+			velocityY = new VoxelData(sizeSize, totalSize, velocityStorage, velocityYCurr, velocityYPrev);
+			velocityZ = new VoxelData(sizeSize, totalSize, velocityStorage, velocityZCurr, velocityZPrev);
+		};
+
+		// Wraps externally owned arrays, in the order current then previous for density and each velocity component.
+		CFDData(const int sizeSize, const int totalSize, FieldStorage densityStorage, FieldStorage velocityStorage, void* const arrays[8])
+		{
+			density = new VoxelData(sizeSize, totalSize, densityStorage, arrays[0], arrays[1]);
+			velocityX = new VoxelData(sizeSize, totalSize, velocityStorage, arrays[2], arrays[3]);
+			velocityY = new VoxelData(sizeSize, totalSize, velocityStorage, arrays[4], arrays[5]);
+			velocityZ = new VoxelData(sizeSize, totalSize, velocityStorage, arrays[6], arrays[7]);
+		};
+
+		// Returns the arena bytes needed to hold every field at the passed in size and storage formats.
+		static size_t getArenaBytes(const int totalSize, FieldStorage densityStorage = FieldStorage::Float32, FieldStorage velocityStorage = FieldStorage::Float32)
+		{
+			return 2 * Arena::alignSize(getFieldStorageBytes(densityStorage) * totalSize) + 6 * Arena::alignSize(getFieldStorageBytes(velocityStorage) * totalSize);
+		}
+
 		~CFDData()
 		{
 			delete density;
@@ -266,6 +625,14 @@ namespace CFD
 		T value;
 	};
 
+	// Filter used when resampling fields to a new resolution.
+	enum class ResampleFilter
+	{
+		Auto = 0,	// Box when shrinking, trilinear when growing.
+		Trilinear,
+		Box,
+	};
+
 	class CFDGrid : public Component
 	{
 	public:
@@ -275,37 +642,50 @@ namespace CFD
 		// Starts the simulation
 		void Start();
 
-		// Sets the simulation grid size.
-		void setGrid(const int size, const int dim) {
+		// Sets the simulation grid size, reusing the existing field memory when the new grid fits.
+		// Returns false and leaves the current grid untouched if the grid would exceed the memory budget or could not be allocated.
+		bool setGrid(const int size, const int dim);
 
-			if(voxels != nullptr)
-			{
-				delete voxels;
-				delete[] densityTextureData;
-				delete[] velocityTextureData;
+		// Replaces the grid with fields that point into a mapped file, such as a checkpoint. The grid keeps the mapping open for as long as it uses the fields.
+		void setMappedGrid(const int size, const int dim, CFDData* data, MappedFile&& mapping);
 
-				if(voxelDensTex) voxelDensTex->Release();
-				if (voxelDensView) voxelDensView->Release();
-				if (voxelDensResource) voxelDensResource->Release();
-				if (voxelVeloTex) voxelVeloTex->Release();
-				if (voxelVeloView) voxelVeloView->Release();
-				if (voxelVeloResource) voxelVeloResource->Release();
-				if (sampler) sampler->Release();
+		// Returns whether the fields currently live in a mapped file rather than the arena.
+		bool isMapped() { return mappedFields.isOpen(); }
 
-				queuedDensities.clear();
-				queuedVelocities.clear();
-			}
+		// Resamples the current simulation state to a new grid size without restarting, reusing the buffers of previous resizes.
+		// Returns false and leaves the current grid untouched if both grids would not fit the memory budget together or could not be allocated.
+		bool resize(const int newSize, ResampleFilter filter = ResampleFilter::Auto);
 
-			N = size;
-			dimensions = dim;
-			totalN = int(pow((N+2), 3));
-			voxels = new CFDData(N, totalN);
-			densityTextureData = new float[totalN];
-			velocityTextureData = new Vector4[totalN];
-		};
+		// Returns how long the last resize took in milliseconds.
+		double getLastResizeTime() { return lastResizeTime; }
+
+		// Returns the memory a grid of the passed in size would use, itemised per field and including the view buffers.
+		MemoryReport estimateMemory(const int size, const int dim);
+
+		// Adds the buffers whatever draws the grid keeps for a grid of the passed in size to a report, such as the renderer's.
+		// The grid cannot see them itself, so without one the budget only covers the fields.
+		typedef std::function<void(int size, int dim, MemoryReport& report)> ViewMemoryEstimator;
+		void setViewMemoryEstimator(const ViewMemoryEstimator& estimator) { viewMemoryEstimator = estimator; }
+
+		// Returns the memory used by the current grid, including buffers kept around for resizing.
+		MemoryReport getMemoryReport();
+
+		// Returns the report of the last setGrid or resize call, including rejected ones.
+		const MemoryReport& getLastSetGridReport() { return lastSetGridReport; }
+
+		// Sets the format density is stored in, takes effect on the next setGrid.
+		void setDensityStorage(FieldStorage val) { densityStorage = val; }
+		FieldStorage getDensityStorage() { return densityStorage; }
+
+		// Sets the format all three velocity components are stored in, takes effect on the next setGrid.
+		void setVelocityStorage(FieldStorage val) { velocityStorage = val; }
+		FieldStorage getVelocityStorage() { return velocityStorage; }
+
+		// Sets the maximum bytes a grid may use, zero disables the budget.
+		void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+		size_t getMemoryBudget() { return memoryBudget; }
 
 		void Update(float deltaTime);
-		void Render();
 
 		// Adds density at the passed in position.
 		void addDensity(const Vector3& pos, const float val);
@@ -329,21 +709,33 @@ namespace CFD
 		bool getSimulating() { return simulating; }
 
 		// Sets the diffusion rate of the density in the simulation.
-		void setDiffusionRate(float val) { diffusionRate = val; }
+		void setDiffusionRate(float val);
 
 		// Returns the diffusion rate of the density in the simulation.
 		float getDiffusionRate() { return diffusionRate; }
 
 		// Sets the viscocity of the velocity in the simulation.
-		void setViscocity(float val) { viscocity = val; }
+		void setViscocity(float val);
 
 		// Returns the viscocity of the velocity in the simulation.
 		float getViscocity() { return viscocity; }
 
 		// Sets the random velocity min max used in the turbulence simulation/
-		void setRandomVelocityMinMax(int val) { randomVelocityMinMax = val; };
+		void setRandomVelocityMinMax(int val);
+		int getRandomVelocityMinMax() { return randomVelocityMinMax; }
+
+		// Sets the seed the turbulence is drawn from, the same seed and steps always give the same turbulence on every thread count and platform.
+		void setRandomSeed(uint64_t val);
+		uint64_t getRandomSeed() { return randomSeed; }
+
+		// Sets the procedural curl noise turbulence added every step, drawn from the random seed.
+		void setTurbulence(const TurbulenceSettings& val);
+		const TurbulenceSettings& getTurbulence() { return turbulence; }
 
-		void setDimensions(int val) { dimensions = val; }
+		// Returns the cost of the turbulence on the last step.
+		const TurbulenceStats& getTurbulenceStats() { return curlNoise.getStats(); }
+
+		void setDimensions(int val);
 		int getDimensions() { return dimensions; }
 
 		// Returns the voxel at the passed in position.
@@ -352,6 +744,81 @@ namespace CFD
 		// Returns all the voxel data in the simulation.
 		CFDData* getAllVoxelData() { return voxels; }
 
+		// Returns the emitters that were rasterised into the grid on the last step.
+		const std::vector<CFDEmitter*>& getEmitters() { return emitters; }
+
+		// Returns the total time spent rasterising emitters on the last step in milliseconds.
+		double getEmitterRasteriseTime() { return emitterRasteriseTime; }
+
+		// Returns the fixed timestep used for each simulation step.
+		float getTimeStep() { return timeStep; }
+
+		// Returns the number of simulation steps taken since the grid was last set.
+		uint64_t getStepCount() { return stepCount; }
+
+		// Sets the steps already taken, so a run restored from a checkpoint draws the same turbulence as the run that saved it.
+		void setStepCount(uint64_t val) { stepCount = val; }
+
+		// Returns the sources added on every step, the calls to addDensity and addVelocity and the random velocity drawn so far.
+		const std::vector<QueueItem<float>>& getQueuedDensities() { return queuedDensities; }
+		const std::vector<QueueItem<Vector3>>& getQueuedVelocities() { return queuedVelocities; }
+
+		// Replaces the sources added on every step, so a run restored from a checkpoint keeps adding what the run that saved it did.
+		void setQueuedSources(const std::vector<QueueItem<float>>& densities, const std::vector<QueueItem<Vector3>>& velocities);
+
+		// Returns how long each phase of the last step took.
+		const StepTimings& getLastStepTimings() { return lastStepTimings; }
+
+		// Reads the passed in counters around every phase of the following steps, nullptr stops. The grid does not own them.
+		void setPerfCounters(const PerfCounters* counters) { perfCounters = counters; }
+		const PerfCounters* getPerfCounters() { return perfCounters; }
+
+		// Returns the hardware counts of each phase of the last step, empty without counters.
+		const StepCounters& getLastStepCounters() { return lastStepCounters; }
+
+		// Hands the inputs of the following steps to the passed in log, or lets it make them on a replay, nullptr stops.
+		// The grid does not own it, CFDInputLog attaches and detaches itself and the grid stops it when destroyed.
+		void setInputLog(CFDInputLog* log) { inputLog = log; }
+		CFDInputLog* getInputLog() { return inputLog; }
+
+		// Requests the field arena be backed by huge pages, takes effect on the next setGrid that reallocates.
+		void setUseHugePages(bool val) { arena.setUseHugePages(val); resizeArena.setUseHugePages(val); }
+		bool getUseHugePages() { return arena.getUseHugePages(); }
+
+		// Sets the number of threads grid wide loops are split across, zero uses every hardware thread.
+		void setThreadCount(int val) { threadPool.setThreadCount(val); }
+		int getThreadCount() { return threadPool.getThreadCount(); }
+
+		// Returns the pool grid wide loops are split across.
+		ThreadPool& getThreadPool() { return threadPool; }
+
+		// Returns the arena all fields are carved from.
+		Arena& getArena() { return arena; }
+
+		// Runs a single kernel once with the fixed timestep, without swapping any arrays. Density is the field for every kernel
+		// but mass conservation, which works on the velocity. Only meant for timing, a step is not equivalent to any sequence of these.
+		void runKernel(SolverKernel kernel);
+
+		// Returns the cells a kernel works on, the visible cells or for the boundary kernel the edge cells.
+		static double getKernelCells(SolverKernel kernel, int size, int dims);
+
+		// Returns the bytes a kernel has to read and write at the least, every value touched once per sweep and neighbours served from cache.
+		// fieldBytes is the storage of the field the kernel works on, velocityBytes that of the velocity it reads.
+		static double getKernelBytes(SolverKernel kernel, int size, int dims, size_t fieldBytes, size_t velocityBytes);
+
+		// Returns the floating point operations a kernel does, counted from its source. Index arithmetic, clamps and
+		// loads of values the kernel never uses are left out, so this is the useful work rather than what the compiler emits.
+		static double getKernelFlops(SolverKernel kernel, int size, int dims);
+
+		// Returns the bytes a whole step has to move at the least with the current size and storage formats.
+		double getStepBytes();
+
+		// Returns the floating point operations of a whole step with the current size.
+		double getStepFlops();
+
+		// Returns a human readable table of where each field lives in the arena.
+		std::string getMemoryLayoutReport() { return arena.getLayoutReport(); }
+
 		// Enables/Disables logging.
 		void setLogging(const bool value) {
 			voxels->density->setLogging(value);
@@ -363,6 +830,9 @@ namespace CFD
 		}
 
 	private:
+
+		// Resamples the current or previous array of a field into a field of a different size.
+		void resampleField(VoxelData* source, VoxelData* destination, int sourceN, int destinationN, bool previous, ResampleFilter filter);
 		
 		// Resets all the current frames values of all data in the simulation.
 		void resetValuesForCurrentFrame();
@@ -370,9 +840,21 @@ namespace CFD
 		// Adds random velocity at random points within the simulation, used to simulate turbulence.
 		void addRandomVelocity();
 
+		// Adds the curl noise turbulence, if enabled.
+		void addTurbulence();
+
 		// Adds forces into the simulation from the queued force lists.
 		void updateForces();
 
+		// Rasterises all emitters attached to the owning entity into the current frame.
+		void updateEmitters();
+
+		// Hands the finished step to every recorder attached to the owning entity.
+		void updateRecorders();
+
+		// Presents the next frame of an open playback attached to the owning entity. Returns false if there is none and the solver should step.
+		bool updatePlayback();
+
 		// Simulates Density for a timestep.
 		void densityStep(float deltaTime);
 
@@ -382,16 +864,38 @@ namespace CFD
 		// Updates the current frames values incrementally with the previous frames data.
 		void updateFromPreviousFrame(VoxelData* data, float deltaTime)
 		{
+			CFD_TRACE_SCOPE("CFDGrid::updateFromPreviousFrame");
+			PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::UpdateFromPrevious)], lastStepCounters.ms[int(CounterPhase::UpdateFromPrevious)]);
+
 			int size = int(pow(N+2, dimensions));
-			for (int i = 0; i < size; i++)
+			threadPool.parallelFor(0, size, [&](int rangeBegin, int rangeEnd)
 			{
-				data->increaseCurrentValue(i, data->getPreviousValue(i) * deltaTime);
-			}
+				float previousScratch[RowLength];
+				float currentScratch[RowLength];
+
+				for (int row = rangeBegin; row < rangeEnd; row += RowLength)
+				{
+					int count = std::min<int>(RowLength, rangeEnd - row);
+					const float* previous = data->readRow(true, row, count, previousScratch);
+					const float* current = data->readRow(false, row, count, currentScratch);
+					float* result = data->beginRow(false, row, currentScratch);
+
+					for (int i = 0; i < count; i++)
+					{
+						result[i] = current[i] + previous[i] * deltaTime;
+					}
+
+					data->writeRow(false, row, count, result);
+				}
+			});
 		}
 
 		// Updates diffusion for the data passed in, in accordance with the diffusion value passed in.
 		void updateDiffusion(VoxelData* data, float boundary, float diff, float deltaTime) 
 		{
+			CFD_TRACE_SCOPE("CFDGrid::updateDiffusion");
+			PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Diffusion)], lastStepCounters.ms[int(CounterPhase::Diffusion)]);
+
 			/*
 			What is going on here:
 				- Loop through every voxel in the grid.
@@ -403,64 +907,74 @@ namespace CFD
 
 			float k = deltaTime * diff * float(pow(N, dimensions));	// k = ammount of change we want to see in the diffusion step.
 			float c = (dimensions > 2) ? 1 + 6 * k : 1 + 4 * k;     // c = overall change, must be more than k's coefficents so 1+4 for 2D (4 coefficients) and 1+6 for 3D
-		
+
+			switch (data->getStorage())
+			{
+			case FieldStorage::Float16:
+				if (HalfFloat::hasHardwareConversion())
+					diffusionSweeps<FieldStorage::Float16, HardwareHalfTraits>(data, int(boundary), k, c);
+				else
+					diffusionSweeps<FieldStorage::Float16>(data, int(boundary), k, c);
+				break;
+			case FieldStorage::BFloat16: diffusionSweeps<FieldStorage::BFloat16>(data, int(boundary), k, c); break;
+			default: diffusionSweeps<FieldStorage::Float32>(data, int(boundary), k, c); break;
+			}
+		};
+
+		// Gauss-Seidel sweeps of updateDiffusion. Each value reads the neighbours this sweep already wrote, so it runs in order one value
+		// at a time, with the storage format fixed for the whole loop. fp16 converts with F16C when the CPU has it, as every value is converted.
+		template<FieldStorage Storage, typename Traits = FieldStorageTraits<Storage>>
+		void diffusionSweeps(VoxelData* data, int boundary, float k, float c)
+		{
+			FieldArray<Storage, Traits> current(data->getCurrentRawArray(), data->getArraySize());
+			FieldArray<Storage, Traits> previous(data->getPreviousRawArray(), data->getArraySize());
+
 			for (int i = 0; i < 20; i++)		// Gauss-Seidel relaxation interative steps.
 			{
 				for(int x = 0; x < N; x++)
 				{
 					for (int y = 0; y < N; y++)
 					{
+						// The value below is the one the last z stored, so it is carried over rather than read back and converted again.
+						float z0 = current.load(N * y + x - N * N);
+
 						for(int z = 0; z < N; z++)
 						{
-							float totalSurroundingValues;
-							float x0, x1, y0, y1, z0, z1;
-							float prev;
-							float value;
-							if (dimensions > 2)
-							{
-								totalSurroundingValues = data->getCurrentValue(Vector3(x - 1, y, z)) + data->getCurrentValue(Vector3(x + 1, y, z))
-									+ data->getCurrentValue(Vector3(x, y - 1, z)) + data->getCurrentValue(Vector3(x, y + 1, z))
-									+ data->getCurrentValue(Vector3(x, y, z - 1)) + data->getCurrentValue(Vector3(x, y, z + 1)); // z.
+							int index = N * N * z + N * y + x;
 
-								x0 = data->getCurrentValue(Vector3(x - 1, y, z));
-								x1 = data->getCurrentValue(Vector3(x + 1, y, z));
+							float x0 = current.load(index - 1);
+							float x1 = current.load(index + 1);
 
-								y0 = data->getCurrentValue(Vector3(x, y - 1, z));
-								y1 = data->getCurrentValue(Vector3(x, y + 1, z));
+							float y0 = current.load(index - N);
+							float y1 = current.load(index + N);
 
-								z0 = data->getCurrentValue(Vector3(x, y, z - 1));
-								z1 = data->getCurrentValue(Vector3(x, y, z + 1));
+							float prev = previous.load(index);
 
-								prev = data->getPreviousValue(Vector3(x, y, z));
+							float value;
+							if (dimensions > 2)
+							{
+								float z1 = current.load(index + N * N);
 
 								value = (prev + k * (x0 + x1 + y0 + y1 + z0 + z1)) / c;
 							}
 							else
 							{
-								totalSurroundingValues = data->getCurrentValue(Vector3(x - 1, y, z)) + data->getCurrentValue(Vector3(x + 1, y, z))
-									+ data->getCurrentValue(Vector3(x, y - 1, z)) + data->getCurrentValue(Vector3(x, y + 1, z)); // z.
-
-								x0 = data->getCurrentValue(Vector3(x - 1, y, z));
-								x1 = data->getCurrentValue(Vector3(x + 1, y, z));
-
-								y0 = data->getCurrentValue(Vector3(x, y - 1, z));
-								y1 = data->getCurrentValue(Vector3(x, y + 1, z));
-
-								prev = data->getPreviousValue(Vector3(x, y, z));
-
 								value = (prev + k * (x0 + x1 + y0 + y1)) / c;
 							}
-							data->setCurrentValue(Vector3(x, y, z), value);
+							z0 = current.store(index, value);
 						}
 					}
 				}
-				updateCurrentDataBoundary(data, int(boundary));
+				updateCurrentDataBoundary(data, boundary);
 			}
-		};
+		}
 
 		// Updates advection for the data passed in, in accordance with the velocity data passed.
 		void updateAdvection(VoxelData* data, VoxelData* velocityDataX, VoxelData* velocityDataY, VoxelData* velocityDataZ, float boundary, float deltaTime)
 		{
+			CFD_TRACE_SCOPE("CFDGrid::updateAdvection");
+			PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::Advection)], lastStepCounters.ms[int(CounterPhase::Advection)]);
+
 			/*
 			What is going on here:
 				- Loop through every voxel in the grid.
@@ -470,113 +984,244 @@ namespace CFD
 			*/
 
 			float dt0;					// Deltatime of one iteration through the whole simulation.
-			Vector3 backtracePosition;
-			Vector3 absolutePosition;	// Rounded backtrace position.
 
 			dt0 = deltaTime * float(pow(N, dimensions));
 
-			for (int x = 0; x < N; ++x)
+			switch (data->getStorage())
 			{
-				for (int y = 0; y < N; ++y)
-				{
-					for (int z = 0; z < N; ++z)
-					{
-						float a, b;
-						float interpX, interpY, interpZ;
-						float value;
+			case FieldStorage::Float16:
+				if (HalfFloat::hasHardwareConversion())
+					advectRows<FieldStorage::Float16, HardwareHalfTraits>(data, velocityDataX, velocityDataY, velocityDataZ, dt0);
+				else
+					advectRows<FieldStorage::Float16>(data, velocityDataX, velocityDataY, velocityDataZ, dt0);
+				break;
+			case FieldStorage::BFloat16: advectRows<FieldStorage::BFloat16>(data, velocityDataX, velocityDataY, velocityDataZ, dt0); break;
+			default: advectRows<FieldStorage::Float32>(data, velocityDataX, velocityDataY, velocityDataZ, dt0); break;
+			}
 
-						if(dimensions > 2)
-						{
-							backtracePosition = Vector3(float(x - dt0 * velocityDataX->getCurrentValue(Vector3(x, y, z))),
-								float(y - dt0 * velocityDataY->getCurrentValue(Vector3(x, y, z))),
-								float(z - dt0 * velocityDataZ->getCurrentValue(Vector3(x, y, z))));
+			updateCurrentDataBoundary(data, int(boundary));
+		};
 
-							Math::clamp(backtracePosition, 0.5f, N + 0.5f);
+		// Voxel loop of updateAdvection. The velocity at each voxel and the result are converted a row at a time, the previous values
+		// around the backtrace are scattered so they are read one at a time in the data's storage format.
+		template<FieldStorage Storage, typename Traits = FieldStorageTraits<Storage>>
+		void advectRows(VoxelData* data, VoxelData* velocityDataX, VoxelData* velocityDataY, VoxelData* velocityDataZ, float dt0)
+		{
+			FieldArray<Storage, Traits> previous(data->getPreviousRawArray(), data->getArraySize());
 
-							absolutePosition = Vector3(int(backtracePosition.x), int(backtracePosition.y), int(backtracePosition.z));
+			// Same index as VoxelData::getIndex, the backtrace cells are held as floats.
+			auto previousValue = [&](float x, float y, float z) { return previous.load(int(N * N * z + y * N + x)); };
 
-							// Interpolate between all neighbours
-							a = data->getPreviousValue(Vector3(absolutePosition.x + 1, absolutePosition.y, absolutePosition.z));	// Left
-							b = data->getPreviousValue(Vector3(absolutePosition.x - 1, absolutePosition.y, absolutePosition.z)); // Right
+			// The 2D solver backtraces z along the y velocity, z is always zero there so it only picks the slice.
+			VoxelData* velocityAlongZ = (dimensions > 2) ? velocityDataZ : velocityDataY;
 
-							interpX = Math::lerp(a, b, backtracePosition.x);
+			// Every voxel only reads the velocity at its own position and the previous frame, so rows are independent.
+			threadPool.parallelFor(0, N, [&](int rangeBegin, int rangeEnd)
+			{
+				float scratchX[RowLength];
+				float scratchY[RowLength];
+				float scratchZ[RowLength];
+				float scratchResult[RowLength];
 
-							a = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y + 1, absolutePosition.z));	// up
-							b = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y - 1, absolutePosition.z)); // down
+				for (int z = rangeBegin; z < rangeEnd; ++z)
+				{
+					for (int y = 0; y < N; ++y)
+					{
+						for (int rowX = 0; rowX < N; rowX += RowLength)
+						{
+							int count = std::min<int>(RowLength, N - rowX);
+							int row = N * N * z + N * y + rowX;
 
-							interpY = Math::lerp(a, b, backtracePosition.y);
+							// When the data is a velocity component its row is written in place, each value is read before it is replaced.
+							const float* velocityX = velocityDataX->readRow(false, row, count, scratchX);
+							const float* velocityY = velocityDataY->readRow(false, row, count, scratchY);
+							const float* velocityZ = velocityAlongZ->readRow(false, row, count, scratchZ);
+							float* result = data->beginRow(false, row, scratchResult);
 
-							a = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y, absolutePosition.z + 1));	// forward
-							b = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y, absolutePosition.z - 1)); // back
+							for (int i = 0; i < count; ++i)
+							{
+								int x = rowX + i;
 
-							interpZ = Math::lerp(a, b, backtracePosition.z);
+								Vector3 backtracePosition = Vector3(float(x - dt0 * velocityX[i]), float(y - dt0 * velocityY[i]), float(z - dt0 * velocityZ[i]));
+								Vector3 absolutePosition = Vector3(int(backtracePosition.x), int(backtracePosition.y), int(backtracePosition.z));	// Rounded backtrace position.
 
-							value = (interpX + interpY + interpZ);
-						}
-						else
-						{
-							backtracePosition = Vector3(float(x - dt0 * velocityDataX->getCurrentValue(Vector3(x, y, z))), 
-														float(y - dt0 * velocityDataY->getCurrentValue(Vector3(x, y, z))),
-														float(z - dt0 * velocityDataY->getCurrentValue(Vector3(x, y, z))));
+								// Interpolate between all neighbours
+								float a = previousValue(absolutePosition.x + 1, absolutePosition.y, absolutePosition.z);	// Left
+								float b = previousValue(absolutePosition.x - 1, absolutePosition.y, absolutePosition.z);	// Right
 
-							Math::clamp(backtracePosition, 0.5f, N + 0.5f);
+								float interpX = Math::lerp(a, b, backtracePosition.x);
 
-							absolutePosition = Vector3(int(backtracePosition.x), int(backtracePosition.y), int(backtracePosition.z));
+								a = previousValue(absolutePosition.x, absolutePosition.y + 1, absolutePosition.z);		// up
+								b = previousValue(absolutePosition.x, absolutePosition.y - 1, absolutePosition.z);		// down
 
-							// Interpolate between all neighbours
+								float interpY = Math::lerp(a, b, backtracePosition.y);
 
-							a = data->getPreviousValue(Vector3(absolutePosition.x + 1, absolutePosition.y, absolutePosition.z));	// Left
-							b = data->getPreviousValue(Vector3(absolutePosition.x - 1, absolutePosition.y, absolutePosition.z)); // Right
+								float value;
+								if (dimensions > 2)
+								{
+									a = previousValue(absolutePosition.x, absolutePosition.y, absolutePosition.z + 1);	// forward
+									b = previousValue(absolutePosition.x, absolutePosition.y, absolutePosition.z - 1);	// back
 
-							interpX = Math::lerp(a, b, backtracePosition.x);
+									float interpZ = Math::lerp(a, b, backtracePosition.z);
 
-							a = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y + 1, absolutePosition.z));	// up
-							b = data->getPreviousValue(Vector3(absolutePosition.x, absolutePosition.y - 1, absolutePosition.z)); // down
+									value = (interpX + interpY + interpZ);
+								}
+								else
+								{
+									value = (interpX + interpY);
+								}
 
-							interpY = Math::lerp(a, b, backtracePosition.y);
+								result[i] = Math::clamp(value, 0.0f, FLT_MAX);
+							}
 
-							value = (interpX + interpY);
+							data->writeRow(false, row, count, result);
 						}
-						data->setCurrentValue(Vector3(x, y, z), Math::clamp(value, 0.0f, FLT_MAX));
 					}
 				}
-			}
-			updateCurrentDataBoundary(data, int(boundary));
-		};
+			});
+		}
 
 		// Updates the velocity to be mass-conserving using Hodge-decomposition.
 		void updateMassConservation(VoxelData* velocityX, VoxelData* velocityY, VoxelData* velocityZ, float deltaTime)
 		{
-			UNREFERENCED_PARAMETER(deltaTime);
+			CFD_TRACE_SCOPE("CFDGrid::updateMassConservation");
+			PerfScope perfScope(perfCounters, lastStepCounters.counts[int(CounterPhase::MassConservation)], lastStepCounters.ms[int(CounterPhase::MassConservation)]);
+
+			(void)deltaTime;
 
 			/*
 			What is going on here:
 				- I do not understand this too well but it makes the velocity mass-conserving by subtracting the gradient field from the imcrompressible field.
 			*/
 
-			for(int x = 0; x < N; x++)
+			// Only the current velocity is read and only the previous arrays are written, so rows are independent.
+			threadPool.parallelFor(0, N, [&](int rangeBegin, int rangeEnd)
 			{
-				for (int y = 0; y < N; y++)
+				float scratchLeftRight[RowLength + 2];
+				float scratchDown[RowLength];
+				float scratchUp[RowLength];
+				float scratchBack[RowLength];
+				float scratchForward[RowLength];
+				float scratchDivergence[RowLength];
+				float scratchZero[RowLength];
+
+				for (int z = rangeBegin; z < rangeEnd; z++)
 				{
-					for (int z = 0; z < N; z++)
+					for (int y = 0; y < N; y++)
 					{
-						float xDiff = velocityX->getCurrentValue(Vector3(x + 1, y, z)) - velocityX->getCurrentValue(Vector3(x - 1, y, z));
-						float yDiff = velocityY->getCurrentValue(Vector3(x, y+1, z)) - velocityY->getCurrentValue(Vector3(x, y-1, z));
-						float zDiff = velocityZ->getCurrentValue(Vector3(x, y, z+1)) - velocityZ->getCurrentValue(Vector3(x, y, z-1)); // ?
+						for (int rowX = 0; rowX < N; rowX += RowLength)
+						{
+							int count = std::min<int>(RowLength, N - rowX);
+							int row = N * N * z + N * y + rowX;
+
+							// Starts one before the row, so x - 1 is at i and x + 1 at i + 2.
+							const float* leftRight = velocityX->readRow(false, row - 1, count + 2, scratchLeftRight);
+							const float* down = velocityY->readRow(false, row - N, count, scratchDown);
+							const float* up = velocityY->readRow(false, row + N, count, scratchUp);
+							const float* back = velocityZ->readRow(false, row - N * N, count, scratchBack);
+							const float* forward = velocityZ->readRow(false, row + N * N, count, scratchForward);
 
-						float value = -0.5f * (xDiff + yDiff + zDiff) / N;
+							float* divergence = velocityY->beginRow(true, row, scratchDivergence);
+							float* zero = velocityX->beginRow(true, row, scratchZero);
 
-						velocityY->setPreviousValue(Vector3(x, y, z), value);
+							for (int i = 0; i < count; i++)
+							{
+								float xDiff = leftRight[i + 2] - leftRight[i];
+								float yDiff = up[i] - down[i];
+								float zDiff = forward[i] - back[i]; // ?
+
+								divergence[i] = -0.5f * (xDiff + yDiff + zDiff) / N;
 
-						velocityX->setPreviousValue(Vector3(x, y, z), 0);
+								zero[i] = 0;
+							}
+
+							velocityY->writeRow(true, row, count, divergence);
+							velocityX->writeRow(true, row, count, zero);
+						}
 					}
 				}
-			}
+			});
 
 			updatePreviousDataBoundary(velocityX, 0);
 			updatePreviousDataBoundary(velocityY, 0);
 			updatePreviousDataBoundary(velocityZ, 0);
 
+			// All three components share a storage format.
+			switch (velocityX->getStorage())
+			{
+			case FieldStorage::Float16:
+				if (HalfFloat::hasHardwareConversion())
+					pressureSweeps<FieldStorage::Float16, HardwareHalfTraits>(velocityX, velocityY);
+				else
+					pressureSweeps<FieldStorage::Float16>(velocityX, velocityY);
+				break;
+			case FieldStorage::BFloat16: pressureSweeps<FieldStorage::BFloat16>(velocityX, velocityY); break;
+			default: pressureSweeps<FieldStorage::Float32>(velocityX, velocityY); break;
+			}
+
+			// Every voxel only changes its own current velocity from the previous arrays, so rows are independent.
+			threadPool.parallelFor(0, N, [&](int rangeBegin, int rangeEnd)
+			{
+				float scratchLeftRight[RowLength + 2];
+				float scratchUp[RowLength];
+				float scratchForward[RowLength];
+				float scratchX[RowLength];
+				float scratchY[RowLength];
+				float scratchZ[RowLength];
+
+				for (int z = rangeBegin; z < rangeEnd; z++)
+				{
+					for (int y = 0; y < N; y++)
+					{
+						for (int rowX = 0; rowX < N; rowX += RowLength)
+						{
+							int count = std::min<int>(RowLength, N - rowX);
+							int row = N * N * z + N * y + rowX;
+
+							const float* leftRight = velocityX->readRow(true, row - 1, count + 2, scratchLeftRight);
+							const float* up = velocityX->readRow(true, row + N, count, scratchUp);
+							const float* forward = velocityX->readRow(true, row + N * N, count, scratchForward);
+
+							const float* currentX = velocityX->readRow(false, row, count, scratchX);
+							const float* currentY = velocityY->readRow(false, row, count, scratchY);
+							const float* currentZ = velocityZ->readRow(false, row, count, scratchZ);
+
+							float* resultX = velocityX->beginRow(false, row, scratchX);
+							float* resultY = velocityY->beginRow(false, row, scratchY);
+							float* resultZ = velocityZ->beginRow(false, row, scratchZ);
+
+							for (int i = 0; i < count; i++)
+							{
+								float xDiff = leftRight[i + 2] - leftRight[i];
+								float yDiff = up[i] - up[i];
+								float zDiff = forward[i] - forward[i];
+
+								resultX[i] = currentX[i] - 0.5f * N * xDiff;
+								resultY[i] = currentY[i] - 0.5f * N * yDiff;
+								resultZ[i] = currentZ[i] - 0.5f * N * zDiff;
+							}
+
+							velocityX->writeRow(false, row, count, resultX);
+							velocityY->writeRow(false, row, count, resultY);
+							velocityZ->writeRow(false, row, count, resultZ);
+						}
+					}
+				}
+			});
+
+			updateCurrentDataBoundary(velocityX, 1);
+			updateCurrentDataBoundary(velocityY, 2);
+			updateCurrentDataBoundary(velocityZ, 3);
+		}
+
+		// Gauss-Seidel sweeps of updateMassConservation, in order one value at a time like diffusionSweeps.
+		template<FieldStorage Storage, typename Traits = FieldStorageTraits<Storage>>
+		void pressureSweeps(VoxelData* velocityX, VoxelData* velocityY)
+		{
+			FieldArray<Storage, Traits> pressure(velocityX->getCurrentRawArray(), velocityX->getArraySize());
+			FieldArray<Storage, Traits> divergence(velocityX->getPreviousRawArray(), velocityX->getArraySize());
+			FieldArray<Storage, Traits> neighbours(velocityY->getCurrentRawArray(), velocityY->getArraySize());
+
 			float k = 1;
 			float c = 4;
 
@@ -588,76 +1233,41 @@ namespace CFD
 					{
 						for (int z = 0; z < N; z++)
 						{
-							float totalSurroundingValues;
-							float x0, x1, y0, y1, z0, z1;
-							float prev;
-							float value;
-							if (dimensions > 2)
-							{
-								totalSurroundingValues = velocityX->getCurrentValue(Vector3(x - 1, y, z)) + velocityX->getCurrentValue(Vector3(x + 1, y, z))
-									+ velocityX->getCurrentValue(Vector3(x, y - 1, z)) + velocityX->getCurrentValue(Vector3(x, y + 1, z))
-									+ velocityX->getCurrentValue(Vector3(x, y, z - 1)) + velocityX->getCurrentValue(Vector3(x, y, z + 1)); // z.
+							int index = N * N * z + N * y + x;
 
-								x0 = velocityY->getCurrentValue(Vector3(x - 1, y, z));
-								x1 = velocityY->getCurrentValue(Vector3(x + 1, y, z));
+							float x0 = neighbours.load(index - 1);
+							float x1 = neighbours.load(index + 1);
 
-								y0 = velocityY->getCurrentValue(Vector3(x, y - 1, z));
-								y1 = velocityY->getCurrentValue(Vector3(x, y + 1, z));
+							float y0 = neighbours.load(index - N);
+							float y1 = neighbours.load(index + N);
 
-								z0 = velocityY->getCurrentValue(Vector3(x, y, z - 1));
-								z1 = velocityY->getCurrentValue(Vector3(x, y, z + 1));
+							float prev = divergence.load(index);
 
-								prev = velocityX->getPreviousValue(Vector3(x, y, z));
+							float value;
+							if (dimensions > 2)
+							{
+								float z0 = neighbours.load(index - N * N);
+								float z1 = neighbours.load(index + N * N);
 
 								value = (prev + k * (x0 + x1 + y0 + y1 + z0 + z1)) / c;
 							}
 							else
 							{
-								totalSurroundingValues = velocityX->getCurrentValue(Vector3(x - 1, y, z)) + velocityX->getCurrentValue(Vector3(x + 1, y, z))
-									+ velocityX->getCurrentValue(Vector3(x, y - 1, z)) + velocityX->getCurrentValue(Vector3(x, y + 1, z)); // z.
-
-								x0 = velocityY->getCurrentValue(Vector3(x - 1, y, z));
-								x1 = velocityY->getCurrentValue(Vector3(x + 1, y, z));
-
-								y0 = velocityY->getCurrentValue(Vector3(x, y - 1, z));
-								y1 = velocityY->getCurrentValue(Vector3(x, y + 1, z));
-
-								prev = velocityX->getPreviousValue(Vector3(x, y, z));
-
 								value = (prev + k * (x0 + x1 + y0 + y1)) / c;
 							}
-							velocityX->setCurrentValue(Vector3(x, y, z), value);
+							pressure.store(index, value);
 						}
 					}
 				}
 				updateCurrentDataBoundary(velocityX, 0);
 			}
-
-			for (int x = 0; x < N; x++)
-			{
-				for (int y = 0; y < N; y++)
-				{
-					for (int z = 0; z < N; z++)
-					{
-						float xDiff = velocityX->getPreviousValue(Vector3(x + 1, y, z)) - velocityX->getPreviousValue(Vector3(x - 1, y, z));
-						float yDiff = velocityX->getPreviousValue(Vector3(x, y+1, z)) - velocityX->getPreviousValue(Vector3(x, y+1, z));
-						float zDiff = velocityX->getPreviousValue(Vector3(x, y, z+1)) - velocityX->getPreviousValue(Vector3(x, y, z+1));
-
-						velocityX->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * xDiff);
-						velocityY->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * yDiff);
-						velocityZ->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * zDiff);
-					}
-				}
-			}
-
-			updateCurrentDataBoundary(velocityX, 1);
-			updateCurrentDataBoundary(velocityY, 2);
-			updateCurrentDataBoundary(velocityZ, 3);
 		}
 
 		// Updates the voxel data's current data to enforce a boundary.
 		void updateCurrentDataBoundary(VoxelData* data, int boundary)
 		{
+			CFD_TRACE_SCOPE("CFDGrid::updateCurrentDataBoundary");
+
 			/*
 			What is going on here:
 				- Sets the data to be constrained by boundaries on X,Y,Z.
@@ -680,6 +1290,8 @@ namespace CFD
 		// Updates the voxel data's previous data to enforce a boundary.
 		void updatePreviousDataBoundary(VoxelData* data, int boundary)
 		{
+			CFD_TRACE_SCOPE("CFDGrid::updatePreviousDataBoundary");
+
 			/*
 			What is going on here:
 				- Sets the data to be constrained by boundaries on X,Y,Z.
@@ -705,6 +1317,9 @@ namespace CFD
 		// Sets all density current values to a reflection of their X,Y,Z coords to debug array alignment.
 		void setDebugDensityValues();
 
+		// Values the kernels convert between storage and floats at a time, kept on the stack of each thread.
+		static const int RowLength = 64;
+
 		bool simulating = false;
 		bool logging = false;
 
@@ -719,36 +1334,57 @@ namespace CFD
 		float viscocity = 0.0f;
 		float diffusionRate = 0.5f;
 		int randomVelocityMinMax = 0;
+		uint64_t randomSeed = 0;
+
+		TurbulenceSettings turbulence;
+		CurlNoise curlNoise;
+		float timeStep = 0.1f;
+		uint64_t stepCount = 0;
+		StepTimings lastStepTimings;
+
+		// Hardware counters read around each phase, nullptr when not counting.
+		const PerfCounters* perfCounters = nullptr;
+		StepCounters lastStepCounters;
+
+		// Log the inputs are recorded into or replayed from, nullptr when neither.
+		CFDInputLog* inputLog = nullptr;
 
 		// Data held within the CFD Grid.
 
 		CFDData* voxels = nullptr;
 
-		// ------------ Input Data.
+		// Single aligned block all fields are carved out of.
+		Arena arena;
 
-		std::vector<QueueItem<float>> queuedDensities;
-		std::vector<QueueItem<Vector3>> queuedVelocities;
+		// File the fields point into after restoring a checkpoint, copy on write so stepping never touches the file.
+		MappedFile mappedFields;
 
-		// ------------ Texture Data.
+		// Block the next resolution is built in during a resize, swapped with the main arena afterwards.
+		Arena resizeArena;
+		double lastResizeTime = 0.0;
 
-		float* densityTextureData = nullptr;
-		Vector4* velocityTextureData = nullptr;
+		// Threads grid wide loops are split across.
+		ThreadPool threadPool;
 
-		// ------------ Textures.
+		// Storage formats used the next time the fields are allocated.
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
 
-		ID3D11SamplerState* sampler = nullptr;
+		// ------------ Memory Budget.
 
-		// Density
+		size_t memoryBudget = size_t(2) * 1024 * 1024 * 1024;
+		MemoryReport lastSetGridReport;
+		ViewMemoryEstimator viewMemoryEstimator;
 
-		ID3D11Texture3D* voxelDensTex = nullptr;
-		ID3D11Resource* voxelDensResource = nullptr;
-		ID3D11ShaderResourceView* voxelDensView = nullptr;
+		// ------------ Input Data.
+
+		std::vector<QueueItem<float>> queuedDensities;
+		std::vector<QueueItem<Vector3>> queuedVelocities;
 
-		// Velocity
+		// ------------ Emitters.
 
-		ID3D11Texture3D* voxelVeloTex = nullptr;
-		ID3D11Resource* voxelVeloResource = nullptr;
-		ID3D11ShaderResourceView* voxelVeloView = nullptr;
+		std::vector<CFDEmitter*> emitters;
+		double emitterRasteriseTime = 0.0;
 	};
 }
 
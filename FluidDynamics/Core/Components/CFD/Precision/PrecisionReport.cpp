@@ -0,0 +1,138 @@
+#include "PrecisionReport.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace CFD;
+
+namespace
+{
+	// Accumulates the error between two fields over the simulated region.
+	FieldError compareField(const char* name, VoxelData* reference, VoxelData* test, int N, int dimensions)
+	{
+		FieldError error = FieldError(name);
+		double sumSquared = 0.0;
+		int count = 0;
+
+		int depth = (dimensions > 2) ? N : 1;
+		for (int z = 0; z < depth; ++z)
+		{
+			for (int y = 0; y < N; ++y)
+			{
+				for (int x = 0; x < N; ++x)
+				{
+					float referenceValue = reference->getCurrentValue(Vector3(x, y, z));
+					float difference = fabsf(referenceValue - test->getCurrentValue(Vector3(x, y, z)));
+
+					error.maxAbsoluteError = std::max<float>(error.maxAbsoluteError, difference);
+					error.maxReferenceValue = std::max<float>(error.maxReferenceValue, fabsf(referenceValue));
+					sumSquared += double(difference) * double(difference);
+					count++;
+				}
+			}
+		}
+
+		error.rmsError = (count > 0) ? float(sqrt(sumSquared / count)) : 0.0f;
+		return error;
+	}
+
+	// Steps the grid and returns the total time in milliseconds, with the median step so a step lost to the scheduler does not count.
+	double runSteps(CFDGrid& grid, int steps, double& medianStepMs)
+	{
+		std::vector<double> stepMs;
+		double total = 0.0;
+		for (int i = 0; i < steps; ++i)
+		{
+			Stopwatch stepTimer;
+			grid.Update(0.016f);
+			stepMs.push_back(stepTimer.getElapsedMilliseconds());
+			total += stepMs.back();
+		}
+
+		std::sort(stepMs.begin(), stepMs.end());
+		medianStepMs = stepMs.empty() ? 0.0 : stepMs[stepMs.size() / 2];
+		return total;
+	}
+
+	// Sets up a grid with a fixed density and velocity source in its centre.
+	void setupScenario(CFDGrid& grid, int size, int dimensions)
+	{
+		grid.setGrid(size, dimensions);
+		grid.setDiffusionRate(0.5f);
+		grid.setViscocity(0.1f);
+		grid.setRandomVelocityMinMax(0);
+		grid.Start();
+
+		Vector3 centre = Vector3(size / 2, size / 2, (dimensions > 2) ? size / 2 : 0);
+		grid.addDensity(centre, 100.0f);
+		grid.addVelocity(centre, Vector3(5.0f, 5.0f, (dimensions > 2) ? 5.0f : 0.0f));
+	}
+}
+
+std::string PrecisionReport::toString() const
+{
+	std::string report;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Density %s / Velocity %s vs fp32, N = %d, %dD, %d steps (%.2f ms vs %.2f ms)\n",
+		getFieldStorageName(densityStorage), getFieldStorageName(velocityStorage), size, dimensions, steps, testMs, referenceMs);
+	report += line;
+
+	// The storage formats exist to make bandwidth bound grids faster, so a step slower than fp32 should be seen next to the error it buys.
+	snprintf(line, sizeof(line), "  %-10s median %.3f ms vs %.3f ms fp32, %.2fx\n", "Step", testStepMs, referenceStepMs, getSlowdown());
+	report += line;
+
+	for (const FieldError& field : fields)
+	{
+		snprintf(line, sizeof(line), "  %-10s max abs %.3e  rms %.3e  max rel %.3e\n", field.name.c_str(), field.maxAbsoluteError, field.rmsError, field.getRelativeError());
+		report += line;
+	}
+
+	return report;
+}
+
+std::vector<FieldError> PrecisionComparison::compareFields(CFDGrid& reference, CFDGrid& test)
+{
+	std::vector<FieldError> errors;
+
+	CFDData* referenceData = reference.getAllVoxelData();
+	CFDData* testData = test.getAllVoxelData();
+
+	if (referenceData == nullptr || testData == nullptr || reference.getGridWidth() != test.getGridWidth())
+		return errors;
+
+	int N = reference.getGridWidth();
+	int dimensions = reference.getDimensions();
+
+	errors.push_back(compareField("Density", referenceData->density, testData->density, N, dimensions));
+	errors.push_back(compareField("VelocityX", referenceData->velocityX, testData->velocityX, N, dimensions));
+	errors.push_back(compareField("VelocityY", referenceData->velocityY, testData->velocityY, N, dimensions));
+	errors.push_back(compareField("VelocityZ", referenceData->velocityZ, testData->velocityZ, N, dimensions));
+
+	return errors;
+}
+
+PrecisionReport PrecisionComparison::run(int size, int dimensions, FieldStorage densityStorage, FieldStorage velocityStorage, int steps)
+{
+	PrecisionReport report;
+	report.size = size;
+	report.dimensions = dimensions;
+	report.steps = steps;
+	report.densityStorage = densityStorage;
+	report.velocityStorage = velocityStorage;
+
+	CFDGrid reference;
+	setupScenario(reference, size, dimensions);
+
+	CFDGrid test;
+	test.setDensityStorage(densityStorage);
+	test.setVelocityStorage(velocityStorage);
+	setupScenario(test, size, dimensions);
+
+	report.referenceMs = runSteps(reference, steps, report.referenceStepMs);
+	report.testMs = runSteps(test, steps, report.testStepMs);
+
+	report.fields = compareFields(reference, test);
+	return report;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include <string>
+#include <vector>
+
+namespace CFD
+{
+	// Error of a single field against the fp32 reference.
+	struct FieldError
+	{
+		FieldError(const std::string& name) : name(name) {};
+		std::string name;
+		float maxAbsoluteError = 0.0f;
+		float rmsError = 0.0f;
+		float maxReferenceValue = 0.0f;
+
+		// Returns the max absolute error relative to the largest reference value.
+		float getRelativeError() const { return (maxReferenceValue > 0.0f) ? maxAbsoluteError / maxReferenceValue : 0.0f; }
+	};
+
+	// Result of running the same scenario with fp32 storage and with reduced precision storage.
+	struct PrecisionReport
+	{
+		int size = 0;
+		int dimensions = 0;
+		int steps = 0;
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+		double referenceMs = 0.0;
+		double testMs = 0.0;
+		double referenceStepMs = 0.0;		// Median step of the fp32 grid.
+		double testStepMs = 0.0;			// Median step of the reduced precision grid.
+		std::vector<FieldError> fields;
+
+		// Returns how many times longer a reduced precision step takes than an fp32 one, above one is slower.
+		double getSlowdown() const { return (referenceStepMs > 0.0) ? testStepMs / referenceStepMs : 0.0; }
+
+		// Returns a human readable table of the report.
+		std::string toString() const;
+	};
+
+	// Measures the error introduced by storing fields at 16 bits.
+	class PrecisionComparison
+	{
+	public:
+		// Compares the current values of every field in the test grid against the reference grid.
+		static std::vector<FieldError> compareFields(CFDGrid& reference, CFDGrid& test);
+
+		// Runs a fixed source scenario for the passed in number of steps on an fp32 grid and a grid using the passed in storage, then compares them.
+		static PrecisionReport run(int size, int dimensions, FieldStorage densityStorage, FieldStorage velocityStorage, int steps);
+	};
+}
@@ -0,0 +1,626 @@
+#include "CFDInputLog.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Emitter/CFDEmitter.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/File/AtomicFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace CFD;
+
+const char CFDInputLog::Magic[8] = { 'C', 'F', 'D', 'I', 'N', 'P', 'T', '\0' };
+
+namespace
+{
+	const char* const InputEventTypeNames[] = { "addDensity", "addVelocity", "setDiffusionRate", "setViscocity", "setRandomVelocityMinMax",
+		"setRandomSeed", "setTurbulence", "setDimensions", "setGrid", "resize" };
+
+	// Fixed header at the start of an input log, followed by the scene as INI text and then the encoded events.
+	struct InputLogHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t endianMarker;
+		uint64_t steps;
+		uint64_t eventCount;
+		uint64_t eventBytes;
+		uint32_t sceneBytes;
+		uint32_t reserved;
+		double durationMs;
+	};
+
+	// Appends events to a byte buffer. Steps and times are stored as varint deltas from the event before, which keeps the
+	// usual burst of calls between two frames to a few bytes each.
+	class InputWriter
+	{
+	public:
+		std::vector<unsigned char> bytes;
+
+		void writeByte(uint8_t value) { bytes.push_back(value); }
+
+		void writeVarint(uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				bytes.push_back(uint8_t(value | 0x80));
+				value >>= 7;
+			}
+
+			bytes.push_back(uint8_t(value));
+		}
+
+		// Zigzag, so small negative numbers stay small.
+		void writeSigned(int64_t value) { writeVarint((uint64_t(value) << 1) ^ uint64_t(value >> 63)); }
+
+		void writeFloat(float value)
+		{
+			unsigned char raw[sizeof(float)];
+			memcpy(raw, &value, sizeof(float));
+			bytes.insert(bytes.end(), raw, raw + sizeof(float));
+		}
+
+		void writeVector(const Vector3& value)
+		{
+			writeFloat(value.x);
+			writeFloat(value.y);
+			writeFloat(value.z);
+		}
+	};
+
+	// Reads what InputWriter wrote, failing rather than reading past the end.
+	class InputReader
+	{
+	public:
+		InputReader(const std::vector<unsigned char>& bytes) : bytes(bytes) {};
+
+		bool failed = false;
+
+		bool atEnd() { return offset >= bytes.size(); }
+
+		uint8_t readByte()
+		{
+			if (offset >= bytes.size())
+			{
+				failed = true;
+				return 0;
+			}
+
+			return bytes[offset++];
+		}
+
+		uint64_t readVarint()
+		{
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				uint8_t byte = readByte();
+				value |= uint64_t(byte & 0x7F) << shift;
+
+				if ((byte & 0x80) == 0 || failed)
+					return value;
+			}
+
+			failed = true;
+			return value;
+		}
+
+		int64_t readSigned()
+		{
+			uint64_t value = readVarint();
+			return int64_t(value >> 1) ^ -int64_t(value & 1);
+		}
+
+		float readFloat()
+		{
+			float value = 0.0f;
+			if (offset + sizeof(float) > bytes.size())
+			{
+				failed = true;
+				return value;
+			}
+
+			memcpy(&value, &bytes[offset], sizeof(float));
+			offset += sizeof(float);
+			return value;
+		}
+
+		Vector3 readVector()
+		{
+			float x = readFloat();
+			float y = readFloat();
+			float z = readFloat();
+			return Vector3(x, y, z);
+		}
+
+	private:
+		const std::vector<unsigned char>& bytes;
+		size_t offset = 0;
+	};
+
+	bool inputLogProblem(std::string* error, const std::string& message)
+	{
+		if (error != nullptr)
+			*error = message;
+
+		return false;
+	}
+
+	// Removes the emitters beside the grid, so applying a scene does not add its emitters to ones already there.
+	void removeInputLogEmitters(CFDGrid* grid)
+	{
+		Entity* entity = static_cast<Entity*>(grid->getParent());
+		if (entity == nullptr)
+			return;
+
+		while (entity->getComponent<CFDEmitter>() != nullptr)
+			entity->removeComponent<CFDEmitter>();
+	}
+}
+
+const char* CFD::getInputEventTypeName(InputEventType type)
+{
+	return (type < InputEventType::Count) ? InputEventTypeNames[int(type)] : "unknown";
+}
+
+bool CFD::CFDInputLog::startRecording(CFDGrid* target, std::string* error)
+{
+	stop();
+
+	// Setting the grid up again empties the fields and fresh emitters start their lifetimes over, which is where a replay of the
+	// captured scene starts. The scene is not applied, that would also reset the settings of a recorder beside the grid.
+	SceneDescription captured = CFDScene::capture(target);
+	if (!target->setGrid(captured.size, captured.dimensions))
+		return inputLogProblem(error, "The grid could not be set up again to record from:\n" + target->getLastSetGridReport().toString());
+
+	target->Start();
+
+	removeInputLogEmitters(target);
+	Entity* entity = static_cast<Entity*>(target->getParent());
+	if (entity != nullptr)
+	{
+		for (const SceneEmitter& description : captured.emitters)
+		{
+			CFDEmitter* emitter = entity->addComponent<CFDEmitter>();
+			emitter->setShape(description.shape);
+			emitter->setPosition(description.position);
+			emitter->setSize(description.size);
+			emitter->setVelocity(description.velocity);
+			emitter->setRate(description.rate);
+			emitter->setLifetime(description.lifetime);
+		}
+	}
+
+	scene = captured;
+	events.clear();
+	steps = 0;
+	durationMs = 0.0;
+
+	grid = target;
+	grid->setInputLog(this);
+	recording = true;
+	step = 0;
+	timer.reset();
+	return true;
+}
+
+bool CFD::CFDInputLog::startReplay(CFDGrid* target, std::string* error)
+{
+	stop();
+
+	removeInputLogEmitters(target);
+	if (!CFDScene::apply(scene, target, error))
+		return false;
+
+	beginReplay(target);
+	return true;
+}
+
+void CFD::CFDInputLog::beginReplay(CFDGrid* target)
+{
+	stop();
+
+	grid = target;
+	grid->setInputLog(this);
+	replaying = true;
+	step = 0;
+	nextEvent = 0;
+	timer.reset();
+}
+
+void CFD::CFDInputLog::stop()
+{
+	if (recording)
+		durationMs = timer.getElapsedMilliseconds();
+
+	if (grid != nullptr && grid->getInputLog() == this)
+		grid->setInputLog(nullptr);
+
+	grid = nullptr;
+	recording = false;
+	replaying = false;
+}
+
+void CFD::CFDInputLog::beginStep()
+{
+	if (!replaying)
+		return;
+
+	// Events are in step order, everything up to this step was called before it.
+	while (nextEvent < events.size() && events[nextEvent].step <= step)
+		apply(events[nextEvent++]);
+}
+
+void CFD::CFDInputLog::endStep()
+{
+	step++;
+
+	if (recording)
+		steps = step;
+}
+
+void CFD::CFDInputLog::recordAddDensity(const Vector3& position, float amount)
+{
+	InputEvent event;
+	event.type = InputEventType::AddDensity;
+	event.position = position;
+	event.amount = amount;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordAddVelocity(const Vector3& position, const Vector3& velocity)
+{
+	InputEvent event;
+	event.type = InputEventType::AddVelocity;
+	event.position = position;
+	event.velocity = velocity;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordDiffusionRate(float rate)
+{
+	InputEvent event;
+	event.type = InputEventType::SetDiffusionRate;
+	event.amount = rate;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordViscocity(float viscocity)
+{
+	InputEvent event;
+	event.type = InputEventType::SetViscocity;
+	event.amount = viscocity;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordRandomVelocityMinMax(int minMax)
+{
+	InputEvent event;
+	event.type = InputEventType::SetRandomVelocityMinMax;
+	event.value = minMax;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordRandomSeed(uint64_t seed)
+{
+	InputEvent event;
+	event.type = InputEventType::SetRandomSeed;
+	event.value = int64_t(seed);
+	append(event);
+}
+
+void CFD::CFDInputLog::recordTurbulence(const TurbulenceSettings& turbulence)
+{
+	InputEvent event;
+	event.type = InputEventType::SetTurbulence;
+	event.turbulence = turbulence;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordDimensions(int dimensions)
+{
+	InputEvent event;
+	event.type = InputEventType::SetDimensions;
+	event.dimensions = dimensions;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordSetGrid(int size, int dimensions)
+{
+	InputEvent event;
+	event.type = InputEventType::SetGrid;
+	event.value = size;
+	event.dimensions = dimensions;
+	append(event);
+}
+
+void CFD::CFDInputLog::recordResize(int size, int filter)
+{
+	InputEvent event;
+	event.type = InputEventType::Resize;
+	event.value = size;
+	event.filter = filter;
+	append(event);
+}
+
+void CFD::CFDInputLog::append(InputEvent& event)
+{
+	if (!recording)
+		return;
+
+	event.step = step;
+	event.timeMs = timer.getElapsedMilliseconds();
+	events.push_back(event);
+}
+
+void CFD::CFDInputLog::apply(const InputEvent& event)
+{
+	switch (event.type)
+	{
+	case InputEventType::AddDensity:
+		grid->addDensity(event.position, event.amount);
+		break;
+	case InputEventType::AddVelocity:
+		grid->addVelocity(event.position, event.velocity);
+		break;
+	case InputEventType::SetDiffusionRate:
+		grid->setDiffusionRate(event.amount);
+		break;
+	case InputEventType::SetViscocity:
+		grid->setViscocity(event.amount);
+		break;
+	case InputEventType::SetRandomVelocityMinMax:
+		grid->setRandomVelocityMinMax(int(event.value));
+		break;
+	case InputEventType::SetRandomSeed:
+		grid->setRandomSeed(uint64_t(event.value));
+		break;
+	case InputEventType::SetTurbulence:
+		grid->setTurbulence(event.turbulence);
+		break;
+	case InputEventType::SetDimensions:
+		grid->setDimensions(event.dimensions);
+		break;
+	case InputEventType::SetGrid:
+		if (grid->setGrid(int(event.value), event.dimensions))
+			grid->Start();
+		break;
+	case InputEventType::Resize:
+		grid->resize(int(event.value), ResampleFilter(event.filter));
+		break;
+	default:
+		break;
+	}
+}
+
+bool CFD::CFDInputLog::save(const std::string& path, std::string* error)
+{
+	InputWriter writer;
+	uint64_t lastStep = 0;
+	uint64_t lastMicroseconds = 0;
+	for (const InputEvent& event : events)
+	{
+		// Times only go forward, a clock that stepped back is stored as no time passing.
+		uint64_t microseconds = std::max(uint64_t(llround(event.timeMs * 1000.0)), lastMicroseconds);
+
+		writer.writeByte(uint8_t(event.type));
+		writer.writeVarint(event.step - lastStep);
+		writer.writeVarint(microseconds - lastMicroseconds);
+		lastStep = event.step;
+		lastMicroseconds = microseconds;
+
+		switch (event.type)
+		{
+		case InputEventType::AddDensity:
+			writer.writeVector(event.position);
+			writer.writeFloat(event.amount);
+			break;
+		case InputEventType::AddVelocity:
+			writer.writeVector(event.position);
+			writer.writeVector(event.velocity);
+			break;
+		case InputEventType::SetDiffusionRate:
+		case InputEventType::SetViscocity:
+			writer.writeFloat(event.amount);
+			break;
+		case InputEventType::SetRandomVelocityMinMax:
+		case InputEventType::SetRandomSeed:
+			writer.writeSigned(event.value);
+			break;
+		case InputEventType::SetTurbulence:
+			writer.writeByte(event.turbulence.enabled ? 1 : 0);
+			writer.writeFloat(event.turbulence.amplitude);
+			writer.writeFloat(event.turbulence.frequency);
+			writer.writeSigned(event.turbulence.octaves);
+			writer.writeFloat(event.turbulence.evolution);
+			writer.writeFloat(event.turbulence.activeThreshold);
+			break;
+		case InputEventType::SetDimensions:
+			writer.writeSigned(event.dimensions);
+			break;
+		case InputEventType::SetGrid:
+			writer.writeSigned(event.value);
+			writer.writeSigned(event.dimensions);
+			break;
+		case InputEventType::Resize:
+			writer.writeSigned(event.value);
+			writer.writeSigned(event.filter);
+			break;
+		default:
+			break;
+		}
+	}
+
+	std::string sceneText = CFDScene::toString(scene);
+
+	InputLogHeader header = {};
+	memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.endianMarker = EndianMarker;
+	header.steps = steps;
+	header.eventCount = events.size();
+	header.eventBytes = writer.bytes.size();
+	header.sceneBytes = uint32_t(sceneText.size());
+	header.durationMs = recording ? timer.getElapsedMilliseconds() : durationMs;
+
+	AtomicFile file;
+	if (!file.open(path))
+		return inputLogProblem(error, "Could not create " + path);
+
+	bool written = file.write(&header, sizeof(header)) && file.write(sceneText.data(), sceneText.size()) &&
+		file.write(writer.bytes.data(), writer.bytes.size());
+
+	if (!written || !file.commit())
+		return inputLogProblem(error, "Could not write " + path);
+
+	return true;
+}
+
+bool CFD::CFDInputLog::load(const std::string& path, std::string* error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+		return inputLogProblem(error, "Could not open " + path);
+
+	InputLogHeader header = {};
+	bool readHeader = fread(&header, sizeof(header), 1, file) == 1;
+
+	std::string problem;
+	if (!readHeader || memcmp(header.magic, Magic, sizeof(Magic)) != 0)
+		problem = path + " is not an input log";
+	else if (header.endianMarker != EndianMarker)
+		problem = path + " was written on a machine of the other byte order";
+	else if (header.version != Version)
+		problem = path + " is version " + std::to_string(header.version) + ", this build reads version " + std::to_string(Version);
+
+	// Each event takes at least three bytes, which catches a corrupt count before anything is allocated for it.
+	else if (header.eventCount > header.eventBytes / 3 + 1 || header.eventBytes > (uint64_t(1) << 32))
+		problem = path + " has a malformed header";
+
+	std::string sceneText;
+	std::vector<unsigned char> bytes;
+	if (problem.empty())
+	{
+		sceneText.resize(header.sceneBytes);
+		bytes.resize(size_t(header.eventBytes));
+
+		if ((!sceneText.empty() && fread(&sceneText[0], 1, sceneText.size(), file) != sceneText.size()) ||
+			(!bytes.empty() && fread(bytes.data(), 1, bytes.size(), file) != bytes.size()))
+			problem = path + " is truncated";
+	}
+
+	fclose(file);
+
+	SceneDescription parsed;
+	std::string sceneError;
+	if (problem.empty() && !CFDScene::parse(sceneText, path, parsed, &sceneError))
+		problem = sceneError;
+
+	std::vector<InputEvent> parsedEvents;
+	if (problem.empty())
+	{
+		parsedEvents.reserve(size_t(header.eventCount));
+
+		InputReader reader = InputReader(bytes);
+		uint64_t lastStep = 0;
+		uint64_t lastMicroseconds = 0;
+		for (uint64_t i = 0; i < header.eventCount && !reader.failed; ++i)
+		{
+			InputEvent event;
+			uint8_t type = reader.readByte();
+			if (type >= uint8_t(InputEventType::Count))
+			{
+				problem = path + " holds an event of unknown type " + std::to_string(type);
+				break;
+			}
+
+			event.type = InputEventType(type);
+			lastStep += reader.readVarint();
+			lastMicroseconds += reader.readVarint();
+			event.step = lastStep;
+			event.timeMs = double(lastMicroseconds) / 1000.0;
+
+			switch (event.type)
+			{
+			case InputEventType::AddDensity:
+				event.position = reader.readVector();
+				event.amount = reader.readFloat();
+				break;
+			case InputEventType::AddVelocity:
+				event.position = reader.readVector();
+				event.velocity = reader.readVector();
+				break;
+			case InputEventType::SetDiffusionRate:
+			case InputEventType::SetViscocity:
+				event.amount = reader.readFloat();
+				break;
+			case InputEventType::SetRandomVelocityMinMax:
+			case InputEventType::SetRandomSeed:
+				event.value = reader.readSigned();
+				break;
+			case InputEventType::SetTurbulence:
+				event.turbulence.enabled = reader.readByte() != 0;
+				event.turbulence.amplitude = reader.readFloat();
+				event.turbulence.frequency = reader.readFloat();
+				event.turbulence.octaves = int(reader.readSigned());
+				event.turbulence.evolution = reader.readFloat();
+				event.turbulence.activeThreshold = reader.readFloat();
+				break;
+			case InputEventType::SetDimensions:
+				event.dimensions = int(reader.readSigned());
+				break;
+			case InputEventType::SetGrid:
+				event.value = reader.readSigned();
+				event.dimensions = int(reader.readSigned());
+				break;
+			case InputEventType::Resize:
+				event.value = reader.readSigned();
+				event.filter = int(reader.readSigned());
+				break;
+			default:
+				break;
+			}
+
+			parsedEvents.push_back(event);
+		}
+
+		if (problem.empty() && (reader.failed || !reader.atEnd()))
+			problem = path + " has events that do not match its header";
+	}
+
+	if (!problem.empty())
+		return inputLogProblem(error, problem);
+
+	stop();
+	scene = parsed;
+	events.swap(parsedEvents);
+	steps = header.steps;
+	durationMs = header.durationMs;
+	return true;
+}
+
+std::string CFD::CFDInputLog::toString()
+{
+	std::string summary;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Input log:         %llu steps over %.1f s, %zu events, starting on a %d^%d grid\n", (unsigned long long)steps,
+		durationMs / 1000.0, events.size(), scene.size, scene.dimensions);
+	summary += line;
+
+	size_t counts[int(InputEventType::Count)] = {};
+	for (const InputEvent& event : events)
+		counts[int(event.type)]++;
+
+	for (int i = 0; i < int(InputEventType::Count); ++i)
+	{
+		if (counts[i] == 0)
+			continue;
+
+		snprintf(line, sizeof(line), "  %-24s %zu\n", getInputEventTypeName(InputEventType(i)), counts[i]);
+		summary += line;
+	}
+
+	return summary;
+}
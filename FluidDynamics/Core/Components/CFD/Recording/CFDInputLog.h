@@ -0,0 +1,148 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Scene/CFDScene.h"
+#include "Utility/Math/Math.h"
+#include "Utility/Time/Stopwatch.h"
+
+namespace CFD
+{
+	class CFDGrid;
+
+	// Calls into the grid an input log keeps, stored as a byte in the file so the values must not change.
+	enum class InputEventType : uint8_t
+	{
+		AddDensity = 0,
+		AddVelocity,
+		SetDiffusionRate,
+		SetViscocity,
+		SetRandomVelocityMinMax,
+		SetRandomSeed,
+		SetTurbulence,
+		SetDimensions,
+		SetGrid,
+		Resize,
+		Count,
+	};
+
+	// Returns the name of the grid call an event type stands for.
+	const char* getInputEventTypeName(InputEventType type);
+
+	// One call into the grid. Only the values of its type are stored.
+	struct InputEvent
+	{
+		InputEventType type = InputEventType::AddDensity;
+		uint64_t step = 0;					// Steps the log had seen when the call was made, it is replayed just before the next one.
+		double timeMs = 0.0;				// Wall clock time since the recording started, only kept to read the session back.
+
+		Vector3 position;					// Voxel of AddDensity and AddVelocity.
+		Vector3 velocity;					// Velocity added by AddVelocity.
+		float amount = 0.0f;				// Density added, diffusion rate or viscocity.
+		int64_t value = 0;					// Random velocity min max, random seed or grid size.
+		int dimensions = 0;					// Dimensions of SetDimensions and SetGrid.
+		int filter = 0;						// ResampleFilter of Resize.
+		TurbulenceSettings turbulence;		// Settings of SetTurbulence.
+	};
+
+	// Timestamped log of the inputs a grid was given, for replaying an interactive session step for step in the app or CFDBatch.
+	// Recording starts the grid again from the scene it is set up as, so a replay that applies the same scene and makes the same
+	// calls before the same steps gets the same fields. Anything not in InputEventType, such as emitters added mid session, is not kept.
+	// The grid holds on to the log while recording or replaying, destroying either one first stops the log.
+	class CFDInputLog
+	{
+	public:
+
+		static const char Magic[8];
+		static const uint32_t Version = 1;
+		static const uint32_t EndianMarker = 0x01020304;
+
+		CFDInputLog() {};
+		~CFDInputLog() { stop(); }
+
+		CFDInputLog(const CFDInputLog&) = delete;
+		CFDInputLog& operator=(const CFDInputLog&) = delete;
+
+		// Captures the grid's scene, starts the grid again from it and records every input from the next step on.
+		// Returns false and describes the problem if the scene could not be applied again.
+		bool startRecording(CFDGrid* grid, std::string* error = nullptr);
+
+		// Applies the log's scene to the grid, replacing any emitters beside it, and replays the inputs into the following steps.
+		// Returns false and describes the problem if the scene could not be applied.
+		bool startReplay(CFDGrid* grid, std::string* error = nullptr);
+
+		// Replays the inputs into the following steps of a grid the log's scene was already applied to.
+		void beginReplay(CFDGrid* grid);
+
+		// Stops recording or replaying and lets go of the grid. The events are kept.
+		void stop();
+
+		bool isRecording() { return recording; }
+		bool isReplaying() { return replaying; }
+
+		// Returns true once a replay has taken as many steps as were recorded.
+		bool isFinished() { return replaying && step >= steps; }
+
+		// Called by the grid before each step. A replay makes the calls that were recorded before this step.
+		void beginStep();
+
+		// Called by the grid after each step.
+		void endStep();
+
+		// ------ Called by the grid as it is given inputs, ignored unless recording.
+
+		void recordAddDensity(const Vector3& position, float amount);
+		void recordAddVelocity(const Vector3& position, const Vector3& velocity);
+		void recordDiffusionRate(float rate);
+		void recordViscocity(float viscocity);
+		void recordRandomVelocityMinMax(int minMax);
+		void recordRandomSeed(uint64_t seed);
+		void recordTurbulence(const TurbulenceSettings& turbulence);
+		void recordDimensions(int dimensions);
+		void recordSetGrid(int size, int dimensions);
+		void recordResize(int size, int filter);
+
+		// Writes the scene and events. Returns false and describes the problem if the file could not be written.
+		bool save(const std::string& path, std::string* error = nullptr);
+
+		// Replaces the scene and events with those of a saved log. Returns false and describes the problem if it could not be read.
+		bool load(const std::string& path, std::string* error = nullptr);
+
+		// Returns the scene the recording started from.
+		const SceneDescription& getScene() { return scene; }
+
+		const std::vector<InputEvent>& getEvents() { return events; }
+
+		// Returns the steps that were recorded.
+		uint64_t getSteps() { return steps; }
+
+		// Returns the steps taken since recording or replaying started.
+		uint64_t getStep() { return step; }
+
+		// Returns how long the recording ran for in milliseconds.
+		double getDurationMs() { return durationMs; }
+
+		// Returns a human readable summary of the log, with the number of events of each type.
+		std::string toString();
+
+	private:
+
+		// Stamps an event with the current step and time and keeps it.
+		void append(InputEvent& event);
+
+		// Makes the recorded call on the grid.
+		void apply(const InputEvent& event);
+
+		SceneDescription scene;
+		std::vector<InputEvent> events;
+		uint64_t steps = 0;
+		double durationMs = 0.0;
+
+		CFDGrid* grid = nullptr;
+		bool recording = false;
+		bool replaying = false;
+		uint64_t step = 0;
+		size_t nextEvent = 0;
+		Stopwatch timer;
+	};
+}
@@ -0,0 +1,287 @@
+#include "CFDPlayback.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace CFD;
+
+CFDPlayback::CFDPlayback()
+{
+	this->setType(ComponentTypes::CFDPlayback);
+	this->setRenderable(false);
+}
+
+CFDPlayback::~CFDPlayback()
+{
+	close();
+}
+
+bool CFD::CFDPlayback::open(const std::string& path)
+{
+	close();
+
+	if (!reader.open(path) || reader.getFrameCount() == 0)
+	{
+		reader.close();
+		return false;
+	}
+
+	header = reader.getHeader();
+	frameCount = reader.getFrameCount();
+	presentedFrame = -1;
+
+	// One slot for the play head and one for every frame decoded ahead of it, all allocated up front.
+	cache.assign(size_t(prefetchCount) + 1, CachedFrame());
+	for (CachedFrame& cached : cache)
+	{
+		for (uint32_t i = 0; i < header.fieldCount; ++i)
+			cached.fields[i].resize(getFieldStorageBytes(FieldStorage(header.storage[i])) * size_t(header.totalN));
+	}
+
+	stats = PlaybackStats();
+	playHead = 0;
+	prefetchWindow = prefetchCount;
+	stopping = false;
+	failed = false;
+
+	prefetcher = std::thread(&CFDPlayback::prefetchLoop, this);
+	opened = true;
+	return true;
+}
+
+void CFD::CFDPlayback::close()
+{
+	if (!opened)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	workAvailable.notify_all();
+	frameDecoded.notify_all();
+	prefetcher.join();
+
+	reader.close();
+	cache.clear();
+	frameCount = 0;
+	opened = false;
+}
+
+void CFD::CFDPlayback::seek(int frame)
+{
+	if (!opened)
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		playHead = std::max<int>(0, std::min<int>(frame, frameCount - 1));
+	}
+
+	workAvailable.notify_one();
+}
+
+bool CFD::CFDPlayback::present(CFDGrid* grid)
+{
+	if (!opened || !matchGrid(grid))
+		return false;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	int slot = findCached(playHead);
+	if (slot < 0)
+	{
+		// Keep showing the previous frame and let the prefetch thread catch up, unless every frame has to be shown.
+		if (!blocking)
+		{
+			stats.framesLate++;
+			return false;
+		}
+
+		Stopwatch waitTimer;
+		frameDecoded.wait(lock, [this, &slot]() { slot = findCached(playHead); return slot >= 0 || failed || stopping; });
+		stats.waitMs += waitTimer.getElapsedMilliseconds();
+
+		if (slot < 0)
+			return false;
+	}
+
+	// The slot cannot be reused while the mutex is held, so it is copied under the lock.
+	Stopwatch presentTimer;
+
+	CFDData* voxels = grid->getAllVoxelData();
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		const std::vector<unsigned char>& field = cache[slot].fields[i];
+		memcpy(fields[i]->getCurrentRawArray(), field.data(), field.size());
+		memcpy(fields[i]->getPreviousRawArray(), field.data(), field.size());
+	}
+
+	stats.presentMs += presentTimer.getElapsedMilliseconds();
+	stats.framesPresented++;
+	presentedFrame = playHead;
+
+	if (playing)
+	{
+		if (playHead + 1 < frameCount)
+			playHead++;
+		else if (looping)
+			playHead = 0;
+		else
+			playing = false;
+	}
+
+	lock.unlock();
+	workAvailable.notify_one();
+	return true;
+}
+
+PlaybackStats CFD::CFDPlayback::getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PlaybackStats snapshot = stats;
+	snapshot.framesCached = 0;
+	for (const CachedFrame& cached : cache)
+	{
+		if (cached.frame >= 0 && inWindow(cached.frame))
+			snapshot.framesCached++;
+	}
+
+	return snapshot;
+}
+
+void CFD::CFDPlayback::prefetchLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		int frame = -1;
+		workAvailable.wait(lock, [this, &frame]() { frame = nextToDecode(); return stopping || frame >= 0; });
+
+		if (stopping)
+			break;
+
+		// There is always a slot outside the window, as there is one more slot than the window is wide.
+		int slot = 0;
+		while (cache[slot].frame >= 0 && inWindow(cache[slot].frame))
+			slot++;
+
+		// Mark the slot empty so a present cannot pick it up while it is written.
+		cache[slot].frame = -1;
+		lock.unlock();
+
+		Stopwatch decodeTimer;
+		bool decoded = reader.readFrame(frame);
+		if (decoded)
+		{
+			for (uint32_t i = 0; i < header.fieldCount; ++i)
+				memcpy(cache[slot].fields[i].data(), reader.getField(int(i)), cache[slot].fields[i].size());
+		}
+
+		double decodeMs = decodeTimer.getElapsedMilliseconds();
+
+		lock.lock();
+		stats.decodeMs += decodeMs;
+
+		if (decoded)
+		{
+			size_t frameBytes = 0;
+			for (uint32_t i = 0; i < header.fieldCount; ++i)
+				frameBytes += cache[slot].fields[i].size();
+
+			cache[slot].frame = frame;
+			stats.framesDecoded += uint64_t(reader.getLastDecodeCount());
+			stats.bytesDecoded += uint64_t(reader.getLastDecodeCount()) * frameBytes;
+		}
+		else
+		{
+			// A corrupt frame ends playback rather than being retried forever.
+			failed = true;
+		}
+
+		frameDecoded.notify_all();
+	}
+}
+
+int CFD::CFDPlayback::findCached(int frame)
+{
+	for (int i = 0; i < int(cache.size()); ++i)
+	{
+		if (cache[i].frame == frame)
+			return i;
+	}
+
+	return -1;
+}
+
+bool CFD::CFDPlayback::inWindow(int frame)
+{
+	int distance = frame - playHead;
+	if (distance < 0 && looping)
+		distance += frameCount;
+
+	return distance >= 0 && distance <= prefetchWindow;
+}
+
+int CFD::CFDPlayback::nextToDecode()
+{
+	if (failed)
+		return -1;
+
+	// Closest to the play head first, so a seek is served before anything past it.
+	for (int distance = 0; distance <= prefetchWindow; ++distance)
+	{
+		int frame = playHead + distance;
+		if (frame >= frameCount)
+		{
+			if (!looping)
+				break;
+
+			frame -= frameCount;
+		}
+
+		if (frame == playHead && distance > 0)
+			break;
+
+		if (findCached(frame) < 0)
+			return frame;
+	}
+
+	return -1;
+}
+
+bool CFD::CFDPlayback::matchGrid(CFDGrid* grid)
+{
+	CFDData* voxels = grid->getAllVoxelData();
+	bool velocityMatches = header.fieldCount < 4 || grid->getVelocityStorage() == FieldStorage(header.storage[1]);
+
+	if (voxels != nullptr && grid->getGridWidth() == header.N && grid->getDimensions() == header.dimensions && voxels->density->getArraySize() == header.totalN &&
+		grid->getDensityStorage() == FieldStorage(header.storage[0]) && velocityMatches)
+		return true;
+
+	grid->setDensityStorage(FieldStorage(header.storage[0]));
+	if (header.fieldCount == 4)
+		grid->setVelocityStorage(FieldStorage(header.storage[1]));
+
+	if (!grid->setGrid(header.N, header.dimensions))
+		return false;
+
+	// Recordings without velocity leave it at rest.
+	voxels = grid->getAllVoxelData();
+	for (VoxelData* field : { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ })
+	{
+		size_t bytes = getFieldStorageBytes(field->getStorage()) * size_t(field->getArraySize());
+		memset(field->getCurrentRawArray(), 0, bytes);
+		memset(field->getPreviousRawArray(), 0, bytes);
+	}
+
+	if (grid->getSimulating())
+		grid->Start();
+
+	return true;
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Core/Entity System/Component.h"
+#include "CFDRecordingReader.h"
+
+namespace CFD
+{
+	class CFDGrid;
+
+	// Throughput accounting for a playback source.
+	struct PlaybackStats
+	{
+		uint64_t framesPresented = 0;	// Frames copied into the grid.
+		uint64_t framesLate = 0;		// Presents that found their frame still decoding and kept the previous one.
+		uint64_t framesDecoded = 0;		// Frames decoded by the prefetch thread, including ones decoded on the way to a seek target.
+		uint64_t bytesDecoded = 0;		// Field bytes the decoded frames expand to.
+		double decodeMs = 0.0;			// Time the prefetch thread spent decoding.
+		double presentMs = 0.0;			// Time spent copying frames into the grid.
+		double waitMs = 0.0;			// Time blocking presents spent waiting for the prefetch thread.
+		int framesCached = 0;			// Decoded frames currently held ahead of the play head.
+
+		// Returns the field megabytes the prefetch thread decodes per second.
+		double getDecodeMBps() const { return decodeMs > 0.0 ? (double(bytesDecoded) / (1024.0 * 1024.0)) / (decodeMs / 1000.0) : 0.0; }
+	};
+
+	// Plays a recording written by CFDRecorder back into the CFDGrid on the same GameObject in place of the solver.
+	// The recording is memory mapped and a background thread decodes the frames ahead of the play head, so playback runs at decode speed.
+	// The grid reads the presented frame through its usual fields, so rendering and getVoxel are unchanged.
+	class CFDPlayback : public Component
+	{
+	public:
+		CFDPlayback();
+		~CFDPlayback();
+
+		// Opens a recording and starts prefetching from its first frame. Returns false if it could not be read.
+		bool open(const std::string& path);
+
+		// Stops the prefetch thread and closes the recording.
+		void close();
+
+		// Returns whether a recording is open.
+		bool isOpen() { return opened; }
+
+		// Returns the header of the open recording.
+		const RecordingHeader& getHeader() { return header; }
+
+		// Returns the number of frames in the open recording.
+		int getFrameCount() { return frameCount; }
+
+		// Moves the play head to the passed in frame, the prefetch thread starts decoding from there straight away.
+		void seek(int frame);
+
+		// Returns the frame the play head is on.
+		int getFrame() { return playHead; }
+
+		// Returns the frame last copied into the grid, -1 before the first present.
+		int getPresentedFrame() { return presentedFrame; }
+
+		// Sets whether the play head advances by one frame every present.
+		void setPlaying(bool val) { playing = val; }
+		bool getPlaying() { return playing; }
+
+		// Sets whether playback wraps to the first frame after the last one.
+		void setLooping(bool val) { std::lock_guard<std::mutex> lock(mutex); looping = val; }
+		bool getLooping() { return looping; }
+
+		// Sets whether a present waits for its frame to finish decoding rather than keeping the previous frame.
+		void setBlocking(bool val) { blocking = val; }
+		bool getBlocking() { return blocking; }
+
+		// Sets how many frames past the play head are decoded ahead of time, takes effect on the next open.
+		void setPrefetchCount(int val) { prefetchCount = val > 0 ? val : 1; }
+		int getPrefetchCount() { return prefetchCount; }
+
+		// Copies the frame under the play head into the grid, reallocating the grid first if it does not match the recording.
+		// Advances the play head when playing. Returns false if nothing was copied.
+		bool present(CFDGrid* grid);
+
+		// Returns a snapshot of the throughput accounting.
+		PlaybackStats getStats();
+
+		// Returns whether playback stopped on a frame that could not be decoded.
+		bool hasFailed() { std::lock_guard<std::mutex> lock(mutex); return failed; }
+
+	private:
+
+		// A decoded frame held by the prefetch cache.
+		struct CachedFrame
+		{
+			int frame = -1;
+			std::vector<unsigned char> fields[4];
+		};
+
+		// Prefetch thread loop.
+		void prefetchLoop();
+
+		// Returns the slot holding the passed in frame, -1 if it is not cached. The mutex must be held.
+		int findCached(int frame);
+
+		// Returns the next frame the prefetch thread should decode, -1 if every frame in the window is cached. The mutex must be held.
+		int nextToDecode();
+
+		// Returns whether a frame is within the prefetch window starting at the play head. The mutex must be held.
+		bool inWindow(int frame);
+
+		// Reallocates the grid to the size and formats of the recording.
+		bool matchGrid(CFDGrid* grid);
+
+		bool opened = false;
+		bool playing = true;
+		bool looping = true;
+		bool blocking = false;
+		int prefetchCount = 8;
+		int frameCount = 0;
+		int presentedFrame = -1;
+		RecordingHeader header = {};
+
+		// ------ Shared with the prefetch thread, guarded by the mutex.
+
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable frameDecoded;
+		std::vector<CachedFrame> cache;
+		PlaybackStats stats;
+		int playHead = 0;
+		int prefetchWindow = 0;		// Prefetch count the open recording was opened with.
+		bool stopping = false;
+		bool failed = false;
+
+		std::thread prefetcher;
+
+		// ------ Prefetch thread state.
+
+		CFDRecordingReader reader;
+	};
+}
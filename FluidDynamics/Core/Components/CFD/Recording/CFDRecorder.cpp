@@ -0,0 +1,346 @@
+#include "CFDRecorder.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace CFD;
+
+const char CFDRecorder::Magic[8] = { 'C', 'F', 'D', 'R', 'E', 'C', '\0', '\0' };
+
+CFDRecorder::CFDRecorder()
+{
+	this->setType(ComponentTypes::CFDRecorder);
+	this->setRenderable(false);
+}
+
+CFDRecorder::~CFDRecorder()
+{
+	stop();
+}
+
+bool CFD::CFDRecorder::start(CFDGrid* grid, const std::string& filePath)
+{
+	stop();
+
+	CFDData* voxels = grid->getAllVoxelData();
+	if (voxels == nullptr)
+		return false;
+
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+
+	header = {};
+	memcpy(header.magic, Magic, sizeof(header.magic));
+	header.version = Version;
+	header.headerBytes = sizeof(RecordingHeader);
+	header.N = grid->getGridWidth();
+	header.dimensions = grid->getDimensions();
+	header.totalN = voxels->density->getArraySize();
+	header.fieldCount = recordVelocity ? 4 : 1;
+	header.codec = uint32_t(codec);
+	header.timeStep = grid->getTimeStep();
+	header.keyframeInterval = uint32_t(keyframeInterval);
+	header.brickSize = uint32_t(brickSize);
+
+	size_t frameBytes = 0;
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		header.storage[i] = uint32_t(fields[i]->getStorage());
+		frameBytes += getFieldStorageBytes(fields[i]->getStorage()) * size_t(header.totalN);
+	}
+
+	if (!file.open(filePath) || !file.write(&header, sizeof(header)))
+	{
+		file.abort();
+		return false;
+	}
+
+	path = filePath;
+
+	// Every buffer is allocated up front so submitting a frame never allocates.
+	pool.assign(poolSize, std::vector<unsigned char>(frameBytes));
+	freeBuffers.clear();
+	for (int i = poolSize - 1; i >= 0; --i)
+		freeBuffers.push_back(i);
+
+	previousFrame.assign(frameBytes, 0);
+	scratch.pool = &encodePool;
+	frameIndexEntries.clear();
+
+	queue.clear();
+	stats = RecorderStats();
+	stopping = false;
+	writeFailed = false;
+	recordingTimer.reset();
+
+	writer = std::thread(&CFDRecorder::writerLoop, this);
+	recording = true;
+	return true;
+}
+
+bool CFD::CFDRecorder::stop()
+{
+	if (!recording)
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	frameQueued.notify_all();
+	bufferFreed.notify_all();
+	writer.join();
+
+	recording = false;
+	stats.elapsedSeconds = recordingTimer.getElapsedSeconds();
+
+	if (writeFailed)
+	{
+		file.abort();
+		return false;
+	}
+
+	return file.commit();
+}
+
+void CFD::CFDRecorder::submit(CFDGrid* grid, uint64_t frameIndex)
+{
+	if (!recording)
+		return;
+
+	CFDData* voxels = grid->getAllVoxelData();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	stats.framesSubmitted++;
+
+	// A resized or restored grid no longer matches the recording header.
+	if (voxels == nullptr || voxels->density->getArraySize() != header.totalN || grid->getDimensions() != header.dimensions)
+	{
+		stats.framesDropped++;
+		return;
+	}
+
+	if (backPressure == RecorderBackPressure::Downsample && frameIndex % uint64_t(stats.downsampleStride) != 0)
+	{
+		stats.framesSkipped++;
+		return;
+	}
+
+	if (freeBuffers.empty())
+	{
+		if (backPressure == RecorderBackPressure::Block)
+		{
+			Stopwatch blockedTimer;
+			bufferFreed.wait(lock, [this]() { return !freeBuffers.empty() || stopping; });
+			stats.blockedMs += blockedTimer.getElapsedMilliseconds();
+
+			if (freeBuffers.empty())
+				return;
+		}
+		else
+		{
+			if (backPressure == RecorderBackPressure::Downsample)
+				stats.downsampleStride = std::min<int>(stats.downsampleStride * 2, int(MaxDownsampleStride));
+
+			stats.framesDropped++;
+			return;
+		}
+	}
+
+	int buffer = freeBuffers.back();
+	freeBuffers.pop_back();
+	lock.unlock();
+
+	// The buffer belongs to this thread until it is queued, so the copy happens outside the lock.
+	Stopwatch copyTimer;
+
+	VoxelData* fields[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	unsigned char* destination = pool[buffer].data();
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		size_t bytes = getFieldStorageBytes(fields[i]->getStorage()) * size_t(header.totalN);
+		memcpy(destination, fields[i]->getCurrentRawArray(), bytes);
+		destination += bytes;
+	}
+
+	double copyMs = copyTimer.getElapsedMilliseconds();
+
+	lock.lock();
+	stats.copyMs += copyMs;
+	queue.push_back({ buffer, frameIndex });
+	stats.queueDepth = int(queue.size());
+	stats.maxQueueDepth = std::max<int>(stats.maxQueueDepth, stats.queueDepth);
+	lock.unlock();
+
+	frameQueued.notify_one();
+}
+
+RecorderStats CFD::CFDRecorder::getStats()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	RecorderStats snapshot = stats;
+	if (recording)
+		snapshot.elapsedSeconds = recordingTimer.getElapsedSeconds();
+
+	return snapshot;
+}
+
+void CFD::CFDRecorder::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (true)
+	{
+		frameQueued.wait(lock, [this]() { return !queue.empty() || stopping; });
+
+		// Drain whatever is queued before honouring a stop so no accepted frame is lost.
+		if (queue.empty())
+		{
+			lock.unlock();
+			bool indexed = !writeFailed && writeIndex();
+			lock.lock();
+
+			writeFailed = !indexed;
+			break;
+		}
+
+		PendingFrame frame = queue.front();
+		queue.pop_front();
+		lock.unlock();
+
+		bool written = !writeFailed && writeFrame(pool[frame.buffer], frame.frameIndex);
+
+		lock.lock();
+		if (written)
+			stats.framesWritten++;
+		else
+			writeFailed = true;
+
+		freeBuffers.push_back(frame.buffer);
+		stats.queueDepth = int(queue.size());
+
+		// Record every frame again once the writer has caught up.
+		if (queue.empty() && stats.downsampleStride > 1)
+			stats.downsampleStride /= 2;
+
+		bufferFreed.notify_one();
+	}
+}
+
+bool CFD::CFDRecorder::writeFrame(const std::vector<unsigned char>& buffer, uint64_t frameIndex)
+{
+	Stopwatch encodeTimer;
+
+	// Keyframes bound how far back a seek has to decode, everything between only stores what changed.
+	// Lossy frames are always whole, a difference against a reconstruction that drifts from the simulation is just noise.
+	const RecordingCodec frameCodec = RecordingCodec(header.codec);
+	const bool keyframe = frameCodec == RecordingCodec::Wavelet || frameIndexEntries.size() % size_t(header.keyframeInterval) == 0;
+
+	RecordingFrameHeader frameHeader = {};
+	frameHeader.magic = FrameMagic;
+	frameHeader.fieldCount = header.fieldCount;
+	frameHeader.frameIndex = frameIndex;
+	frameHeader.frameType = uint32_t(keyframe ? RecordingFrameType::Keyframe : RecordingFrameType::Delta);
+
+	// Encode every field back to back into the scratch buffer so the frame is written with one call.
+	size_t encodedCapacity = 0;
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		SequenceLayout layout(header.N, header.totalN, getFieldStorageBytes(FieldStorage(header.storage[i])), int(header.brickSize));
+		encodedCapacity = std::max<size_t>(encodedCapacity, SequenceCodec::encodeBound(layout));
+	}
+
+	wholeField.resize(encodedCapacity);
+	encoded.resize(encodedCapacity * header.fieldCount);
+
+	size_t fieldOffset = 0;
+	size_t encodedTotal = 0;
+	uint64_t rawTotal = 0;
+	uint64_t bricksTotal = 0;
+
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		SequenceLayout layout(header.N, header.totalN, getFieldStorageBytes(FieldStorage(header.storage[i])), int(header.brickSize));
+		size_t rawBytes = layout.valueBytes * size_t(header.totalN);
+
+		const unsigned char* field = buffer.data() + fieldOffset;
+		unsigned char* previous = previousFrame.data() + fieldOffset;
+		unsigned char* destination = encoded.data() + encodedTotal;
+		size_t capacity = encoded.size() - encodedTotal;
+
+		size_t encodedBytes = 0;
+		if (frameCodec == RecordingCodec::Wavelet)
+		{
+			encodedBytes = SequenceCodec::encodeLossy(field, layout, FieldStorage(header.storage[i]), waveletSettings, scratch, destination, capacity);
+		}
+		else if (keyframe)
+		{
+			encodedBytes = SequenceCodec::encodeKeyframe(field, layout, frameCodec, scratch, destination, capacity);
+		}
+		else
+		{
+			int changedBricks = 0;
+			encodedBytes = SequenceCodec::encodeDelta(field, previous, layout, frameCodec, scratch, destination, capacity, changedBricks);
+
+			// When most of the field changed the difference is noise and can be larger than the field itself.
+			if (changedBricks * 2 > layout.getBrickCount())
+			{
+				size_t wholeBytes = SequenceCodec::encodeKeyframe(field, layout, frameCodec, scratch, wholeField.data(), wholeField.size());
+				if (wholeBytes != 0 && (encodedBytes == 0 || wholeBytes < encodedBytes))
+				{
+					memcpy(destination, wholeField.data(), wholeBytes);
+					encodedBytes = wholeBytes;
+					changedBricks = layout.getBrickCount();
+					frameHeader.wholeFields |= 1u << i;
+				}
+			}
+
+			frameHeader.changedBricks += uint32_t(changedBricks);
+			bricksTotal += uint64_t(layout.getBrickCount());
+		}
+
+		if (encodedBytes == 0)
+			return false;
+
+		memcpy(previous, field, rawBytes);
+
+		frameHeader.rawBytes[i] = uint32_t(rawBytes);
+		frameHeader.encodedBytes[i] = uint32_t(encodedBytes);
+
+		fieldOffset += rawBytes;
+		encodedTotal += encodedBytes;
+		rawTotal += rawBytes;
+	}
+
+	double encodeMs = encodeTimer.getElapsedMilliseconds();
+
+	Stopwatch writeTimer;
+	RecordingIndexEntry entry = { uint64_t(file.getPosition()), frameIndex, frameHeader.frameType, 0 };
+	bool written = file.write(&frameHeader, sizeof(frameHeader)) && file.write(encoded.data(), encodedTotal);
+	double writeMs = writeTimer.getElapsedMilliseconds();
+
+	frameIndexEntries.push_back(entry);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.encodeMs += encodeMs;
+	stats.writeMs += writeMs;
+	stats.rawBytes += rawTotal;
+	stats.encodedBytes += sizeof(frameHeader) + encodedTotal;
+	stats.bricksStored += frameHeader.changedBricks;
+	stats.bricksTotal += bricksTotal;
+	if (keyframe)
+		stats.keyframesWritten++;
+
+	return written;
+}
+
+bool CFD::CFDRecorder::writeIndex()
+{
+	RecordingFooter footer = {};
+	footer.indexOffset = uint64_t(file.getPosition());
+	footer.frameCount = uint32_t(frameIndexEntries.size());
+	footer.magic = FooterMagic;
+
+	return file.write(frameIndexEntries.data(), frameIndexEntries.size() * sizeof(RecordingIndexEntry)) && file.write(&footer, sizeof(footer));
+}
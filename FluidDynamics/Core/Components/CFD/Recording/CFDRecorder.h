@@ -0,0 +1,241 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Core/Entity System/Component.h"
+#include "SequenceCodec.h"
+#include "Utility/File/AtomicFile.h"
+#include "Utility/Threading/ThreadPool.h"
+#include "Utility/Time/Stopwatch.h"
+
+namespace CFD
+{
+	class CFDGrid;
+
+	// What the recorder does when the writer thread falls behind and every pooled buffer is in use.
+	enum class RecorderBackPressure
+	{
+		Drop = 0,		// Skip the frame, the solver never waits.
+		Block,			// Wait for the writer to free a buffer, every frame is kept.
+		Downsample,		// Skip the frame and only record every other frame until the writer catches up.
+	};
+
+	// How field payloads are encoded in a recording.
+	enum class RecordingCodec : uint32_t
+	{
+		None = 0,
+		ShuffleLZ,		// Byte shuffle by value width followed by the LZ block compressor.
+		Wavelet,		// Lossy wavelet codec within an error bound, every frame is a keyframe.
+	};
+
+	// Fixed size header at the start of every recording.
+	struct RecordingHeader
+	{
+		char magic[8];
+		uint32_t version;
+		uint32_t headerBytes;
+		int32_t N;
+		int32_t dimensions;
+		int32_t totalN;
+		uint32_t fieldCount;		// 1 for density only, 4 with velocity.
+		uint32_t codec;
+		uint32_t storage[4];		// FieldStorage of density and each velocity component.
+		float timeStep;
+		uint32_t keyframeInterval;	// Frames between keyframes.
+		uint32_t brickSize;			// Width of the bricks deltas skip unchanged regions in.
+	};
+
+	// Whether a frame can be decoded on its own or needs the frame before it.
+	enum class RecordingFrameType : uint32_t
+	{
+		Keyframe = 0,
+		Delta,
+	};
+
+	// Header in front of every frame, followed by the encoded payload of each field.
+	struct RecordingFrameHeader
+	{
+		uint32_t magic;
+		uint32_t fieldCount;
+		uint64_t frameIndex;		// Simulation step the frame was taken on.
+		uint32_t frameType;
+		uint32_t changedBricks;		// Bricks stored across every field of a delta.
+		uint32_t wholeFields;		// Bit per field stored whole inside a delta, used when that was smaller than the difference.
+		uint32_t reserved;
+		uint32_t rawBytes[4];
+		uint32_t encodedBytes[4];
+	};
+
+	// Entry in the frame index written at the end of a recording.
+	struct RecordingIndexEntry
+	{
+		uint64_t offset;			// Start of the frame header.
+		uint64_t frameIndex;
+		uint32_t frameType;
+		uint32_t reserved;
+	};
+
+	// Last bytes of a recording, pointing back at the frame index.
+	struct RecordingFooter
+	{
+		uint64_t indexOffset;
+		uint32_t frameCount;
+		uint32_t magic;
+	};
+
+	// Throughput accounting for a recorder.
+	struct RecorderStats
+	{
+		uint64_t framesSubmitted = 0;	// Frames the solver offered to the recorder.
+		uint64_t framesWritten = 0;		// Frames that reached the file.
+		uint64_t framesDropped = 0;		// Frames lost because every buffer was in use.
+		uint64_t framesSkipped = 0;		// Frames skipped while downsampling.
+		uint64_t keyframesWritten = 0;
+		uint64_t bricksStored = 0;		// Delta bricks that changed and had to be written.
+		uint64_t bricksTotal = 0;		// Delta bricks considered, changed or not.
+		uint64_t rawBytes = 0;			// Field bytes of every written frame before encoding.
+		uint64_t encodedBytes = 0;		// Bytes written to the file, including headers.
+		double copyMs = 0.0;			// Time the solver spent copying fields into buffers.
+		double blockedMs = 0.0;			// Time the solver spent waiting for a free buffer.
+		double encodeMs = 0.0;			// Time the writer spent encoding.
+		double writeMs = 0.0;			// Time the writer spent writing to disk.
+		double elapsedSeconds = 0.0;	// Time since the recording started.
+		int queueDepth = 0;				// Frames waiting for the writer.
+		int maxQueueDepth = 0;
+		int downsampleStride = 1;		// Only every Nth frame is currently recorded.
+
+		// Returns how many times smaller the encoded frames are than the raw fields.
+		double getCompressionRatio() const { return encodedBytes > 0 ? double(rawBytes) / double(encodedBytes) : 0.0; }
+
+		// Returns the raw field megabytes the writer gets through per second of encoding and writing.
+		double getWriterMBps() const { return (encodeMs + writeMs) > 0.0 ? (double(rawBytes) / (1024.0 * 1024.0)) / ((encodeMs + writeMs) / 1000.0) : 0.0; }
+
+		// Returns the fraction of delta bricks left out because they did not change.
+		double getBrickSkipRatio() const { return bricksTotal > 0 ? 1.0 - double(bricksStored) / double(bricksTotal) : 0.0; }
+
+		// Returns the raw field megabytes recorded per second of wall clock time.
+		double getRecordedMBps() const { return elapsedSeconds > 0.0 ? (double(rawBytes) / (1024.0 * 1024.0)) / elapsedSeconds : 0.0; }
+	};
+
+	// Records every simulation step of the CFDGrid on the same GameObject to disk.
+	// The solver only copies the fields into a pooled buffer, encoding and writing happen on a background thread.
+	class CFDRecorder : public Component
+	{
+	public:
+		static const char Magic[8];
+		static const uint32_t Version = 2;
+		static const uint32_t FrameMagic = 0x454D5246; // "FRME"
+		static const uint32_t FooterMagic = 0x58444E49; // "INDX"
+
+		CFDRecorder();
+		~CFDRecorder();
+
+		// Starts recording the passed in grid to the passed in path, the file only appears once the recording is stopped.
+		bool start(CFDGrid* grid, const std::string& path);
+
+		// Writes every queued frame, stops the writer thread and moves the recording into place.
+		bool stop();
+
+		// Returns whether a recording is in progress.
+		bool isRecording() { return recording; }
+
+		// Copies the current frame of the grid into a pooled buffer and queues it for the writer.
+		void submit(CFDGrid* grid, uint64_t frameIndex);
+
+		// Sets whether the three velocity components are recorded alongside density, takes effect on the next start.
+		void setRecordVelocity(bool val) { recordVelocity = val; }
+		bool getRecordVelocity() { return recordVelocity; }
+
+		// Sets what happens when the writer falls behind.
+		void setBackPressure(RecorderBackPressure val) { backPressure = val; }
+		RecorderBackPressure getBackPressure() { return backPressure; }
+
+		// Sets how frames are encoded, takes effect on the next start.
+		void setCodec(RecordingCodec val) { codec = val; }
+		RecordingCodec getCodec() { return codec; }
+
+		// Sets the error bound or rate of the wavelet codec, takes effect on the next start.
+		void setWaveletSettings(const WaveletSettings& val) { waveletSettings = val; }
+		const WaveletSettings& getWaveletSettings() { return waveletSettings; }
+
+		// Sets how many frames apart keyframes are, the frames between store only what changed. Takes effect on the next start.
+		void setKeyframeInterval(int val) { keyframeInterval = val > 0 ? val : 1; }
+		int getKeyframeInterval() { return keyframeInterval; }
+
+		// Sets the width of the bricks unchanged regions are skipped in, takes effect on the next start.
+		void setBrickSize(int val) { brickSize = val > 0 ? val : 1; }
+		int getBrickSize() { return brickSize; }
+
+		// Sets how many frames can be waiting for the writer at once, takes effect on the next start.
+		void setPoolSize(int val) { poolSize = val > 0 ? val : 1; }
+		int getPoolSize() { return poolSize; }
+
+		// Returns a snapshot of the throughput accounting.
+		RecorderStats getStats();
+
+		// Returns the path the recording is written to.
+		const std::string& getPath() { return path; }
+
+		// Largest value the downsample stride grows to.
+		static const int MaxDownsampleStride = 64;
+
+	private:
+
+		// A pooled buffer waiting for the writer.
+		struct PendingFrame
+		{
+			int buffer;
+			uint64_t frameIndex;
+		};
+
+		// Writer thread loop.
+		void writerLoop();
+
+		// Encodes and writes one frame, called on the writer thread.
+		bool writeFrame(const std::vector<unsigned char>& buffer, uint64_t frameIndex);
+
+		// Writes the frame index and footer once every frame is written.
+		bool writeIndex();
+
+		bool recording = false;
+		bool recordVelocity = false;
+		RecorderBackPressure backPressure = RecorderBackPressure::Drop;
+		RecordingCodec codec = RecordingCodec::ShuffleLZ;
+		int poolSize = 4;
+		int keyframeInterval = 30;
+		int brickSize = 8;
+		WaveletSettings waveletSettings;
+
+		std::string path;
+		RecordingHeader header = {};
+		AtomicFile file;
+
+		// ------ Shared with the writer thread, guarded by the mutex.
+
+		std::mutex mutex;
+		std::condition_variable frameQueued;
+		std::condition_variable bufferFreed;
+		std::vector<std::vector<unsigned char>> pool;
+		std::vector<int> freeBuffers;
+		std::deque<PendingFrame> queue;
+		RecorderStats stats;
+		bool stopping = false;
+		bool writeFailed = false;
+
+		std::thread writer;
+		Stopwatch recordingTimer;
+
+		// ------ Writer thread state.
+
+		std::vector<unsigned char> previousFrame;
+		std::vector<unsigned char> encoded;
+		std::vector<unsigned char> wholeField;
+		std::vector<RecordingIndexEntry> frameIndexEntries;
+		SequenceScratch scratch;
+		ThreadPool encodePool;
+	};
+}
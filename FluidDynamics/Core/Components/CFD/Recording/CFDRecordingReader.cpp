@@ -0,0 +1,222 @@
+#include "CFDRecordingReader.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace CFD;
+
+CFDRecordingReader::CFDRecordingReader()
+{
+}
+
+CFDRecordingReader::~CFDRecordingReader()
+{
+	close();
+}
+
+bool CFD::CFDRecordingReader::open(const std::string& path)
+{
+	close();
+
+	// Frames are decoded straight out of the mapping, nothing is read ahead of time.
+	if (!file.open(path) || file.getSize() < sizeof(header))
+	{
+		close();
+		return false;
+	}
+
+	fileBytes = file.getSize();
+	memcpy(&header, file.getData(), sizeof(header));
+
+	if (memcmp(header.magic, CFDRecorder::Magic, sizeof(header.magic)) != 0 ||
+		header.version != CFDRecorder::Version || header.headerBytes != sizeof(RecordingHeader) ||
+		header.fieldCount < 1 || header.fieldCount > 4 || header.N <= 0 || header.totalN <= 0 ||
+		header.keyframeInterval == 0 || header.brickSize == 0 || header.codec > uint32_t(RecordingCodec::Wavelet))
+	{
+		close();
+		return false;
+	}
+
+	if (!loadIndex())
+		scanFrames();
+
+	// Every frame needs a keyframe to decode from.
+	while (!frames.empty() && frames.front().type != RecordingFrameType::Keyframe)
+		frames.erase(frames.begin());
+
+	for (int i = 0; i < int(frames.size()); ++i)
+	{
+		if (frames[i].type == RecordingFrameType::Keyframe)
+			keyframes.push_back(i);
+	}
+
+	scratch.pool = &decodePool;
+
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		if (header.storage[i] > uint32_t(FieldStorage::BFloat16))
+		{
+			close();
+			return false;
+		}
+
+		fields[i].assign(getFieldStorageBytes(FieldStorage(header.storage[i])) * size_t(header.totalN), 0);
+	}
+
+	return true;
+}
+
+void CFD::CFDRecordingReader::close()
+{
+	file.close();
+	fileBytes = 0;
+	header = {};
+	frames.clear();
+	keyframes.clear();
+	decodedFrame = -1;
+	lastDecodeCount = 0;
+	lastDecodeMs = 0.0;
+
+	for (std::vector<unsigned char>& field : fields)
+		field.clear();
+}
+
+bool CFD::CFDRecordingReader::loadIndex()
+{
+	RecordingFooter footer;
+	if (fileBytes < sizeof(header) + sizeof(footer))
+		return false;
+
+	memcpy(&footer, file.getData() + fileBytes - sizeof(footer), sizeof(footer));
+
+	uint64_t indexBytes = uint64_t(footer.frameCount) * sizeof(RecordingIndexEntry);
+	if (footer.magic != CFDRecorder::FooterMagic || footer.indexOffset < sizeof(header) || footer.indexOffset + indexBytes + sizeof(footer) != fileBytes)
+		return false;
+
+	for (uint32_t i = 0; i < footer.frameCount; ++i)
+	{
+		RecordingIndexEntry entry;
+		memcpy(&entry, file.getData() + footer.indexOffset + i * sizeof(RecordingIndexEntry), sizeof(entry));
+
+		if (entry.offset + sizeof(RecordingFrameHeader) > footer.indexOffset || entry.frameType > uint32_t(RecordingFrameType::Delta))
+		{
+			frames.clear();
+			return false;
+		}
+
+		frames.push_back({ entry.frameIndex, entry.offset, RecordingFrameType(entry.frameType) });
+	}
+
+	return true;
+}
+
+void CFD::CFDRecordingReader::scanFrames()
+{
+	// Walk the frame headers, a frame cut short ends the index.
+	uint64_t offset = sizeof(header);
+	RecordingFrameHeader frameHeader;
+	while (offset + sizeof(frameHeader) <= fileBytes)
+	{
+		memcpy(&frameHeader, file.getData() + offset, sizeof(frameHeader));
+
+		if (frameHeader.magic != CFDRecorder::FrameMagic || frameHeader.fieldCount != header.fieldCount || frameHeader.frameType > uint32_t(RecordingFrameType::Delta))
+			break;
+
+		uint64_t payloadBytes = 0;
+		for (uint32_t i = 0; i < frameHeader.fieldCount; ++i)
+			payloadBytes += frameHeader.encodedBytes[i];
+
+		if (offset + sizeof(frameHeader) + payloadBytes > fileBytes)
+			break;
+
+		frames.push_back({ frameHeader.frameIndex, offset, RecordingFrameType(frameHeader.frameType) });
+		offset += sizeof(frameHeader) + payloadBytes;
+	}
+}
+
+int CFD::CFDRecordingReader::getKeyframeFor(int frame)
+{
+	std::vector<int>::iterator keyframe = std::upper_bound(keyframes.begin(), keyframes.end(), frame);
+	return (keyframe == keyframes.begin()) ? -1 : *(keyframe - 1);
+}
+
+bool CFD::CFDRecordingReader::readFrame(int frame)
+{
+	lastDecodeCount = 0;
+	lastDecodeMs = 0.0;
+
+	if (!file.isOpen() || frame < 0 || frame >= int(frames.size()))
+		return false;
+
+	if (frame == decodedFrame)
+		return true;
+
+	// Carry on from the decoded frame if no keyframe sits between it and the target, otherwise start at the keyframe.
+	int keyframe = getKeyframeFor(frame);
+	int start = (decodedFrame >= keyframe && decodedFrame < frame) ? decodedFrame + 1 : keyframe;
+	Stopwatch decodeTimer;
+
+	for (int i = start; i <= frame; ++i)
+	{
+		if (!decodeFrame(i))
+		{
+			decodedFrame = -1;
+			return false;
+		}
+
+		decodedFrame = i;
+		lastDecodeCount++;
+	}
+
+	lastDecodeMs = decodeTimer.getElapsedMilliseconds();
+	return true;
+}
+
+bool CFD::CFDRecordingReader::decodeFrame(int frame)
+{
+	RecordingFrameHeader frameHeader;
+	memcpy(&frameHeader, file.getData() + frames[frame].offset, sizeof(frameHeader));
+
+	if (frameHeader.magic != CFDRecorder::FrameMagic || frameHeader.fieldCount != header.fieldCount)
+		return false;
+
+	uint64_t payloadBytes = 0;
+	for (uint32_t i = 0; i < frameHeader.fieldCount; ++i)
+		payloadBytes += frameHeader.encodedBytes[i];
+
+	if (frames[frame].offset + sizeof(frameHeader) + payloadBytes > fileBytes)
+		return false;
+
+	const bool keyframe = RecordingFrameType(frameHeader.frameType) == RecordingFrameType::Keyframe;
+	const unsigned char* source = file.getData() + frames[frame].offset + sizeof(frameHeader);
+
+	for (uint32_t i = 0; i < header.fieldCount; ++i)
+	{
+		SequenceLayout layout(header.N, header.totalN, getFieldStorageBytes(FieldStorage(header.storage[i])), int(header.brickSize));
+
+		bool whole = keyframe || (frameHeader.wholeFields & (1u << i)) != 0;
+		bool decoded;
+		if (RecordingCodec(header.codec) == RecordingCodec::Wavelet)
+			decoded = keyframe && SequenceCodec::decodeLossy(source, frameHeader.encodedBytes[i], layout, FieldStorage(header.storage[i]), scratch, fields[i].data());
+		else if (whole)
+			decoded = SequenceCodec::decodeKeyframe(source, frameHeader.encodedBytes[i], layout, RecordingCodec(header.codec), scratch, fields[i].data());
+		else
+			decoded = SequenceCodec::decodeDelta(source, frameHeader.encodedBytes[i], layout, RecordingCodec(header.codec), scratch, fields[i].data());
+
+		if (!decoded)
+			return false;
+
+		source += frameHeader.encodedBytes[i];
+	}
+
+	return true;
+}
+
+bool CFD::CFDRecordingReader::readField(int frame, int field, void* destination)
+{
+	if (field < 0 || field >= int(header.fieldCount) || !readFrame(frame))
+		return false;
+
+	memcpy(destination, fields[field].data(), fields[field].size());
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CFDRecorder.h"
+#include "Utility/File/MappedFile.h"
+
+namespace CFD
+{
+	// Reads frames back out of a recording written by CFDRecorder, decoding straight from a memory mapping of the file.
+	// Seeking decodes forward from the nearest keyframe, reading frames in order only applies one delta per frame.
+	class CFDRecordingReader
+	{
+	public:
+		CFDRecordingReader();
+		~CFDRecordingReader();
+
+		CFDRecordingReader(const CFDRecordingReader&) = delete;
+		CFDRecordingReader& operator=(const CFDRecordingReader&) = delete;
+
+		// Opens a recording and loads its frame index. Returns false if the file is not a recording this version can read.
+		bool open(const std::string& path);
+
+		// Closes the recording.
+		void close();
+
+		// Returns whether a recording is open.
+		bool isOpen() { return file.isOpen(); }
+
+		// Returns the header of the open recording.
+		const RecordingHeader& getHeader() { return header; }
+
+		// Returns the number of complete frames in the recording.
+		int getFrameCount() { return int(frames.size()); }
+
+		// Returns the number of keyframes in the recording.
+		int getKeyframeCount() { return int(keyframes.size()); }
+
+		// Returns the simulation step the passed in frame was taken on.
+		uint64_t getFrameIndex(int frame) { return frames[frame].frameIndex; }
+
+		// Returns the keyframe decoding of the passed in frame has to start from.
+		int getKeyframeFor(int frame);
+
+		// Decodes every field of the passed in frame, reusing the last decoded frame when it is on the way.
+		// Returns false if the frame doesnt exist or a payload is corrupt.
+		bool readFrame(int frame);
+
+		// Returns the frame held in the field buffers, -1 if none is.
+		int getDecodedFrame() { return decodedFrame; }
+
+		// Returns a field of the last decoded frame in its stored format. Field 0 is density, 1 to 3 are the velocity components.
+		const void* getField(int field) { return fields[field].data(); }
+
+		// Returns the number of frames decoded by the last readFrame, one when playing forwards.
+		int getLastDecodeCount() { return lastDecodeCount; }
+
+		// Returns the milliseconds the last readFrame spent decoding.
+		double getLastDecodeMs() { return lastDecodeMs; }
+
+		// Decodes one field of a frame into destination in its stored format.
+		// Returns false if the frame or field doesnt exist or a payload is corrupt.
+		bool readField(int frame, int field, void* destination);
+
+	private:
+
+		// Location of a frame in the file.
+		struct FrameEntry
+		{
+			uint64_t frameIndex;
+			uint64_t offset;	// Start of the frame header.
+			RecordingFrameType type;
+		};
+
+		// Loads the index written at the end of the file. Returns false if there isnt a valid one.
+		bool loadIndex();
+
+		// Builds the index by walking the frame headers, used when the file has no index.
+		void scanFrames();
+
+		// Decodes a single frame on top of the field buffers, which must hold the frame before it unless it is a keyframe.
+		bool decodeFrame(int frame);
+
+		MappedFile file;
+		uint64_t fileBytes = 0;
+		RecordingHeader header = {};
+		std::vector<FrameEntry> frames;
+		std::vector<int> keyframes;
+
+		std::vector<unsigned char> fields[4];
+		int decodedFrame = -1;
+		int lastDecodeCount = 0;
+		double lastDecodeMs = 0.0;
+
+		SequenceScratch scratch;
+		ThreadPool decodePool;
+	};
+}
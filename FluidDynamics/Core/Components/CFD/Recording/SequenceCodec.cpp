@@ -0,0 +1,226 @@
+#include "SequenceCodec.h"
+#include "CFDRecorder.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Compression/ByteShuffle.h"
+#include "Utility/Compression/LZ.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace CFD;
+
+namespace
+{
+	// Returns whether every byte in the range is zero.
+	bool isZero(const unsigned char* bytes, size_t count)
+	{
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= count; i += sizeof(uint64_t))
+		{
+			uint64_t word;
+			memcpy(&word, bytes + i, sizeof(word));
+			if (word != 0)
+				return false;
+		}
+
+		for (; i < count; ++i)
+		{
+			if (bytes[i] != 0)
+				return false;
+		}
+
+		return true;
+	}
+
+	// XORs count bytes of a and b into destination.
+	void exclusiveOr(const unsigned char* a, const unsigned char* b, unsigned char* destination, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			destination[i] = a[i] ^ b[i];
+	}
+}
+
+template<typename RowFunction>
+void CFD::SequenceCodec::forEachBrickRow(const SequenceLayout& layout, int brick, RowFunction row)
+{
+	const int bricksX = layout.getBricksX();
+	const int bricksY = layout.getBricksY();
+
+	const int x0 = (brick % bricksX) * layout.brickSize;
+	const int y0 = ((brick / bricksX) % bricksY) * layout.brickSize;
+	const int z0 = (brick / (bricksX * bricksY)) * layout.brickSize;
+
+	const int x1 = std::min<int>(x0 + layout.brickSize, layout.N);
+	const int y1 = std::min<int>(y0 + layout.brickSize, layout.N);
+	const int z1 = std::min<int>(z0 + layout.brickSize, layout.getDepth());
+
+	for (int z = z0; z < z1; ++z)
+	{
+		for (int y = y0; y < y1; ++y)
+		{
+			// The last slice of the volume can run past the end of the array.
+			int begin = layout.N * layout.N * z + layout.N * y + x0;
+			int end = std::min<int>(begin + (x1 - x0), layout.totalN);
+			if (end <= begin)
+				return;
+
+			row(size_t(begin) * layout.valueBytes, size_t(end - begin) * layout.valueBytes);
+		}
+	}
+}
+
+size_t CFD::SequenceCodec::encodeBound(const SequenceLayout& layout)
+{
+	size_t bound = layout.getBitmapBytes() + LZ::compressBound(size_t(layout.totalN) * layout.valueBytes);
+	return std::max<size_t>(bound, Wavelet::compressBound(size_t(layout.totalN)));
+}
+
+size_t CFD::SequenceCodec::encodeKeyframe(const unsigned char* field, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination, size_t capacity)
+{
+	return pack(field, size_t(layout.totalN) * layout.valueBytes, layout.valueBytes, codec, scratch, destination, capacity);
+}
+
+size_t CFD::SequenceCodec::encodeDelta(const unsigned char* field, const unsigned char* previous, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch,
+	unsigned char* destination, size_t capacity, int& changedBricks)
+{
+	const size_t fieldBytes = size_t(layout.totalN) * layout.valueBytes;
+	const size_t bitmapBytes = layout.getBitmapBytes();
+	if (capacity < bitmapBytes)
+		return 0;
+
+	// Unchanged values XOR to zero, so unchanged bricks are all zero bytes.
+	scratch.difference.resize(fieldBytes);
+	exclusiveOr(field, previous, scratch.difference.data(), fieldBytes);
+
+	scratch.gathered.resize(fieldBytes);
+	memset(destination, 0, bitmapBytes);
+
+	size_t gatheredBytes = 0;
+	changedBricks = 0;
+
+	const int brickCount = layout.getBrickCount();
+	for (int brick = 0; brick < brickCount; ++brick)
+	{
+		bool changed = false;
+		forEachBrickRow(layout, brick, [&](size_t offset, size_t bytes)
+		{
+			changed = changed || !isZero(scratch.difference.data() + offset, bytes);
+		});
+
+		if (!changed)
+			continue;
+
+		destination[brick / 8] |= (unsigned char)(1 << (brick % 8));
+		changedBricks++;
+
+		forEachBrickRow(layout, brick, [&](size_t offset, size_t bytes)
+		{
+			memcpy(scratch.gathered.data() + gatheredBytes, scratch.difference.data() + offset, bytes);
+			gatheredBytes += bytes;
+		});
+	}
+
+	if (gatheredBytes == 0)
+		return bitmapBytes;
+
+	size_t packedBytes = pack(scratch.gathered.data(), gatheredBytes, layout.valueBytes, codec, scratch, destination + bitmapBytes, capacity - bitmapBytes);
+	return packedBytes == 0 ? 0 : bitmapBytes + packedBytes;
+}
+
+bool CFD::SequenceCodec::decodeKeyframe(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* field)
+{
+	return unpack(source, sourceBytes, size_t(layout.totalN) * layout.valueBytes, layout.valueBytes, codec, scratch, field);
+}
+
+bool CFD::SequenceCodec::decodeDelta(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* field)
+{
+	const size_t bitmapBytes = layout.getBitmapBytes();
+	if (sourceBytes < bitmapBytes)
+		return false;
+
+	// The bitmap says how many bytes the gathered bricks unpack to.
+	const int brickCount = layout.getBrickCount();
+	size_t gatheredBytes = 0;
+	for (int brick = 0; brick < brickCount; ++brick)
+	{
+		if (source[brick / 8] & (1 << (brick % 8)))
+		{
+			forEachBrickRow(layout, brick, [&](size_t, size_t bytes) { gatheredBytes += bytes; });
+		}
+	}
+
+	if (gatheredBytes == 0)
+		return sourceBytes == bitmapBytes;
+
+	scratch.gathered.resize(gatheredBytes);
+	if (!unpack(source + bitmapBytes, sourceBytes - bitmapBytes, gatheredBytes, layout.valueBytes, codec, scratch, scratch.gathered.data()))
+		return false;
+
+	size_t position = 0;
+	for (int brick = 0; brick < brickCount; ++brick)
+	{
+		if (source[brick / 8] & (1 << (brick % 8)))
+		{
+			forEachBrickRow(layout, brick, [&](size_t offset, size_t bytes)
+			{
+				exclusiveOr(field + offset, scratch.gathered.data() + position, field + offset, bytes);
+				position += bytes;
+			});
+		}
+	}
+
+	return true;
+}
+
+size_t CFD::SequenceCodec::encodeLossy(const unsigned char* field, const SequenceLayout& layout, FieldStorage storage, const WaveletSettings& settings, SequenceScratch& scratch,
+	unsigned char* destination, size_t capacity)
+{
+	scratch.values.resize(size_t(layout.totalN));
+	widenFieldArray(storage, field, scratch.values.data(), scratch.values.size());
+
+	return Wavelet::compress(scratch.values.data(), layout.N, layout.N, layout.totalN, settings, destination, capacity, scratch.pool);
+}
+
+bool CFD::SequenceCodec::decodeLossy(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, FieldStorage storage, SequenceScratch& scratch, unsigned char* field)
+{
+	scratch.values.resize(size_t(layout.totalN));
+	if (!Wavelet::decompress(source, sourceBytes, scratch.values.data(), layout.N, layout.N, layout.totalN, scratch.pool))
+		return false;
+
+	narrowFieldArray(storage, scratch.values.data(), field, scratch.values.size());
+	return true;
+}
+
+size_t CFD::SequenceCodec::pack(const unsigned char* values, size_t bytes, size_t valueBytes, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination, size_t capacity)
+{
+	if (codec == RecordingCodec::ShuffleLZ)
+	{
+		scratch.shuffled.resize(bytes);
+		ByteShuffle::shuffle(values, scratch.shuffled.data(), bytes / valueBytes, valueBytes);
+		return LZ::compress(scratch.shuffled.data(), bytes, destination, capacity);
+	}
+
+	if (bytes > capacity)
+		return 0;
+
+	memcpy(destination, values, bytes);
+	return bytes;
+}
+
+bool CFD::SequenceCodec::unpack(const unsigned char* source, size_t sourceBytes, size_t bytes, size_t valueBytes, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination)
+{
+	if (codec == RecordingCodec::ShuffleLZ)
+	{
+		scratch.shuffled.resize(bytes);
+		if (!LZ::decompress(source, sourceBytes, scratch.shuffled.data(), bytes))
+			return false;
+
+		ByteShuffle::unshuffle(scratch.shuffled.data(), destination, bytes / valueBytes, valueBytes);
+		return true;
+	}
+
+	if (sourceBytes != bytes)
+		return false;
+
+	memcpy(destination, source, bytes);
+	return true;
+}
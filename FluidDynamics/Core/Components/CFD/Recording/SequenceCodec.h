@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "Utility/Compression/Wavelet.h"
+
+class ThreadPool;
+
+namespace CFD
+{
+	enum class RecordingCodec : uint32_t;
+	enum class FieldStorage;
+
+	// Shape of a field array as the sequence codec walks it.
+	// Arrays are indexed N * N * z + N * y + x, so they are treated as a volume N wide, N high and as deep as the array reaches.
+	struct SequenceLayout
+	{
+		SequenceLayout(int sideSize, int totalSize, size_t bytesPerValue, int brick) : N(sideSize), totalN(totalSize), valueBytes(bytesPerValue), brickSize(brick) {};
+
+		// Returns the depth of the volume covering the whole array.
+		int getDepth() const { return (totalN + N * N - 1) / (N * N); }
+
+		// Returns the number of bricks along each axis.
+		int getBricksX() const { return (N + brickSize - 1) / brickSize; }
+		int getBricksY() const { return (N + brickSize - 1) / brickSize; }
+		int getBricksZ() const { return (getDepth() + brickSize - 1) / brickSize; }
+
+		// Returns the total number of bricks covering the array.
+		int getBrickCount() const { return getBricksX() * getBricksY() * getBricksZ(); }
+
+		// Returns the bytes of the bitmap marking changed bricks.
+		size_t getBitmapBytes() const { return size_t(getBrickCount() + 7) / 8; }
+
+		int N;
+		int totalN;
+		size_t valueBytes;
+		int brickSize;
+	};
+
+	// Scratch buffers reused between frames so encoding and decoding never allocate once warmed up.
+	struct SequenceScratch
+	{
+		std::vector<unsigned char> difference;
+		std::vector<unsigned char> gathered;
+		std::vector<unsigned char> shuffled;
+		std::vector<float> values;
+
+		// Pool lossy fields are split across, they are coded on the calling thread without one.
+		ThreadPool* pool = nullptr;
+	};
+
+	// Encodes fields as whole keyframes or as the XOR against the previous frame, leaving out every brick that did not change.
+	class SequenceCodec
+	{
+	public:
+
+		// Returns the largest size a field of the passed in layout can encode to, as a keyframe or a delta.
+		static size_t encodeBound(const SequenceLayout& layout);
+
+		// Encodes a whole field. Returns the encoded size, or zero if it did not fit.
+		static size_t encodeKeyframe(const unsigned char* field, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination, size_t capacity);
+
+		// Encodes the difference between a field and the same field in the previous frame. Returns the encoded size, or zero if it did not fit.
+		// changedBricks is set to the number of bricks that had to be stored.
+		static size_t encodeDelta(const unsigned char* field, const unsigned char* previous, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch,
+			unsigned char* destination, size_t capacity, int& changedBricks);
+
+		// Decodes a keyframe into field. Returns false if the payload is corrupt.
+		static bool decodeKeyframe(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* field);
+
+		// Applies a delta to field, which must hold the previous frame. Returns false if the payload is corrupt.
+		static bool decodeDelta(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, RecordingCodec codec, SequenceScratch& scratch, unsigned char* field);
+
+		// Encodes a whole field with the lossy wavelet codec. Returns the encoded size, or zero if it did not fit.
+		static size_t encodeLossy(const unsigned char* field, const SequenceLayout& layout, FieldStorage storage, const WaveletSettings& settings, SequenceScratch& scratch,
+			unsigned char* destination, size_t capacity);
+
+		// Decodes a lossy field back into its storage format. Returns false if the payload is corrupt.
+		static bool decodeLossy(const unsigned char* source, size_t sourceBytes, const SequenceLayout& layout, FieldStorage storage, SequenceScratch& scratch, unsigned char* field);
+
+	private:
+
+		// Packs values with the codec, shuffling by value width first. Returns the packed size, or zero if it did not fit.
+		static size_t pack(const unsigned char* values, size_t bytes, size_t valueBytes, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination, size_t capacity);
+
+		// Reverses pack into exactly bytes of destination.
+		static bool unpack(const unsigned char* source, size_t sourceBytes, size_t bytes, size_t valueBytes, RecordingCodec codec, SequenceScratch& scratch, unsigned char* destination);
+
+		// Calls the passed in function with the array offset and byte length of every row of the passed in brick.
+		template<typename RowFunction>
+		static void forEachBrickRow(const SequenceLayout& layout, int brick, RowFunction row);
+	};
+}
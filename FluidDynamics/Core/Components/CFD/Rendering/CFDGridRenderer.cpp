@@ -0,0 +1,132 @@
+#include "CFDGridRenderer.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "CFDTexturePacker.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Profiling/Trace.h"
+#include "Utility/Direct3D/Headers/D3D.h"
+
+using namespace CFD;
+
+CFDGridRenderer::CFDGridRenderer()
+{
+	this->setType(ComponentTypes::CFDGridRenderer);
+	this->setUpdateable(false);
+}
+
+CFDGridRenderer::~CFDGridRenderer()
+{
+	releaseTextures();
+}
+
+void CFD::CFDGridRenderer::Render()
+{
+	CFD_TRACE_SCOPE("CFDGridRenderer::Render");
+
+	Entity* owner = static_cast<Entity*>(getParent());
+	CFDGrid* grid = (owner != nullptr) ? owner->getComponent<CFDGrid>() : nullptr;
+
+	if (grid == nullptr || !grid->getSimulating() || grid->getAllVoxelData() == nullptr)
+		return;
+
+	int N = grid->getGridWidth();
+	int dimensions = grid->getDimensions();
+
+	if (voxelDensTex == nullptr || N != textureN || dimensions != textureDimensions)
+	{
+		releaseTextures();
+		if (!createTextures(N, dimensions))
+			return;
+	}
+
+	fillStaging(grid);
+
+	D3D* direct3D = D3D::getInstance();
+
+	direct3D->immediateContext->UpdateSubresource(voxelDensTex, 0, nullptr, densityTextureData.data(), UINT(sizeof(float) * N), UINT(sizeof(float) * N * N));
+	direct3D->immediateContext->UpdateSubresource(voxelVeloTex, 0, nullptr, velocityTextureData.data(), UINT(sizeof(Vector4) * N), UINT(sizeof(Vector4) * N * N));
+
+	direct3D->immediateContext->PSSetSamplers(0, 1, &sampler);
+	direct3D->immediateContext->PSSetShaderResources(0, 1, &voxelDensView);
+	direct3D->immediateContext->PSSetShaderResources(1, 1, &voxelVeloView);
+}
+
+bool CFD::CFDGridRenderer::createTextures(int size, int dim)
+{
+	D3D* direct3D = D3D::getInstance();
+
+	D3D11_TEXTURE3D_DESC texDesc = {};
+	texDesc.Width = size;
+	texDesc.Height = size;
+	texDesc.Depth = (dim > 2) ? size : 1;
+	texDesc.MipLevels = 1;
+	texDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	if (FAILED(direct3D->device->CreateTexture3D(&texDesc, nullptr, &voxelDensTex)))
+		return false;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC texViewDesc = {};
+	texViewDesc.Format = texDesc.Format;
+	texViewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
+	texViewDesc.Texture3D.MipLevels = texDesc.MipLevels;
+	texViewDesc.Texture3D.MostDetailedMip = 0;
+
+	if (FAILED(direct3D->device->CreateShaderResourceView(voxelDensTex, &texViewDesc, &voxelDensView)))
+		return false;
+
+	texDesc.Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
+
+	if (FAILED(direct3D->device->CreateTexture3D(&texDesc, nullptr, &voxelVeloTex)))
+		return false;
+
+	texViewDesc.Format = texDesc.Format;
+
+	if (FAILED(direct3D->device->CreateShaderResourceView(voxelVeloTex, &texViewDesc, &voxelVeloView)))
+		return false;
+
+	// Create Sampler
+	D3D11_SAMPLER_DESC sampDesc = {};
+	sampDesc.Filter = D3D11_FILTER_ANISOTROPIC;
+	sampDesc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+	sampDesc.ComparisonFunc = D3D11_COMPARISON_NEVER;
+	sampDesc.MinLOD = 0;
+	sampDesc.MaxLOD = D3D11_FLOAT32_MAX;
+
+	if (FAILED(direct3D->device->CreateSamplerState(&sampDesc, &sampler)))
+		return false;
+
+	size_t cells = size_t(size) * size_t(size) * size_t(texDesc.Depth);
+	densityTextureData.resize(cells);
+	velocityTextureData.resize(cells);
+	componentData.resize(cells);
+
+	textureN = size;
+	textureDimensions = dim;
+	return true;
+}
+
+void CFD::CFDGridRenderer::releaseTextures()
+{
+	if (voxelDensTex) voxelDensTex->Release();
+	if (voxelDensView) voxelDensView->Release();
+	if (voxelVeloTex) voxelVeloTex->Release();
+	if (voxelVeloView) voxelVeloView->Release();
+	if (sampler) sampler->Release();
+
+	voxelDensTex = nullptr;
+	voxelDensView = nullptr;
+	voxelVeloTex = nullptr;
+	voxelVeloView = nullptr;
+	sampler = nullptr;
+
+	textureN = 0;
+	textureDimensions = 0;
+}
+
+void CFD::CFDGridRenderer::fillStaging(CFDGrid* grid)
+{
+	CFDTexturePacker::pack(grid->getAllVoxelData(), densityTextureData.size(), densityTextureData.data(), velocityTextureData.data(), componentData.data());
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+#include <d3d11.h>
+#include "Core/Entity System/Component.h"
+#include "Utility/Math/Math.h"
+
+namespace CFD
+{
+	class CFDGrid;
+
+	// Uploads the fields of the CFDGrid on the same GameObject into 3D textures and binds them for the volume shaders.
+	// The grid itself knows nothing about Direct3D, this is the only place the simulation meets the GPU.
+	// Textures are created on the first frame and again whenever the grid changes size or dimensions.
+	class CFDGridRenderer : public Component
+	{
+	public:
+		CFDGridRenderer();
+		~CFDGridRenderer();
+
+		void Render();
+
+		// Returns the size of the CPU side staging buffers for a grid of the passed in dimensions.
+		static size_t getStagingBytes(int w, int h, int d) { return (sizeof(float) + sizeof(Vector4)) * size_t(w) * size_t(h) * size_t(d); }
+
+	private:
+
+		// Creates the density and velocity textures, their views and the sampler for the passed in grid.
+		bool createTextures(int size, int dim);
+
+		// Releases the density and velocity textures.
+		void releaseTextures();
+
+		// Widens the visible cells of every field into the staging buffers.
+		void fillStaging(CFDGrid* grid);
+
+		// Size and dimensions the textures were created for.
+		int textureN = 0;
+		int textureDimensions = 0;
+
+		// ------------ Texture Data.
+
+		std::vector<float> densityTextureData;
+		std::vector<Vector4> velocityTextureData;
+		std::vector<float> componentData;
+
+		// ------------ Textures.
+
+		ID3D11SamplerState* sampler = nullptr;
+
+		// Density
+
+		ID3D11Texture3D* voxelDensTex = nullptr;
+		ID3D11ShaderResourceView* voxelDensView = nullptr;
+
+		// Velocity
+
+		ID3D11Texture3D* voxelVeloTex = nullptr;
+		ID3D11ShaderResourceView* voxelVeloView = nullptr;
+	};
+}
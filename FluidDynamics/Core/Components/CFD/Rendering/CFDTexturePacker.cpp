@@ -0,0 +1,23 @@
+#include "CFDTexturePacker.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Profiling/Trace.h"
+
+using namespace CFD;
+
+void CFD::CFDTexturePacker::pack(CFDData* voxels, size_t cells, float* density, Vector4* velocity, float* scratch)
+{
+	CFD_TRACE_SCOPE("CFDTexturePacker::pack");
+
+	// The visible cells are the first N^dims values of every field, already in texture order.
+	widenFieldArray(voxels->density->getStorage(), voxels->density->getCurrentRawArray(), density, cells);
+
+	VoxelData* fields[] = { voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	float Vector4::* components[] = { &Vector4::x, &Vector4::y, &Vector4::z };
+	for (int c = 0; c < 3; ++c)
+	{
+		widenFieldArray(fields[c]->getStorage(), fields[c]->getCurrentRawArray(), scratch, cells);
+
+		for (size_t i = 0; i < cells; ++i)
+			velocity[i].*components[c] = scratch[i];
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include "Utility/Math/Math.h"
+
+namespace CFD
+{
+	struct CFDData;
+
+	// Repacks the visible cells of the grid's fields into the layouts the volume textures are uploaded from.
+	// Kept apart from CFDGridRenderer so the repack can be run and timed without a device.
+	class CFDTexturePacker
+	{
+	public:
+
+		// Widens the first cells values of density into density and of the three velocity fields into the x, y and z of velocity.
+		// scratch must hold cells floats, it is used to widen one velocity component at a time.
+		static void pack(CFDData* voxels, size_t cells, float* density, Vector4* velocity, float* scratch);
+	};
+}
@@ -0,0 +1,665 @@
+#include "CFDScenarioLibrary.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+
+using namespace CFD;
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	const char* const ScenarioNames[] = { "plume", "gaussian", "taylorGreen", "vortexRing", "room" };
+
+	// Starting fields of the visible cells, x fastest.
+	struct ScenarioFields
+	{
+		std::vector<float> density;
+		std::vector<float> velocityX;
+		std::vector<float> velocityY;
+		std::vector<float> velocityZ;
+	};
+
+	// Advection moves a value dt0 * velocity cells a step and diffusion spreads it dt0 * rate cells squared, so rates and speeds
+	// are given per step in cells and divided by this to get the same behaviour at every size.
+	double getCellScale(int N, int dimensions, float timeStep)
+	{
+		return double(timeStep) * pow(double(N), double(dimensions));
+	}
+
+	// Diffusion a step of the Gaussian blob and viscosity a step of the Taylor-Green vortex, in cells squared.
+	const double GaussianSpreadPerStep = 0.5;
+	const double TaylorGreenViscosityPerStep = 0.25;
+
+	// Speed the velocity scenarios start at, in cells a step.
+	const double StartingSpeed = 0.5;
+
+	double getGaussianWidth(int N) { return std::max(1.0, N / 10.0); }
+
+	double getCentre(int N) { return 0.5 * double(N - 1); }
+
+	size_t getVisibleCells(int N, int dimensions) { return size_t(N) * size_t(N) * size_t(dimensions > 2 ? N : 1); }
+
+	// Density of the Gaussian blob after the passed in steps, its variance grows by twice the spread each step and its peak
+	// falls to keep the mass.
+	float getGaussianDensity(int N, int dimensions, int x, int y, int z, int steps)
+	{
+		double width = getGaussianWidth(N);
+		double variance = width * width + 2.0 * GaussianSpreadPerStep * steps;
+		double centre = getCentre(N);
+
+		double distanceSquared = (x - centre) * (x - centre) + (y - centre) * (y - centre);
+		if (dimensions > 2)
+			distanceSquared += (z - centre) * (z - centre);
+
+		double peak = pow(width * width / variance, 0.5 * dimensions);
+		return float(peak * exp(-distanceSquared / (2.0 * variance)));
+	}
+
+	// Velocity of the Taylor-Green vortex after the passed in steps, one period across the grid decaying at exp(-2 nu k^2 t).
+	Vector3 getTaylorGreenVelocity(int N, float speed, int x, int y, int steps)
+	{
+		double k = 2.0 * Pi / N;
+		double decay = exp(-2.0 * k * k * TaylorGreenViscosityPerStep * steps);
+		double px = k * (x + 0.5);
+		double py = k * (y + 0.5);
+
+		return Vector3(float(speed * decay * sin(px) * cos(py)), float(-speed * decay * cos(px) * sin(py)), 0.0f);
+	}
+
+	// Vector potential of the vortex ring, a Gaussian core around a circle in the xz plane. Its curl is the ring's velocity.
+	Vector3 getRingPotential(int N, double x, double y, double z)
+	{
+		double radius = N / 6.0;
+		double core = std::max(1.0, N / 16.0);
+		double centre = getCentre(N);
+		double height = N / 3.0;
+
+		double dx = x - centre;
+		double dz = z - centre;
+		double rho = std::max(sqrt(dx * dx + dz * dz), 1.0e-6);
+		double distanceSquared = (rho - radius) * (rho - radius) + (y - height) * (y - height);
+		double strength = exp(-distanceSquared / (core * core));
+
+		return Vector3(float(-strength * dz / rho), 0.0f, float(strength * dx / rho));
+	}
+
+	void getStartingFields(CanonicalScenario scenario, int N, int dimensions, float cellScale, ScenarioFields& fields)
+	{
+		size_t cells = getVisibleCells(N, dimensions);
+		fields.density.assign(cells, 0.0f);
+		fields.velocityX.assign(cells, 0.0f);
+		fields.velocityY.assign(cells, 0.0f);
+		fields.velocityZ.assign(cells, 0.0f);
+
+		int depth = (dimensions > 2) ? N : 1;
+		float speed = float(StartingSpeed / cellScale);
+
+		if (scenario == CanonicalScenario::GaussianDiffusion)
+		{
+			for (int z = 0; z < depth; ++z)
+				for (int y = 0; y < N; ++y)
+					for (int x = 0; x < N; ++x)
+						fields.density[size_t(N) * N * z + size_t(N) * y + x] = getGaussianDensity(N, dimensions, x, y, z, 0);
+		}
+		else if (scenario == CanonicalScenario::TaylorGreen)
+		{
+			for (int z = 0; z < depth; ++z)
+			{
+				for (int y = 0; y < N; ++y)
+				{
+					for (int x = 0; x < N; ++x)
+					{
+						size_t index = size_t(N) * N * z + size_t(N) * y + x;
+						Vector3 velocity = getTaylorGreenVelocity(N, speed, x, y, 0);
+						fields.velocityX[index] = velocity.x;
+						fields.velocityY[index] = velocity.y;
+					}
+				}
+			}
+		}
+		else if (scenario == CanonicalScenario::VortexRing)
+		{
+			// Central differences of the potential, whose central difference divergence cancels exactly.
+			float largest = 0.0f;
+			for (int z = 0; z < depth; ++z)
+			{
+				for (int y = 0; y < N; ++y)
+				{
+					for (int x = 0; x < N; ++x)
+					{
+						size_t index = size_t(N) * N * z + size_t(N) * y + x;
+						Vector3 yUp = getRingPotential(N, x, y + 1, z);
+						Vector3 yDown = getRingPotential(N, x, y - 1, z);
+						Vector3 zUp = getRingPotential(N, x, y, z + 1);
+						Vector3 zDown = getRingPotential(N, x, y, z - 1);
+						Vector3 xUp = getRingPotential(N, x + 1, y, z);
+						Vector3 xDown = getRingPotential(N, x - 1, y, z);
+
+						fields.velocityX[index] = 0.5f * (yUp.z - yDown.z);
+						fields.velocityY[index] = 0.5f * (zUp.x - zDown.x) - 0.5f * (xUp.z - xDown.z);
+						fields.velocityZ[index] = -0.5f * (yUp.x - yDown.x);
+
+						// The ring's core also carries density, so it can be seen moving.
+						Vector3 potential = getRingPotential(N, x, y, z);
+						fields.density[index] = sqrtf(potential.x * potential.x + potential.z * potential.z);
+
+						largest = std::max(largest, fabsf(fields.velocityX[index]));
+						largest = std::max(largest, fabsf(fields.velocityY[index]));
+						largest = std::max(largest, fabsf(fields.velocityZ[index]));
+					}
+				}
+			}
+
+			float scale = (largest > 0.0f) ? speed / largest : 0.0f;
+			for (size_t i = 0; i < cells; ++i)
+			{
+				fields.velocityX[i] *= scale;
+				fields.velocityY[i] *= scale;
+				fields.velocityZ[i] *= scale;
+			}
+		}
+	}
+
+	// Reads the current values of the visible cells of a field.
+	std::vector<double> readVisible(VoxelData* field, size_t cells)
+	{
+		std::vector<double> values(cells);
+		for (size_t i = 0; i < cells; ++i)
+			values[i] = field->getCurrentValue(int(i));
+
+		return values;
+	}
+
+	// Returns the norm of the difference relative to the norm of the expected values.
+	double getRelativeL2(const std::vector<double>& actual, const std::vector<double>& expected)
+	{
+		double difference = 0.0;
+		double reference = 0.0;
+		for (size_t i = 0; i < actual.size(); ++i)
+		{
+			difference += (actual[i] - expected[i]) * (actual[i] - expected[i]);
+			reference += expected[i] * expected[i];
+		}
+
+		return (reference > 0.0) ? sqrt(difference / reference) : sqrt(difference);
+	}
+
+	// Returns how far a field is from its own mirror image across the centre of x, relative to its norm.
+	double getMirrorError(const std::vector<double>& values, int N, int dimensions)
+	{
+		double difference = 0.0;
+		double total = 0.0;
+		int depth = (dimensions > 2) ? N : 1;
+		for (int z = 0; z < depth; ++z)
+		{
+			for (int y = 0; y < N; ++y)
+			{
+				for (int x = 0; x < N; ++x)
+				{
+					double value = values[size_t(N) * N * z + size_t(N) * y + x];
+					double mirrored = values[size_t(N) * N * z + size_t(N) * y + (N - 1 - x)];
+					difference += (value - mirrored) * (value - mirrored);
+					total += value * value;
+				}
+			}
+		}
+
+		return (total > 0.0) ? sqrt(difference / total) : 0.0;
+	}
+
+	// Returns the RMS central difference divergence over the interior relative to the RMS speed there, in cells.
+	double getRelativeDivergence(const std::vector<double>& u, const std::vector<double>& v, const std::vector<double>& w, int N, int dimensions)
+	{
+		double divergence = 0.0;
+		double speed = 0.0;
+		size_t strideY = size_t(N);
+		size_t strideZ = size_t(N) * N;
+
+		int zBegin = (dimensions > 2) ? 1 : 0;
+		int zEnd = (dimensions > 2) ? N - 1 : 1;
+		for (int z = zBegin; z < zEnd; ++z)
+		{
+			for (int y = 1; y < N - 1; ++y)
+			{
+				for (int x = 1; x < N - 1; ++x)
+				{
+					size_t i = strideZ * z + strideY * y + x;
+					double d = 0.5 * (u[i + 1] - u[i - 1]) + 0.5 * (v[i + strideY] - v[i - strideY]);
+					if (dimensions > 2)
+						d += 0.5 * (w[i + strideZ] - w[i - strideZ]);
+
+					divergence += d * d;
+					speed += u[i] * u[i] + v[i] * v[i] + (dimensions > 2 ? w[i] * w[i] : 0.0);
+				}
+			}
+		}
+
+		return (speed > 0.0) ? sqrt(divergence / speed) : 0.0;
+	}
+
+	double getKineticEnergy(const std::vector<double>& u, const std::vector<double>& v, const std::vector<double>& w)
+	{
+		double energy = 0.0;
+		for (size_t i = 0; i < u.size(); ++i)
+			energy += 0.5 * (u[i] * u[i] + v[i] * v[i] + w[i] * w[i]);
+
+		return energy;
+	}
+
+	double getTotal(const std::vector<double>& values)
+	{
+		double total = 0.0;
+		for (double value : values)
+			total += value;
+
+		return total;
+	}
+
+	// Returns the density the emitters beside the grid have put in so far.
+	double getEmittedMass(CFDGrid* grid)
+	{
+		Entity* owner = static_cast<Entity*>(grid->getParent());
+		if (owner == nullptr)
+			return 0.0;
+
+		double emitted = 0.0;
+		for (CFDEmitter* emitter : owner->getAllComponents<CFDEmitter>())
+		{
+			if (!emitter->getFootprint().empty())
+				emitted += double(emitter->getRate()) * grid->getTimeStep() * emitter->getStats().stepsEmitted;
+		}
+
+		return emitted;
+	}
+
+	SceneEmitter makeScenarioEmitter(const Vector3& position, float radius, const Vector3& velocity, float rate, float lifetime)
+	{
+		SceneEmitter emitter;
+		emitter.shape = EmitterShape::Sphere;
+		emitter.position = position;
+		emitter.size = Vector3(radius, radius, radius);
+		emitter.velocity = velocity;
+		emitter.rate = rate;
+		emitter.lifetime = lifetime;
+		return emitter;
+	}
+
+	// Formats a number for the scenario JSON, which has no representation for infinities or NaN.
+	std::string scenarioJsonNumber(double value)
+	{
+		if (!std::isfinite(value))
+			return "null";
+
+		char number[32];
+		snprintf(number, sizeof(number), "%.6g", value);
+		return number;
+	}
+}
+
+const char* CFD::getCanonicalScenarioName(CanonicalScenario scenario)
+{
+	return (int(scenario) >= 0 && scenario < CanonicalScenario::Count) ? ScenarioNames[int(scenario)] : "unknown";
+}
+
+double CFD::ScenarioResult::getTotalStepMs() const
+{
+	double total = 0.0;
+	for (double ms : stepMs)
+		total += ms;
+
+	return total;
+}
+
+double CFD::ScenarioResult::getMedianStepMs() const
+{
+	if (stepMs.empty())
+		return 0.0;
+
+	std::vector<double> sorted = stepMs;
+	std::sort(sorted.begin(), sorted.end());
+	return sorted[sorted.size() / 2];
+}
+
+bool CFD::CFDScenarioLibrary::findScenario(const std::string& name, CanonicalScenario& scenario)
+{
+	auto lower = [](std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return char(tolower(c)); });
+		return text;
+	};
+
+	for (int i = 0; i < int(CanonicalScenario::Count); ++i)
+	{
+		if (lower(name) == lower(ScenarioNames[i]))
+		{
+			scenario = CanonicalScenario(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+const char* CFD::CFDScenarioLibrary::getDescription(CanonicalScenario scenario)
+{
+	switch (scenario)
+	{
+	case CanonicalScenario::BuoyantPlume: return "Rising plume from a floor emitter, against its mass budget and mirror symmetry";
+	case CanonicalScenario::GaussianDiffusion: return "Still Gaussian blob diffusing, against the closed form Gaussian";
+	case CanonicalScenario::TaylorGreen: return "Taylor-Green vortex decaying under viscosity, against its closed form decay";
+	case CanonicalScenario::VortexRing: return "Vortex ring travelling through still fluid, against the energy an inviscid solver keeps";
+	case CanonicalScenario::MultiEmitterRoom: return "Sparse mirrored emitters in an empty room, against their mass budget and mirror symmetry";
+	default: return "";
+	}
+}
+
+int CFD::CFDScenarioLibrary::getDefaultSteps(CanonicalScenario scenario)
+{
+	return (scenario == CanonicalScenario::BuoyantPlume || scenario == CanonicalScenario::MultiEmitterRoom) ? 40 : 20;
+}
+
+SceneDescription CFD::CFDScenarioLibrary::describe(CanonicalScenario scenario, const ScenarioSettings& settings)
+{
+	SceneDescription scene;
+	scene.size = settings.size;
+	scene.dimensions = settings.dimensions;
+	scene.densityStorage = settings.densityStorage;
+	scene.velocityStorage = settings.velocityStorage;
+	scene.threads = settings.threads;
+	scene.steps = (settings.steps > 0) ? settings.steps : getDefaultSteps(scenario);
+	scene.diffusionRate = 0.0f;
+	scene.viscosity = 0.0f;
+
+	int N = settings.size;
+	bool volume = settings.dimensions > 2;
+	float timeStep = CFDGrid().getTimeStep();
+	float cellScale = float(getCellScale(N, settings.dimensions, timeStep));
+	float radius = float(std::max(1, N / 16));
+	float centre = float(getCentre(N));
+
+	switch (scenario)
+	{
+	case CanonicalScenario::BuoyantPlume:
+		scene.diffusionRate = 0.2f / cellScale;
+		scene.viscosity = 0.1f / cellScale;
+		scene.emitters.push_back(makeScenarioEmitter(Vector3(centre, float(N / 8), volume ? centre : 0.0f), radius,
+			Vector3(0.0f, float(StartingSpeed) / cellScale, 0.0f), 10.0f, 0.0f));
+		break;
+	case CanonicalScenario::GaussianDiffusion:
+		scene.diffusionRate = float(GaussianSpreadPerStep) / cellScale;
+		break;
+	case CanonicalScenario::TaylorGreen:
+		scene.viscosity = float(TaylorGreenViscosityPerStep) / cellScale;
+		break;
+	case CanonicalScenario::VortexRing:
+		scene.diffusionRate = 0.05f / cellScale;
+		break;
+	case CanonicalScenario::MultiEmitterRoom:
+	{
+		scene.diffusionRate = 0.1f / cellScale;
+		scene.viscosity = 0.05f / cellScale;
+
+		// Emitters come in pairs mirrored across the centre of x, so the answer is mirror symmetric. The second pair stops half way.
+		float near = float(N / 4);
+		float far = float(N - 1 - N / 4);
+		float speed = float(StartingSpeed) / cellScale;
+		float lifetime = 0.5f * timeStep * scene.steps;
+
+		scene.emitters.push_back(makeScenarioEmitter(Vector3(near, float(N / 8), volume ? near : 0.0f), radius, Vector3(0.5f * speed, speed, 0.0f), 5.0f, 0.0f));
+		scene.emitters.push_back(makeScenarioEmitter(Vector3(far, float(N / 8), volume ? near : 0.0f), radius, Vector3(-0.5f * speed, speed, 0.0f), 5.0f, 0.0f));
+
+		float secondX = volume ? near : float(N / 8);
+		float secondZ = volume ? far : 0.0f;
+		scene.emitters.push_back(makeScenarioEmitter(Vector3(secondX, float(N / 2), secondZ), radius, Vector3(speed, 0.0f, 0.0f), 5.0f, lifetime));
+		scene.emitters.push_back(makeScenarioEmitter(Vector3(float(N - 1) - secondX, float(N / 2), secondZ), radius, Vector3(-speed, 0.0f, 0.0f), 5.0f, lifetime));
+		break;
+	}
+	default:
+		break;
+	}
+
+	return scene;
+}
+
+bool CFD::CFDScenarioLibrary::instantiate(CanonicalScenario scenario, CFDGrid* grid, const ScenarioSettings& settings, std::string* error)
+{
+	if (scenario == CanonicalScenario::VortexRing && settings.dimensions != 3)
+	{
+		if (error != nullptr)
+			*error = "The vortex ring needs 3 dimensions";
+
+		return false;
+	}
+
+	if (!CFDScene::apply(describe(scenario, settings), grid, error))
+		return false;
+
+	ScenarioFields fields;
+	int N = grid->getGridWidth();
+	getStartingFields(scenario, N, grid->getDimensions(), float(getCellScale(N, grid->getDimensions(), grid->getTimeStep())), fields);
+
+	// The previous arrays carry the state into the next step, the current ones are what is shown and measured until then.
+	CFDData* voxels = grid->getAllVoxelData();
+	VoxelData* targets[] = { voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ };
+	const std::vector<float>* sources[] = { &fields.density, &fields.velocityX, &fields.velocityY, &fields.velocityZ };
+	for (int field = 0; field < 4; ++field)
+	{
+		for (size_t i = 0; i < sources[field]->size(); ++i)
+		{
+			targets[field]->setPreviousValue(int(i), (*sources[field])[i]);
+			targets[field]->setCurrentValue(int(i), (*sources[field])[i]);
+		}
+	}
+
+	return true;
+}
+
+std::vector<ScenarioError> CFD::CFDScenarioLibrary::measure(CanonicalScenario scenario, CFDGrid* grid, int steps)
+{
+	std::vector<ScenarioError> errors;
+	CFDData* voxels = grid->getAllVoxelData();
+	if (voxels == nullptr)
+		return errors;
+
+	int N = grid->getGridWidth();
+	int dimensions = grid->getDimensions();
+	size_t cells = getVisibleCells(N, dimensions);
+	int depth = (dimensions > 2) ? N : 1;
+
+	std::vector<double> density = readVisible(voxels->density, cells);
+	std::vector<double> u = readVisible(voxels->velocityX, cells);
+	std::vector<double> v = readVisible(voxels->velocityY, cells);
+	std::vector<double> w = readVisible(voxels->velocityZ, cells);
+
+	auto add = [&](const char* name, double value) { errors.push_back(ScenarioError{ name, value }); };
+
+	switch (scenario)
+	{
+	case CanonicalScenario::GaussianDiffusion:
+	{
+		std::vector<double> expected(cells);
+		for (int z = 0; z < depth; ++z)
+			for (int y = 0; y < N; ++y)
+				for (int x = 0; x < N; ++x)
+					expected[size_t(N) * N * z + size_t(N) * y + x] = getGaussianDensity(N, dimensions, x, y, z, steps);
+
+		double expectedPeak = *std::max_element(expected.begin(), expected.end());
+		double expectedMass = getTotal(expected);
+
+		add("density L2", getRelativeL2(density, expected));
+		add("peak", fabs(*std::max_element(density.begin(), density.end()) - expectedPeak) / expectedPeak);
+		add("mass", fabs(getTotal(density) - expectedMass) / expectedMass);
+		break;
+	}
+	case CanonicalScenario::TaylorGreen:
+	{
+		float speed = float(StartingSpeed / getCellScale(N, dimensions, grid->getTimeStep()));
+		std::vector<double> expectedU(cells);
+		std::vector<double> expectedV(cells);
+		for (int z = 0; z < depth; ++z)
+		{
+			for (int y = 0; y < N; ++y)
+			{
+				for (int x = 0; x < N; ++x)
+				{
+					Vector3 velocity = getTaylorGreenVelocity(N, speed, x, y, steps);
+					expectedU[size_t(N) * N * z + size_t(N) * y + x] = velocity.x;
+					expectedV[size_t(N) * N * z + size_t(N) * y + x] = velocity.y;
+				}
+			}
+		}
+
+		// Both components in one norm, the z velocity should stay zero.
+		std::vector<double> actual = u;
+		actual.insert(actual.end(), v.begin(), v.end());
+		actual.insert(actual.end(), w.begin(), w.end());
+		std::vector<double> expected = expectedU;
+		expected.insert(expected.end(), expectedV.begin(), expectedV.end());
+		expected.resize(actual.size(), 0.0);
+
+		double expectedEnergy = getKineticEnergy(expectedU, expectedV, std::vector<double>(cells, 0.0));
+
+		add("velocity L2", getRelativeL2(actual, expected));
+		add("energy", fabs(getKineticEnergy(u, v, w) - expectedEnergy) / expectedEnergy);
+		add("divergence", getRelativeDivergence(u, v, w, N, dimensions));
+		break;
+	}
+	case CanonicalScenario::VortexRing:
+	{
+		ScenarioFields start;
+		getStartingFields(scenario, N, dimensions, float(getCellScale(N, dimensions, grid->getTimeStep())), start);
+
+		std::vector<double> startU(start.velocityX.begin(), start.velocityX.end());
+		std::vector<double> startV(start.velocityY.begin(), start.velocityY.end());
+		std::vector<double> startW(start.velocityZ.begin(), start.velocityZ.end());
+		double startEnergy = getKineticEnergy(startU, startV, startW);
+
+		add("energy", fabs(getKineticEnergy(u, v, w) - startEnergy) / startEnergy);
+		add("divergence", getRelativeDivergence(u, v, w, N, dimensions));
+		add("symmetry", getMirrorError(density, N, dimensions));
+		break;
+	}
+	case CanonicalScenario::BuoyantPlume:
+	case CanonicalScenario::MultiEmitterRoom:
+	{
+		double emitted = getEmittedMass(grid);
+		add("mass", (emitted > 0.0) ? fabs(getTotal(density) - emitted) / emitted : 0.0);
+		add("symmetry", getMirrorError(density, N, dimensions));
+		add("divergence", getRelativeDivergence(u, v, w, N, dimensions));
+		break;
+	}
+	default:
+		break;
+	}
+
+	return errors;
+}
+
+ScenarioResult CFD::CFDScenarioLibrary::run(CanonicalScenario scenario, const ScenarioSettings& settings)
+{
+	ScenarioResult result;
+	result.scenario = scenario;
+	result.steps = (settings.steps > 0) ? settings.steps : getDefaultSteps(scenario);
+
+	Entity owner = Entity("Scenario");
+	CFDGrid* grid = owner.addComponent<CFDGrid>();
+
+	Stopwatch setupTimer;
+	if (instantiate(scenario, grid, settings, &result.problem))
+	{
+		result.setupMs = setupTimer.getElapsedMilliseconds();
+		result.size = grid->getGridWidth();
+		result.dimensions = grid->getDimensions();
+		result.threads = grid->getThreadCount();
+
+		result.stepMs.reserve(size_t(result.steps));
+		for (int i = 0; i < result.steps; ++i)
+		{
+			Stopwatch stepTimer;
+			grid->Update(grid->getTimeStep());
+			result.stepMs.push_back(stepTimer.getElapsedMilliseconds());
+		}
+
+		result.errors = measure(scenario, grid, result.steps);
+	}
+
+	while (owner.getComponent<CFDEmitter>() != nullptr)
+		owner.removeComponent<CFDEmitter>();
+
+	while (owner.getComponent<CFDRecorder>() != nullptr)
+		owner.removeComponent<CFDRecorder>();
+
+	owner.removeComponent<CFDGrid>();
+	return result;
+}
+
+std::string CFD::CFDScenarioLibrary::toString(const std::vector<ScenarioResult>& results)
+{
+	std::string table;
+	char line[512];
+
+	snprintf(line, sizeof(line), "  %-12s %8s %6s %12s %12s  %s\n", "scenario", "grid", "steps", "median ms", "total ms", "errors");
+	table += line;
+
+	for (const ScenarioResult& result : results)
+	{
+		if (!result.problem.empty())
+		{
+			snprintf(line, sizeof(line), "  %-12s %s\n", getCanonicalScenarioName(result.scenario), result.problem.c_str());
+			table += line;
+			continue;
+		}
+
+		char grid[32];
+		snprintf(grid, sizeof(grid), "%d^%d", result.size, result.dimensions);
+		snprintf(line, sizeof(line), "  %-12s %8s %6d %12.3f %12.3f ", getCanonicalScenarioName(result.scenario), grid, result.steps,
+			result.getMedianStepMs(), result.getTotalStepMs());
+		table += line;
+
+		for (const ScenarioError& error : result.errors)
+		{
+			snprintf(line, sizeof(line), " %s %.3g", error.name.c_str(), error.value);
+			table += line;
+		}
+
+		table += "\n";
+	}
+
+	return table;
+}
+
+std::string CFD::CFDScenarioLibrary::toJson(const std::vector<ScenarioResult>& results)
+{
+	std::string json = "[\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const ScenarioResult& result = results[i];
+		json += "  {\"scenario\": \"" + std::string(getCanonicalScenarioName(result.scenario)) + "\"";
+
+		if (!result.problem.empty())
+		{
+			// Problems are fixed messages without quotes or control characters.
+			json += ", \"problem\": \"" + result.problem + "\"}";
+		}
+		else
+		{
+			json += ", \"size\": " + std::to_string(result.size) + ", \"dimensions\": " + std::to_string(result.dimensions);
+			json += ", \"threads\": " + std::to_string(result.threads) + ", \"steps\": " + std::to_string(result.steps);
+			json += ", \"setupMs\": " + scenarioJsonNumber(result.setupMs) + ", \"medianStepMs\": " + scenarioJsonNumber(result.getMedianStepMs());
+			json += ", \"totalStepMs\": " + scenarioJsonNumber(result.getTotalStepMs()) + ", \"errors\": {";
+
+			for (size_t e = 0; e < result.errors.size(); ++e)
+				json += std::string(e > 0 ? ", " : "") + "\"" + result.errors[e].name + "\": " + scenarioJsonNumber(result.errors[e].value);
+
+			json += "}}";
+		}
+
+		json += (i + 1 < results.size()) ? ",\n" : "\n";
+	}
+
+	return json + "]\n";
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Scene/CFDScene.h"
+
+namespace CFD
+{
+	// Standard workloads for comparing solvers, each with a known answer to measure the result against.
+	enum class CanonicalScenario
+	{
+		BuoyantPlume = 0,		// Sphere emitter rising from the floor, checked on its mass budget and mirror symmetry.
+		GaussianDiffusion,		// Still Gaussian blob spreading, against the closed form solution of the heat equation.
+		TaylorGreen,			// Decaying Taylor-Green vortex, against its closed form exponential decay.
+		VortexRing,				// Divergence free vortex ring, checked on the energy an inviscid solver would keep. 3D only.
+		MultiEmitterRoom,		// Sparse mirrored emitters in an otherwise empty room, checked on mass budget and symmetry.
+		Count,
+	};
+
+	// Returns the name a scenario is found by.
+	const char* getCanonicalScenarioName(CanonicalScenario scenario);
+
+	// Grid a scenario is instantiated on. Positions, sizes and speeds scale with the size, so any size gives the same workload.
+	struct ScenarioSettings
+	{
+		int size = 32;
+		int dimensions = 3;
+		int steps = 0;						// Zero takes the scenario's own step count.
+		int threads = 0;					// Zero uses every hardware thread.
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+	};
+
+	// One measure of how far a result is from the known answer, zero is an exact match.
+	struct ScenarioError
+	{
+		std::string name;
+		double value = 0.0;
+	};
+
+	// Time and accuracy of one scenario run.
+	struct ScenarioResult
+	{
+		CanonicalScenario scenario = CanonicalScenario::BuoyantPlume;
+		int size = 0;
+		int dimensions = 0;
+		int threads = 0;
+		int steps = 0;
+		double setupMs = 0.0;
+		std::vector<double> stepMs;
+		std::vector<ScenarioError> errors;
+		std::string problem;				// Set if the scenario could not be run.
+
+		double getTotalStepMs() const;
+		double getMedianStepMs() const;
+	};
+
+	// Built in scenarios that can be set up on any grid by name and report their error alongside their time, so solver
+	// choices can be compared on accuracy for the cost rather than on speed alone.
+	// Scenarios with emitters need the grid on an entity, as scene files do.
+	class CFDScenarioLibrary
+	{
+	public:
+
+		// Finds a scenario by its name, ignoring case. Returns false if there is none.
+		static bool findScenario(const std::string& name, CanonicalScenario& scenario);
+
+		// Returns a one line description of the scenario and what it is measured against.
+		static const char* getDescription(CanonicalScenario scenario);
+
+		// Returns the steps a run takes when the settings leave it to the scenario.
+		static int getDefaultSteps(CanonicalScenario scenario);
+
+		// Returns the grid, solver and emitter part of the scenario as a scene.
+		static SceneDescription describe(CanonicalScenario scenario, const ScenarioSettings& settings);
+
+		// Sets the grid up with the scenario and writes its starting fields. Returns false and describes the problem if it could not.
+		static bool instantiate(CanonicalScenario scenario, CFDGrid* grid, const ScenarioSettings& settings, std::string* error = nullptr);
+
+		// Measures the grid against the scenario's known answer after the passed in number of steps.
+		static std::vector<ScenarioError> measure(CanonicalScenario scenario, CFDGrid* grid, int steps);
+
+		// Instantiates the scenario on a grid of its own, steps it and measures the result.
+		static ScenarioResult run(CanonicalScenario scenario, const ScenarioSettings& settings);
+
+		// Returns a human readable table of the results.
+		static std::string toString(const std::vector<ScenarioResult>& results);
+
+		// Returns the results as a JSON array.
+		static std::string toJson(const std::vector<ScenarioResult>& results);
+	};
+}
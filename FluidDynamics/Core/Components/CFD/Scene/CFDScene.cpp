@@ -0,0 +1,429 @@
+#include "CFDScene.h"
+#include "Core/Entity System/Entity.h"
+#include "Utility/Config/IniFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
+#include <climits>
+#include <cstdio>
+
+using namespace CFD;
+
+namespace
+{
+	// Names enum values are written as, in enum order.
+	const char* const StorageNames[] = { "fp32", "fp16", "bf16" };
+	const char* const ShapeNames[] = { "point", "sphere", "box" };
+	const char* const CodecNames[] = { "none", "shufflelz", "wavelet" };
+	const char* const BackPressureNames[] = { "drop", "block", "downsample" };
+
+	// Reads typed values out of a section, keeping the first problem and catching keys nothing asked for.
+	class SectionReader
+	{
+	public:
+		SectionReader(const IniFile& file, const IniSection& section) : file(file), section(section), used(section.values.size(), false) {}
+
+		void read(const char* key, int& value, int minimum = INT_MIN, int maximum = INT_MAX)
+		{
+			std::string expected = "a whole number";
+			if (maximum != INT_MAX)
+				expected += " from " + std::to_string(minimum) + " to " + std::to_string(maximum);
+			else if (minimum != INT_MIN)
+				expected += " of at least " + std::to_string(minimum);
+
+			readWith(key, expected, [&](const std::string& text)
+			{
+				int parsed;
+				if (!IniFile::parseInt(text, parsed) || parsed < minimum || parsed > maximum)
+					return false;
+
+				value = parsed;
+				return true;
+			});
+		}
+
+		void read(const char* key, float& value, float minimum = -FLT_MAX)
+		{
+			std::string expected = (minimum > -FLT_MAX) ? "a number of at least " + formatFloat(minimum) : "a number";
+			readWith(key, expected, [&](const std::string& text)
+			{
+				float parsed;
+				if (!IniFile::parseFloat(text, parsed) || parsed < minimum)
+					return false;
+
+				value = parsed;
+				return true;
+			});
+		}
+
+		void read(const char* key, bool& value)
+		{
+			readWith(key, "true or false", [&](const std::string& text) { return IniFile::parseBool(text, value); });
+		}
+
+		void read(const char* key, std::string& value)
+		{
+			readWith(key, "a non empty string", [&](const std::string& text)
+			{
+				if (text.empty())
+					return false;
+
+				value = text;
+				return true;
+			});
+		}
+
+		void read(const char* key, Vector3& value)
+		{
+			readWith(key, "three numbers", [&](const std::string& text)
+			{
+				float parsed[3];
+				if (!IniFile::parseFloat3(text, parsed))
+					return false;
+
+				value = Vector3(parsed[0], parsed[1], parsed[2]);
+				return true;
+			});
+		}
+
+		template<typename T, size_t Count>
+		void readName(const char* key, T& value, const char* const (&names)[Count])
+		{
+			std::string expected = "one of";
+			for (size_t i = 0; i < Count; ++i)
+				expected += std::string(i == 0 ? " " : ", ") + names[i];
+
+			readWith(key, expected, [&](const std::string& text)
+			{
+				std::string lower = text;
+				std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return char(tolower(c)); });
+
+				for (size_t i = 0; i < Count; ++i)
+				{
+					if (lower == names[i])
+					{
+						value = T(i);
+						return true;
+					}
+				}
+
+				return false;
+			});
+		}
+
+		// Returns false and describes the problem if a value was malformed or the section sets a key nothing read.
+		bool finish(std::string* error)
+		{
+			for (size_t i = 0; i < used.size() && problem.empty(); ++i)
+			{
+				if (!used[i])
+					problem = file.describe(section.values[i].line, "unknown key '" + section.values[i].key + "' in [" + section.name + "]");
+			}
+
+			if (!problem.empty() && error != nullptr)
+				*error = problem;
+
+			return problem.empty();
+		}
+
+		static std::string formatFloat(float value)
+		{
+			char text[32];
+			snprintf(text, sizeof(text), "%.9g", value);
+			return text;
+		}
+
+	private:
+
+		template<typename Parse>
+		void readWith(const char* key, const std::string& expected, Parse parse)
+		{
+			for (size_t i = 0; i < section.values.size(); ++i)
+			{
+				const IniValue& value = section.values[i];
+				if (value.key != key)
+					continue;
+
+				used[i] = true;
+				if (problem.empty() && !parse(value.value))
+					problem = file.describe(value.line, "'" + value.key + "' must be " + expected + ", not '" + value.value + "'");
+			}
+		}
+
+		const IniFile& file;
+		const IniSection& section;
+		std::vector<bool> used;
+		std::string problem;
+	};
+
+	std::string formatVector(const Vector3& value)
+	{
+		return SectionReader::formatFloat(value.x) + ", " + SectionReader::formatFloat(value.y) + ", " + SectionReader::formatFloat(value.z);
+	}
+}
+
+bool CFD::CFDScene::load(const std::string& path, SceneDescription& scene, std::string* error)
+{
+	IniFile file;
+	return file.load(path, error) && read(file, scene, error);
+}
+
+bool CFD::CFDScene::parse(const std::string& text, const std::string& sourceName, SceneDescription& scene, std::string* error)
+{
+	IniFile file;
+	return file.parse(text, sourceName, error) && read(file, scene, error);
+}
+
+bool CFD::CFDScene::read(IniFile& file, SceneDescription& scene, std::string* error)
+{
+	// Parsed into a copy so a bad file leaves the passed in scene untouched.
+	SceneDescription parsed;
+
+	for (const IniSection& section : file.getSections())
+	{
+		SectionReader reader(file, section);
+
+		if (section.name == "grid")
+		{
+			reader.read("size", parsed.size, 1);
+			reader.read("dimensions", parsed.dimensions, 2, 3);
+			reader.readName("densityStorage", parsed.densityStorage, StorageNames);
+			reader.readName("velocityStorage", parsed.velocityStorage, StorageNames);
+			reader.read("memoryBudgetMB", parsed.memoryBudgetMB, 0);
+			reader.read("hugePages", parsed.hugePages);
+		}
+		else if (section.name == "solver")
+		{
+			reader.read("diffusionRate", parsed.diffusionRate, 0.0f);
+			reader.read("viscosity", parsed.viscosity, 0.0f);
+			reader.read("randomVelocityMinMax", parsed.randomVelocityMinMax, 0);
+			reader.read("randomSeed", parsed.randomSeed, 0);
+			reader.read("threads", parsed.threads, 0);
+			reader.read("steps", parsed.steps, 0);
+		}
+		else if (section.name == "turbulence")
+		{
+			reader.read("enabled", parsed.turbulence.enabled);
+			reader.read("amplitude", parsed.turbulence.amplitude);
+			reader.read("frequency", parsed.turbulence.frequency, 0.0f);
+			reader.read("octaves", parsed.turbulence.octaves, 1, 16);
+			reader.read("evolution", parsed.turbulence.evolution, 0.0f);
+			reader.read("activeThreshold", parsed.turbulence.activeThreshold, 0.0f);
+		}
+		else if (section.name == "emitter")
+		{
+			SceneEmitter emitter;
+			reader.readName("shape", emitter.shape, ShapeNames);
+			reader.read("position", emitter.position);
+			reader.read("size", emitter.size);
+			reader.read("velocity", emitter.velocity);
+			reader.read("rate", emitter.rate);
+			reader.read("lifetime", emitter.lifetime);
+			parsed.emitters.push_back(emitter);
+		}
+		else if (section.name == "recording")
+		{
+			reader.read("enabled", parsed.record);
+			reader.read("path", parsed.recordingPath);
+			reader.read("velocity", parsed.recordVelocity);
+			reader.readName("codec", parsed.codec, CodecNames);
+			reader.read("maxError", parsed.wavelet.maxError, 0.0f);
+			reader.read("bitsPerValue", parsed.wavelet.bitsPerValue, 0.0f);
+			reader.readName("whenBehind", parsed.backPressure, BackPressureNames);
+			reader.read("keyframeInterval", parsed.keyframeInterval, 1);
+			reader.read("brickSize", parsed.brickSize, 1);
+			reader.read("bufferedFrames", parsed.bufferedFrames, 1);
+		}
+		else if (section.name == "output")
+		{
+			reader.read("checkpoint", parsed.checkpointPath);
+			reader.read("vtk", parsed.vtkPath);
+			reader.read("vtkCompress", parsed.vtkCompress);
+			reader.read("vtkVelocity", parsed.vtkVelocity);
+			reader.read("vtkSpacing", parsed.vtkSpacing, 0.0f);
+			reader.read("vtkEvery", parsed.vtkEvery, 0);
+		}
+		else
+		{
+			if (error != nullptr)
+				*error = file.describe(section.line, "unknown section [" + section.name + "]");
+
+			return false;
+		}
+
+		if (!reader.finish(error))
+			return false;
+	}
+
+	scene = parsed;
+	return true;
+}
+
+bool CFD::CFDScene::apply(const SceneDescription& scene, CFDGrid* grid, std::string* error)
+{
+	Entity* entity = static_cast<Entity*>(grid->getParent());
+	if (entity == nullptr && (!scene.emitters.empty() || scene.record))
+	{
+		if (error != nullptr)
+			*error = "The grid has to be on a GameObject for the scene to add emitters or record";
+
+		return false;
+	}
+
+	grid->setDensityStorage(scene.densityStorage);
+	grid->setVelocityStorage(scene.velocityStorage);
+	grid->setMemoryBudget(size_t(scene.memoryBudgetMB) * 1024 * 1024);
+	grid->setUseHugePages(scene.hugePages);
+	grid->setThreadCount(scene.threads);
+
+	if (!grid->setGrid(scene.size, scene.dimensions))
+	{
+		if (error != nullptr)
+			*error = "The scene grid could not be allocated:\n" + grid->getLastSetGridReport().toString();
+
+		return false;
+	}
+
+	grid->setDiffusionRate(scene.diffusionRate);
+	grid->setViscocity(scene.viscosity);
+	grid->setRandomVelocityMinMax(scene.randomVelocityMinMax);
+	grid->setRandomSeed(uint64_t(scene.randomSeed));
+	grid->setTurbulence(scene.turbulence);
+	grid->Start();
+
+	if (entity == nullptr)
+		return true;
+
+	for (const SceneEmitter& description : scene.emitters)
+	{
+		CFDEmitter* emitter = entity->addComponent<CFDEmitter>();
+		emitter->setShape(description.shape);
+		emitter->setPosition(description.position);
+		emitter->setSize(description.size);
+		emitter->setVelocity(description.velocity);
+		emitter->setRate(description.rate);
+		emitter->setLifetime(description.lifetime);
+	}
+
+	// Reuses a recorder already beside the grid, so applying a scene never leaves two recording the same steps.
+	std::vector<CFDRecorder*> recorders = entity->getAllComponents<CFDRecorder>();
+	CFDRecorder* recorder = recorders.empty() ? entity->addComponent<CFDRecorder>() : recorders[0];
+
+	recorder->setRecordVelocity(scene.recordVelocity);
+	recorder->setCodec(scene.codec);
+	recorder->setWaveletSettings(scene.wavelet);
+	recorder->setBackPressure(scene.backPressure);
+	recorder->setKeyframeInterval(scene.keyframeInterval);
+	recorder->setBrickSize(scene.brickSize);
+	recorder->setPoolSize(scene.bufferedFrames);
+
+	if (scene.record && !recorder->start(grid, scene.recordingPath))
+	{
+		if (error != nullptr)
+			*error = "Could not start recording to " + scene.recordingPath;
+
+		return false;
+	}
+
+	return true;
+}
+
+SceneDescription CFD::CFDScene::capture(CFDGrid* grid)
+{
+	SceneDescription scene;
+	scene.size = grid->getGridWidth();
+	scene.dimensions = grid->getDimensions();
+	scene.densityStorage = grid->getDensityStorage();
+	scene.velocityStorage = grid->getVelocityStorage();
+	scene.memoryBudgetMB = int(grid->getMemoryBudget() / (1024 * 1024));
+	scene.hugePages = grid->getUseHugePages();
+
+	scene.diffusionRate = grid->getDiffusionRate();
+	scene.viscosity = grid->getViscocity();
+	scene.randomVelocityMinMax = grid->getRandomVelocityMinMax();
+	scene.randomSeed = int(std::min<uint64_t>(grid->getRandomSeed(), uint64_t(INT_MAX)));
+	scene.threads = grid->getThreadCount();
+	scene.turbulence = grid->getTurbulence();
+
+	Entity* entity = static_cast<Entity*>(grid->getParent());
+	if (entity == nullptr)
+		return scene;
+
+	for (CFDEmitter* emitter : entity->getAllComponents<CFDEmitter>())
+	{
+		SceneEmitter description;
+		description.shape = emitter->getShape();
+		description.position = emitter->getPosition();
+		description.size = emitter->getSize();
+		description.velocity = emitter->getVelocity();
+		description.rate = emitter->getRate();
+		description.lifetime = emitter->getLifetime();
+		scene.emitters.push_back(description);
+	}
+
+	return scene;
+}
+
+std::string CFD::CFDScene::toString(const SceneDescription& scene)
+{
+	auto line = [](const char* key, const std::string& value) { return std::string(key) + " = " + value + "\n"; };
+	auto number = [](float value) { return SectionReader::formatFloat(value); };
+	auto flag = [](bool value) { return std::string(value ? "true" : "false"); };
+
+	std::string text = "[grid]\n";
+	text += line("size", std::to_string(scene.size));
+	text += line("dimensions", std::to_string(scene.dimensions));
+	text += line("densityStorage", StorageNames[int(scene.densityStorage)]);
+	text += line("velocityStorage", StorageNames[int(scene.velocityStorage)]);
+	text += line("memoryBudgetMB", std::to_string(scene.memoryBudgetMB));
+	text += line("hugePages", flag(scene.hugePages));
+
+	text += "\n[solver]\n";
+	text += line("diffusionRate", number(scene.diffusionRate));
+	text += line("viscosity", number(scene.viscosity));
+	text += line("randomVelocityMinMax", std::to_string(scene.randomVelocityMinMax));
+	text += line("randomSeed", std::to_string(scene.randomSeed));
+	text += line("threads", std::to_string(scene.threads));
+	text += line("steps", std::to_string(scene.steps));
+
+	text += "\n[turbulence]\n";
+	text += line("enabled", flag(scene.turbulence.enabled));
+	text += line("amplitude", number(scene.turbulence.amplitude));
+	text += line("frequency", number(scene.turbulence.frequency));
+	text += line("octaves", std::to_string(scene.turbulence.octaves));
+	text += line("evolution", number(scene.turbulence.evolution));
+	text += line("activeThreshold", number(scene.turbulence.activeThreshold));
+
+	for (const SceneEmitter& emitter : scene.emitters)
+	{
+		text += "\n[emitter]\n";
+		text += line("shape", ShapeNames[int(emitter.shape)]);
+		text += line("position", formatVector(emitter.position));
+		text += line("size", formatVector(emitter.size));
+		text += line("velocity", formatVector(emitter.velocity));
+		text += line("rate", number(emitter.rate));
+		text += line("lifetime", number(emitter.lifetime));
+	}
+
+	text += "\n[recording]\n";
+	text += line("enabled", flag(scene.record));
+	text += line("path", "\"" + scene.recordingPath + "\"");
+	text += line("velocity", flag(scene.recordVelocity));
+	text += line("codec", CodecNames[int(scene.codec)]);
+	text += line("maxError", number(scene.wavelet.maxError));
+	text += line("bitsPerValue", number(scene.wavelet.bitsPerValue));
+	text += line("whenBehind", BackPressureNames[int(scene.backPressure)]);
+	text += line("keyframeInterval", std::to_string(scene.keyframeInterval));
+	text += line("brickSize", std::to_string(scene.brickSize));
+	text += line("bufferedFrames", std::to_string(scene.bufferedFrames));
+
+	text += "\n[output]\n";
+	text += line("checkpoint", "\"" + scene.checkpointPath + "\"");
+	text += line("vtk", "\"" + scene.vtkPath + "\"");
+	text += line("vtkCompress", flag(scene.vtkCompress));
+	text += line("vtkVelocity", flag(scene.vtkVelocity));
+	text += line("vtkSpacing", number(scene.vtkSpacing));
+	text += line("vtkEvery", std::to_string(scene.vtkEvery));
+
+	return text;
+}
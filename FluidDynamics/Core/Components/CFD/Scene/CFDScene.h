@@ -0,0 +1,104 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Core/Components/CFD/Emitter/CFDEmitter.h"
+#include "Core/Components/CFD/Recording/CFDRecorder.h"
+#include "Utility/Math/Math.h"
+
+class IniFile;
+
+namespace CFD
+{
+	// An [emitter] section, one per emitter.
+	struct SceneEmitter
+	{
+		EmitterShape shape = EmitterShape::Sphere;
+		Vector3 position;
+		Vector3 size = Vector3(1.0f, 1.0f, 1.0f);
+		Vector3 velocity;
+		float rate = 0.0f;
+		float lifetime = 0.0f;
+	};
+
+	// Everything needed to set a simulation up without touching the UI. Anything a scene file leaves out keeps these defaults,
+	// which match a freshly constructed grid.
+	struct SceneDescription
+	{
+		// ------ [grid]
+
+		int size = 32;
+		int dimensions = 2;
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+		int memoryBudgetMB = 2048;			// Zero disables the budget.
+		bool hugePages = false;
+
+		// ------ [solver]
+
+		float diffusionRate = 0.5f;
+		float viscosity = 0.0f;
+		int randomVelocityMinMax = 0;
+		int randomSeed = 0;					// Seed of the turbulence, runs with the same seed are reproducible.
+		int threads = 0;					// Threads grid wide loops are split across, zero uses every hardware thread.
+		int steps = 0;						// Steps a headless run takes, zero runs until stopped.
+
+		// ------ [turbulence]
+
+		TurbulenceSettings turbulence;
+
+		// ------ [emitter]
+
+		std::vector<SceneEmitter> emitters;
+
+		// ------ [recording]
+
+		bool record = false;				// Starts recording as soon as the scene is applied.
+		std::string recordingPath = "smoke.cfdrec";
+		bool recordVelocity = false;
+		RecordingCodec codec = RecordingCodec::ShuffleLZ;
+		WaveletSettings wavelet;
+		RecorderBackPressure backPressure = RecorderBackPressure::Drop;
+		int keyframeInterval = 30;
+		int brickSize = 8;
+		int bufferedFrames = 4;
+
+		// ------ [output]
+
+		std::string checkpointPath = "smoke.cfdckpt";
+		std::string vtkPath = "smoke.vti";
+		bool vtkCompress = true;
+		bool vtkVelocity = true;
+		float vtkSpacing = 1.0f;
+		int vtkEvery = 0;					// Steps between exports in a headless run, zero only exports the final step.
+	};
+
+	// Reads scene files and sets grids up from them, so runs start the same way every time.
+	// Scene files are INI files with [grid], [solver], [turbulence], [recording] and [output] sections and one [emitter] section per emitter.
+	// Unknown sections or keys and malformed values are errors rather than being skipped, so a typo cannot silently change a run.
+	class CFDScene
+	{
+	public:
+
+		// Reads the passed in scene file. Returns false and describes the first problem if it could not be read.
+		static bool load(const std::string& path, SceneDescription& scene, std::string* error = nullptr);
+
+		// Reads a scene from INI text, naming problems after the passed in source.
+		static bool parse(const std::string& text, const std::string& sourceName, SceneDescription& scene, std::string* error = nullptr);
+
+		// Allocates and starts the grid, adds the emitters to its GameObject and configures, and if asked starts, a recorder beside it.
+		// Returns false and describes the problem if the grid could not be allocated, the grid is left as it was.
+		static bool apply(const SceneDescription& scene, CFDGrid* grid, std::string* error = nullptr);
+
+		// Returns the scene the grid and the emitters beside it are set up as now. Recording and outputs are left at their defaults.
+		static SceneDescription capture(CFDGrid* grid);
+
+		// Returns the scene as INI text that parses back to the same description.
+		static std::string toString(const SceneDescription& scene);
+
+	private:
+
+		// Reads a scene out of a parsed INI file.
+		static bool read(IniFile& file, SceneDescription& scene, std::string* error);
+	};
+}
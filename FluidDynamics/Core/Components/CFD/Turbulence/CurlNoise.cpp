@@ -0,0 +1,324 @@
+#include "CurlNoise.h"
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+#include "Utility/Math/Philox.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+using namespace CFD;
+
+namespace
+{
+	// Quintic fade of gradient noise, its first and second derivatives are zero at the lattice points.
+	inline float fade(float t)
+	{
+		return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+	}
+
+	// Philox steps of the noise lattice are kept apart from the per step draws of the grid, which count up from zero.
+	const uint64_t LatticeStream = uint64_t(1) << 63;
+}
+
+float CFD::CurlNoise::getOctaveFrequency(const TurbulenceSettings& settings, int octave, int N)
+{
+	float frequency = settings.frequency * float(1 << octave);
+	return (frequency > 0.0f && frequency <= 0.5f * float(N)) ? frequency : 0.0f;
+}
+
+void CFD::CurlNoise::updateLattice(int N, int dimensions, uint64_t seed, uint64_t slice, const TurbulenceSettings& settings)
+{
+	bool sameLattice = (seed == cachedSeed && N == cachedN && dimensions == cachedDimensions && settings.octaves == cachedOctaves && settings.frequency == cachedFrequency);
+	if (sameLattice && slice == cachedSlice)
+		return;
+
+	bool threeD = (dimensions > 2);
+	int components = threeD ? 3 : 1;		// A vector potential in 3D, a stream function in 2D.
+	int axes = threeD ? 3 : 2;
+
+	if (!sameLattice)
+	{
+		latticeSizes.clear();
+		latticeOffsets.clear();
+
+		size_t total = 0;
+		for (int octave = 0; octave < settings.octaves && octave < 16; ++octave)
+		{
+			float frequency = getOctaveFrequency(settings, octave, N);
+			if (frequency == 0.0f)
+				break;
+
+			// Potentials are sampled from -1 to N, one corner past the furthest sample keeps every cell whole.
+			int size = int(frequency * float(N + 1) / float(N)) + 2;
+			size_t corners = size_t(size) * size_t(size) * size_t(threeD ? size : 1);
+
+			latticeSizes.push_back(size);
+			latticeOffsets.push_back(total);
+			total += corners * components * axes;
+		}
+
+		sliceGradients[0].assign(total, 0.0f);
+		sliceGradients[1].assign(total, 0.0f);
+	}
+
+	// Moving on by one slice keeps the later slice, so only one slice of gradients is drawn each time.
+	int first = 0;
+	if (sameLattice && cachedSlice != UINT64_MAX && slice == cachedSlice + 1)
+	{
+		std::swap(sliceGradients[0], sliceGradients[1]);
+		first = 1;
+	}
+
+	Philox random = Philox(seed);
+	for (int s = first; s < 2; ++s)
+	{
+		for (size_t octave = 0; octave < latticeSizes.size(); ++octave)
+		{
+			size_t begin = latticeOffsets[octave];
+			size_t end = (octave + 1 < latticeOffsets.size()) ? latticeOffsets[octave + 1] : sliceGradients[s].size();
+			uint64_t step = LatticeStream | (uint64_t(octave) << 40) | (slice + uint64_t(s));
+
+			// One block per corner and component, its first values are the gradient.
+			for (size_t i = begin, block = 0; i < end; i += axes, ++block)
+			{
+				Philox::Block bits = random.generate(step, block);
+				for (int axis = 0; axis < axes; ++axis)
+					sliceGradients[s][i + axis] = Philox::toUnitFloat(bits.values[axis]) * 2.0f - 1.0f;
+			}
+		}
+	}
+
+	cachedSeed = seed;
+	cachedSlice = slice;
+	cachedN = N;
+	cachedDimensions = dimensions;
+	cachedOctaves = settings.octaves;
+	cachedFrequency = settings.frequency;
+}
+
+void CFD::CurlNoise::apply(CFDData* voxels, int N, int dimensions, uint64_t seed, float time, const TurbulenceSettings& settings, ThreadPool& pool)
+{
+	Stopwatch timer;
+	stats = TurbulenceStats();
+
+	if (voxels == nullptr || N < 3 || settings.amplitude == 0.0f || settings.octaves <= 0 || getOctaveFrequency(settings, 0, N) == 0.0f)
+		return;
+
+	bool threeD = (dimensions > 2);
+	int components = threeD ? 3 : 1;
+	int axes = threeD ? 3 : 2;
+	int depth = threeD ? N : 1;
+	int stride = N + 2;
+	int paddedDepth = threeD ? stride : 1;
+	size_t componentSize = size_t(stride) * size_t(stride) * size_t(paddedDepth);
+
+	// The field moves through time by blending between the lattices of whole slices.
+	double sliceTime = std::max(0.0, double(time) * double(settings.evolution));
+	uint64_t slice = uint64_t(floor(sliceTime));
+	float blend = fade(float(sliceTime - double(slice)));
+
+	updateLattice(N, dimensions, seed, slice, settings);
+
+	gradients.resize(sliceGradients[0].size());
+	for (size_t i = 0; i < gradients.size(); ++i)
+		gradients[i] = sliceGradients[0][i] + (sliceGradients[1][i] - sliceGradients[0][i]) * blend;
+
+	// ------ Rows along x that are stirred.
+
+	stats.totalRows = N * depth;
+	activeRows.assign(size_t(N) * size_t(depth), 1);
+
+	if (settings.activeThreshold > 0.0f)
+	{
+		VoxelData* density = voxels->density;
+		pool.parallelFor(0, depth, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int z = rangeBegin; z < rangeEnd; ++z)
+			{
+				for (int y = 0; y < N; ++y)
+				{
+					uint8_t active = 0;
+					int index = N * N * z + N * y;
+					for (int x = 0; x < N && !active; ++x)
+						active = (density->getPreviousValue(index + x) > settings.activeThreshold) ? 1 : 0;
+
+					activeRows[size_t(z) * N + y] = active;
+				}
+			}
+		});
+	}
+
+	// A row of potential is needed by every active row next to it.
+	neededRows.assign(size_t(stride) * size_t(paddedDepth), 0);
+	for (int z = 0; z < depth; ++z)
+	{
+		for (int y = 0; y < N; ++y)
+		{
+			if (!activeRows[size_t(z) * N + y])
+				continue;
+
+			stats.activeRows++;
+			for (int pz = (threeD ? z : 0); pz <= (threeD ? z + 2 : 0); ++pz)
+			{
+				for (int py = y; py <= y + 2; ++py)
+					neededRows[size_t(pz) * stride + py] = 1;
+			}
+		}
+	}
+
+	if (stats.activeRows == 0)
+	{
+		stats.lastMs = timer.getElapsedMilliseconds();
+		return;
+	}
+
+	potential.resize(componentSize * components);
+
+	// ------ Potential, padded coordinates run from 0 to N + 1 for voxels -1 to N.
+
+	auto evaluateRow = [&](int py, int pz)
+	{
+		for (int component = 0; component < components; ++component)
+		{
+			float* row = &potential[component * componentSize + (size_t(pz) * stride + py) * stride];
+			std::fill(row, row + stride, 0.0f);
+
+			for (size_t octave = 0; octave < latticeSizes.size(); ++octave)
+			{
+				float frequency = getOctaveFrequency(settings, int(octave), N);
+				float spacing = frequency / float(N);
+				float scale = settings.amplitude * float(N) / (frequency * float(1 << octave));
+
+				int size = latticeSizes[octave];
+				const float* lattice = &gradients[latticeOffsets[octave]];
+
+				float v = float(py) * spacing;
+				int iy = int(v);
+				float fy = v - float(iy);
+				float sy = fade(fy);
+
+				float w = float(pz) * spacing;
+				int iz = threeD ? int(w) : 0;
+				float fz = threeD ? w - float(iz) : 0.0f;
+				float sz = threeD ? fade(fz) : 0.0f;
+
+				int px = 0;
+				while (px < stride)
+				{
+					int ix = int(float(px) * spacing);
+
+					// Across a cell only x changes, so the corners reduce to a line in x at each side of the cell that the fade blends between.
+					float a[2] = { 0.0f, 0.0f };
+					float b[2] = { 0.0f, 0.0f };
+					for (int dx = 0; dx < 2; ++dx)
+					{
+						for (int dz = 0; dz < (threeD ? 2 : 1); ++dz)
+						{
+							for (int dy = 0; dy < 2; ++dy)
+							{
+								float weight = (dy ? sy : 1.0f - sy) * (threeD ? (dz ? sz : 1.0f - sz) : 1.0f);
+								size_t corner = (size_t(iz + dz) * size + size_t(iy + dy)) * size + size_t(ix + dx);
+								const float* gradient = lattice + (corner * components + component) * axes;
+
+								float offset = gradient[1] * (fy - float(dy)) - gradient[0] * float(dx);
+								if (threeD)
+									offset += gradient[2] * (fz - float(dz));
+
+								a[dx] += weight * offset;
+								b[dx] += weight * gradient[0];
+							}
+						}
+					}
+
+					int end = px + 1;
+					while (end < stride && int(float(end) * spacing) == ix)
+						end++;
+
+					for (int x = px; x < end; ++x)
+					{
+						float fx = float(x) * spacing - float(ix);
+						float sx = fade(fx);
+						row[x] += scale * ((a[0] + b[0] * fx) * (1.0f - sx) + (a[1] + b[1] * fx) * sx);
+					}
+
+					px = end;
+				}
+			}
+		}
+	};
+
+	pool.parallelFor(0, threeD ? paddedDepth : stride, [&](int rangeBegin, int rangeEnd)
+	{
+		for (int i = rangeBegin; i < rangeEnd; ++i)
+		{
+			if (threeD)
+			{
+				for (int py = 0; py < stride; ++py)
+				{
+					if (neededRows[size_t(i) * stride + py])
+						evaluateRow(py, i);
+				}
+			}
+			else if (neededRows[i])
+			{
+				evaluateRow(i, 0);
+			}
+		}
+	});
+
+	// ------ Curl by central differences, whose divergence cancels exactly as the differences commute.
+
+	VoxelData* velocityX = voxels->velocityX;
+	VoxelData* velocityY = voxels->velocityY;
+	VoxelData* velocityZ = voxels->velocityZ;
+
+	pool.parallelFor(0, threeD ? depth : N, [&](int rangeBegin, int rangeEnd)
+	{
+		for (int i = rangeBegin; i < rangeEnd; ++i)
+		{
+			for (int j = 0; j < (threeD ? N : 1); ++j)
+			{
+				int y = threeD ? j : i;
+				int z = threeD ? i : 0;
+				if (!activeRows[size_t(z) * N + y])
+					continue;
+
+				// Offsets of the neighbouring potentials along each axis.
+				const ptrdiff_t dy = stride;
+				const ptrdiff_t dz = ptrdiff_t(stride) * stride;
+				size_t centre = (size_t(threeD ? z + 1 : 0) * stride + size_t(y + 1)) * stride + 1;
+				int index = N * N * z + N * y;
+
+				if (threeD)
+				{
+					const float* px = &potential[centre];
+					const float* py = &potential[componentSize + centre];
+					const float* pz = &potential[2 * componentSize + centre];
+
+					for (int x = 0; x < N; ++x)
+					{
+						float vx = 0.5f * ((pz[x + dy] - pz[x - dy]) - (py[x + dz] - py[x - dz]));
+						float vy = 0.5f * ((px[x + dz] - px[x - dz]) - (pz[x + 1] - pz[x - 1]));
+						float vz = 0.5f * ((py[x + 1] - py[x - 1]) - (px[x + dy] - px[x - dy]));
+
+						velocityX->increaseCurrentValue(index + x, vx);
+						velocityY->increaseCurrentValue(index + x, vy);
+						velocityZ->increaseCurrentValue(index + x, vz);
+					}
+				}
+				else
+				{
+					const float* stream = &potential[centre];
+
+					for (int x = 0; x < N; ++x)
+					{
+						velocityX->increaseCurrentValue(index + x, 0.5f * (stream[x + dy] - stream[x - dy]));
+						velocityY->increaseCurrentValue(index + x, -0.5f * (stream[x + 1] - stream[x - 1]));
+					}
+				}
+			}
+		}
+	});
+
+	stats.lastMs = timer.getElapsedMilliseconds();
+}
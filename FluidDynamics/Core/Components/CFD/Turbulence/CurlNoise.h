@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "Utility/Threading/ThreadPool.h"
+
+namespace CFD
+{
+	struct CFDData;
+
+	// How the procedural turbulence stirs the grid.
+	struct TurbulenceSettings
+	{
+		bool enabled = false;
+		float amplitude = 1.0f;				// Velocity added to a voxel each step where the first octave is strongest.
+		float frequency = 4.0f;				// Noise features across the grid on the first octave.
+		int octaves = 2;					// Each octave doubles the frequency and halves the amplitude, octaves finer than two voxels are skipped.
+		float evolution = 0.5f;				// Noise features replaced per second of simulated time, zero freezes the field.
+		float activeThreshold = 0.0f;		// Only rows of voxels holding more density than this are stirred, zero stirs the whole grid.
+	};
+
+	// Cost of the last application of the turbulence.
+	struct TurbulenceStats
+	{
+		double lastMs = 0.0;
+		int activeRows = 0;					// Rows of voxels along x that were stirred.
+		int totalRows = 0;
+
+		// Returns the share of rows that were stirred.
+		double getActiveFraction() const { return (totalRows > 0) ? double(activeRows) / double(totalRows) : 0.0; }
+	};
+
+	// Divergence free turbulence, the curl of a vector potential made of octaves of gradient noise (Bridson et al., "Curl-Noise for Procedural
+	// Fluid Flow", SIGGRAPH 2007). The potential is only evaluated around active rows, and every row is independent, so rows are split over the
+	// pool. Along a row the lattice gradients only change at lattice cell boundaries, so the inner loops are plain arithmetic over contiguous x
+	// the compiler can vectorise. The lattice comes from Philox, so the field only depends on the seed and time and is bit identical for any
+	// thread count.
+	class CurlNoise
+	{
+	public:
+
+		// Adds the turbulence at the passed in simulation time to the current velocity arrays. Activity is judged on the previous density,
+		// which holds the state between steps.
+		void apply(CFDData* voxels, int N, int dimensions, uint64_t seed, float time, const TurbulenceSettings& settings, ThreadPool& pool);
+
+		// Returns the cost of the last call to apply.
+		const TurbulenceStats& getStats() const { return stats; }
+
+	private:
+
+		// Regenerates the lattice gradients of both time slices around the passed in slice if anything they depend on changed.
+		void updateLattice(int N, int dimensions, uint64_t seed, uint64_t slice, const TurbulenceSettings& settings);
+
+		// Returns the frequency of the passed in octave, or zero if it is finer than the grid can hold.
+		static float getOctaveFrequency(const TurbulenceSettings& settings, int octave, int N);
+
+		// Lattice corners along each axis of an octave.
+		std::vector<int> latticeSizes;
+		std::vector<size_t> latticeOffsets;
+
+		// Gradients of the slices before and after the current time, blended into the gradients used this step.
+		std::vector<float> sliceGradients[2];
+		std::vector<float> gradients;
+
+		// Key of the cached slices.
+		uint64_t cachedSeed = 0;
+		uint64_t cachedSlice = UINT64_MAX;
+		int cachedN = 0;
+		int cachedDimensions = 0;
+		int cachedOctaves = 0;
+		float cachedFrequency = 0.0f;
+
+		// Potential of each component over the grid and a ring of one voxel, and which rows need it.
+		std::vector<float> potential;
+		std::vector<uint8_t> activeRows;
+		std::vector<uint8_t> neededRows;
+
+		TurbulenceStats stats;
+	};
+}
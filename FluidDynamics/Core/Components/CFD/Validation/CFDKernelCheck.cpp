@@ -0,0 +1,207 @@
+#include "CFDKernelCheck.h"
+#include "CFDReferenceKernels.h"
+#include "Core/Components/CFD/Batch/CFDRegression.h"
+#include "Utility/Math/Philox.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace CFD;
+
+namespace
+{
+	const SolverKernel CheckedKernels[] = { SolverKernel::Reset, SolverKernel::UpdateFromPrevious, SolverKernel::Diffusion,
+		SolverKernel::Advection, SolverKernel::MassConservation, SolverKernel::Boundary };
+
+	// Fills both arrays of a field with values drawn from the seed, scaled into [-scale, scale] or [0, scale] for non negative fields.
+	void fillField(VoxelData* field, const Philox& random, uint64_t stream, float scale, bool nonNegative)
+	{
+		for (int i = 0; i < field->getArraySize(); ++i)
+		{
+			Philox::Block block = random.generate(stream, uint64_t(i));
+			float current = Philox::toUnitFloat(block.values[0]);
+			float previous = Philox::toUnitFloat(block.values[1]);
+
+			field->setCurrentValue(i, nonNegative ? current * scale : (2.0f * current - 1.0f) * scale);
+			field->setPreviousValue(i, nonNegative ? previous * scale : (2.0f * previous - 1.0f) * scale);
+		}
+	}
+
+	// Gives both grids the same random fields.
+	void fillInputs(CFDGrid& grid, const KernelCheckOptions& options)
+	{
+		Philox random = Philox(options.seed);
+		CFDData* voxels = grid.getAllVoxelData();
+
+		// Velocities that backtrace up to a quarter of the grid, so advection reads inside it, off its edges and across the boundary.
+		float dt0 = grid.getTimeStep() * float(pow(options.size, options.dimensions));
+		float velocityScale = 0.25f * float(options.size) / dt0;
+
+		fillField(voxels->density, random, 0, 1.0f, true);
+		fillField(voxels->velocityX, random, 1, velocityScale, false);
+		fillField(voxels->velocityY, random, 2, velocityScale, false);
+		fillField(voxels->velocityZ, random, 3, velocityScale, false);
+	}
+
+	void setupCheckGrid(CFDGrid& grid, const KernelCheckOptions& options, int threads)
+	{
+		grid.setDensityStorage(options.densityStorage);
+		grid.setVelocityStorage(options.velocityStorage);
+		grid.setDiffusionRate(options.diffusionRate);
+		grid.setThreadCount(threads);
+		grid.setGrid(options.size, options.dimensions);
+	}
+
+	KernelFieldDifference compareArrays(const std::string& name, VoxelData* reference, VoxelData* optimised, bool previous, int N, int maxUlps)
+	{
+		KernelFieldDifference difference;
+		difference.name = name + (previous ? " previous" : " current");
+
+		for (int i = 0; i < reference->getArraySize(); ++i)
+		{
+			float expected = previous ? reference->getPreviousValue(i) : reference->getCurrentValue(i);
+			float actual = previous ? optimised->getPreviousValue(i) : optimised->getCurrentValue(i);
+
+			uint32_t ulps = CFDRegression::getUlpDistance(expected, actual);
+			float absoluteError = fabsf(actual - expected);
+
+			difference.maxUlps = std::max(difference.maxUlps, ulps);
+			if (!std::isnan(absoluteError))
+			{
+				difference.maxAbsoluteError = std::max(difference.maxAbsoluteError, absoluteError);
+				if (expected != 0.0f)
+					difference.maxRelativeError = std::max(difference.maxRelativeError, absoluteError / fabsf(expected));
+			}
+
+			if (ulps <= uint32_t(maxUlps))
+				continue;
+
+			if (difference.mismatches++ == 0)
+			{
+				// Same layout as VoxelData::getIndex, x fastest.
+				difference.firstIndex = i;
+				difference.firstX = i % N;
+				difference.firstY = (i / N) % N;
+				difference.firstZ = i / (N * N);
+				difference.firstExpected = expected;
+				difference.firstActual = actual;
+			}
+		}
+
+		return difference;
+	}
+}
+
+bool CFD::KernelCheckResult::passed() const
+{
+	return !fields.empty() && getFirstDivergence() == nullptr;
+}
+
+const KernelFieldDifference* CFD::KernelCheckResult::getFirstDivergence() const
+{
+	for (const KernelFieldDifference& field : fields)
+	{
+		if (field.mismatches > 0)
+			return &field;
+	}
+
+	return nullptr;
+}
+
+KernelCheckResult CFD::CFDKernelCheck::check(SolverKernel kernel, const KernelCheckOptions& options)
+{
+	KernelCheckResult result;
+	result.kernel = kernel;
+	result.options = options;
+
+	// The reference runs on a grid of its own so nothing the optimised kernels share, such as the thread pool, can reach it.
+	CFDGrid optimised;
+	CFDGrid reference;
+	setupCheckGrid(optimised, options, options.threads);
+	setupCheckGrid(reference, options, 1);
+
+	if (optimised.getAllVoxelData() == nullptr || reference.getAllVoxelData() == nullptr)
+		return result;
+
+	result.threads = optimised.getThreadCount();
+
+	fillInputs(optimised, options);
+	fillInputs(reference, options);
+
+	optimised.runKernel(kernel);
+	CFDReferenceKernels::run(kernel, reference.getAllVoxelData(), options.size, options.dimensions, reference.getDiffusionRate(), reference.getTimeStep());
+
+	CFDData* expected = reference.getAllVoxelData();
+	CFDData* actual = optimised.getAllVoxelData();
+
+	VoxelData* expectedFields[] = { expected->density, expected->velocityX, expected->velocityY, expected->velocityZ };
+	VoxelData* actualFields[] = { actual->density, actual->velocityX, actual->velocityY, actual->velocityZ };
+	const char* names[] = { "density", "velocityX", "velocityY", "velocityZ" };
+
+	for (int i = 0; i < 4; ++i)
+	{
+		result.fields.push_back(compareArrays(names[i], expectedFields[i], actualFields[i], false, options.size, options.maxUlps));
+		result.fields.push_back(compareArrays(names[i], expectedFields[i], actualFields[i], true, options.size, options.maxUlps));
+	}
+
+	return result;
+}
+
+std::vector<KernelCheckResult> CFD::CFDKernelCheck::checkAll(const KernelCheckOptions& options)
+{
+	std::vector<KernelCheckResult> results;
+	for (SolverKernel kernel : CheckedKernels)
+		results.push_back(check(kernel, options));
+
+	return results;
+}
+
+std::string CFD::CFDKernelCheck::toString(const std::vector<KernelCheckResult>& results)
+{
+	std::string table;
+	char line[512];
+
+	if (!results.empty())
+	{
+		const KernelCheckOptions& options = results.front().options;
+		snprintf(line, sizeof(line), "Kernel check:      %d^%d, %d threads against 1, density %s, velocity %s, seed %llu, max %d ulps\n",
+			options.size, options.dimensions, results.front().threads, getFieldStorageName(options.densityStorage),
+			getFieldStorageName(options.velocityStorage), (unsigned long long)options.seed, options.maxUlps);
+		table += line;
+	}
+
+	snprintf(line, sizeof(line), "  %-20s %6s %12s %12s %12s\n", "kernel", "result", "max ulps", "max abs", "max rel");
+	table += line;
+
+	for (const KernelCheckResult& result : results)
+	{
+		uint32_t maxUlps = 0;
+		float maxAbsolute = 0.0f;
+		float maxRelative = 0.0f;
+		for (const KernelFieldDifference& field : result.fields)
+		{
+			maxUlps = std::max(maxUlps, field.maxUlps);
+			maxAbsolute = std::max(maxAbsolute, field.maxAbsoluteError);
+			maxRelative = std::max(maxRelative, field.maxRelativeError);
+		}
+
+		snprintf(line, sizeof(line), "  %-20s %6s %12u %12.3g %12.3g\n", getSolverKernelName(result.kernel), result.passed() ? "pass" : "FAIL",
+			maxUlps, maxAbsolute, maxRelative);
+		table += line;
+
+		const KernelFieldDifference* divergence = result.getFirstDivergence();
+		if (divergence != nullptr)
+		{
+			snprintf(line, sizeof(line), "    first divergence in %s at index %d (%d, %d, %d), expected %.9g got %.9g, %zu values differ\n",
+				divergence->name.c_str(), divergence->firstIndex, divergence->firstX, divergence->firstY, divergence->firstZ,
+				divergence->firstExpected, divergence->firstActual, divergence->mismatches);
+			table += line;
+		}
+		else if (result.fields.empty())
+		{
+			table += "    grid could not be created\n";
+		}
+	}
+
+	return table;
+}
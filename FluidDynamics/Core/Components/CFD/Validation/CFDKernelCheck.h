@@ -0,0 +1,69 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+
+namespace CFD
+{
+	// Grid and inputs a kernel check runs on.
+	struct KernelCheckOptions
+	{
+		int size = 24;
+		int dimensions = 3;
+		int threads = 0;					// Threads the optimised kernels run on, zero uses every hardware thread.
+		FieldStorage densityStorage = FieldStorage::Float32;
+		FieldStorage velocityStorage = FieldStorage::Float32;
+		float diffusionRate = 0.5f;
+		uint64_t seed = 1;					// Seed of the random inputs, every kernel gets the same ones for the same seed.
+		int maxUlps = 0;					// Largest difference that still passes, zero asks for identical bits.
+	};
+
+	// How far one array of a field moved away from the reference.
+	struct KernelFieldDifference
+	{
+		std::string name;					// Field and array, such as "density current".
+		size_t mismatches = 0;				// Values further than maxUlps from the reference.
+		uint32_t maxUlps = 0;
+		float maxAbsoluteError = 0.0f;
+		float maxRelativeError = 0.0f;
+
+		// First value in memory order further than maxUlps from the reference, only set if there are mismatches.
+		int firstIndex = -1;
+		int firstX = 0;
+		int firstY = 0;
+		int firstZ = 0;
+		float firstExpected = 0.0f;
+		float firstActual = 0.0f;
+	};
+
+	// Result of running one kernel both ways on the same inputs.
+	struct KernelCheckResult
+	{
+		SolverKernel kernel = SolverKernel::Reset;
+		KernelCheckOptions options;
+		int threads = 0;					// Threads the optimised kernel actually ran on.
+		std::vector<KernelFieldDifference> fields;
+
+		bool passed() const;
+
+		// Returns the first field that diverged, nullptr if every field passed.
+		const KernelFieldDifference* getFirstDivergence() const;
+	};
+
+	// Checks the kernels of CFDGrid against CFDReferenceKernels. Both start from identical random fields, including the boundary
+	// cells, and every array of every field is compared afterwards, so a kernel writing where it should not is caught as well.
+	class CFDKernelCheck
+	{
+	public:
+
+		// Checks a single kernel.
+		static KernelCheckResult check(SolverKernel kernel, const KernelCheckOptions& options);
+
+		// Checks every kernel of the step pipeline.
+		static std::vector<KernelCheckResult> checkAll(const KernelCheckOptions& options);
+
+		// Returns a human readable table of the results, with the first divergent voxel of every kernel that failed.
+		static std::string toString(const std::vector<KernelCheckResult>& results);
+	};
+}
@@ -0,0 +1,242 @@
+#include "CFDReferenceKernels.h"
+#include "Utility/Math/Math.h"
+#include <cfloat>
+#include <cmath>
+
+using namespace CFD;
+
+void CFD::CFDReferenceKernels::run(SolverKernel kernel, CFDData* voxels, int N, int dimensions, float diffusionRate, float deltaTime)
+{
+	switch (kernel)
+	{
+	case SolverKernel::Reset:
+		reset(voxels, N);
+		break;
+	case SolverKernel::UpdateFromPrevious:
+		updateFromPrevious(voxels->density, N, dimensions, deltaTime);
+		break;
+	case SolverKernel::Diffusion:
+		diffusion(voxels->density, N, dimensions, 0, diffusionRate, deltaTime);
+		break;
+	case SolverKernel::Advection:
+		advection(voxels->density, voxels->velocityX, voxels->velocityY, voxels->velocityZ, N, dimensions, 0, deltaTime);
+		break;
+	case SolverKernel::MassConservation:
+		massConservation(voxels->velocityX, voxels->velocityY, voxels->velocityZ, N, dimensions);
+		break;
+	case SolverKernel::Boundary:
+		currentBoundary(voxels->density, N, 0);
+		previousBoundary(voxels->density, N, 0);
+		break;
+	}
+}
+
+void CFD::CFDReferenceKernels::reset(CFDData* voxels, int N)
+{
+	int count = N * N * N + N * N + N + 1;
+	for (int i = 0; i < count; ++i)
+	{
+		voxels->density->setCurrentValue(i, 0);
+		voxels->velocityY->setCurrentValue(i, 0);
+		voxels->velocityX->setCurrentValue(i, 0);
+		voxels->velocityZ->setCurrentValue(i, 0);
+	}
+}
+
+void CFD::CFDReferenceKernels::updateFromPrevious(VoxelData* data, int N, int dimensions, float deltaTime)
+{
+	int size = int(pow(N + 2, dimensions));
+	for (int i = 0; i < size; i++)
+		data->increaseCurrentValue(i, data->getPreviousValue(i) * deltaTime);
+}
+
+void CFD::CFDReferenceKernels::diffusion(VoxelData* data, int N, int dimensions, float boundary, float diff, float deltaTime)
+{
+	float k = deltaTime * diff * float(pow(N, dimensions));
+	float c = (dimensions > 2) ? 1 + 6 * k : 1 + 4 * k;
+
+	for (int i = 0; i < 20; i++)
+	{
+		for (int x = 0; x < N; x++)
+		{
+			for (int y = 0; y < N; y++)
+			{
+				for (int z = 0; z < N; z++)
+				{
+					float x0 = data->getCurrentValue(Vector3(x - 1, y, z));
+					float x1 = data->getCurrentValue(Vector3(x + 1, y, z));
+					float y0 = data->getCurrentValue(Vector3(x, y - 1, z));
+					float y1 = data->getCurrentValue(Vector3(x, y + 1, z));
+					float prev = data->getPreviousValue(Vector3(x, y, z));
+
+					float value;
+					if (dimensions > 2)
+					{
+						float z0 = data->getCurrentValue(Vector3(x, y, z - 1));
+						float z1 = data->getCurrentValue(Vector3(x, y, z + 1));
+						value = (prev + k * (x0 + x1 + y0 + y1 + z0 + z1)) / c;
+					}
+					else
+					{
+						value = (prev + k * (x0 + x1 + y0 + y1)) / c;
+					}
+
+					data->setCurrentValue(Vector3(x, y, z), value);
+				}
+			}
+		}
+		currentBoundary(data, N, int(boundary));
+	}
+}
+
+void CFD::CFDReferenceKernels::advection(VoxelData* data, VoxelData* velocityX, VoxelData* velocityY, VoxelData* velocityZ, int N, int dimensions, float boundary, float deltaTime)
+{
+	float dt0 = deltaTime * float(pow(N, dimensions));
+
+	for (int x = 0; x < N; ++x)
+	{
+		for (int y = 0; y < N; ++y)
+		{
+			for (int z = 0; z < N; ++z)
+			{
+				// The 2D solver backtraces z along the y velocity, z is always zero there so it only picks the slice.
+				VoxelData* velocityAlongZ = (dimensions > 2) ? velocityZ : velocityY;
+				Vector3 backtrace = Vector3(float(x - dt0 * velocityX->getCurrentValue(Vector3(x, y, z))),
+					float(y - dt0 * velocityY->getCurrentValue(Vector3(x, y, z))),
+					float(z - dt0 * velocityAlongZ->getCurrentValue(Vector3(x, y, z))));
+
+				Vector3 cell = Vector3(int(backtrace.x), int(backtrace.y), int(backtrace.z));
+
+				float interpX = Math::lerp(data->getPreviousValue(Vector3(cell.x + 1, cell.y, cell.z)), data->getPreviousValue(Vector3(cell.x - 1, cell.y, cell.z)), backtrace.x);
+				float interpY = Math::lerp(data->getPreviousValue(Vector3(cell.x, cell.y + 1, cell.z)), data->getPreviousValue(Vector3(cell.x, cell.y - 1, cell.z)), backtrace.y);
+
+				float value;
+				if (dimensions > 2)
+				{
+					float interpZ = Math::lerp(data->getPreviousValue(Vector3(cell.x, cell.y, cell.z + 1)), data->getPreviousValue(Vector3(cell.x, cell.y, cell.z - 1)), backtrace.z);
+					value = (interpX + interpY + interpZ);
+				}
+				else
+				{
+					value = (interpX + interpY);
+				}
+
+				data->setCurrentValue(Vector3(x, y, z), Math::clamp(value, 0.0f, FLT_MAX));
+			}
+		}
+	}
+	currentBoundary(data, N, int(boundary));
+}
+
+void CFD::CFDReferenceKernels::massConservation(VoxelData* velocityX, VoxelData* velocityY, VoxelData* velocityZ, int N, int dimensions)
+{
+	for (int x = 0; x < N; x++)
+	{
+		for (int y = 0; y < N; y++)
+		{
+			for (int z = 0; z < N; z++)
+			{
+				float xDiff = velocityX->getCurrentValue(Vector3(x + 1, y, z)) - velocityX->getCurrentValue(Vector3(x - 1, y, z));
+				float yDiff = velocityY->getCurrentValue(Vector3(x, y + 1, z)) - velocityY->getCurrentValue(Vector3(x, y - 1, z));
+				float zDiff = velocityZ->getCurrentValue(Vector3(x, y, z + 1)) - velocityZ->getCurrentValue(Vector3(x, y, z - 1));
+
+				velocityY->setPreviousValue(Vector3(x, y, z), -0.5f * (xDiff + yDiff + zDiff) / N);
+				velocityX->setPreviousValue(Vector3(x, y, z), 0);
+			}
+		}
+	}
+
+	previousBoundary(velocityX, N, 0);
+	previousBoundary(velocityY, N, 0);
+	previousBoundary(velocityZ, N, 0);
+
+	float k = 1;
+	float c = 4;
+
+	for (int i = 0; i < 20; i++)
+	{
+		for (int x = 0; x < N; x++)
+		{
+			for (int y = 0; y < N; y++)
+			{
+				for (int z = 0; z < N; z++)
+				{
+					float x0 = velocityY->getCurrentValue(Vector3(x - 1, y, z));
+					float x1 = velocityY->getCurrentValue(Vector3(x + 1, y, z));
+					float y0 = velocityY->getCurrentValue(Vector3(x, y - 1, z));
+					float y1 = velocityY->getCurrentValue(Vector3(x, y + 1, z));
+					float prev = velocityX->getPreviousValue(Vector3(x, y, z));
+
+					float value;
+					if (dimensions > 2)
+					{
+						float z0 = velocityY->getCurrentValue(Vector3(x, y, z - 1));
+						float z1 = velocityY->getCurrentValue(Vector3(x, y, z + 1));
+						value = (prev + k * (x0 + x1 + y0 + y1 + z0 + z1)) / c;
+					}
+					else
+					{
+						value = (prev + k * (x0 + x1 + y0 + y1)) / c;
+					}
+
+					velocityX->setCurrentValue(Vector3(x, y, z), value);
+				}
+			}
+		}
+		currentBoundary(velocityX, N, 0);
+	}
+
+	for (int x = 0; x < N; x++)
+	{
+		for (int y = 0; y < N; y++)
+		{
+			for (int z = 0; z < N; z++)
+			{
+				// The y and z gradients difference a value with itself, so they are always zero. Kept as written to match the solver.
+				float xDiff = velocityX->getPreviousValue(Vector3(x + 1, y, z)) - velocityX->getPreviousValue(Vector3(x - 1, y, z));
+				float yDiff = velocityX->getPreviousValue(Vector3(x, y + 1, z)) - velocityX->getPreviousValue(Vector3(x, y + 1, z));
+				float zDiff = velocityX->getPreviousValue(Vector3(x, y, z + 1)) - velocityX->getPreviousValue(Vector3(x, y, z + 1));
+
+				velocityX->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * xDiff);
+				velocityY->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * yDiff);
+				velocityZ->decreaseCurrentValue(Vector3(x, y, z), 0.5f * N * zDiff);
+			}
+		}
+	}
+
+	currentBoundary(velocityX, N, 1);
+	currentBoundary(velocityY, N, 2);
+	currentBoundary(velocityZ, N, 3);
+}
+
+void CFD::CFDReferenceKernels::currentBoundary(VoxelData* data, int N, int boundary)
+{
+	for (int i = 0; i < N; i++)
+	{
+		data->setCurrentValue(Vector3(0, i, 0), (boundary == 1) ? -data->getCurrentValue(Vector3(1, i, 0)) : data->getCurrentValue(Vector3(1, i, 0)));
+		data->setCurrentValue(Vector3(N + 1, i, 0), (boundary == 1) ? -data->getCurrentValue(Vector3(N, i, 0)) : data->getCurrentValue(Vector3(N, i, 0)));
+		data->setCurrentValue(Vector3(i, 0, 0), (boundary == 1) ? -data->getCurrentValue(Vector3(i, 0, 0)) : data->getCurrentValue(Vector3(i, 0, 0)));
+		data->setCurrentValue(Vector3(i, N + 1, 0), (boundary == 1) ? -data->getCurrentValue(Vector3(i, N, 0)) : data->getCurrentValue(Vector3(i, N, 0)));
+	}
+
+	data->setCurrentValue(Vector3(0, 0, 0), 0.5f * (data->getCurrentValue(Vector3(1, 0, 0)) + data->getCurrentValue(Vector3(0, 1, 0))));
+	data->setCurrentValue(Vector3(0, N + 1, 0), 0.5f * (data->getCurrentValue(Vector3(1, N + 1, 0)) + data->getCurrentValue(Vector3(0, N, 0))));
+	data->setCurrentValue(Vector3(N + 1, 0, 0), 0.5f * (data->getCurrentValue(Vector3(N, 0, 0)) + data->getCurrentValue(Vector3(N + 1, 1, 0))));
+	data->setCurrentValue(Vector3(N + 1, N + 1, 0), 0.5f * (data->getCurrentValue(Vector3(N, N + 1, 0)) + data->getCurrentValue(Vector3(N + 1, N, 0))));
+}
+
+void CFD::CFDReferenceKernels::previousBoundary(VoxelData* data, int N, int boundary)
+{
+	for (int i = 0; i < N; i++)
+	{
+		data->setPreviousValue(Vector3(0, i, 0), (boundary == 1) ? -data->getPreviousValue(Vector3(1, i, 0)) : data->getPreviousValue(Vector3(1, i, 0)));
+		data->setPreviousValue(Vector3(N + 1, i, 0), (boundary == 1) ? -data->getPreviousValue(Vector3(N, i, 0)) : data->getPreviousValue(Vector3(N, i, 0)));
+		data->setPreviousValue(Vector3(i, 0, 0), (boundary == 1) ? -data->getPreviousValue(Vector3(i, 0, 0)) : data->getPreviousValue(Vector3(i, 0, 0)));
+		data->setPreviousValue(Vector3(i, N + 1, 0), (boundary == 1) ? -data->getPreviousValue(Vector3(i, N, 0)) : data->getPreviousValue(Vector3(i, N, 0)));
+	}
+
+	data->setPreviousValue(Vector3(0, 0, 0), 0.5f * (data->getPreviousValue(Vector3(1, 0, 0)) + data->getPreviousValue(Vector3(0, 1, 0))));
+	data->setPreviousValue(Vector3(0, N + 1, 0), 0.5f * (data->getPreviousValue(Vector3(1, N + 1, 0)) + data->getPreviousValue(Vector3(0, N, 0))));
+	data->setPreviousValue(Vector3(N + 1, 0, 0), 0.5f * (data->getPreviousValue(Vector3(N, 0, 0)) + data->getPreviousValue(Vector3(N + 1, 1, 0))));
+	data->setPreviousValue(Vector3(N + 1, N + 1, 0), 0.5f * (data->getPreviousValue(Vector3(N, N + 1, 0)) + data->getPreviousValue(Vector3(N + 1, N, 0))));
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include "Core/Components/CFD/Grid/CFDGrid.h"
+
+namespace CFD
+{
+	// Plain single threaded versions of the solver kernels, the definition the kernels in CFDGrid are checked against.
+	// Each follows its CFDGrid counterpart voxel for voxel, including the order of the Gauss-Seidel sweeps, so only change one
+	// when the solver's results are meant to change, never to speed it up.
+	class CFDReferenceKernels
+	{
+	public:
+
+		// Runs a kernel the way CFDGrid::runKernel does, on the passed in fields.
+		static void run(SolverKernel kernel, CFDData* voxels, int N, int dimensions, float diffusionRate, float deltaTime);
+
+		static void reset(CFDData* voxels, int N);
+		static void updateFromPrevious(VoxelData* data, int N, int dimensions, float deltaTime);
+		static void diffusion(VoxelData* data, int N, int dimensions, float boundary, float diff, float deltaTime);
+		static void advection(VoxelData* data, VoxelData* velocityX, VoxelData* velocityY, VoxelData* velocityZ, int N, int dimensions, float boundary, float deltaTime);
+		static void massConservation(VoxelData* velocityX, VoxelData* velocityY, VoxelData* velocityZ, int N, int dimensions);
+		static void currentBoundary(VoxelData* data, int N, int boundary);
+		static void previousBoundary(VoxelData* data, int N, int boundary);
+	};
+}
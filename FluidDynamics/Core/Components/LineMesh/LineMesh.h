@@ -17,6 +17,12 @@ public:
 
 	void setSelectedItem(DirectX::XMFLOAT3 val) { selectedMesh = val; };
 
+	// Returns the size of the per instance position buffer for a grid of the passed in dimensions.
+	static size_t getInstanceBufferBytes(int w, int h, int d) { return sizeof(Instance) * size_t(w) * size_t(h) * size_t(d); }
+
+	// Returns the size of the per instance grid position buffer for a grid of the passed in dimensions.
+	static size_t getInstanceDataBufferBytes(int w, int h, int d) { return sizeof(InstanceData) * size_t(w) * size_t(h) * size_t(d); }
+
 	void Render();
 	void Update(float deltaTime);
 
@@ -1,4 +1,5 @@
 #include "GameObject.h"
+#include "Utility/Profiling/Trace.h"
 
 using namespace std;
 using namespace DirectX;
@@ -37,6 +38,8 @@ void GameObject::setPosition(XMFLOAT3 position)
 
 void GameObject::update(float deltaTime)
 {
+	CFD_TRACE_SCOPE("GameObject::update");
+
 	if(this->updateable)
 	{
 		for (auto it = components.begin(); it != components.end(); it++)
@@ -56,6 +59,8 @@ void GameObject::update(float deltaTime)
 
 void GameObject::draw()
 {
+	CFD_TRACE_SCOPE("GameObject::draw");
+
 	if(this->renderable)
 	{
 		for (auto it = components.begin(); it != components.end(); it++)
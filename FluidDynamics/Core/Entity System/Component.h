@@ -1,13 +1,15 @@
 #pragma once
 #include "ComponentTypes.h"
 #include <cstdint>
-#include <Windows.h>
 
 class Component
 {
 public:
 	Component() : parent(nullptr), type(ComponentTypes::NOTSET), id(0) { id = reinterpret_cast<unsigned long long>(this); };
 
+	// Components are deleted through this type when they are removed from their entity.
+	virtual ~Component() = default;
+
 	ComponentTypes getType() { return type; };
 	void setType(const ComponentTypes TYPE) { type = TYPE; };
 
@@ -21,7 +23,7 @@ public:
 	void setUpdateable(bool val) { updateable = val; };
 	bool getUpdatable() { return updateable; };
 
-	virtual void Update(float deltaTime) { UNREFERENCED_PARAMETER(deltaTime); };
+	virtual void Update(float deltaTime) { (void)deltaTime; };
 	virtual void Render() {};
 
 private:
@@ -9,4 +9,9 @@ enum class ComponentTypes
 	Camera,
 	Material,
 	Grid,
+	CFDGrid,
+	CFDEmitter,
+	CFDRecorder,
+	CFDPlayback,
+	CFDGridRenderer,
 };
\ No newline at end of file
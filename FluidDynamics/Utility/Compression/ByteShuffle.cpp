@@ -0,0 +1,44 @@
+#include "ByteShuffle.h"
+#include <cstring>
+
+void ByteShuffle::shuffle(const void* source, void* destination, size_t count, size_t elementSize)
+{
+	const unsigned char* in = static_cast<const unsigned char*>(source);
+	unsigned char* out = static_cast<unsigned char*>(destination);
+
+	if (elementSize <= 1)
+	{
+		memcpy(out, in, count * elementSize);
+		return;
+	}
+
+	for (size_t byte = 0; byte < elementSize; ++byte)
+	{
+		unsigned char* plane = out + byte * count;
+		for (size_t i = 0; i < count; ++i)
+		{
+			plane[i] = in[i * elementSize + byte];
+		}
+	}
+}
+
+void ByteShuffle::unshuffle(const void* source, void* destination, size_t count, size_t elementSize)
+{
+	const unsigned char* in = static_cast<const unsigned char*>(source);
+	unsigned char* out = static_cast<unsigned char*>(destination);
+
+	if (elementSize <= 1)
+	{
+		memcpy(out, in, count * elementSize);
+		return;
+	}
+
+	for (size_t byte = 0; byte < elementSize; ++byte)
+	{
+		const unsigned char* plane = in + byte * count;
+		for (size_t i = 0; i < count; ++i)
+		{
+			out[i * elementSize + byte] = plane[i];
+		}
+	}
+}
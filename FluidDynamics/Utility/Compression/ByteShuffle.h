@@ -0,0 +1,15 @@
+#pragma once
+#include <cstddef>
+
+// Regroups the bytes of an array of fixed size elements so byte N of every element is stored together.
+// Smoothly varying floats share their sign and exponent bytes, so shuffled fields compress far better.
+class ByteShuffle
+{
+public:
+
+	// Writes the bytes of count elements of elementSize bytes from source into destination grouped by byte position.
+	static void shuffle(const void* source, void* destination, size_t count, size_t elementSize);
+
+	// Reverses shuffle, writing count elements of elementSize bytes back into destination.
+	static void unshuffle(const void* source, void* destination, size_t count, size_t elementSize);
+};
@@ -0,0 +1,500 @@
+#include "Deflate.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Format limits of deflate.
+	const size_t MinMatch = 4;			// Deflate allows three, but four bytes hash in one read.
+	const size_t MaxMatch = 258;
+	const size_t WindowSize = 32768;
+	const size_t StoredBlockBytes = 65535;
+
+	const int HashBits = 15;
+	const int MaxChain = 8;				// Candidates tried per position, more finds longer matches but costs speed.
+
+	const uint16_t LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	uint32_t reverseBits(uint32_t code, int length)
+	{
+		uint32_t reversed = 0;
+		for (int i = 0; i < length; ++i)
+		{
+			reversed = (reversed << 1) | (code & 1);
+			code >>= 1;
+		}
+
+		return reversed;
+	}
+
+	// The fixed Huffman codes, bit reversed so they can be written least significant bit first, and the symbol lookups.
+	struct FixedCodes
+	{
+		FixedCodes()
+		{
+			for (int symbol = 0; symbol < 288; ++symbol)
+			{
+				uint32_t code;
+				int length;
+				if (symbol < 144)		{ code = 0x30 + symbol; length = 8; }
+				else if (symbol < 256)	{ code = 0x190 + (symbol - 144); length = 9; }
+				else if (symbol < 280)	{ code = symbol - 256; length = 7; }
+				else					{ code = 0xC0 + (symbol - 280); length = 8; }
+
+				literal[symbol] = uint16_t(reverseBits(code, length));
+				literalLength[symbol] = uint8_t(length);
+			}
+
+			for (int i = 0; i < 30; ++i)
+				distance[i] = uint8_t(reverseBits(uint32_t(i), 5));
+
+			for (int i = 0; i < 29; ++i)
+			{
+				int end = (i == 28) ? 259 : LengthBase[i] + (1 << LengthExtra[i]);
+				for (int length = LengthBase[i]; length < end; ++length)
+					lengthCode[length] = uint8_t(i);
+			}
+
+			for (int i = 0; i < 30; ++i)
+			{
+				for (int d = DistanceBase[i] - 1; d < DistanceBase[i] - 1 + (1 << DistanceExtra[i]); ++d)
+					distanceCode[d < 256 ? d : 256 + (d >> 7)] = uint8_t(i);
+			}
+		}
+
+		// Returns the distance code of a match distance.
+		int getDistanceCode(size_t matchDistance) const
+		{
+			size_t d = matchDistance - 1;
+			return distanceCode[d < 256 ? d : 256 + (d >> 7)];
+		}
+
+		uint16_t literal[288];
+		uint8_t literalLength[288];
+		uint8_t distance[30];
+		uint8_t lengthCode[MaxMatch + 1];
+		uint8_t distanceCode[512];		// Distances below 257 directly, the rest in steps of 128.
+	};
+
+	const FixedCodes& getFixedCodes()
+	{
+		static const FixedCodes codes;
+		return codes;
+	}
+
+	uint32_t read32(const unsigned char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Writes codes least significant bit first, as deflate packs them.
+	struct BitWriter
+	{
+		BitWriter(unsigned char* begin, unsigned char* end) : op(begin), end(end) {}
+
+		void put(uint32_t value, int length)
+		{
+			bits |= uint64_t(value) << count;
+			count += length;
+
+			if (count >= 32)
+			{
+				if (end - op < 4)
+				{
+					overflow = true;
+					return;
+				}
+
+				uint32_t word = uint32_t(bits);
+				op[0] = (unsigned char)(word);
+				op[1] = (unsigned char)(word >> 8);
+				op[2] = (unsigned char)(word >> 16);
+				op[3] = (unsigned char)(word >> 24);
+				op += 4;
+				bits >>= 32;
+				count -= 32;
+			}
+		}
+
+		// Writes out the remaining bits, padded to a whole byte.
+		void flush()
+		{
+			while (count > 0)
+			{
+				if (op >= end)
+				{
+					overflow = true;
+					return;
+				}
+
+				*op++ = (unsigned char)(bits);
+				bits >>= 8;
+				count -= 8;
+			}
+
+			bits = 0;
+			count = 0;
+		}
+
+		unsigned char* op;
+		unsigned char* end;
+		uint64_t bits = 0;
+		int count = 0;
+		bool overflow = false;
+	};
+
+	// Reads bits least significant first, flagging an overrun instead of reading past the end.
+	struct BitReader
+	{
+		BitReader(const unsigned char* begin, const unsigned char* end) : ip(begin), end(end) {}
+
+		uint32_t get(int length)
+		{
+			while (count < length)
+			{
+				if (ip >= end)
+				{
+					overrun = true;
+					return 0;
+				}
+
+				bits |= uint64_t(*ip++) << count;
+				count += 8;
+			}
+
+			uint32_t value = uint32_t(bits & ((uint64_t(1) << length) - 1));
+			bits >>= length;
+			count -= length;
+			return value;
+		}
+
+		// Reads a Huffman code, which is packed most significant bit first.
+		uint32_t getCode(int length)
+		{
+			uint32_t code = 0;
+			for (int i = 0; i < length; ++i)
+				code = (code << 1) | get(1);
+
+			return code;
+		}
+
+		// Drops the bits up to the next byte boundary.
+		void alignToByte()
+		{
+			bits >>= count % 8;
+			count -= count % 8;
+		}
+
+		const unsigned char* ip;
+		const unsigned char* end;
+		uint64_t bits = 0;
+		int count = 0;
+		bool overrun = false;
+	};
+
+	// Encodes the whole source as a single final fixed Huffman block. Returns false if it overflowed the writer.
+	bool encodeFixed(const unsigned char* in, size_t sourceBytes, BitWriter& writer)
+	{
+		const FixedCodes& codes = getFixedCodes();
+
+		writer.put(1, 1);	// Final block.
+		writer.put(1, 2);	// Fixed Huffman codes.
+
+		std::vector<int64_t> head(size_t(1) << HashBits, -1);
+		std::vector<int64_t> chain(WindowSize, -1);
+
+		auto insert = [&](size_t position)
+		{
+			uint32_t h = hash(read32(in + position));
+			chain[position & (WindowSize - 1)] = head[h];
+			head[h] = int64_t(position);
+		};
+
+		size_t i = 0;
+		while (i < sourceBytes && !writer.overflow)
+		{
+			size_t bestLength = 0;
+			size_t bestDistance = 0;
+
+			if (i + MinMatch <= sourceBytes)
+			{
+				int64_t candidate = head[hash(read32(in + i))];
+				insert(i);
+
+				size_t maxLength = std::min<size_t>(MaxMatch, sourceBytes - i);
+				for (int c = 0; c < MaxChain && candidate >= 0 && i - size_t(candidate) <= WindowSize; ++c)
+				{
+					const unsigned char* a = in + candidate;
+					const unsigned char* b = in + i;
+
+					// A candidate can only beat the best match if it also matches the byte the best match ended on.
+					if (bestLength == 0 || a[bestLength] == b[bestLength])
+					{
+						size_t length = 0;
+						while (length < maxLength && a[length] == b[length])
+							length++;
+
+						if (length > bestLength)
+						{
+							bestLength = length;
+							bestDistance = i - size_t(candidate);
+
+							if (length == maxLength)
+								break;
+						}
+					}
+
+					candidate = chain[size_t(candidate) & (WindowSize - 1)];
+				}
+			}
+
+			if (bestLength >= MinMatch)
+			{
+				int lengthCode = codes.lengthCode[bestLength];
+				writer.put(codes.literal[257 + lengthCode], codes.literalLength[257 + lengthCode]);
+				writer.put(uint32_t(bestLength - LengthBase[lengthCode]), LengthExtra[lengthCode]);
+
+				int distanceCode = codes.getDistanceCode(bestDistance);
+				writer.put(codes.distance[distanceCode], 5);
+				writer.put(uint32_t(bestDistance - DistanceBase[distanceCode]), DistanceExtra[distanceCode]);
+
+				// The positions the match covers are hashed too, so later matches can refer into it.
+				for (size_t j = i + 1; j < i + bestLength && j + MinMatch <= sourceBytes; ++j)
+					insert(j);
+
+				i += bestLength;
+			}
+			else
+			{
+				writer.put(codes.literal[in[i]], codes.literalLength[in[i]]);
+				i++;
+			}
+		}
+
+		writer.put(codes.literal[256], codes.literalLength[256]);
+		writer.flush();
+		return !writer.overflow;
+	}
+
+	// Decodes the symbols of a fixed Huffman block into the output. Returns false if the block is malformed.
+	bool decodeFixed(BitReader& reader, unsigned char* out, size_t outBytes, size_t& produced)
+	{
+		while (true)
+		{
+			uint32_t code = reader.getCode(7);
+			uint32_t symbol;
+
+			if (code <= 0x17)
+			{
+				symbol = 256 + code;
+			}
+			else
+			{
+				code = (code << 1) | reader.get(1);
+				if (code >= 0x30 && code <= 0xBF)
+					symbol = code - 0x30;
+				else if (code >= 0xC0 && code <= 0xC7)
+					symbol = 280 + (code - 0xC0);
+				else
+					symbol = 144 + (((code << 1) | reader.get(1)) - 0x190);
+			}
+
+			if (reader.overrun)
+				return false;
+
+			if (symbol < 256)
+			{
+				if (produced >= outBytes)
+					return false;
+
+				out[produced++] = (unsigned char)symbol;
+				continue;
+			}
+
+			if (symbol == 256)
+				return true;
+
+			if (symbol > 285)
+				return false;
+
+			int lengthCode = int(symbol - 257);
+			size_t length = LengthBase[lengthCode] + reader.get(LengthExtra[lengthCode]);
+
+			uint32_t distanceCode = reader.getCode(5);
+			if (distanceCode >= 30)
+				return false;
+
+			size_t distance = DistanceBase[distanceCode] + reader.get(DistanceExtra[distanceCode]);
+			if (reader.overrun || distance > produced || length > outBytes - produced)
+				return false;
+
+			// Matches may overlap the bytes they produce, so they are copied a byte at a time.
+			for (size_t k = 0; k < length; ++k, ++produced)
+				out[produced] = out[produced - distance];
+		}
+	}
+}
+
+size_t Deflate::compress(const void* source, size_t sourceBytes, void* destination, size_t destinationCapacity)
+{
+	const unsigned char* in = static_cast<const unsigned char*>(source);
+	unsigned char* out = static_cast<unsigned char*>(destination);
+
+	size_t storedBlocks = std::max<size_t>(1, (sourceBytes + StoredBlockBytes - 1) / StoredBlockBytes);
+	size_t storedBytes = 2 + storedBlocks * 5 + sourceBytes + 4;
+
+	if (destinationCapacity < 6)
+		return 0;
+
+	// Deflate with a 32KB window, no preset dictionary, and the check bits the header needs.
+	out[0] = 0x78;
+	out[1] = 0x01;
+
+	// Fixed codes that come out no smaller than storing the data are abandoned for stored blocks.
+	size_t limit = std::min<size_t>(destinationCapacity, storedBytes);
+	BitWriter writer(out + 2, out + limit - 4);
+
+	unsigned char* op;
+	if (encodeFixed(in, sourceBytes, writer))
+	{
+		op = writer.op;
+	}
+	else
+	{
+		if (destinationCapacity < storedBytes)
+			return 0;
+
+		op = out + 2;
+		size_t remaining = sourceBytes;
+		do
+		{
+			size_t blockBytes = std::min<size_t>(remaining, StoredBlockBytes);
+			remaining -= blockBytes;
+
+			// Block type bits, padded to the byte, then the length and its complement.
+			*op++ = (remaining == 0) ? 1 : 0;
+			op[0] = (unsigned char)(blockBytes);
+			op[1] = (unsigned char)(blockBytes >> 8);
+			op[2] = (unsigned char)(~blockBytes);
+			op[3] = (unsigned char)(~blockBytes >> 8);
+			op += 4;
+
+			memcpy(op, in, blockBytes);
+			op += blockBytes;
+			in += blockBytes;
+		} while (remaining > 0);
+	}
+
+	uint32_t adler = adler32(source, sourceBytes);
+	op[0] = (unsigned char)(adler >> 24);
+	op[1] = (unsigned char)(adler >> 16);
+	op[2] = (unsigned char)(adler >> 8);
+	op[3] = (unsigned char)(adler);
+	op += 4;
+
+	return size_t(op - out);
+}
+
+bool Deflate::decompress(const void* source, size_t sourceBytes, void* destination, size_t destinationBytes)
+{
+	const unsigned char* in = static_cast<const unsigned char*>(source);
+	unsigned char* out = static_cast<unsigned char*>(destination);
+
+	if (sourceBytes < 6)
+		return false;
+
+	// Deflate, no preset dictionary, valid check bits.
+	if ((in[0] & 0x0F) != 8 || (in[0] >> 4) > 7 || (in[1] & 0x20) != 0 || ((in[0] << 8) | in[1]) % 31 != 0)
+		return false;
+
+	BitReader reader(in + 2, in + sourceBytes);
+	size_t produced = 0;
+
+	bool finalBlock = false;
+	while (!finalBlock)
+	{
+		finalBlock = reader.get(1) == 1;
+		uint32_t type = reader.get(2);
+
+		if (reader.overrun)
+			return false;
+
+		if (type == 0)
+		{
+			reader.alignToByte();
+			uint32_t length = reader.get(16);
+			uint32_t complement = reader.get(16);
+			if (reader.overrun || (length ^ 0xFFFF) != complement)
+				return false;
+
+			// Hand any whole bytes still buffered back to the input and copy straight from it.
+			reader.ip -= reader.count / 8;
+			reader.bits = 0;
+			reader.count = 0;
+
+			if (size_t(reader.end - reader.ip) < length || length > destinationBytes - produced)
+				return false;
+
+			memcpy(out + produced, reader.ip, length);
+			reader.ip += length;
+			produced += length;
+		}
+		else if (type == 1)
+		{
+			if (!decodeFixed(reader, out, destinationBytes, produced))
+				return false;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	reader.alignToByte();
+	uint32_t adler = reader.get(8) << 24;
+	adler |= reader.get(8) << 16;
+	adler |= reader.get(8) << 8;
+	adler |= reader.get(8);
+
+	return !reader.overrun && produced == destinationBytes && adler == adler32(destination, destinationBytes);
+}
+
+uint32_t Deflate::adler32(const void* bytes, size_t count, uint32_t adler)
+{
+	// Largest run that cannot overflow the sums before they are reduced.
+	const size_t MaxRun = 5552;
+	const uint32_t Modulus = 65521;
+
+	const unsigned char* p = static_cast<const unsigned char*>(bytes);
+	uint32_t a = adler & 0xFFFF;
+	uint32_t b = adler >> 16;
+
+	while (count > 0)
+	{
+		size_t run = std::min<size_t>(count, MaxRun);
+		count -= run;
+
+		for (size_t i = 0; i < run; ++i)
+		{
+			a += p[i];
+			b += a;
+		}
+
+		p += run;
+		a %= Modulus;
+		b %= Modulus;
+	}
+
+	return (b << 16) | a;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Compressor producing zlib streams (RFC 1950) of fixed Huffman deflate blocks (RFC 1951), readable by any zlib inflate.
+// Trades ratio for speed, matches come from a short hash chain and no dynamic Huffman tables are built.
+// Streams are self contained, nothing is shared between calls, so blocks can be compressed on any thread.
+class Deflate
+{
+public:
+
+	// Returns the largest size a stream of the passed in bytes can compress to, which is the size of storing them uncompressed.
+	static size_t compressBound(size_t bytes) { return bytes + (bytes / 65535 + 1) * 5 + 6; }
+
+	// Compresses sourceBytes from source into destination, falling back to stored blocks when the data does not compress.
+	// Returns the compressed size, or zero if it did not fit the capacity.
+	static size_t compress(const void* source, size_t sourceBytes, void* destination, size_t destinationCapacity);
+
+	// Decompresses a stream written by compress into exactly destinationBytes. Returns false if the stream is malformed, fails its checksum,
+	// or uses dynamic Huffman blocks, which compress never writes.
+	static bool decompress(const void* source, size_t sourceBytes, void* destination, size_t destinationBytes);
+
+	// Returns the Adler-32 checksum of the passed in bytes, continuing from a previous checksum.
+	static uint32_t adler32(const void* bytes, size_t count, uint32_t adler = 1);
+};
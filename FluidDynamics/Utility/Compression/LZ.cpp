@@ -0,0 +1,206 @@
+#include "LZ.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Format limits of the LZ4 block format.
+	const size_t MinMatch = 4;
+	const size_t LastLiterals = 5;		// The last bytes of a block are always literals.
+	const size_t MatchSearchLimit = 12;	// No match may start within this many bytes of the end.
+	const size_t MaxOffset = 65535;
+
+	const int HashBits = 12;
+
+	uint32_t read32(const unsigned char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Writes a length continuation, one 255 byte per full 255 and the remainder.
+	bool writeLength(unsigned char*& op, const unsigned char* end, size_t length)
+	{
+		while (length >= 255)
+		{
+			if (op >= end)
+				return false;
+
+			*op++ = 255;
+			length -= 255;
+		}
+
+		if (op >= end)
+			return false;
+
+		*op++ = (unsigned char)length;
+		return true;
+	}
+
+	// Writes one sequence, the literals since the last match followed by a match. A zero match length writes the final literals only.
+	bool writeSequence(unsigned char*& op, const unsigned char* end, const unsigned char* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		if (op >= end)
+			return false;
+
+		unsigned char* token = op++;
+		*token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+
+		if (literalLength >= 15 && !writeLength(op, end, literalLength - 15))
+			return false;
+
+		if (size_t(end - op) < literalLength)
+			return false;
+
+		memcpy(op, literals, literalLength);
+		op += literalLength;
+
+		if (matchLength == 0)
+			return true;
+
+		if (end - op < 2)
+			return false;
+
+		*op++ = (unsigned char)(offset & 0xFF);
+		*op++ = (unsigned char)(offset >> 8);
+
+		size_t matchCode = matchLength - MinMatch;
+		*token |= (unsigned char)(matchCode >= 15 ? 15 : matchCode);
+
+		return matchCode < 15 || writeLength(op, end, matchCode - 15);
+	}
+
+	// Reads a length continuation, returning false if it runs off the end of the input.
+	bool readLength(const unsigned char*& ip, const unsigned char* end, size_t& length)
+	{
+		unsigned char byte;
+		do
+		{
+			if (ip >= end)
+				return false;
+
+			byte = *ip++;
+			length += byte;
+		} while (byte == 255);
+
+		return true;
+	}
+}
+
+size_t LZ::compress(const void* source, size_t sourceBytes, void* destination, size_t destinationCapacity)
+{
+	const unsigned char* src = static_cast<const unsigned char*>(source);
+	unsigned char* op = static_cast<unsigned char*>(destination);
+	const unsigned char* opEnd = op + destinationCapacity;
+
+	size_t anchor = 0;
+
+	if (sourceBytes > MatchSearchLimit)
+	{
+		// Positions are stored plus one so an empty slot is never mistaken for a match at the start of the block.
+		std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+		const size_t searchEnd = sourceBytes - MatchSearchLimit;
+		const size_t matchEnd = sourceBytes - LastLiterals;
+		size_t ip = 0;
+		unsigned misses = 0;
+
+		while (ip < searchEnd)
+		{
+			uint32_t sequence = read32(src + ip);
+			uint32_t& slot = table[hash(sequence)];
+			size_t candidate = size_t(slot);
+			slot = uint32_t(ip + 1);
+
+			if (candidate == 0 || ip - (candidate - 1) > MaxOffset || read32(src + candidate - 1) != sequence)
+			{
+				// Skip faster through data that isnt compressing.
+				ip += 1 + (misses++ >> 6);
+				continue;
+			}
+
+			size_t reference = candidate - 1;
+			size_t length = MinMatch;
+			while (ip + length < matchEnd && src[reference + length] == src[ip + length])
+				length++;
+
+			if (!writeSequence(op, opEnd, src + anchor, ip - anchor, ip - reference, length))
+				return 0;
+
+			ip += length;
+			anchor = ip;
+			misses = 0;
+		}
+	}
+
+	if (!writeSequence(op, opEnd, src + anchor, sourceBytes - anchor, 0, 0))
+		return 0;
+
+	return size_t(op - static_cast<unsigned char*>(destination));
+}
+
+bool LZ::decompress(const void* source, size_t sourceBytes, void* destination, size_t destinationBytes)
+{
+	const unsigned char* ip = static_cast<const unsigned char*>(source);
+	const unsigned char* ipEnd = ip + sourceBytes;
+	unsigned char* out = static_cast<unsigned char*>(destination);
+	size_t op = 0;
+
+	while (ip < ipEnd)
+	{
+		unsigned char token = *ip++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(ip, ipEnd, literalLength))
+			return false;
+
+		if (size_t(ipEnd - ip) < literalLength || destinationBytes - op < literalLength)
+			return false;
+
+		memcpy(out + op, ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// The final sequence has no match.
+		if (ip == ipEnd)
+			break;
+
+		if (ipEnd - ip < 2)
+			return false;
+
+		size_t offset = size_t(ip[0]) | (size_t(ip[1]) << 8);
+		ip += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(ip, ipEnd, matchLength))
+			return false;
+
+		matchLength += MinMatch;
+
+		if (offset == 0 || offset > op || destinationBytes - op < matchLength)
+			return false;
+
+		// Matches can overlap the bytes they produce, so copy forwards a byte at a time when they do.
+		unsigned char* match = out + op - offset;
+		if (offset >= matchLength)
+		{
+			memcpy(out + op, match, matchLength);
+		}
+		else
+		{
+			for (size_t i = 0; i < matchLength; ++i)
+				out[op + i] = match[i];
+		}
+
+		op += matchLength;
+	}
+
+	return op == destinationBytes;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+// Fast byte oriented LZ77 compressor producing the LZ4 block format.
+// Blocks are self contained, nothing is shared between calls, so blocks can be compressed on any thread.
+class LZ
+{
+public:
+
+	// Returns the largest size a block of the passed in bytes can compress to.
+	static size_t compressBound(size_t bytes) { return bytes + bytes / 255 + 16; }
+
+	// Compresses sourceBytes from source into destination. Returns the compressed size, or zero if it did not fit the capacity.
+	static size_t compress(const void* source, size_t sourceBytes, void* destination, size_t destinationCapacity);
+
+	// Decompresses a block into destination. Returns false if the block is malformed or does not decode to exactly destinationBytes.
+	static bool decompress(const void* source, size_t sourceBytes, void* destination, size_t destinationBytes);
+};
@@ -0,0 +1,712 @@
+#include "Wavelet.h"
+#include "Utility/Threading/ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <mutex>
+
+namespace
+{
+	// Largest quantised magnitude, leaves headroom for the growth of the transform inside 32 bits.
+	const int QuantLimit = 1 << 22;
+
+	// Largest exponent a coefficient magnitude can have.
+	const int MaxExponent = 30;
+
+	// Bits of precision in the adaptive probabilities and how fast they adapt.
+	const int ProbabilityBits = 11;
+	const int AdaptShift = 5;
+
+	// Contexts for the zero flag, indexed by the magnitude class of the coefficient before it.
+	const int NeighbourClasses = 3;
+
+	// Unary exponent bits past this share a context.
+	const int ExponentContexts = 20;
+
+	const int BandCount = Wavelet::MaxLevels + 1;
+
+	// Adaptive probabilities for the coefficients of one block, split by wavelet band.
+	struct CoefficientModel
+	{
+		CoefficientModel()
+		{
+			uint16_t* all[] = { &zero[0][0], &sign[0], &exponent[0][0] };
+			size_t counts[] = { sizeof(zero) / sizeof(uint16_t), sizeof(sign) / sizeof(uint16_t), sizeof(exponent) / sizeof(uint16_t) };
+			for (int i = 0; i < 3; ++i)
+				std::fill(all[i], all[i] + counts[i], uint16_t(1 << (ProbabilityBits - 1)));
+		}
+
+		uint16_t zero[BandCount][NeighbourClasses];
+		uint16_t sign[BandCount];
+		uint16_t exponent[BandCount][ExponentContexts];
+	};
+
+	// Binary range coder in the style of LZMA.
+	class RangeEncoder
+	{
+	public:
+		RangeEncoder(std::vector<unsigned char>& output) : out(output) {}
+
+		void encodeBit(uint16_t& probability, int bit)
+		{
+			uint32_t bound = (range >> ProbabilityBits) * probability;
+			if (bit == 0)
+			{
+				range = bound;
+				probability = uint16_t(probability + (((1 << ProbabilityBits) - probability) >> AdaptShift));
+			}
+			else
+			{
+				low += bound;
+				range -= bound;
+				probability = uint16_t(probability - (probability >> AdaptShift));
+			}
+
+			normalise();
+		}
+
+		// Writes bits with an even chance of either value, most significant first.
+		void encodeDirect(uint32_t value, int bits)
+		{
+			for (int i = bits - 1; i >= 0; --i)
+			{
+				range >>= 1;
+				if ((value >> i) & 1)
+					low += range;
+
+				normalise();
+			}
+		}
+
+		void flush()
+		{
+			for (int i = 0; i < 5; ++i)
+				shiftLow();
+		}
+
+	private:
+		void normalise()
+		{
+			while (range < (1u << 24))
+			{
+				range <<= 8;
+				shiftLow();
+			}
+		}
+
+		// Moves the top byte of low to the output, holding back 0xFF bytes until a carry can no longer reach them.
+		void shiftLow()
+		{
+			if (uint32_t(low) < 0xFF000000u || (low >> 32) != 0)
+			{
+				unsigned char carry = (unsigned char)(low >> 32);
+				unsigned char pending = cache;
+				do
+				{
+					out.push_back((unsigned char)(pending + carry));
+					pending = 0xFF;
+				} while (--cacheSize != 0);
+
+				cache = (unsigned char)(low >> 24);
+			}
+
+			cacheSize++;
+			low = (low & 0x00FFFFFFu) << 8;
+		}
+
+		std::vector<unsigned char>& out;
+		uint64_t low = 0;
+		uint32_t range = 0xFFFFFFFFu;
+		unsigned char cache = 0;
+		uint64_t cacheSize = 1;
+	};
+
+	class RangeDecoder
+	{
+	public:
+		RangeDecoder(const unsigned char* input, size_t inputBytes) : in(input), size(inputBytes)
+		{
+			for (int i = 0; i < 5; ++i)
+				code = (code << 8) | nextByte();
+		}
+
+		int decodeBit(uint16_t& probability)
+		{
+			uint32_t bound = (range >> ProbabilityBits) * probability;
+			int bit;
+			if (code < bound)
+			{
+				range = bound;
+				probability = uint16_t(probability + (((1 << ProbabilityBits) - probability) >> AdaptShift));
+				bit = 0;
+			}
+			else
+			{
+				code -= bound;
+				range -= bound;
+				probability = uint16_t(probability - (probability >> AdaptShift));
+				bit = 1;
+			}
+
+			normalise();
+			return bit;
+		}
+
+		uint32_t decodeDirect(int bits)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < bits; ++i)
+			{
+				range >>= 1;
+				uint32_t bit = code >= range ? 1 : 0;
+				if (bit)
+					code -= range;
+
+				value = (value << 1) | bit;
+				normalise();
+			}
+
+			return value;
+		}
+
+		// Returns whether the decoder read past the end of its input.
+		bool isOverrun() { return overrun; }
+
+	private:
+		void normalise()
+		{
+			while (range < (1u << 24))
+			{
+				range <<= 8;
+				code = (code << 8) | nextByte();
+			}
+		}
+
+		uint32_t nextByte()
+		{
+			if (position >= size)
+			{
+				overrun = true;
+				return 0;
+			}
+
+			return in[position++];
+		}
+
+		const unsigned char* in;
+		size_t size;
+		size_t position = 0;
+		uint32_t code = 0;
+		uint32_t range = 0xFFFFFFFFu;
+		bool overrun = false;
+	};
+
+	// Position and extent of one block of the volume.
+	struct Block
+	{
+		Block(int index, int width, int height, int depth)
+		{
+			int blocksX = (width + Wavelet::BlockSize - 1) / Wavelet::BlockSize;
+			int blocksY = (height + Wavelet::BlockSize - 1) / Wavelet::BlockSize;
+
+			x0 = (index % blocksX) * Wavelet::BlockSize;
+			y0 = ((index / blocksX) % blocksY) * Wavelet::BlockSize;
+			z0 = (index / (blocksX * blocksY)) * Wavelet::BlockSize;
+
+			sizeX = std::min<int>(int(Wavelet::BlockSize), width - x0);
+			sizeY = std::min<int>(int(Wavelet::BlockSize), height - y0);
+			sizeZ = std::min<int>(int(Wavelet::BlockSize), depth - z0);
+		}
+
+		int x0, y0, z0;
+		int sizeX, sizeY, sizeZ;
+	};
+
+	int getDepth(int width, int height, int count)
+	{
+		return int((int64_t(count) + int64_t(width) * height - 1) / (int64_t(width) * height));
+	}
+
+	int getBlockCount(int width, int height, int count)
+	{
+		int blocks = 1;
+		for (int side : { width, height, getDepth(width, height, count) })
+			blocks *= (side + Wavelet::BlockSize - 1) / Wavelet::BlockSize;
+
+		return blocks;
+	}
+
+	// One level of the reversible CDF 5/3 lifting along a line, lows are written first and highs after.
+	// The signal is mirrored at both ends. Sums are widened so corrupt streams cannot overflow.
+	void forwardLine(int32_t* line, int length, ptrdiff_t stride, int32_t* scratch)
+	{
+		const int lows = (length + 1) / 2;
+		const int highs = length / 2;
+		int32_t* low = scratch;
+		int32_t* high = scratch + lows;
+
+		for (int n = 0; n < highs; ++n)
+		{
+			int64_t left = line[stride * 2 * n];
+			int64_t right = (2 * n + 2 < length) ? line[stride * (2 * n + 2)] : left;
+			high[n] = int32_t(line[stride * (2 * n + 1)] - ((left + right) >> 1));
+		}
+
+		for (int n = 0; n < lows; ++n)
+		{
+			int64_t left = high[std::max<int>(n - 1, 0)];
+			int64_t right = high[std::min<int>(n, highs - 1)];
+			low[n] = int32_t(line[stride * 2 * n] + ((left + right + 2) >> 2));
+		}
+
+		for (int i = 0; i < length; ++i)
+			line[stride * i] = scratch[i];
+	}
+
+	// Reverses forwardLine exactly.
+	void inverseLine(int32_t* line, int length, ptrdiff_t stride, int32_t* scratch)
+	{
+		const int lows = (length + 1) / 2;
+		const int highs = length / 2;
+
+		for (int i = 0; i < length; ++i)
+			scratch[length + i] = line[stride * i];
+
+		const int32_t* low = scratch + length;
+		const int32_t* high = scratch + length + lows;
+		int32_t* signal = scratch;
+
+		for (int n = 0; n < lows; ++n)
+		{
+			int64_t left = high[std::max<int>(n - 1, 0)];
+			int64_t right = high[std::min<int>(n, highs - 1)];
+			signal[2 * n] = int32_t(low[n] - ((left + right + 2) >> 2));
+		}
+
+		for (int n = 0; n < highs; ++n)
+		{
+			int64_t left = signal[2 * n];
+			int64_t right = (2 * n + 2 < length) ? signal[2 * n + 2] : left;
+			signal[2 * n + 1] = int32_t(high[n] + ((left + right) >> 1));
+		}
+
+		for (int i = 0; i < length; ++i)
+			line[stride * i] = signal[i];
+	}
+
+	// Sizes of the low band of a block after each level, index 0 is the whole block.
+	struct LevelSizes
+	{
+		LevelSizes(int sizeX, int sizeY, int sizeZ)
+		{
+			x[0] = sizeX;
+			y[0] = sizeY;
+			z[0] = sizeZ;
+
+			levels = 0;
+			while (levels < Wavelet::MaxLevels && (x[levels] > 1 || y[levels] > 1 || z[levels] > 1))
+			{
+				x[levels + 1] = (x[levels] + 1) / 2;
+				y[levels + 1] = (y[levels] + 1) / 2;
+				z[levels + 1] = (z[levels] + 1) / 2;
+				levels++;
+			}
+		}
+
+		// Returns how many levels a coordinate stays in the low band for.
+		static int depthOf(const int* sizes, int levels, int coordinate)
+		{
+			int level = 0;
+			while (level < levels && coordinate < sizes[level + 1])
+				level++;
+
+			return level;
+		}
+
+		int x[Wavelet::MaxLevels + 1];
+		int y[Wavelet::MaxLevels + 1];
+		int z[Wavelet::MaxLevels + 1];
+		int levels;
+	};
+
+	// Runs every level of the transform over a block of coefficients, x fastest.
+	void transformBlock(int32_t* coefficients, const LevelSizes& sizes, bool inverse, std::vector<int32_t>& scratch)
+	{
+		const int sizeX = sizes.x[0];
+		const int sizeY = sizes.y[0];
+		const ptrdiff_t strideY = sizeX;
+		const ptrdiff_t strideZ = ptrdiff_t(sizeX) * sizeY;
+
+		scratch.resize(2 * size_t(std::max<int>(sizeX, std::max<int>(sizeY, sizes.z[0]))));
+
+		for (int step = 0; step < sizes.levels; ++step)
+		{
+			// The inverse undoes the coarsest level first.
+			int level = inverse ? sizes.levels - 1 - step : step;
+			int lx = sizes.x[level];
+			int ly = sizes.y[level];
+			int lz = sizes.z[level];
+
+			auto line = inverse ? inverseLine : forwardLine;
+			auto axisX = [&]() { if (lx > 1) for (int z = 0; z < lz; ++z) for (int y = 0; y < ly; ++y) line(coefficients + z * strideZ + y * strideY, lx, 1, scratch.data()); };
+			auto axisY = [&]() { if (ly > 1) for (int z = 0; z < lz; ++z) for (int x = 0; x < lx; ++x) line(coefficients + z * strideZ + x, ly, strideY, scratch.data()); };
+			auto axisZ = [&]() { if (lz > 1) for (int y = 0; y < ly; ++y) for (int x = 0; x < lx; ++x) line(coefficients + y * strideY + x, lz, strideZ, scratch.data()); };
+
+			if (inverse)
+			{
+				axisZ();
+				axisY();
+				axisX();
+			}
+			else
+			{
+				axisX();
+				axisY();
+				axisZ();
+			}
+		}
+	}
+
+	// Returns the magnitude class of a coefficient used as context for the one after it.
+	int neighbourClass(int32_t coefficient)
+	{
+		uint32_t magnitude = coefficient < 0 ? uint32_t(0) - uint32_t(coefficient) : uint32_t(coefficient);
+		return magnitude == 0 ? 0 : (magnitude == 1 ? 1 : 2);
+	}
+
+	// Returns the position of the highest set bit.
+	int highestBit(uint32_t value)
+	{
+		int bit = 0;
+		while (value >>= 1)
+			bit++;
+
+		return bit;
+	}
+
+	// Calls the passed in function with the band of every coefficient of a block in storage order.
+	template<typename CoefficientFunction>
+	void forEachCoefficient(const LevelSizes& sizes, CoefficientFunction function)
+	{
+		int index = 0;
+		for (int z = 0; z < sizes.z[0]; ++z)
+		{
+			int bandZ = LevelSizes::depthOf(sizes.z, sizes.levels, z);
+			for (int y = 0; y < sizes.y[0]; ++y)
+			{
+				int bandZY = std::min<int>(bandZ, LevelSizes::depthOf(sizes.y, sizes.levels, y));
+				for (int x = 0; x < sizes.x[0]; ++x)
+				{
+					function(index++, std::min<int>(bandZY, LevelSizes::depthOf(sizes.x, sizes.levels, x)));
+				}
+			}
+		}
+	}
+
+	void encodeCoefficients(const int32_t* coefficients, const LevelSizes& sizes, std::vector<unsigned char>& output)
+	{
+		CoefficientModel model;
+		RangeEncoder encoder(output);
+		int previous = 0;
+
+		forEachCoefficient(sizes, [&](int index, int band)
+		{
+			int32_t coefficient = coefficients[index];
+			encoder.encodeBit(model.zero[band][previous], coefficient != 0);
+			previous = neighbourClass(coefficient);
+
+			if (coefficient == 0)
+				return;
+
+			encoder.encodeBit(model.sign[band], coefficient < 0);
+
+			// Exp-Golomb: the exponent in adaptive unary, then the bits below the leading one as they are.
+			uint32_t magnitude = coefficient < 0 ? uint32_t(0) - uint32_t(coefficient) : uint32_t(coefficient);
+			int exponent = highestBit(magnitude);
+			for (int i = 0; i < exponent; ++i)
+				encoder.encodeBit(model.exponent[band][std::min<int>(i, ExponentContexts - 1)], 1);
+
+			if (exponent < MaxExponent)
+				encoder.encodeBit(model.exponent[band][std::min<int>(exponent, ExponentContexts - 1)], 0);
+
+			encoder.encodeDirect(magnitude, exponent);
+		});
+
+		encoder.flush();
+	}
+
+	bool decodeCoefficients(const unsigned char* input, size_t inputBytes, const LevelSizes& sizes, int32_t* coefficients)
+	{
+		CoefficientModel model;
+		RangeDecoder decoder(input, inputBytes);
+		int previous = 0;
+
+		forEachCoefficient(sizes, [&](int index, int band)
+		{
+			if (!decoder.decodeBit(model.zero[band][previous]))
+			{
+				coefficients[index] = 0;
+				previous = 0;
+				return;
+			}
+
+			bool negative = decoder.decodeBit(model.sign[band]) != 0;
+
+			int exponent = 0;
+			while (exponent < MaxExponent && decoder.decodeBit(model.exponent[band][std::min<int>(exponent, ExponentContexts - 1)]))
+				exponent++;
+
+			uint32_t magnitude = (1u << exponent) | decoder.decodeDirect(exponent);
+			coefficients[index] = negative ? -int32_t(magnitude) : int32_t(magnitude);
+			previous = neighbourClass(coefficients[index]);
+		});
+
+		return !decoder.isOverrun();
+	}
+
+	// Runs the body over [begin, end) on the pool, or inline without one.
+	void runBlocks(ThreadPool* pool, int blockCount, const std::function<void(int, int)>& body)
+	{
+		if (pool != nullptr)
+			pool->parallelFor(0, blockCount, body);
+		else
+			body(0, blockCount);
+	}
+
+	float getLargestMagnitude(const float* values, int count)
+	{
+		float largest = 0.0f;
+		for (int i = 0; i < count; ++i)
+		{
+			if (std::isfinite(values[i]))
+				largest = std::max<float>(largest, std::fabs(values[i]));
+		}
+
+		return largest;
+	}
+}
+
+size_t Wavelet::compressBound(size_t count)
+{
+	// Worst case every coefficient needs its zero flag, sign, a full unary exponent and as many direct bits.
+	size_t blocks = count / (size_t(BlockSize) * BlockSize) + 8;
+	return sizeof(StreamHeader) + blocks * (sizeof(uint32_t) + 16) + count * 9;
+}
+
+void Wavelet::encodeBlocks(const float* values, int width, int height, int count, float step, std::vector<std::vector<unsigned char>>& blocks, ThreadPool* pool)
+{
+	const int depth = getDepth(width, height, count);
+	const double inverseStep = 1.0 / double(step);
+
+	blocks.resize(size_t(getBlockCount(width, height, count)));
+
+	runBlocks(pool, int(blocks.size()), [&](int begin, int end)
+	{
+		std::vector<int32_t> coefficients;
+		std::vector<int32_t> scratch;
+
+		for (int b = begin; b < end; ++b)
+		{
+			Block block(b, width, height, depth);
+			LevelSizes sizes(block.sizeX, block.sizeY, block.sizeZ);
+			coefficients.resize(size_t(block.sizeX) * block.sizeY * block.sizeZ);
+
+			// Quantising first bounds the error, the integer transform after it is lossless.
+			int32_t* coefficient = coefficients.data();
+			for (int z = 0; z < block.sizeZ; ++z)
+			{
+				for (int y = 0; y < block.sizeY; ++y)
+				{
+					int64_t row = int64_t(width) * height * (block.z0 + z) + int64_t(width) * (block.y0 + y) + block.x0;
+					for (int x = 0; x < block.sizeX; ++x)
+					{
+						int64_t index = row + x;
+						float value = (index < count) ? values[index] : 0.0f;
+						double quantised = std::isfinite(value) ? std::nearbyint(double(value) * inverseStep) : 0.0;
+						*coefficient++ = int32_t(std::max<double>(-QuantLimit, std::min<double>(QuantLimit, quantised)));
+					}
+				}
+			}
+
+			transformBlock(coefficients.data(), sizes, false, scratch);
+
+			blocks[b].clear();
+			encodeCoefficients(coefficients.data(), sizes, blocks[b]);
+		}
+	});
+}
+
+size_t Wavelet::writeStream(int width, int height, int count, float step, const std::vector<std::vector<unsigned char>>& blocks, void* destination, size_t capacity)
+{
+	StreamHeader header = {};
+	header.magic = Magic;
+	header.width = width;
+	header.height = height;
+	header.count = count;
+	header.step = step;
+	header.blockSize = BlockSize;
+	header.blockCount = uint32_t(blocks.size());
+
+	size_t total = sizeof(header) + blocks.size() * sizeof(uint32_t);
+	for (const std::vector<unsigned char>& block : blocks)
+		total += block.size();
+
+	if (total > capacity)
+		return 0;
+
+	unsigned char* out = static_cast<unsigned char*>(destination);
+	memcpy(out, &header, sizeof(header));
+	out += sizeof(header);
+
+	for (const std::vector<unsigned char>& block : blocks)
+	{
+		uint32_t bytes = uint32_t(block.size());
+		memcpy(out, &bytes, sizeof(bytes));
+		out += sizeof(bytes);
+	}
+
+	for (const std::vector<unsigned char>& block : blocks)
+	{
+		memcpy(out, block.data(), block.size());
+		out += block.size();
+	}
+
+	return total;
+}
+
+size_t Wavelet::compress(const float* values, int width, int height, int count, const WaveletSettings& settings, void* destination, size_t capacity, ThreadPool* pool)
+{
+	if (width <= 0 || height <= 0 || count <= 0)
+		return 0;
+
+	// The finest step keeps every quantised value inside the limit the transform has room for.
+	const float largest = getLargestMagnitude(values, count);
+	const float finestStep = std::max<float>(largest / float(QuantLimit), std::numeric_limits<float>::min());
+
+	std::vector<std::vector<unsigned char>> blocks;
+
+	if (settings.bitsPerValue <= 0.0f)
+	{
+		float step = std::max<float>(2.0f * settings.maxError, finestStep);
+		encodeBlocks(values, width, height, count, step, blocks, pool);
+		return writeStream(width, height, count, step, blocks, destination, capacity);
+	}
+
+	// Search for the finest step that meets the rate, the size falls as the step grows.
+	const size_t targetBytes = size_t(double(settings.bitsPerValue) * double(count) / 8.0);
+	auto encodedBytes = [&](float step)
+	{
+		encodeBlocks(values, width, height, count, step, blocks, pool);
+
+		size_t total = sizeof(StreamHeader) + blocks.size() * sizeof(uint32_t);
+		for (const std::vector<unsigned char>& block : blocks)
+			total += block.size();
+
+		return total;
+	};
+
+	double fine = std::log2(double(finestStep));
+	double coarse = std::log2(std::max<double>(2.0 * double(largest), double(finestStep))) + 1.0;
+
+	if (encodedBytes(finestStep) <= targetBytes)
+		return writeStream(width, height, count, finestStep, blocks, destination, capacity);
+
+	for (int i = 0; i < 12; ++i)
+	{
+		double middle = 0.5 * (fine + coarse);
+		if (encodedBytes(float(std::exp2(middle))) <= targetBytes)
+			coarse = middle;
+		else
+			fine = middle;
+	}
+
+	float step = float(std::exp2(coarse));
+	encodeBlocks(values, width, height, count, step, blocks, pool);
+	return writeStream(width, height, count, step, blocks, destination, capacity);
+}
+
+bool Wavelet::decompress(const void* source, size_t sourceBytes, float* values, int width, int height, int count, ThreadPool* pool)
+{
+	StreamHeader header;
+	if (sourceBytes < sizeof(header))
+		return false;
+
+	memcpy(&header, source, sizeof(header));
+
+	const int blockCount = (width > 0 && height > 0 && count > 0) ? getBlockCount(width, height, count) : 0;
+	if (header.magic != Magic || header.width != width || header.height != height || header.count != count || header.blockSize != uint32_t(BlockSize) ||
+		header.blockCount != uint32_t(blockCount) || blockCount == 0 || !(header.step > 0.0f) || !std::isfinite(header.step))
+		return false;
+
+	const unsigned char* bytes = static_cast<const unsigned char*>(source);
+	if (sourceBytes - sizeof(header) < size_t(blockCount) * sizeof(uint32_t))
+		return false;
+
+	// Every block decodes on its own, so work out where each one starts before splitting them across threads.
+	std::vector<size_t> offsets(size_t(blockCount) + 1);
+	offsets[0] = sizeof(header) + size_t(blockCount) * sizeof(uint32_t);
+	for (int b = 0; b < blockCount; ++b)
+	{
+		uint32_t blockBytes;
+		memcpy(&blockBytes, bytes + sizeof(header) + size_t(b) * sizeof(uint32_t), sizeof(blockBytes));
+		offsets[b + 1] = offsets[b] + blockBytes;
+
+		if (offsets[b + 1] > sourceBytes)
+			return false;
+	}
+
+	const int depth = getDepth(width, height, count);
+	const double step = double(header.step);
+	bool corrupt = false;
+	std::mutex corruptMutex;
+
+	runBlocks(pool, blockCount, [&](int begin, int end)
+	{
+		std::vector<int32_t> coefficients;
+		std::vector<int32_t> scratch;
+
+		for (int b = begin; b < end; ++b)
+		{
+			Block block(b, width, height, depth);
+			LevelSizes sizes(block.sizeX, block.sizeY, block.sizeZ);
+			coefficients.resize(size_t(block.sizeX) * block.sizeY * block.sizeZ);
+
+			if (!decodeCoefficients(bytes + offsets[b], offsets[b + 1] - offsets[b], sizes, coefficients.data()))
+			{
+				std::lock_guard<std::mutex> lock(corruptMutex);
+				corrupt = true;
+				return;
+			}
+
+			transformBlock(coefficients.data(), sizes, true, scratch);
+
+			const int32_t* coefficient = coefficients.data();
+			for (int z = 0; z < block.sizeZ; ++z)
+			{
+				for (int y = 0; y < block.sizeY; ++y)
+				{
+					int64_t row = int64_t(width) * height * (block.z0 + z) + int64_t(width) * (block.y0 + y) + block.x0;
+					for (int x = 0; x < block.sizeX; ++x, ++coefficient)
+					{
+						if (row + x < count)
+							values[row + x] = float(double(*coefficient) * step);
+					}
+				}
+			}
+		}
+	});
+
+	return !corrupt;
+}
+
+float Wavelet::getErrorBound(const void* source, size_t sourceBytes)
+{
+	StreamHeader header;
+	if (sourceBytes < sizeof(header))
+		return -1.0f;
+
+	memcpy(&header, source, sizeof(header));
+	return header.magic == Magic ? header.step * 0.5f : -1.0f;
+}
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// What the lossy wavelet codec aims for.
+struct WaveletSettings
+{
+	float maxError = 0.001f;		// Largest absolute difference between a value and its decoded value.
+	float bitsPerValue = 0.0f;		// When above zero the smallest error bound that fits this rate is searched for instead.
+};
+
+// Lossy compressor for float volumes with a guaranteed maximum absolute error.
+// Values are quantised to the error bound first and then decorrelated with the reversible integer CDF 5/3 wavelet,
+// so the transform adds no error of its own. Coefficients are written with an adaptive binary range coder.
+// The volume is split into independent blocks which are encoded and decoded in parallel.
+class Wavelet
+{
+public:
+	static const uint32_t Magic = 0x544C5657; // "WVLT"
+
+	// Width of the cubic blocks the volume is coded in.
+	static const int BlockSize = 32;
+
+	// Most wavelet levels applied to a block.
+	static const int MaxLevels = 4;
+
+	// Returns the largest size count values can compress to.
+	static size_t compressBound(size_t count);
+
+	// Compresses count values laid out as a volume width wide and height high, as deep as the values reach.
+	// Returns the compressed size, or zero if it did not fit the capacity. Error bounds too fine for the range of the values are raised to the
+	// finest the coder can hold, about 2^-23 of the largest magnitude. Non finite values are stored as zero.
+	static size_t compress(const float* values, int width, int height, int count, const WaveletSettings& settings, void* destination, size_t capacity,
+		ThreadPool* pool = nullptr);
+
+	// Decompresses into exactly count values. Returns false if the stream is malformed or describes a different volume.
+	static bool decompress(const void* source, size_t sourceBytes, float* values, int width, int height, int count, ThreadPool* pool = nullptr);
+
+	// Returns the error bound a compressed stream was written with, or a negative value if it is not a stream.
+	static float getErrorBound(const void* source, size_t sourceBytes);
+
+private:
+
+	// Fixed size header in front of the block size table.
+	struct StreamHeader
+	{
+		uint32_t magic;
+		int32_t width;
+		int32_t height;
+		int32_t count;
+		float step;					// Quantisation step, twice the error bound.
+		uint32_t blockSize;
+		uint32_t blockCount;
+		uint32_t reserved;
+	};
+
+	// Quantises and codes every block with the passed in step into its own buffer.
+	static void encodeBlocks(const float* values, int width, int height, int count, float step, std::vector<std::vector<unsigned char>>& blocks, ThreadPool* pool);
+
+	// Joins the coded blocks behind a header and size table. Returns the written size, or zero if it did not fit.
+	static size_t writeStream(int width, int height, int count, float step, const std::vector<std::vector<unsigned char>>& blocks, void* destination, size_t capacity);
+};
@@ -0,0 +1,205 @@
+#include "IniFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	std::string trim(const std::string& text)
+	{
+		size_t begin = 0;
+		size_t end = text.size();
+
+		while (begin < end && isspace((unsigned char)text[begin]))
+			begin++;
+
+		while (end > begin && isspace((unsigned char)text[end - 1]))
+			end--;
+
+		return text.substr(begin, end - begin);
+	}
+
+	std::string toLower(std::string text)
+	{
+		std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return char(tolower(c)); });
+		return text;
+	}
+}
+
+const IniValue* IniSection::find(const std::string& key) const
+{
+	for (const IniValue& value : values)
+	{
+		if (value.key == key)
+			return &value;
+	}
+
+	return nullptr;
+}
+
+bool IniFile::load(const std::string& path, std::string* error)
+{
+	FILE* file = fopen(path.c_str(), "rb");
+	if (file == nullptr)
+	{
+		if (error != nullptr)
+			*error = "Could not open " + path;
+
+		return false;
+	}
+
+	std::string text;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		text.append(buffer, read);
+
+	fclose(file);
+	return parse(text, path, error);
+}
+
+bool IniFile::parse(const std::string& text, const std::string& sourceName, std::string* error)
+{
+	source = sourceName;
+	sections.clear();
+
+	// Editors on Windows like to start UTF-8 files with a byte order mark.
+	size_t start = (text.compare(0, 3, "\xEF\xBB\xBF") == 0) ? 3 : 0;
+
+	std::istringstream stream(text.substr(start));
+	std::string rawLine;
+	int lineNumber = 0;
+
+	auto fail = [&](const std::string& problem)
+	{
+		if (error != nullptr)
+			*error = describe(lineNumber, problem);
+
+		sections.clear();
+		return false;
+	};
+
+	while (std::getline(stream, rawLine))
+	{
+		lineNumber++;
+		std::string line = trim(rawLine);
+
+		if (line.empty() || line[0] == ';' || line[0] == '#')
+			continue;
+
+		if (line[0] == '[')
+		{
+			if (line.back() != ']')
+				return fail("section header is missing its closing ']'");
+
+			std::string name = trim(line.substr(1, line.size() - 2));
+			if (name.empty())
+				return fail("section has no name");
+
+			sections.push_back({ name, lineNumber, {} });
+			continue;
+		}
+
+		size_t equals = line.find('=');
+		if (equals == std::string::npos)
+			return fail("expected 'key = value'");
+
+		if (sections.empty())
+			return fail("value is outside of any section");
+
+		std::string key = trim(line.substr(0, equals));
+		std::string value = trim(line.substr(equals + 1));
+
+		if (key.empty())
+			return fail("value has no key");
+
+		if (value.size() >= 2 && value.front() == '"' && value.back() == '"')
+			value = value.substr(1, value.size() - 2);
+
+		IniSection& section = sections.back();
+		if (section.find(key) != nullptr)
+			return fail("'" + key + "' is set twice in [" + section.name + "]");
+
+		section.values.push_back({ key, value, lineNumber });
+	}
+
+	return true;
+}
+
+std::string IniFile::describe(int line, const std::string& problem) const
+{
+	return source + ":" + std::to_string(line) + ": " + problem;
+}
+
+bool IniFile::parseInt(const std::string& text, int& value)
+{
+	if (text.empty())
+		return false;
+
+	errno = 0;
+	char* end = nullptr;
+	long parsed = strtol(text.c_str(), &end, 10);
+
+	if (errno != 0 || *end != '\0' || parsed < INT32_MIN || parsed > INT32_MAX)
+		return false;
+
+	value = int(parsed);
+	return true;
+}
+
+bool IniFile::parseFloat(const std::string& text, float& value)
+{
+	if (text.empty())
+		return false;
+
+	char* end = nullptr;
+	float parsed = strtof(text.c_str(), &end);
+
+	if (*end != '\0' || !std::isfinite(parsed))
+		return false;
+
+	value = parsed;
+	return true;
+}
+
+bool IniFile::parseBool(const std::string& text, bool& value)
+{
+	std::string lower = toLower(text);
+
+	if (lower == "true" || lower == "yes" || lower == "on" || lower == "1")
+		value = true;
+	else if (lower == "false" || lower == "no" || lower == "off" || lower == "0")
+		value = false;
+	else
+		return false;
+
+	return true;
+}
+
+bool IniFile::parseFloat3(const std::string& text, float values[3])
+{
+	std::string spaced = text;
+	std::replace(spaced.begin(), spaced.end(), ',', ' ');
+
+	std::istringstream stream(spaced);
+	std::string parts[3];
+	std::string extra;
+
+	if (!(stream >> parts[0] >> parts[1] >> parts[2]) || (stream >> extra))
+		return false;
+
+	float parsed[3];
+	for (int i = 0; i < 3; ++i)
+	{
+		if (!parseFloat(parts[i], parsed[i]))
+			return false;
+	}
+
+	std::copy(parsed, parsed + 3, values);
+	return true;
+}
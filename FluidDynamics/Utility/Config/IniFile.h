@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// A key and its value as written in an INI file.
+struct IniValue
+{
+	std::string key;
+	std::string value;
+	int line;
+};
+
+// One [section] of an INI file and the values under it, in file order.
+struct IniSection
+{
+	std::string name;
+	int line;
+	std::vector<IniValue> values;
+
+	// Returns the value with the passed in key, nullptr if the section does not set it.
+	const IniValue* find(const std::string& key) const;
+};
+
+// Sections of key value pairs read from an INI file.
+// Sections open with "[name]", values are "key = value" and lines starting with ';' or '#' are comments. Values may be quoted to keep
+// surrounding spaces. Sections may repeat, every occurrence is kept separately so a file can describe lists such as emitters.
+class IniFile
+{
+public:
+
+	// Reads and parses the passed in file. Returns false and describes the first problem if it could not be read or is malformed.
+	bool load(const std::string& path, std::string* error = nullptr);
+
+	// Parses INI text, naming problems after the passed in source. Returns false and describes the first problem if it is malformed.
+	bool parse(const std::string& text, const std::string& sourceName, std::string* error = nullptr);
+
+	// Returns every section in file order.
+	const std::vector<IniSection>& getSections() { return sections; }
+
+	// Returns the name problems are reported against, the path for loaded files.
+	const std::string& getSourceName() { return source; }
+
+	// Returns a problem prefixed with the source and line it was found on.
+	std::string describe(int line, const std::string& problem) const;
+
+	// Parses a whole decimal number. Returns false if the text is anything else.
+	static bool parseInt(const std::string& text, int& value);
+
+	// Parses a number. Returns false if the text is not one or is not finite.
+	static bool parseFloat(const std::string& text, float& value);
+
+	// Parses true/false, yes/no, on/off or 1/0.
+	static bool parseBool(const std::string& text, bool& value);
+
+	// Parses three numbers separated by commas or spaces.
+	static bool parseFloat3(const std::string& text, float values[3]);
+
+private:
+	std::string source;
+	std::vector<IniSection> sections;
+};
@@ -0,0 +1,138 @@
+#include "AtomicFile.h"
+#include <vector>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+AtomicFile::AtomicFile()
+{
+}
+
+AtomicFile::~AtomicFile()
+{
+	abort();
+}
+
+bool AtomicFile::open(const std::string& destination)
+{
+	abort();
+
+	destinationPath = destination;
+	temporaryPath = getTemporaryPath(destination);
+	position = 0;
+	failed = false;
+
+	file = fopen(temporaryPath.c_str(), "wb");
+	return file != nullptr;
+}
+
+bool AtomicFile::write(const void* bytes, size_t count)
+{
+	if (file == nullptr || failed)
+		return false;
+
+	if (count > 0 && fwrite(bytes, 1, count, file) != count)
+	{
+		failed = true;
+		return false;
+	}
+
+	position += count;
+	return true;
+}
+
+bool AtomicFile::writeAt(size_t offset, const void* bytes, size_t count)
+{
+	if (file == nullptr || failed)
+		return false;
+
+	if (offset + count > position)
+	{
+		failed = true;
+		return false;
+	}
+
+#ifdef _WIN32
+	bool seeked = _fseeki64(file, __int64(offset), SEEK_SET) == 0;
+#else
+	bool seeked = fseeko(file, off_t(offset), SEEK_SET) == 0;
+#endif
+
+	bool written = seeked && (count == 0 || fwrite(bytes, 1, count, file) == count);
+
+#ifdef _WIN32
+	bool returned = _fseeki64(file, 0, SEEK_END) == 0;
+#else
+	bool returned = fseeko(file, 0, SEEK_END) == 0;
+#endif
+
+	if (!written || !returned)
+	{
+		failed = true;
+		return false;
+	}
+
+	return true;
+}
+
+bool AtomicFile::pad(size_t alignment)
+{
+	size_t remainder = position % alignment;
+	if (remainder == 0)
+		return !failed;
+
+	std::vector<unsigned char> zeros(alignment - remainder, 0);
+	return write(zeros.data(), zeros.size());
+}
+
+bool AtomicFile::commit()
+{
+	if (file == nullptr)
+		return false;
+
+	// The data has to be on disk before the rename, otherwise a crash could leave the destination pointing at a partial file.
+	bool flushed = !failed && fflush(file) == 0;
+
+#ifdef _WIN32
+	flushed = flushed && FlushFileBuffers(HANDLE(_get_osfhandle(_fileno(file)))) != 0;
+#else
+	flushed = flushed && fsync(fileno(file)) == 0;
+#endif
+
+	bool closed = fclose(file) == 0;
+	file = nullptr;
+
+	if (!flushed || !closed)
+	{
+		remove(temporaryPath.c_str());
+		return false;
+	}
+
+#ifdef _WIN32
+	bool renamed = MoveFileExA(temporaryPath.c_str(), destinationPath.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = rename(temporaryPath.c_str(), destinationPath.c_str()) == 0;
+#endif
+
+	if (!renamed)
+		remove(temporaryPath.c_str());
+
+	return renamed;
+}
+
+void AtomicFile::abort()
+{
+	if (file != nullptr)
+	{
+		fclose(file);
+		file = nullptr;
+		remove(temporaryPath.c_str());
+	}
+
+	position = 0;
+	failed = false;
+}
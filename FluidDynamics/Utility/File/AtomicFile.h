@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+// Writes a file next to its destination and only moves it into place on commit.
+// A crash or failed write before commit leaves whatever was at the destination untouched.
+class AtomicFile
+{
+public:
+	AtomicFile();
+	~AtomicFile();
+
+	AtomicFile(const AtomicFile&) = delete;
+	AtomicFile& operator=(const AtomicFile&) = delete;
+
+	// Opens the temporary file for the passed in destination. Returns false if it could not be created.
+	bool open(const std::string& destination);
+
+	// Appends the passed in bytes. Returns false if the write failed, which also fails the commit.
+	bool write(const void* bytes, size_t count);
+
+	// Overwrites bytes already written at the passed in position, later writes still append.
+	bool writeAt(size_t offset, const void* bytes, size_t count);
+
+	// Appends zeros until the file size is a multiple of the passed in alignment.
+	bool pad(size_t alignment);
+
+	// Returns the number of bytes written so far.
+	size_t getPosition() { return position; }
+
+	// Flushes the temporary file to disk and renames it over the destination.
+	bool commit();
+
+	// Closes and deletes the temporary file, leaving the destination untouched.
+	void abort();
+
+	// Returns the path of the temporary file for the passed in destination.
+	static std::string getTemporaryPath(const std::string& destination) { return destination + ".tmp"; }
+
+private:
+	FILE* file = nullptr;
+	std::string destinationPath;
+	std::string temporaryPath;
+	size_t position = 0;
+	bool failed = false;
+};
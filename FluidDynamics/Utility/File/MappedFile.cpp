@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+MappedFile::MappedFile(MappedFile&& other)
+{
+	swap(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other)
+{
+	if (this != &other)
+	{
+		close();
+		swap(other);
+	}
+
+	return *this;
+}
+
+bool MappedFile::open(const std::string& filePath)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize = {};
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	// Copy on write so the simulation can step in place without modifying the file.
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* view = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	data = static_cast<unsigned char*>(view);
+	size = size_t(fileSize.QuadPart);
+#else
+	int file = ::open(filePath.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	// Private so the simulation can step in place without modifying the file, the descriptor isnt needed once mapped.
+	void* view = mmap(nullptr, size_t(fileStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	::close(file);
+
+	if (view == MAP_FAILED)
+		return false;
+
+	data = static_cast<unsigned char*>(view);
+	size = size_t(fileStat.st_size);
+#endif
+
+	path = filePath;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != nullptr)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		mappingHandle = nullptr;
+		fileHandle = nullptr;
+#else
+		munmap(data, size);
+#endif
+	}
+
+	data = nullptr;
+	size = 0;
+	path.clear();
+}
+
+void MappedFile::swap(MappedFile& other)
+{
+	std::swap(data, other.data);
+	std::swap(size, other.size);
+	std::swap(path, other.path);
+
+#ifdef _WIN32
+	std::swap(fileHandle, other.fileHandle);
+	std::swap(mappingHandle, other.mappingHandle);
+#endif
+}
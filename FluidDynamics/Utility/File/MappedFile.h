@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Read only view of a whole file mapped into memory.
+// Writes through the view are copy on write, they never reach the file on disk.
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other);
+	MappedFile& operator=(MappedFile&& other);
+
+	// Maps the passed in file, closing any previously mapped one. Returns false if the file could not be mapped.
+	bool open(const std::string& path);
+
+	// Unmaps the file.
+	void close();
+
+	// Returns whether a file is currently mapped.
+	bool isOpen() { return data != nullptr; }
+
+	// Returns the start of the mapping, aligned to the OS allocation granularity.
+	unsigned char* getData() { return data; }
+
+	// Returns the size of the mapped file in bytes.
+	size_t getSize() { return size; }
+
+	// Returns the path of the mapped file.
+	const std::string& getPath() { return path; }
+
+private:
+
+	// Exchanges mappings with another mapped file.
+	void swap(MappedFile& other);
+
+	unsigned char* data = nullptr;
+	size_t size = 0;
+	std::string path;
+
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
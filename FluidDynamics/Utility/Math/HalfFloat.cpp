@@ -0,0 +1,168 @@
+#include "HalfFloat.h"
+
+#if !defined(HALF_FLOAT_F16C) && !defined(__AVX512F__) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define HALF_FLOAT_F16C_DISPATCH 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace
+{
+#ifdef HALF_FLOAT_F16C_DISPATCH
+	// Builds default to SSE2, so the F16C loops are compiled for it on their own and only called once the CPU is known to have it.
+	// MSVC allows the intrinsics without /arch, GCC and Clang need the target attribute.
+#ifdef _MSC_VER
+#define HALF_FLOAT_TARGET_F16C
+#else
+#define HALF_FLOAT_TARGET_F16C __attribute__((target("avx,f16c")))
+#endif
+
+	bool detectF16C()
+	{
+		unsigned int registers[4] = { 0, 0, 0, 0 };
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 1);
+		for (int i = 0; i < 4; ++i)
+			registers[i] = unsigned(info[i]);
+#else
+		if (!__get_cpuid(1, &registers[0], &registers[1], &registers[2], &registers[3]))
+			return false;
+#endif
+
+		// F16C works on YMM registers, so the OS has to save them as well as the CPU having the instructions.
+		const unsigned int ecx = registers[2];
+		const bool osxsave = (ecx & (1u << 27)) != 0;
+		const bool avx = (ecx & (1u << 28)) != 0;
+		const bool f16c = (ecx & (1u << 29)) != 0;
+		if (!osxsave || !avx || !f16c)
+			return false;
+
+#ifdef _MSC_VER
+		unsigned long long xcr0 = _xgetbv(0);
+#else
+		unsigned int xcr0Low = 0;
+		unsigned int xcr0High = 0;
+		__asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+		unsigned long long xcr0 = xcr0Low;
+#endif
+		return (xcr0 & 0x6) == 0x6;
+	}
+
+	bool cpuHasF16C()
+	{
+		static const bool hasF16C = detectF16C();
+		return hasF16C;
+	}
+
+	HALF_FLOAT_TARGET_F16C size_t halfToFloatF16C(const uint16_t* src, float* dst, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(packed));
+		}
+
+		return i;
+	}
+
+	HALF_FLOAT_TARGET_F16C size_t floatToHalfF16C(const float* src, uint16_t* dst, size_t count)
+	{
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i packed = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+		}
+
+		return i;
+	}
+#endif
+}
+
+bool HalfFloat::hasHardwareConversion()
+{
+#if defined(HALF_FLOAT_F16C) || defined(__AVX512F__)
+	return true;
+#elif defined(HALF_FLOAT_F16C_DISPATCH)
+	return cpuHasF16C();
+#else
+	return false;
+#endif
+}
+
+void HalfFloat::halfToFloatArray(const uint16_t* src, float* dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(__AVX512F__)
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i packed = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		_mm512_storeu_ps(dst + i, _mm512_cvtph_ps(packed));
+	}
+#elif defined(HALF_FLOAT_F16C)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm256_storeu_ps(dst + i, _mm256_cvtph_ps(packed));
+	}
+#elif defined(HALF_FLOAT_F16C_DISPATCH)
+	if (cpuHasF16C())
+		i = halfToFloatF16C(src, dst, count);
+#endif
+
+	for (; i < count; ++i)
+	{
+		dst[i] = halfToFloat(src[i]);
+	}
+}
+
+void HalfFloat::floatToHalfArray(const float* src, uint16_t* dst, size_t count)
+{
+	size_t i = 0;
+
+#if defined(__AVX512F__)
+	for (; i + 16 <= count; i += 16)
+	{
+		__m256i packed = _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+	}
+#elif defined(HALF_FLOAT_F16C)
+	for (; i + 8 <= count; i += 8)
+	{
+		__m128i packed = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+	}
+#elif defined(HALF_FLOAT_F16C_DISPATCH)
+	if (cpuHasF16C())
+		i = floatToHalfF16C(src, dst, count);
+#endif
+
+	for (; i < count; ++i)
+	{
+		dst[i] = floatToHalf(src[i]);
+	}
+}
+
+void HalfFloat::bfloat16ToFloatArray(const uint16_t* src, float* dst, size_t count)
+{
+	// Plain shifts, the compiler vectorises this on its own.
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] = bfloat16ToFloat(src[i]);
+	}
+}
+
+void HalfFloat::floatToBFloat16Array(const float* src, uint16_t* dst, size_t count)
+{
+	for (size_t i = 0; i < count; ++i)
+	{
+		dst[i] = floatToBFloat16(src[i]);
+	}
+}
@@ -0,0 +1,165 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__))
+#define HALF_FLOAT_F16C 1
+#endif
+
+#if defined(HALF_FLOAT_F16C) || defined(__AVX512F__) || defined(__x86_64__) || defined(_M_X64) || defined(_M_IX86) || (defined(__i386__) && defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+// Conversions between 32 bit floats and the 16 bit IEEE half and bfloat16 storage formats.
+// All conversions round to nearest even, matching the hardware conversion instructions.
+class HalfFloat
+{
+public:
+
+	// Converts a float to an IEEE 754 half.
+	static uint16_t floatToHalf(float value)
+	{
+#ifdef HALF_FLOAT_F16C
+		return uint16_t(_cvtss_sh(value, 0));
+#else
+		// From: https://gist.github.com/rygorous/2156668 (float_to_half_fast3_rtne)
+		uint32_t bits = floatBits(value);
+		uint32_t sign = bits & 0x80000000u;
+		bits ^= sign;
+
+		uint16_t result;
+		if (bits >= (127u + 16u) << 23)
+		{
+			// Too large for a half, becomes infinity or stays NaN.
+			result = (bits > (255u << 23)) ? 0x7E00 : 0x7C00;
+		}
+		else if (bits < (113u << 23))
+		{
+			// Subnormal or zero, let float addition align and round the mantissa.
+			const uint32_t denormMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+			float aligned = bitsFloat(bits) + bitsFloat(denormMagic);
+			result = uint16_t(floatBits(aligned) - denormMagic);
+		}
+		else
+		{
+			uint32_t mantissaOdd = (bits >> 13) & 1;
+			bits += 0xC8000FFFu + mantissaOdd;
+			result = uint16_t(bits >> 13);
+		}
+
+		return uint16_t(result | (sign >> 16));
+#endif
+	}
+
+	// Converts an IEEE 754 half to a float.
+	static float halfToFloat(uint16_t value)
+	{
+#ifdef HALF_FLOAT_F16C
+		return _cvtsh_ss(value);
+#else
+		const uint32_t shiftedExponent = 0x7C00u << 13;
+		uint32_t bits = (uint32_t(value) & 0x7FFFu) << 13;
+		uint32_t exponent = shiftedExponent & bits;
+		bits += (127u - 15u) << 23;
+
+		if (exponent == shiftedExponent)
+		{
+			// Infinity or NaN.
+			bits += (128u - 16u) << 23;
+		}
+		else if (exponent == 0)
+		{
+			// Zero or subnormal, renormalise.
+			bits += 1u << 23;
+			bits = floatBits(bitsFloat(bits) - bitsFloat(113u << 23));
+		}
+
+		return bitsFloat(bits | ((uint32_t(value) & 0x8000u) << 16));
+#endif
+	}
+
+	// Converts a float to an IEEE 754 half with the F16C instruction, only to be called once hasHardwareConversion returned true.
+	// Loops that convert a value at a time are not compiled for F16C, so the instruction is written out where the intrinsic is not allowed.
+	static uint16_t floatToHalfHardware(float value)
+	{
+#if defined(HALF_FLOAT_F16C) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+		return uint16_t(_cvtss_sh(value, 0));
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+		// Only the lowest lane is used, so the float goes in as its register is rather than being moved into a cleared one.
+		__m128i packed;
+		__asm__("vcvtps2ph $0, %1, %0" : "=x"(packed) : "x"(value));
+		return uint16_t(_mm_cvtsi128_si32(packed));
+#else
+		return floatToHalf(value);
+#endif
+	}
+
+	// Converts an IEEE 754 half to a float with the F16C instruction, only to be called once hasHardwareConversion returned true.
+	static float halfToFloatHardware(uint16_t value)
+	{
+#if defined(HALF_FLOAT_F16C) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+		return _cvtsh_ss(value);
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+		__m128 widened;
+		__asm__("vcvtph2ps %1, %0" : "=x"(widened) : "x"(_mm_cvtsi32_si128(value)));
+		return _mm_cvtss_f32(widened);
+#else
+		return halfToFloat(value);
+#endif
+	}
+
+	// Rounds a float to the nearest half and back without leaving the vector register, for a loop that goes on with the stored value.
+	// Only to be called once hasHardwareConversion returned true.
+	static float roundToHalfHardware(float value)
+	{
+#if defined(HALF_FLOAT_F16C) || (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86)))
+		return _mm_cvtss_f32(_mm_cvtph_ps(_mm_cvtps_ph(_mm_set_ss(value), 0)));
+#elif defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+		float rounded = value;
+		__asm__("vcvtps2ph $0, %0, %0\n\tvcvtph2ps %0, %0" : "+x"(rounded));
+		return rounded;
+#else
+		return halfToFloat(floatToHalf(value));
+#endif
+	}
+
+	// Converts a float to a bfloat16 (the top 16 bits of a float).
+	static uint16_t floatToBFloat16(float value)
+	{
+		uint32_t bits = floatBits(value);
+
+		// Keep NaNs quiet rather than letting rounding carry them into infinity.
+		if ((bits & 0x7FFFFFFFu) > 0x7F800000u)
+			return uint16_t((bits >> 16) | 0x40);
+
+		bits += 0x7FFFu + ((bits >> 16) & 1);
+		return uint16_t(bits >> 16);
+	}
+
+	// Converts a bfloat16 to a float.
+	static float bfloat16ToFloat(uint16_t value)
+	{
+		return bitsFloat(uint32_t(value) << 16);
+	}
+
+	// Converts an array of halfs to floats, vectorised with AVX-512 when compiled for it or F16C when the CPU has it.
+	static void halfToFloatArray(const uint16_t* src, float* dst, size_t count);
+
+	// Converts an array of floats to halfs, vectorised with AVX-512 when compiled for it or F16C when the CPU has it.
+	static void floatToHalfArray(const float* src, uint16_t* dst, size_t count);
+
+	// Returns whether the array conversions use the F16C instructions, either compiled in or picked at runtime.
+	static bool hasHardwareConversion();
+
+	// Converts an array of bfloat16s to floats.
+	static void bfloat16ToFloatArray(const uint16_t* src, float* dst, size_t count);
+
+	// Converts an array of floats to bfloat16s.
+	static void floatToBFloat16Array(const float* src, uint16_t* dst, size_t count);
+
+private:
+
+	static uint32_t floatBits(float value) { uint32_t bits; memcpy(&bits, &value, sizeof(bits)); return bits; }
+	static float bitsFloat(uint32_t bits) { float value; memcpy(&value, &bits, sizeof(value)); return value; }
+};
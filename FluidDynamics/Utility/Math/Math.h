@@ -1,7 +1,11 @@
 #pragma once
 #include <algorithm>
-#include <d3d11.h>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef _WIN32
 #include <DirectXMath.h>
+#endif
 
 // TODO: Intergrate this with the other classes.
 class Vector3
@@ -47,10 +51,12 @@ public:
 		return Vector3(-x, -y, -z);
 	};
 
+#ifdef _WIN32
 	operator DirectX::XMFLOAT3()
 	{
 		return DirectX::XMFLOAT3(x, y, z);
 	}
+#endif
 };
 
 class Vector4
@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+
+// Counter based random numbers, Philox4x32-10 from Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3" (SC11).
+// Every draw is a pure function of the seed, a step and an index, so any thread can draw the numbers of any (step, voxel) in any order
+// and get the same bits on every platform and compiler. There is no state to share, lock or advance.
+class Philox
+{
+public:
+	// Four independent 32 bit values from one counter.
+	struct Block
+	{
+		uint32_t values[4];
+	};
+
+	Philox(uint64_t seed = 0) : seed(seed) {};
+
+	// Returns the block of the passed in step and index, usually a voxel.
+	Block generate(uint64_t step, uint64_t index) const
+	{
+		const uint32_t counter[4] = { uint32_t(index), uint32_t(index >> 32), uint32_t(step), uint32_t(step >> 32) };
+		const uint32_t key[2] = { uint32_t(seed), uint32_t(seed >> 32) };
+		return generate(counter, key);
+	}
+
+	// Runs the ten Philox rounds on a raw counter and key.
+	static Block generate(const uint32_t counter[4], const uint32_t key[2])
+	{
+		uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+		uint32_t k0 = key[0], k1 = key[1];
+
+		for (int round = 0; round < 10; ++round)
+		{
+			uint64_t product0 = uint64_t(0xD2511F53u) * c0;
+			uint64_t product1 = uint64_t(0xCD9E8D57u) * c2;
+
+			uint32_t next0 = uint32_t(product1 >> 32) ^ c1 ^ k0;
+			uint32_t next2 = uint32_t(product0 >> 32) ^ c3 ^ k1;
+			c1 = uint32_t(product1);
+			c3 = uint32_t(product0);
+			c0 = next0;
+			c2 = next2;
+
+			// Weyl sequence key schedule.
+			k0 += 0x9E3779B9u;
+			k1 += 0xBB67AE85u;
+		}
+
+		Block block = { { c0, c1, c2, c3 } };
+		return block;
+	}
+
+	// Maps 32 random bits to [0, 1) using the top 24, every result is exactly representable.
+	static float toUnitFloat(uint32_t bits) { return float(bits >> 8) * (1.0f / 16777216.0f); }
+
+	// Maps 32 random bits to [min, max] by multiplying rather than taking a modulo, which would favour the low values.
+	static int toRange(uint32_t bits, int min, int max)
+	{
+		uint64_t range = uint64_t(int64_t(max) - int64_t(min) + 1);
+		return int(int64_t(min) + int64_t((uint64_t(bits) * range) >> 32));
+	}
+
+	uint64_t getSeed() const { return seed; }
+
+private:
+	uint64_t seed;
+};
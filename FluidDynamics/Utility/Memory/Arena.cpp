@@ -0,0 +1,173 @@
+#include "Arena.h"
+#include <cstring>
+#include <utility>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+	// Size of a transparent huge page on Linux.
+	const size_t LinuxHugePageSize = size_t(2) * 1024 * 1024;
+
+	size_t roundUp(size_t value, size_t multiple)
+	{
+		return ((value + multiple - 1) / multiple) * multiple;
+	}
+}
+
+Arena::Arena()
+{
+}
+
+Arena::~Arena()
+{
+	release();
+}
+
+bool Arena::reserve(size_t bytes)
+{
+	reset();
+
+	// Reuse the block as long as the request fits and the backing hasnt been changed.
+	if (canReuse(bytes))
+	{
+		return true;
+	}
+
+	release();
+	return allocateBlock(bytes);
+}
+
+void Arena::reset()
+{
+	used = 0;
+	layout.clear();
+}
+
+void Arena::release()
+{
+	if (block != nullptr)
+	{
+#ifdef _WIN32
+		VirtualFree(block, 0, MEM_RELEASE);
+#else
+		munmap(block, capacity);
+#endif
+	}
+
+	block = nullptr;
+	capacity = 0;
+	hugePageBacked = false;
+	reset();
+}
+
+void Arena::swap(Arena& other)
+{
+	std::swap(block, other.block);
+	std::swap(capacity, other.capacity);
+	std::swap(used, other.used);
+	std::swap(blockAllocations, other.blockAllocations);
+	std::swap(hugePageBacked, other.hugePageBacked);
+	std::swap(blockRequestedHugePages, other.blockRequestedHugePages);
+	layout.swap(other.layout);
+}
+
+void* Arena::allocate(size_t bytes, const char* name, bool zeroFill)
+{
+	size_t alignedBytes = alignSize(bytes);
+
+	if (block == nullptr || used + alignedBytes > capacity)
+	{
+		return nullptr;
+	}
+
+	unsigned char* region = block + used;
+	layout.emplace_back(ArenaAllocation(name, used, alignedBytes));
+	used += alignedBytes;
+
+	if (zeroFill)
+	{
+		memset(region, 0, bytes);
+	}
+
+	return region;
+}
+
+std::string Arena::getLayoutReport()
+{
+	std::string report;
+	char line[256];
+
+	snprintf(line, sizeof(line), "Arena: %zu / %zu bytes used, %s pages, %d block allocations\n", used, capacity, hugePageBacked ? "huge" : "regular", blockAllocations);
+	report += line;
+
+	for (const ArenaAllocation& allocation : layout)
+	{
+		snprintf(line, sizeof(line), "  %-24s offset %12zu size %12zu\n", allocation.name.c_str(), allocation.offset, allocation.bytes);
+		report += line;
+	}
+
+	return report;
+}
+
+bool Arena::allocateBlock(size_t bytes)
+{
+	if (bytes == 0)
+	{
+		return true;
+	}
+
+#ifdef _WIN32
+	if (useHugePages)
+	{
+		// Large pages need the SeLockMemoryPrivilege, fall back to regular pages when it isnt held.
+		SIZE_T largePageSize = GetLargePageMinimum();
+		if (largePageSize > 0)
+		{
+			size_t rounded = roundUp(bytes, largePageSize);
+			block = static_cast<unsigned char*>(VirtualAlloc(nullptr, rounded, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE));
+			if (block != nullptr)
+			{
+				capacity = rounded;
+				hugePageBacked = true;
+			}
+		}
+	}
+
+	if (block == nullptr)
+	{
+		block = static_cast<unsigned char*>(VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+		capacity = bytes;
+	}
+#else
+	size_t rounded = useHugePages ? roundUp(bytes, LinuxHugePageSize) : bytes;
+	void* mapping = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping != MAP_FAILED)
+	{
+		block = static_cast<unsigned char*>(mapping);
+		capacity = rounded;
+
+#ifdef MADV_HUGEPAGE
+		if (useHugePages)
+		{
+			hugePageBacked = madvise(block, capacity, MADV_HUGEPAGE) == 0;
+		}
+#endif
+	}
+#endif
+
+	if (block == nullptr)
+	{
+		capacity = 0;
+		return false;
+	}
+
+	blockRequestedHugePages = useHugePages;
+	blockAllocations++;
+	return true;
+}
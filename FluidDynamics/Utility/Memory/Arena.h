@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Named region carved out of an arena, used to report the arena layout.
+struct ArenaAllocation
+{
+	ArenaAllocation(const std::string& name, size_t offset, size_t bytes) : name(name), offset(offset), bytes(bytes) {};
+	std::string name;
+	size_t offset;
+	size_t bytes;
+};
+
+// Single aligned block of memory that allocations are carved out of linearly.
+// The block is kept between resets so repeated allocations of the same size never touch the OS.
+class Arena
+{
+public:
+	// Alignment of every allocation, a full cache line so all arrays are SIMD aligned.
+	static const size_t Alignment = 64;
+
+	Arena();
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	// Ensures the arena can hold the passed in bytes, reusing the current block when it fits.
+	// Resets all allocations. Returns false if the block could not be allocated.
+	bool reserve(size_t bytes);
+
+	// Returns whether reserve would keep the current block for the passed in bytes rather than going back to the OS.
+	bool canReuse(size_t bytes) { return block != nullptr && bytes <= capacity && useHugePages == blockRequestedHugePages; }
+
+	// Discards all allocations while keeping the block.
+	void reset();
+
+	// Frees the block back to the OS.
+	void release();
+
+	// Exchanges blocks and layouts with another arena, used to ping-pong between two generations of data.
+	void swap(Arena& other);
+
+	// Carves an aligned region out of the arena, returns nullptr if it does not fit.
+	void* allocate(size_t bytes, const char* name, bool zeroFill = true);
+
+	// Carves an aligned array out of the arena, returns nullptr if it does not fit.
+	template<typename T>
+	T* allocateArray(size_t count, const char* name, bool zeroFill = true)
+	{
+		return static_cast<T*>(allocate(sizeof(T) * count, name, zeroFill));
+	}
+
+	// Requests the block be backed by huge pages, takes effect on the next reallocation.
+	void setUseHugePages(bool val) { useHugePages = val; }
+	bool getUseHugePages() { return useHugePages; }
+
+	// Returns whether the current block actually ended up on huge pages.
+	bool isHugePageBacked() { return hugePageBacked; }
+
+	// Returns the size of the block in bytes.
+	size_t getCapacity() { return capacity; }
+
+	// Returns the bytes currently carved out of the block, including alignment padding.
+	size_t getUsed() { return used; }
+
+	// Returns the number of times the block has been (re)allocated from the OS.
+	int getBlockAllocations() { return blockAllocations; }
+
+	// Returns every allocation made since the last reset.
+	const std::vector<ArenaAllocation>& getLayout() { return layout; }
+
+	// Returns a human readable table of the current layout.
+	std::string getLayoutReport();
+
+	// Returns the passed in size rounded up to the arena alignment.
+	static size_t alignSize(size_t bytes) { return (bytes + Alignment - 1) & ~(Alignment - 1); }
+
+private:
+
+	// Allocates a new block from the OS of at least the passed in bytes.
+	bool allocateBlock(size_t bytes);
+
+	unsigned char* block = nullptr;
+	size_t capacity = 0;
+	size_t used = 0;
+	int blockAllocations = 0;
+
+	bool useHugePages = false;
+	bool hugePageBacked = false;
+	bool blockRequestedHugePages = false;
+
+	std::vector<ArenaAllocation> layout;
+};
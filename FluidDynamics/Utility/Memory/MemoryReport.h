@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// A single named allocation within a memory report.
+struct MemoryReportEntry
+{
+	MemoryReportEntry(const std::string& name, size_t bytes) : name(name), bytes(bytes) {};
+	std::string name;
+	size_t bytes;
+};
+
+// Itemised memory footprint checked against a budget, a budget of zero is unlimited.
+struct MemoryReport
+{
+	MemoryReport() : budget(0) {};
+	MemoryReport(size_t budget) : budget(budget) {};
+
+	// Adds a named allocation to the report.
+	void addEntry(const std::string& name, size_t bytes) { entries.emplace_back(MemoryReportEntry(name, bytes)); }
+
+	// Returns the total bytes of all entries.
+	size_t getTotal() const
+	{
+		size_t total = 0;
+		for (const MemoryReportEntry& entry : entries)
+			total += entry.bytes;
+		return total;
+	}
+
+	// Returns whether the total fits in the budget.
+	bool withinBudget() const { return budget == 0 || getTotal() <= budget; }
+
+	// Returns a human readable table of the report.
+	std::string toString() const
+	{
+		std::string report;
+		char line[256];
+
+		for (const MemoryReportEntry& entry : entries)
+		{
+			snprintf(line, sizeof(line), "  %-28s %10.2f MB\n", entry.name.c_str(), toMegabytes(entry.bytes));
+			report += line;
+		}
+
+		snprintf(line, sizeof(line), "  %-28s %10.2f MB", "Total", toMegabytes(getTotal()));
+		report += line;
+
+		if (budget > 0)
+		{
+			snprintf(line, sizeof(line), " of %.2f MB budget%s", toMegabytes(budget), withinBudget() ? "" : " (OVER BUDGET)");
+			report += line;
+		}
+
+		return report + "\n";
+	}
+
+	// Converts bytes to megabytes for display.
+	static double toMegabytes(size_t bytes) { return double(bytes) / (1024.0 * 1024.0); }
+
+	std::vector<MemoryReportEntry> entries;
+	size_t budget;
+};
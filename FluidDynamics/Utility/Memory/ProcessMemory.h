@@ -0,0 +1,11 @@
+#pragma once
+#include <cstddef>
+
+// Queries how much physical memory the whole process is using, as the OS sees it.
+class ProcessMemory
+{
+public:
+
+	// Returns the most physical memory the process has had resident at once in bytes, zero if the OS does not report it.
+	static size_t getPeakResidentBytes();
+};
@@ -0,0 +1,132 @@
+#include "MachineProbe.h"
+#include "Utility/Time/Stopwatch.h"
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace
+{
+	// Times one pass of a STREAM kernel over the pool and returns its GB/s for the bytes it names.
+	double timeStream(ThreadPool& pool, int elements, double bytes, const std::function<void(int rangeBegin, int rangeEnd)>& kernel)
+	{
+		Stopwatch timer;
+		pool.parallelFor(0, elements, kernel);
+		double seconds = timer.getElapsedSeconds();
+
+		return (seconds > 0.0) ? bytes / seconds / 1.0e9 : 0.0;
+	}
+}
+
+double MachinePeaks::getBandwidthGBs() const
+{
+	return std::max(std::max(copyGBs, scaleGBs), std::max(addGBs, triadGBs));
+}
+
+std::string MachinePeaks::toString() const
+{
+	char line[256];
+	std::string summary;
+
+	snprintf(line, sizeof(line), "Bandwidth:         copy %.2f, scale %.2f, add %.2f, triad %.2f GB/s (%d threads, %.0f MB arrays)\n",
+		copyGBs, scaleGBs, addGBs, triadGBs, threads, double(arrayBytes) / (1024.0 * 1024.0));
+	summary += line;
+	snprintf(line, sizeof(line), "Compute:           %.2f GFLOP/s, ridge at %.2f flops/byte\n", gflops, getRidgeIntensity());
+	summary += line;
+	return summary;
+}
+
+MachinePeaks MachineProbe::measure(ThreadPool& pool, size_t arrayBytes, int repeats)
+{
+	MachinePeaks peaks;
+	peaks.threads = pool.getThreadCount();
+
+	int elements = int(std::max<size_t>(arrayBytes / sizeof(double), 1024));
+	peaks.arrayBytes = size_t(elements) * sizeof(double);
+	repeats = std::max(repeats, 1);
+
+	std::vector<double> a(elements), b(elements), c(elements);
+	const double scalar = 3.0;
+
+	// Every thread first touches the part of the arrays it streams, so on NUMA machines the pages sit next to it.
+	pool.parallelFor(0, elements, [&](int rangeBegin, int rangeEnd)
+	{
+		for (int i = rangeBegin; i < rangeEnd; ++i)
+		{
+			a[i] = 1.0;
+			b[i] = 2.0;
+			c[i] = 0.0;
+		}
+	});
+
+	double array = double(peaks.arrayBytes);
+	for (int repeat = 0; repeat < repeats; ++repeat)
+	{
+		peaks.copyGBs = std::max(peaks.copyGBs, timeStream(pool, elements, 2.0 * array, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+				c[i] = a[i];
+		}));
+
+		peaks.scaleGBs = std::max(peaks.scaleGBs, timeStream(pool, elements, 2.0 * array, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+				b[i] = scalar * c[i];
+		}));
+
+		peaks.addGBs = std::max(peaks.addGBs, timeStream(pool, elements, 3.0 * array, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+				c[i] = a[i] + b[i];
+		}));
+
+		peaks.triadGBs = std::max(peaks.triadGBs, timeStream(pool, elements, 3.0 * array, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int i = rangeBegin; i < rangeEnd; ++i)
+				a[i] = b[i] + scalar * c[i];
+		}));
+	}
+
+	// Independent chains of multiply-adds, enough of them to hide the latency of each and laid out so the compiler can vectorise across them.
+	const int chains = 32;
+	const int iterations = 1 << 21;
+	int threads = pool.getThreadCount();
+	std::vector<float> sinks(threads);
+	volatile float multiplier = 0.999999f;
+	volatile float addend = 0.000001f;
+
+	for (int repeat = 0; repeat < repeats; ++repeat)
+	{
+		float m = multiplier;
+		float add = addend;
+
+		Stopwatch timer;
+		pool.parallelFor(0, threads, [&](int rangeBegin, int rangeEnd)
+		{
+			for (int thread = rangeBegin; thread < rangeEnd; ++thread)
+			{
+				float values[chains];
+				for (int chain = 0; chain < chains; ++chain)
+					values[chain] = float(chain + thread);
+
+				for (int i = 0; i < iterations; ++i)
+				{
+					for (int chain = 0; chain < chains; ++chain)
+						values[chain] = values[chain] * m + add;
+				}
+
+				// Keeps the loop from being optimised away.
+				float sum = 0.0f;
+				for (int chain = 0; chain < chains; ++chain)
+					sum += values[chain];
+				sinks[thread] = sum;
+			}
+		});
+		double seconds = timer.getElapsedSeconds();
+
+		double flops = 2.0 * double(chains) * double(iterations) * double(threads);
+		if (seconds > 0.0)
+			peaks.gflops = std::max(peaks.gflops, flops / seconds / 1.0e9);
+	}
+
+	return peaks;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include "Utility/Threading/ThreadPool.h"
+
+// Sustained rates of the machine as measured by MachineProbe, the ceilings of a roofline.
+struct MachinePeaks
+{
+	int threads = 0;
+	size_t arrayBytes = 0;				// Size of each STREAM array.
+
+	// Best of the repeats of each STREAM kernel, counting the bytes the kernel names and not write allocations.
+	double copyGBs = 0.0;
+	double scaleGBs = 0.0;
+	double addGBs = 0.0;
+	double triadGBs = 0.0;
+
+	double gflops = 0.0;				// Multiply-adds on values held in registers, as this build's compiler emits them.
+
+	// Returns the bandwidth ceiling, the best of the STREAM kernels.
+	double getBandwidthGBs() const;
+
+	// Returns the flops per byte where the machine turns from bandwidth to compute bound.
+	double getRidgeIntensity() const { return (getBandwidthGBs() > 0.0) ? gflops / getBandwidthGBs() : 0.0; }
+
+	// Returns a human readable summary of the peaks.
+	std::string toString() const;
+};
+
+// Measures the machine's memory bandwidth with a STREAM style probe and its floating point rate with a register bound loop.
+// The probe splits its work over the pool it is given, so the peaks match the threads the solver runs with.
+class MachineProbe
+{
+public:
+
+	// Runs each probe repeats times and keeps the best. Arrays well past the last level cache are needed for a memory rather than cache bandwidth.
+	static MachinePeaks measure(ThreadPool& pool, size_t arrayBytes = defaultArrayBytes, int repeats = 5);
+
+	// Three arrays of this size, 192 MB, are past the last level cache of any current desktop or server part.
+	static const size_t defaultArrayBytes = size_t(64) * 1024 * 1024;
+};
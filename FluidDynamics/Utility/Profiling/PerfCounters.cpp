@@ -0,0 +1,163 @@
+#include "PerfCounters.h"
+#include <cstring>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+double PerfSample::getIPC() const
+{
+	if (!has(PerfCounter::Cycles) || !has(PerfCounter::Instructions) || get(PerfCounter::Cycles) == 0)
+		return 0.0;
+
+	return double(get(PerfCounter::Instructions)) / double(get(PerfCounter::Cycles));
+}
+
+double PerfSample::getPerKiloInstruction(PerfCounter counter) const
+{
+	if (!has(counter) || !has(PerfCounter::Instructions) || get(PerfCounter::Instructions) == 0)
+		return 0.0;
+
+	return double(get(counter)) * 1000.0 / double(get(PerfCounter::Instructions));
+}
+
+PerfSample PerfSample::operator-(const PerfSample& earlier) const
+{
+	PerfSample difference;
+	for (int i = 0; i < int(PerfCounter::Count); ++i)
+	{
+		difference.available[i] = available[i] && earlier.available[i];
+		difference.values[i] = (difference.available[i] && values[i] > earlier.values[i]) ? values[i] - earlier.values[i] : 0;
+	}
+
+	return difference;
+}
+
+PerfSample& PerfSample::operator+=(const PerfSample& other)
+{
+	for (int i = 0; i < int(PerfCounter::Count); ++i)
+	{
+		available[i] = available[i] || other.available[i];
+		values[i] += other.values[i];
+	}
+
+	return *this;
+}
+
+PerfCounters::~PerfCounters()
+{
+	close();
+}
+
+bool PerfCounters::open()
+{
+	close();
+
+#ifdef __linux__
+	// Generic events the kernel maps to whatever the CPU calls them.
+	const uint32_t types[] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE };
+	const uint64_t configs[] = {
+		PERF_COUNT_HW_CPU_CYCLES,
+		PERF_COUNT_HW_INSTRUCTIONS,
+		PERF_COUNT_HW_CACHE_MISSES,
+		PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		PERF_COUNT_HW_BRANCH_MISSES,
+	};
+
+	int opened = 0;
+	int lastError = 0;
+	for (int i = 0; i < int(PerfCounter::Count); ++i)
+	{
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+		attributes.size = sizeof(attributes);
+		attributes.type = types[i];
+		attributes.config = configs[i];
+		attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attributes.inherit = 1;
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+
+		descriptors[i] = int(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+		if (descriptors[i] >= 0)
+			opened++;
+		else
+			lastError = errno;
+	}
+
+	if (opened == 0)
+	{
+		status = std::string("No hardware counters available (") + strerror(lastError) + "), check perf_event_paranoid or run outside a container or VM";
+		return false;
+	}
+
+	status = (opened == int(PerfCounter::Count)) ? "Counting" : "Counting, some events are not supported here";
+	return true;
+#else
+	status = "Hardware counters are only read on Linux";
+	return false;
+#endif
+}
+
+void PerfCounters::close()
+{
+	for (int& descriptor : descriptors)
+	{
+#ifdef __linux__
+		if (descriptor >= 0)
+			::close(descriptor);
+#endif
+		descriptor = -1;
+	}
+
+	status = "Not opened";
+}
+
+bool PerfCounters::isOpen() const
+{
+	for (int descriptor : descriptors)
+	{
+		if (descriptor >= 0)
+			return true;
+	}
+
+	return false;
+}
+
+PerfSample PerfCounters::read() const
+{
+	PerfSample sample;
+
+#ifdef __linux__
+	for (int i = 0; i < int(PerfCounter::Count); ++i)
+	{
+		if (descriptors[i] < 0)
+			continue;
+
+		// Value, time enabled, time running. An event that was enabled but never got onto the PMU has nothing to scale.
+		uint64_t data[3] = {};
+		if (::read(descriptors[i], data, sizeof(data)) != ssize_t(sizeof(data)) || (data[1] > 0 && data[2] == 0))
+			continue;
+
+		sample.values[i] = (data[2] > 0 && data[2] < data[1]) ? uint64_t(double(data[0]) * double(data[1]) / double(data[2])) : data[0];
+		sample.available[i] = true;
+	}
+#endif
+
+	return sample;
+}
+
+const char* PerfCounters::getName(PerfCounter counter)
+{
+	switch (counter)
+	{
+	case PerfCounter::Cycles: return "cycles";
+	case PerfCounter::Instructions: return "instructions";
+	case PerfCounter::LLCMisses: return "llcMisses";
+	case PerfCounter::DTLBMisses: return "dtlbMisses";
+	default: return "branchMisses";
+	}
+}
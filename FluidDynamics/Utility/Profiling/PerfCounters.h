@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Hardware events counted around solver phases.
+enum class PerfCounter
+{
+	Cycles = 0,
+	Instructions,
+	LLCMisses,			// Last level cache misses.
+	DTLBMisses,			// Data TLB read misses.
+	BranchMisses,		// Mispredicted branches.
+	Count,
+};
+
+// Counts of every event over a span of time. Events that could not be opened are left unavailable rather than zero.
+struct PerfSample
+{
+	uint64_t values[int(PerfCounter::Count)] = {};
+	bool available[int(PerfCounter::Count)] = {};
+
+	uint64_t get(PerfCounter counter) const { return values[int(counter)]; }
+	bool has(PerfCounter counter) const { return available[int(counter)]; }
+
+	// Returns instructions per cycle, zero if either is unavailable.
+	double getIPC() const;
+
+	// Returns the passed in event per thousand instructions, zero if either is unavailable.
+	double getPerKiloInstruction(PerfCounter counter) const;
+
+	// Returns the counts between an earlier sample and this one.
+	PerfSample operator-(const PerfSample& earlier) const;
+	PerfSample& operator+=(const PerfSample& other);
+};
+
+// Hardware performance counters read through perf_event_open on Linux, counting user space only.
+// The counters follow the thread that opens them and any thread it starts afterwards, so open them before the grid's workers first start.
+// Where counters are missing (other platforms, containers and VMs without a PMU, a strict perf_event_paranoid) the events stay unavailable
+// and reads return empty samples, so callers never need a separate path.
+class PerfCounters
+{
+public:
+	PerfCounters() {};
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	// Opens every event it can. Returns false if none could be opened, getStatus then says why.
+	bool open();
+
+	// Closes every event.
+	void close();
+
+	// Returns true if at least one event is counting.
+	bool isOpen() const;
+
+	// Returns the totals counted since open, scaled up for any time the kernel had an event multiplexed out.
+	PerfSample read() const;
+
+	// Returns a short description of what is counting, or why nothing is.
+	const std::string& getStatus() const { return status; }
+
+	// Returns a display name for the passed in event.
+	static const char* getName(PerfCounter counter);
+
+private:
+	int descriptors[int(PerfCounter::Count)] = { -1, -1, -1, -1, -1 };
+	std::string status = "Not opened";
+};
+
+// Adds the counts and time of its lifetime to running totals, does nothing without counters so it can sit on the hot path.
+class PerfScope
+{
+public:
+	PerfScope(const PerfCounters* perfCounters, PerfSample& totalCounts, double& totalMs) : counters(perfCounters), counts(totalCounts), ms(totalMs)
+	{
+		if (counters != nullptr)
+		{
+			begin = counters->read();
+			start = std::chrono::steady_clock::now();
+		}
+	};
+
+	~PerfScope()
+	{
+		if (counters != nullptr)
+		{
+			ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			counts += counters->read() - begin;
+		}
+	};
+
+	PerfScope(const PerfScope&) = delete;
+	PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+	const PerfCounters* counters;
+	PerfSample& counts;
+	double& ms;
+	PerfSample begin;
+	std::chrono::steady_clock::time_point start;
+};
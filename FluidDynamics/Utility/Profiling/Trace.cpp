@@ -0,0 +1,199 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> Trace::enabled(false);
+
+namespace
+{
+	// Events of a single thread. Only the owning thread writes, so recording never takes a lock.
+	struct ThreadBuffer
+	{
+		std::vector<Trace::Event> events;
+		std::atomic<uint64_t> written;
+		int threadId = 0;
+		std::string name;
+
+		ThreadBuffer(int id) : events(Trace::eventsPerThread), written(0), threadId(id) {};
+	};
+
+	// Buffers outlive their threads, so the workers of a stopped pool still show up in the export.
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+	};
+
+	Registry& getRegistry()
+	{
+		static Registry registry;
+		return registry;
+	}
+
+	ThreadBuffer* getThreadBuffer()
+	{
+		thread_local ThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr)
+		{
+			Registry& registry = getRegistry();
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			registry.buffers.emplace_back(new ThreadBuffer(int(registry.buffers.size()) + 1));
+			buffer = registry.buffers.back().get();
+		}
+
+		return buffer;
+	}
+
+	// Escapes a string for use inside JSON quotes.
+	std::string escapeJson(const std::string& text)
+	{
+		std::string escaped = "\"";
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+			{
+				escaped += '\\';
+				escaped += c;
+			}
+			else if ((unsigned char)c < 0x20)
+			{
+				char code[8];
+				snprintf(code, sizeof(code), "\\u%04x", (unsigned)(unsigned char)c);
+				escaped += code;
+			}
+			else
+			{
+				escaped += c;
+			}
+		}
+
+		return escaped + "\"";
+	}
+}
+
+bool Trace::isCompiledIn()
+{
+#ifdef CFD_TRACE_ENABLED
+	return true;
+#else
+	return false;
+#endif
+}
+
+void Trace::setThreadName(const std::string& name)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	std::lock_guard<std::mutex> lock(getRegistry().mutex);
+	buffer->name = name;
+}
+
+void Trace::record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+	ThreadBuffer* buffer = getThreadBuffer();
+
+	uint64_t index = buffer->written.load(std::memory_order_relaxed);
+	Event& event = buffer->events[size_t(index % eventsPerThread)];
+	event.name = name;
+	event.beginNs = beginNs;
+	event.endNs = endNs;
+
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+uint64_t Trace::now()
+{
+	return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void Trace::clear()
+{
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+		buffer->written.store(0, std::memory_order_relaxed);
+}
+
+size_t Trace::getEventCount()
+{
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	size_t count = 0;
+	for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+	{
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		count += size_t((written < eventsPerThread) ? written : eventsPerThread);
+	}
+
+	return count;
+}
+
+std::string Trace::getChromeTraceJson()
+{
+	Registry& registry = getRegistry();
+	std::lock_guard<std::mutex> lock(registry.mutex);
+
+	// Times are written relative to the oldest held event, so the trace starts at zero.
+	uint64_t originNs = UINT64_MAX;
+	for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+	{
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t first = (written > eventsPerThread) ? written - eventsPerThread : 0;
+		for (uint64_t i = first; i < written; ++i)
+		{
+			uint64_t beginNs = buffer->events[size_t(i % eventsPerThread)].beginNs;
+			originNs = (beginNs < originNs) ? beginNs : originNs;
+		}
+	}
+
+	std::string json = "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	bool firstEvent = true;
+	char line[256];
+
+	for (std::unique_ptr<ThreadBuffer>& buffer : registry.buffers)
+	{
+		if (!buffer->name.empty())
+		{
+			json += firstEvent ? "" : ",\n";
+			json += "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " + std::to_string(buffer->threadId) +
+				", \"args\": {\"name\": " + escapeJson(buffer->name) + "}}";
+			firstEvent = false;
+		}
+
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t first = (written > eventsPerThread) ? written - eventsPerThread : 0;
+		for (uint64_t i = first; i < written; ++i)
+		{
+			const Event& event = buffer->events[size_t(i % eventsPerThread)];
+			snprintf(line, sizeof(line), ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %d}",
+				double(event.beginNs - originNs) / 1000.0, double(event.endNs - event.beginNs) / 1000.0, buffer->threadId);
+
+			json += firstEvent ? "" : ",\n";
+			json += "{\"name\": " + escapeJson(event.name != nullptr ? event.name : "") + ", \"cat\": \"cfd\"" + line;
+			firstEvent = false;
+		}
+	}
+
+	json += "\n]}\n";
+	return json;
+}
+
+bool Trace::writeChromeTrace(const std::string& path, std::string* error)
+{
+	std::string json = getChromeTraceJson();
+
+	FILE* file = fopen(path.c_str(), "wb");
+	bool written = (file != nullptr) && fwrite(json.data(), 1, json.size(), file) == json.size();
+	if (file != nullptr && fclose(file) != 0)
+		written = false;
+
+	if (!written && error != nullptr)
+		*error = "Could not write the trace to " + path;
+
+	return written;
+}
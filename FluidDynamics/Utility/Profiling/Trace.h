@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Scoped zones on the hot path, kept in a ring buffer per thread and exported as Chrome trace event JSON for chrome://tracing or ui.perfetto.dev.
+// Zones only exist in builds with CFD_TRACE_ENABLED defined, everywhere else the macros compile to nothing.
+// With tracing compiled in but not enabled a zone costs a single relaxed load.
+
+#ifdef CFD_TRACE_ENABLED
+#define CFD_TRACE_CONCAT_INNER(a, b) a##b
+#define CFD_TRACE_CONCAT(a, b) CFD_TRACE_CONCAT_INNER(a, b)
+
+// Records the enclosing scope under the passed in name, which has to outlive the trace so a string literal is expected.
+#define CFD_TRACE_SCOPE(name) Trace::Zone CFD_TRACE_CONCAT(traceZone, __LINE__)(name)
+
+// Names the calling thread in exported traces.
+#define CFD_TRACE_THREAD_NAME(name) Trace::setThreadName(name)
+#else
+#define CFD_TRACE_SCOPE(name) ((void)0)
+#define CFD_TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+class Trace
+{
+public:
+
+	// A finished zone, times are nanoseconds of the steady clock.
+	struct Event
+	{
+		const char* name = nullptr;
+		uint64_t beginNs = 0;
+		uint64_t endNs = 0;
+	};
+
+	// Records its lifetime as an event if tracing was enabled when it was constructed.
+	class Zone
+	{
+	public:
+		explicit Zone(const char* zoneName) : name(zoneName), active(isEnabled()), beginNs(active ? now() : 0) {};
+		~Zone() { if (active) record(name, beginNs, now()); };
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+
+	private:
+		const char* name;
+		bool active;
+		uint64_t beginNs;
+	};
+
+	// Events each thread keeps, older events are overwritten once a thread has recorded more.
+	static const size_t eventsPerThread = size_t(1) << 15;
+
+	// Returns true if this build was made with CFD_TRACE_ENABLED, without it no zones exist to record.
+	static bool isCompiledIn();
+
+	// Starts or stops recording zones.
+	static void setEnabled(bool value) { enabled.store(value, std::memory_order_relaxed); }
+	static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	// Names the calling thread in exported traces.
+	static void setThreadName(const std::string& name);
+
+	// Appends an event to the calling thread's ring buffer.
+	static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+	// Returns the current time of the clock events are recorded with in nanoseconds.
+	static uint64_t now();
+
+	// Discards every recorded event. Only call while no other thread is recording.
+	static void clear();
+
+	// Returns the number of events currently held across all threads.
+	static size_t getEventCount();
+
+	// Returns every held event as Chrome trace event JSON. Only call while no other thread is recording, such as between steps.
+	static std::string getChromeTraceJson();
+
+	// Writes getChromeTraceJson to the passed in path. Returns false and describes the problem if it could not be written.
+	static bool writeChromeTrace(const std::string& path, std::string* error = nullptr);
+
+private:
+	static std::atomic<bool> enabled;
+};
@@ -0,0 +1,217 @@
+#include "ThreadPool.h"
+#include "Utility/Profiling/Trace.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <Windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	setThreadCount(threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+	stopWorkers();
+}
+
+void ThreadPool::setThreadCount(int count)
+{
+	int newCount = (count > 0) ? count : getHardwareThreadCount();
+	if (newCount == threadCount)
+		return;
+
+	// Workers are restarted lazily with the new count on the next loop.
+	stopWorkers();
+	threadCount = newCount;
+}
+
+void ThreadPool::setPinning(ThreadPinning value)
+{
+	if (value == pinning)
+		return;
+
+	// Workers pick up their affinity when they start, so they are restarted lazily like a change of count.
+	stopWorkers();
+	pinning = value;
+}
+
+int ThreadPool::getPinnedHardwareThread(int thread)
+{
+	int hardwareThreads = getHardwareThreadCount();
+
+	switch (pinning)
+	{
+	case ThreadPinning::Compact: return thread % hardwareThreads;
+	case ThreadPinning::Spread: return int((long long)thread * hardwareThreads / threadCount) % hardwareThreads;
+	default: return -1;
+	}
+}
+
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int rangeBegin, int rangeEnd)>& body)
+{
+	int count = end - begin;
+	if (count <= 0)
+		return;
+
+	int ranges = (count < threadCount) ? count : threadCount;
+	if (ranges <= 1)
+	{
+		body(begin, end);
+		return;
+	}
+
+	startWorkers();
+
+	unsigned long long job;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobBody = &body;
+		jobBegin = begin;
+		jobEnd = end;
+		jobRanges = ranges;
+		nextRange = 0;
+		remainingRanges = ranges;
+		job = ++jobId;
+	}
+	wakeCondition.notify_all();
+
+	runRanges(job);
+
+	std::unique_lock<std::mutex> lock(mutex);
+	doneCondition.wait(lock, [this] { return remainingRanges == 0; });
+	jobBody = nullptr;
+}
+
+int ThreadPool::getHardwareThreadCount()
+{
+	unsigned int count = std::thread::hardware_concurrency();
+	return (count > 0) ? int(count) : 1;
+}
+
+bool ThreadPool::pinCurrentThread(int hardwareThread)
+{
+	if (hardwareThread < 0 || hardwareThread >= getHardwareThreadCount())
+		return false;
+
+#ifdef _WIN32
+	if (hardwareThread >= int(sizeof(DWORD_PTR) * 8))
+		return false;
+
+	return SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << hardwareThread) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(hardwareThread, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+const char* ThreadPool::getPinningName(ThreadPinning pinning)
+{
+	switch (pinning)
+	{
+	case ThreadPinning::Compact: return "compact";
+	case ThreadPinning::Spread: return "spread";
+	default: return "none";
+	}
+}
+
+void ThreadPool::startWorkers()
+{
+	if (int(workers.size()) == threadCount - 1)
+		return;
+
+	stopWorkers();
+
+	stopping = false;
+	for (int i = 0; i < threadCount - 1; ++i)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+	}
+}
+
+void ThreadPool::stopWorkers()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wakeCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+	workers.clear();
+}
+
+void ThreadPool::workerLoop(int index)
+{
+	CFD_TRACE_THREAD_NAME("ThreadPool worker " + std::to_string(index));
+
+	int hardwareThread = getPinnedHardwareThread(index);
+	if (hardwareThread >= 0)
+		pinCurrentThread(hardwareThread);
+
+	unsigned long long lastJob = 0;
+
+	for (;;)
+	{
+		unsigned long long job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wakeCondition.wait(lock, [&] { return stopping || (jobBody != nullptr && jobId != lastJob); });
+
+			if (stopping)
+				return;
+
+			job = jobId;
+		}
+
+		lastJob = job;
+		runRanges(job);
+	}
+}
+
+void ThreadPool::runRanges(unsigned long long job)
+{
+	for (;;)
+	{
+		const std::function<void(int, int)>* body;
+		int rangeBegin;
+		int rangeEnd;
+
+		{
+			// Ranges are claimed under the lock so a late worker can never run a range of a newer job with an older body.
+			std::lock_guard<std::mutex> lock(mutex);
+			if (jobId != job || jobBody == nullptr || nextRange >= jobRanges)
+				return;
+
+			int range = nextRange++;
+			int count = jobEnd - jobBegin;
+			rangeBegin = jobBegin + int((long long)count * range / jobRanges);
+			rangeEnd = jobBegin + int((long long)count * (range + 1) / jobRanges);
+			body = jobBody;
+		}
+
+		{
+			CFD_TRACE_SCOPE("ThreadPool::range");
+			(*body)(rangeBegin, rangeEnd);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--remainingRanges == 0)
+		{
+			doneCondition.notify_all();
+		}
+	}
+}
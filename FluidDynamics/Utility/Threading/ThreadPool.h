@@ -0,0 +1,86 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// How the threads of a pool are tied to hardware threads.
+enum class ThreadPinning
+{
+	None = 0,		// Left to the scheduler.
+	Compact,		// Thread i runs on hardware thread i, filling one core or socket before the next.
+	Spread,			// Threads are spaced evenly over all hardware threads.
+};
+
+// Fixed set of worker threads used to split loops over the grid.
+// Workers are only started the first time work is submitted, so idle pools are free to construct.
+class ThreadPool
+{
+public:
+	// A thread count of zero uses every hardware thread.
+	ThreadPool(int threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Sets the number of threads loops are split across, including the calling thread. Zero uses every hardware thread.
+	void setThreadCount(int count);
+
+	// Returns the number of threads loops are split across, including the calling thread.
+	int getThreadCount() { return threadCount; }
+
+	// Sets how workers are tied to hardware threads, applied when the workers next start. The calling thread is left alone, use pinCurrentThread.
+	void setPinning(ThreadPinning pinning);
+	ThreadPinning getPinning() { return pinning; }
+
+	// Returns the hardware thread the passed in thread of the pool runs on under the pool's pinning, zero being the calling thread. -1 if unpinned.
+	int getPinnedHardwareThread(int thread);
+
+	// Splits [begin, end) into one contiguous range per thread and runs the body on each, blocking until all are done.
+	// The calling thread claims ranges alongside the workers rather than waiting, and a single thread pool runs the body inline.
+	void parallelFor(int begin, int end, const std::function<void(int rangeBegin, int rangeEnd)>& body);
+
+	// Returns the number of hardware threads, at least one.
+	static int getHardwareThreadCount();
+
+	// Ties the calling thread to the passed in hardware thread. Returns false where affinity is not supported or the thread does not exist.
+	static bool pinCurrentThread(int hardwareThread);
+
+	// Returns a display name for the passed in pinning.
+	static const char* getPinningName(ThreadPinning pinning);
+
+private:
+
+	// Starts the workers if the thread count has changed since they were last started.
+	void startWorkers();
+
+	// Stops and joins all workers.
+	void stopWorkers();
+
+	// Worker thread loop, index is the worker's thread number in the pool starting from one.
+	void workerLoop(int index);
+
+	// Claims and runs ranges of the current job until there are none left.
+	void runRanges(unsigned long long job);
+
+	int threadCount = 1;
+	ThreadPinning pinning = ThreadPinning::None;
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wakeCondition;
+	std::condition_variable doneCondition;
+
+	// ------ Current job, guarded by the mutex.
+
+	const std::function<void(int, int)>* jobBody = nullptr;
+	unsigned long long jobId = 0;
+	int jobBegin = 0;
+	int jobEnd = 0;
+	int jobRanges = 0;
+	int nextRange = 0;
+	int remainingRanges = 0;
+	bool stopping = false;
+};
@@ -0,0 +1,27 @@
+#pragma once
+#include <chrono>
+
+// High resolution stopwatch used to time sections of the simulation.
+class Stopwatch
+{
+public:
+	Stopwatch() : start(std::chrono::high_resolution_clock::now()) {};
+
+	// Restarts the stopwatch from now.
+	void reset() { start = std::chrono::high_resolution_clock::now(); }
+
+	// Returns the time elapsed since the last reset in milliseconds.
+	double getElapsedMilliseconds() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	// Returns the time elapsed since the last reset in seconds.
+	double getElapsedSeconds() const
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+private:
+	std::chrono::high_resolution_clock::time_point start;
+};
@@ -15,10 +15,13 @@
 #define _XM_NO_INTRINSICS_
 
 #include "main.h"
+#include <algorithm>
 #include "Core/Entity System/Entity.h"
 #include "Core/Components/Test/TestComponent.h"
 #include <Utility/Shader/ShaderUtility.h>
 #include <Utility/Time/Time.h>
+#include <Utility/Time/Stopwatch.h>
+#include <Utility/Profiling/Trace.h>
 #include <Utility/Window/Headers/Window.h>
 #include <Utility/Direct3D/Headers/D3D.h>
 #include "Core/Components/Transform/Transform.h"
@@ -26,6 +29,18 @@
 #include <Core/Components/Grid/Grid.h>
 #include <Core/Components/LineMesh/LineMesh.h>
 #include <Core/Components/CFD/Grid/CFDGrid.h>
+#include <Core/Components/CFD/Rendering/CFDGridRenderer.h>
+#include <Core/Components/CFD/Emitter/CFDEmitter.h>
+#include <Core/Components/CFD/Precision/PrecisionReport.h>
+#include <Core/Components/CFD/Batch/CFDRoofline.h>
+#include <Core/Components/CFD/Validation/CFDKernelCheck.h>
+#include <Core/Components/CFD/Scenarios/CFDScenarioLibrary.h>
+#include <Core/Components/CFD/Checkpoint/CFDCheckpoint.h>
+#include <Core/Components/CFD/Recording/CFDRecorder.h>
+#include <Core/Components/CFD/Recording/CFDPlayback.h>
+#include <Core/Components/CFD/Recording/CFDInputLog.h>
+#include <Core/Components/CFD/Export/CFDVtkExporter.h>
+#include <Core/Components/CFD/Scene/CFDScene.h>
 
 #include "Dependencies\UI\IMGUI\imgui.h"
 #include "Dependencies\UI\IMGUI\imgui_impl_dx11.h"
@@ -36,6 +51,7 @@
 //--------------------------------------------------------------------------------------
 HRESULT	InitMesh();
 HRESULT	InitWorld(int width, int height);
+void LoadScene(const std::string& path);
 void InitUI();
 void RenderUI();
 void CleanupDevice();
@@ -66,7 +82,6 @@ D3D* direct3D = D3D::getInstance();
 int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance, _In_ LPWSTR lpCmdLine, _In_ int nCmdShow )
 {
     UNREFERENCED_PARAMETER( hPrevInstance );
-    UNREFERENCED_PARAMETER( lpCmdLine );
 
     if (FAILED(window->InitWindow(hInstance, nCmdShow)))
     {
@@ -83,12 +98,29 @@ int WINAPI wWinMain( _In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
         return 0;
     }
 
+    CFD_TRACE_THREAD_NAME("Main");
+
     InitUI();
 
     InitMesh();
 
     InitWorld(1280, 720);
 
+    // A scene file passed on the command line, or scene.ini in the working directory, sets the simulation up without the UI.
+    std::wstring sceneArgument = lpCmdLine;
+    sceneArgument.erase(std::remove(sceneArgument.begin(), sceneArgument.end(), L'"'), sceneArgument.end());
+    if (!sceneArgument.empty())
+    {
+        char scenePath[MAX_PATH] = {};
+        WideCharToMultiByte(CP_ACP, 0, sceneArgument.c_str(), -1, scenePath, MAX_PATH, nullptr, nullptr);
+        LoadScene(scenePath);
+    }
+    else if (FILE* defaultScene = fopen("scene.ini", "rb"))
+    {
+        fclose(defaultScene);
+        LoadScene("scene.ini");
+    }
+
     // Main message loop
     MSG msg = {0};
     while( WM_QUIT != msg.message )
@@ -152,6 +184,18 @@ HRESULT		InitMesh()
 GameObject* camera;
 GameObject* grid;
 CFD::CFDGrid* cfd;
+CFD::CFDRecorder* recorder;
+CFD::CFDPlayback* playback;
+CFD::CFDVtkExporter vtkExporter;
+CFD::CFDInputLog inputLog;
+
+// Paths and settings the UI starts with, replaced by those of a loaded scene.
+char checkpointPath[256] = "smoke.cfdckpt";
+char recordingPath[256] = "smoke.cfdrec";
+char exportPath[256] = "smoke.vti";
+char inputLogPath[256] = "session.cfdinput";
+CFD::VtkExportSettings exportSettings;
+std::string sceneStatus;
 Grid* gridComponent;
 Camera* cam;
 
@@ -188,6 +232,18 @@ HRESULT		InitWorld(int width, int height)
     gridComponent = grid->addComponent<Grid>();
     CFD::CFDGrid* CFD = grid->addComponent<CFD::CFDGrid>();
     cfd = CFD;
+    grid->addComponent<CFD::CFDGridRenderer>();
+
+    // The renderer and grid lines grow with the grid, so the memory budget covers them along with the fields.
+    cfd->setViewMemoryEstimator([](int size, int dim, MemoryReport& report)
+    {
+        int depth = (dim == 3) ? size : 1;
+        report.addEntry("Texture staging buffers", CFD::CFDGridRenderer::getStagingBytes(size, size, depth));
+        report.addEntry("Grid instance buffer", LineMesh::getInstanceBufferBytes(size, size, depth));
+        report.addEntry("Grid instance data buffer", LineMesh::getInstanceDataBufferBytes(size, size, depth));
+    });
+    recorder = grid->addComponent<CFD::CFDRecorder>();
+    playback = grid->addComponent<CFD::CFDPlayback>();
    
     gridComponent->setMatrices(grid->getTransform()->getWorld(), cam->getViewMatrix(), cam->getProjectionMatrix());
 
@@ -197,6 +253,32 @@ HRESULT		InitWorld(int width, int height)
 	return S_OK;
 }
 
+// ***************************************************************************************
+// LoadScene
+// ***************************************************************************************
+void LoadScene(const std::string& path)
+{
+    CFD::SceneDescription scene;
+    std::string error;
+    if (!CFD::CFDScene::load(path, scene, &error) || !CFD::CFDScene::apply(scene, cfd, &error))
+    {
+        sceneStatus = error;
+        return;
+    }
+
+    gridComponent->GenerateGrid(scene.size, scene.size, (scene.dimensions == 3) ? scene.size : 1);
+
+    // The UI picks the rest of the scene up from the grid and recorder the first time it is drawn.
+    strncpy_s(checkpointPath, scene.checkpointPath.c_str(), _TRUNCATE);
+    strncpy_s(recordingPath, scene.recordingPath.c_str(), _TRUNCATE);
+    strncpy_s(exportPath, scene.vtkPath.c_str(), _TRUNCATE);
+    exportSettings.compress = scene.vtkCompress;
+    exportSettings.exportVelocity = scene.vtkVelocity;
+    exportSettings.spacing = scene.vtkSpacing;
+
+    sceneStatus = "Loaded scene " + path;
+}
+
 void InitUI()
 {
     // Init IMGUI
@@ -210,6 +292,8 @@ void InitUI()
 
 void RenderUI()
 {
+    CFD_TRACE_SCOPE("RenderUI");
+
     ImGui_ImplDX11_NewFrame();
     ImGui_ImplWin32_NewFrame();
     ImGui::NewFrame();
@@ -268,6 +352,22 @@ void RenderUI()
             cfd->addDensity(vox.position, editedDens);
         }
 
+        static float emitterRadius = 1.0f;
+        static float emitterLifetime = 0.0f;
+        ImGui::SliderFloat("Emitter Radius", &emitterRadius, 0, 10);
+        ImGui::SliderFloat("Emitter Lifetime", &emitterLifetime, 0, 100);
+
+        if (ImGui::Button("Add Emitter"))
+        {
+            CFD::CFDEmitter* emitter = grid->addComponent<CFD::CFDEmitter>();
+            emitter->setShape(CFD::EmitterShape::Sphere);
+            emitter->setPosition(vox.position);
+            emitter->setSize(Vector3(emitterRadius, emitterRadius, emitterRadius));
+            emitter->setRate(editedDens);
+            emitter->setVelocity(Vector3(veloEdit[0], veloEdit[1], veloEdit[2]));
+            emitter->setLifetime(emitterLifetime);
+        }
+
         if (ImGui::Button("Back"))
         {
             editingVoxel = false;
@@ -278,11 +378,26 @@ void RenderUI()
 
     ImGui::End();
 
-    static int domainSize = cfd->getGridSize();
+    static int domainSize = cfd->getGridWidth();
     static int dimensions = cfd->getDimensions();
     static float diffusionRate = cfd->getDiffusionRate();
     static float viscocityRate = cfd->getViscocity();
-    static int veloMinMax;
+    static int veloMinMax = cfd->getRandomVelocityMinMax();
+
+    // A replay drives the grid, so the controls follow it rather than push their own values over it.
+    if (inputLog.isReplaying())
+    {
+        diffusionRate = cfd->getDiffusionRate();
+        viscocityRate = cfd->getViscocity();
+        veloMinMax = cfd->getRandomVelocityMinMax();
+
+        if (domainSize != cfd->getGridWidth() || dimensions != cfd->getDimensions())
+        {
+            domainSize = cfd->getGridWidth();
+            dimensions = cfd->getDimensions();
+            gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+        }
+    }
 
     ImGui::Begin("Domain Controls");
     ImGui::InputInt("Size", &domainSize);
@@ -296,28 +411,555 @@ void RenderUI()
     ImGui::SliderInt("Random Velocity MinMax", &veloMinMax, 0, 10);
     cfd->setRandomVelocityMinMax(veloMinMax);
 
+    static int randomSeed = int(cfd->getRandomSeed());
+    if (ImGui::InputInt("Random Seed", &randomSeed))
+    {
+        randomSeed = std::max(randomSeed, 0);
+        cfd->setRandomSeed(uint64_t(randomSeed));
+    }
+
+    if (ImGui::CollapsingHeader("Turbulence"))
+    {
+        // Read back from the grid every frame, so loading a scene or checkpoint shows up here.
+        CFD::TurbulenceSettings turbulence = cfd->getTurbulence();
+        ImGui::Checkbox("Curl Noise", &turbulence.enabled);
+        ImGui::SliderFloat("Amplitude", &turbulence.amplitude, 0, 10);
+        ImGui::SliderFloat("Frequency", &turbulence.frequency, 0.5f, 16);
+        ImGui::SliderInt("Octaves", &turbulence.octaves, 1, 5);
+        ImGui::SliderFloat("Evolution", &turbulence.evolution, 0, 4);
+        ImGui::SliderFloat("Active Threshold", &turbulence.activeThreshold, 0, 1);
+        cfd->setTurbulence(turbulence);
+
+        const CFD::TurbulenceStats& turbulenceStats = cfd->getTurbulenceStats();
+        ImGui::Text("%.3f ms/step, %.1f%% of rows stirred", turbulenceStats.lastMs, turbulenceStats.getActiveFraction() * 100.0);
+    }
+
     ImGui::SliderInt("Dimensions", &dimensions, 2, 3);
 
     cfd->setDimensions(dimensions);
 
+    static bool useHugePages = cfd->getUseHugePages();
+    ImGui::Checkbox("Huge Pages", &useHugePages);
+    cfd->setUseHugePages(useHugePages);
+
+    static const char* storageNames[] = { "fp32", "fp16", "bf16" };
+    static int densityStorage = int(cfd->getDensityStorage());
+    static int velocityStorage = int(cfd->getVelocityStorage());
+    if (inputLog.isReplaying())
+    {
+        densityStorage = int(cfd->getDensityStorage());
+        velocityStorage = int(cfd->getVelocityStorage());
+    }
+
+    ImGui::Combo("Density Storage", &densityStorage, storageNames, IM_ARRAYSIZE(storageNames));
+    ImGui::Combo("Velocity Storage", &velocityStorage, storageNames, IM_ARRAYSIZE(storageNames));
+    cfd->setDensityStorage(CFD::FieldStorage(densityStorage));
+    cfd->setVelocityStorage(CFD::FieldStorage(velocityStorage));
+
+    static int memoryBudgetMB = int(cfd->getMemoryBudget() / (1024 * 1024));
+    ImGui::InputInt("Memory Budget (MB)", &memoryBudgetMB);
+    cfd->setMemoryBudget(size_t(std::max<int>(memoryBudgetMB, 0)) * 1024 * 1024);
+
+    if (!sceneStatus.empty())
+        ImGui::TextUnformatted(sceneStatus.c_str());
+
     ImGui::Separator();
 
+    static std::string rejectedGridReport;
+
     if (ImGui::Button("Save"))
     {
-        if (dimensions == 3)
-            gridComponent->GenerateGrid(domainSize, domainSize, domainSize);
+        // The grid checks the fields and the grid visualisation together before allocating anything.
+        if (cfd->setGrid(domainSize, dimensions))
+        {
+            rejectedGridReport.clear();
+            gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+            cfd->Start();
+        }
         else
-            gridComponent->GenerateGrid(domainSize, domainSize, 1);
-
-        cfd->setGrid(domainSize, dimensions);
-        cfd->Start();
+        {
+            rejectedGridReport = cfd->getLastSetGridReport().toString();
+        }
     };
 
+    static const char* resampleNames[] = { "Auto", "Trilinear", "Box" };
+    static int resampleFilter = 0;
+    ImGui::Combo("Resample Filter", &resampleFilter, resampleNames, IM_ARRAYSIZE(resampleNames));
+
+    ImGui::SameLine();
+    if (ImGui::Button("Resize"))
+    {
+        // Resampling keeps the running simulation, unlike Save which starts again from an empty grid.
+        if (cfd->resize(domainSize, CFD::ResampleFilter(resampleFilter)))
+        {
+            rejectedGridReport.clear();
+            gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+        }
+        else
+        {
+            rejectedGridReport = cfd->getLastSetGridReport().toString();
+        }
+    }
+
+    if (cfd->getLastResizeTime() > 0.0)
+        ImGui::Text("Last resize took %.2f ms", cfd->getLastResizeTime());
+
+    ImGui::Separator();
+
+    static std::string checkpointStatus;
+    static bool lossyCheckpoint = false;
+    static WaveletSettings checkpointWavelet;
+    ImGui::InputText("Checkpoint", checkpointPath, IM_ARRAYSIZE(checkpointPath));
+    ImGui::Checkbox("Lossy Checkpoint", &lossyCheckpoint);
+    if (lossyCheckpoint)
+        ImGui::InputFloat("Checkpoint Max Error", &checkpointWavelet.maxError, 0.0001f, 0.001f, "%.5f");
+
+    if (ImGui::Button("Save Checkpoint"))
+    {
+        std::string error;
+        Stopwatch saveTimer;
+        if (CFD::CFDCheckpoint::save(cfd, checkpointPath, &error, lossyCheckpoint ? &checkpointWavelet : nullptr))
+            checkpointStatus = "Saved " + std::string(checkpointPath) + " in " + std::to_string(saveTimer.getElapsedMilliseconds()) + " ms";
+        else
+            checkpointStatus = error;
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("Load Checkpoint"))
+    {
+        std::string error;
+        if (CFD::CFDCheckpoint::load(cfd, checkpointPath, &error))
+        {
+            // Keep the UI in step with the restored grid.
+            domainSize = cfd->getGridWidth();
+            dimensions = cfd->getDimensions();
+            diffusionRate = cfd->getDiffusionRate();
+            viscocityRate = cfd->getViscocity();
+            veloMinMax = cfd->getRandomVelocityMinMax();
+            gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+            checkpointStatus = "Loaded " + std::string(checkpointPath);
+        }
+        else
+        {
+            checkpointStatus = error;
+        }
+    }
+
+    if (!checkpointStatus.empty())
+        ImGui::TextUnformatted(checkpointStatus.c_str());
+
+    ImGui::Separator();
+
+    // Keeps the voxel edits and parameter changes of a session, so a slow session can be replayed here or in CFDBatch --replay and profiled.
+    static std::string inputLogStatus;
+    ImGui::InputText("Input Log", inputLogPath, IM_ARRAYSIZE(inputLogPath));
+
+    if (inputLog.isRecording())
+    {
+        ImGui::Text("Recording inputs, %zu events over %llu steps", inputLog.getEvents().size(), (unsigned long long)inputLog.getStep());
+        if (ImGui::Button("Stop And Save Inputs"))
+        {
+            inputLog.stop();
+
+            std::string error;
+            if (inputLog.save(inputLogPath, &error))
+                inputLogStatus = "Saved " + std::to_string(inputLog.getEvents().size()) + " inputs to " + std::string(inputLogPath);
+            else
+                inputLogStatus = error;
+        }
+    }
+    else if (inputLog.isReplaying())
+    {
+        ImGui::Text("Replaying step %llu of %llu", (unsigned long long)inputLog.getStep(), (unsigned long long)inputLog.getSteps());
+        if (inputLog.isFinished() || ImGui::Button("Stop Replay"))
+        {
+            inputLogStatus = inputLog.isFinished() ? "Replay finished after " + std::to_string(inputLog.getSteps()) + " steps" : "Replay stopped";
+            inputLog.stop();
+        }
+    }
+    else
+    {
+        if (ImGui::Button("Record Inputs"))
+        {
+            // Recording starts the grid again from empty, which is where the replay starts too.
+            std::string error;
+            inputLogStatus = inputLog.startRecording(cfd, &error) ? "Recording inputs" : error;
+        }
+
+        ImGui::SameLine();
+        if (ImGui::Button("Replay Inputs"))
+        {
+            std::string error;
+            if (inputLog.load(inputLogPath, &error) && inputLog.startReplay(cfd, &error))
+                inputLogStatus = inputLog.toString();
+            else
+                inputLogStatus = error;
+        }
+    }
+
+    if (!inputLogStatus.empty())
+        ImGui::TextUnformatted(inputLogStatus.c_str());
+
+    if (!rejectedGridReport.empty())
+    {
+        ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "Grid rejected, over memory budget:");
+        ImGui::TextUnformatted(rejectedGridReport.c_str());
+    }
+
 
     ImGui::End();
 
     ImGui::Begin("Stats");
     ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", 1000.0f / ImGui::GetIO().Framerate, ImGui::GetIO().Framerate);
+
+    if (ImGui::CollapsingHeader("Memory"))
+    {
+        MemoryReport report = cfd->getMemoryReport();
+        ImGui::TextUnformatted(report.toString().c_str());
+    }
+
+    if (ImGui::CollapsingHeader("Storage Precision"))
+    {
+        static std::string precisionReport;
+        static int precisionSteps = 50;
+        ImGui::InputInt("Steps", &precisionSteps);
+
+        if (ImGui::Button("Compare Against fp32"))
+        {
+            CFD::PrecisionReport report = CFD::PrecisionComparison::run(cfd->getGridWidth(), cfd->getDimensions(),
+                cfd->getDensityStorage(), cfd->getVelocityStorage(), precisionSteps);
+            precisionReport = report.toString();
+        }
+
+        ImGui::TextUnformatted(precisionReport.c_str());
+    }
+
+    if (ImGui::CollapsingHeader("Roofline"))
+    {
+        static std::string rooflineReport;
+        static MachinePeaks machinePeaks;
+
+        // The peaks only change with the thread count, so the slow probe is kept and only the kernels are timed again.
+        if (ImGui::Button("Measure Kernels"))
+        {
+            if (machinePeaks.threads != cfd->getThreadCount())
+                machinePeaks = MachineProbe::measure(cfd->getThreadPool());
+
+            // Kernels run on a copy of the setup so the simulation on screen is left alone.
+            CFD::CFDGrid scratch;
+            scratch.setDensityStorage(cfd->getDensityStorage());
+            scratch.setVelocityStorage(cfd->getVelocityStorage());
+            scratch.setThreadCount(cfd->getThreadCount());
+            scratch.setGrid(cfd->getGridWidth(), cfd->getDimensions());
+
+            rooflineReport = CFD::CFDRoofline::run(scratch, machinePeaks).toString();
+        }
+
+        ImGui::TextUnformatted(rooflineReport.c_str());
+    }
+
+    if (ImGui::CollapsingHeader("Kernel Check"))
+    {
+        static std::string kernelCheckReport;
+
+        // Runs on grids of its own with random fields, the simulation on screen is left alone.
+        if (ImGui::Button("Check Kernels"))
+        {
+            CFD::KernelCheckOptions options;
+            options.size = cfd->getGridWidth();
+            options.dimensions = cfd->getDimensions();
+            options.threads = cfd->getThreadCount();
+            options.densityStorage = cfd->getDensityStorage();
+            options.velocityStorage = cfd->getVelocityStorage();
+            options.diffusionRate = cfd->getDiffusionRate();
+            options.seed = cfd->getRandomSeed();
+
+            kernelCheckReport = CFD::CFDKernelCheck::toString(CFD::CFDKernelCheck::checkAll(options));
+        }
+
+        ImGui::TextUnformatted(kernelCheckReport.c_str());
+    }
+
+    if (ImGui::CollapsingHeader("Scenarios"))
+    {
+        static int scenarioIndex = 0;
+        static std::string scenarioReport;
+
+        static const char* scenarioNames[int(CFD::CanonicalScenario::Count)] = {};
+        for (int i = 0; i < int(CFD::CanonicalScenario::Count); ++i)
+            scenarioNames[i] = CFD::getCanonicalScenarioName(CFD::CanonicalScenario(i));
+
+        ImGui::Combo("Scenario", &scenarioIndex, scenarioNames, IM_ARRAYSIZE(scenarioNames));
+        ImGui::TextWrapped("%s", CFD::CFDScenarioLibrary::getDescription(CFD::CanonicalScenario(scenarioIndex)));
+
+        CFD::ScenarioSettings scenarioSettings;
+        scenarioSettings.size = domainSize;
+        scenarioSettings.dimensions = dimensions;
+        scenarioSettings.threads = cfd->getThreadCount();
+        scenarioSettings.densityStorage = CFD::FieldStorage(densityStorage);
+        scenarioSettings.velocityStorage = CFD::FieldStorage(velocityStorage);
+
+        if (ImGui::Button("Load Scenario"))
+        {
+            std::string error;
+            if (CFD::CFDScenarioLibrary::instantiate(CFD::CanonicalScenario(scenarioIndex), cfd, scenarioSettings, &error))
+            {
+                gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+
+                // The sliders push their values every frame, so they take the scenario's rates.
+                diffusionRate = cfd->getDiffusionRate();
+                viscocityRate = cfd->getViscocity();
+                sceneStatus = "Loaded scenario " + std::string(scenarioNames[scenarioIndex]);
+            }
+            else
+            {
+                sceneStatus = error;
+            }
+        }
+
+        ImGui::SameLine();
+
+        // Runs on a grid of its own, the simulation on screen is left alone.
+        if (ImGui::Button("Measure"))
+            scenarioReport = CFD::CFDScenarioLibrary::toString({ CFD::CFDScenarioLibrary::run(CFD::CanonicalScenario(scenarioIndex), scenarioSettings) });
+
+        ImGui::TextUnformatted(scenarioReport.c_str());
+    }
+
+    Arena& arena = cfd->getArena();
+    ImGui::Text("Field arena: %.2f / %.2f MB (%s pages, %d allocations)", arena.getUsed() / (1024.0f * 1024.0f), arena.getCapacity() / (1024.0f * 1024.0f),
+        arena.isHugePageBacked() ? "huge" : "regular", arena.getBlockAllocations());
+
+    if (ImGui::CollapsingHeader("Field Layout"))
+    {
+        for (const ArenaAllocation& allocation : arena.getLayout())
+        {
+            ImGui::Text("%-20s offset %10zu size %10zu", allocation.name.c_str(), allocation.offset, allocation.bytes);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Tracing"))
+    {
+        if (Trace::isCompiledIn())
+        {
+            static char tracePath[256] = "trace.json";
+            static std::string traceStatus;
+
+            bool tracing = Trace::isEnabled();
+            if (ImGui::Checkbox("Record zones", &tracing))
+                Trace::setEnabled(tracing);
+
+            ImGui::Text("%zu events held, the last %zu per thread are kept", Trace::getEventCount(), Trace::eventsPerThread);
+            ImGui::InputText("Trace path", tracePath, sizeof(tracePath));
+
+            // Workers only record inside a step and this runs between steps, so the buffers are safe to read and clear here.
+            if (ImGui::Button("Save Chrome Trace"))
+            {
+                std::string error;
+                traceStatus = Trace::writeChromeTrace(tracePath, &error) ? std::string("Wrote ") + tracePath + ", open it in ui.perfetto.dev or chrome://tracing" : error;
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Clear"))
+                Trace::clear();
+
+            ImGui::TextUnformatted(traceStatus.c_str());
+        }
+        else
+        {
+            ImGui::TextUnformatted("Tracing is compiled out of this build, use the Debug or Profile configuration.");
+        }
+    }
+
+    const std::vector<CFD::CFDEmitter*>& emitters = cfd->getEmitters();
+    if (!emitters.empty())
+    {
+        ImGui::Separator();
+        ImGui::Text("Emitters: %d (%.3f ms/step)", int(emitters.size()), cfd->getEmitterRasteriseTime());
+
+        for (int i = 0; i < emitters.size(); i++)
+        {
+            const CFD::EmitterStats& emitterStats = emitters[i]->getStats();
+            ImGui::Text("[%d] %s %d voxels, %.3f ms/step, %d rebuilds (%.3f ms)", i, emitters[i]->isAlive() ? "Active" : "Expired",
+                emitterStats.footprintVoxels, emitterStats.lastRasteriseMs, emitterStats.rebuildCount, emitterStats.lastRebuildMs);
+        }
+    }
+    ImGui::End();
+
+    ImGui::Begin("Recording");
+
+    static bool recordVelocity = recorder->getRecordVelocity();
+    static int backPressure = int(recorder->getBackPressure());
+    static int poolSize = recorder->getPoolSize();
+    static const char* backPressureNames[] = { "Drop", "Block", "Downsample" };
+
+    ImGui::InputText("File", recordingPath, IM_ARRAYSIZE(recordingPath));
+    ImGui::Checkbox("Record Velocity", &recordVelocity);
+    ImGui::Combo("When Behind", &backPressure, backPressureNames, IM_ARRAYSIZE(backPressureNames));
+    ImGui::InputInt("Buffered Frames", &poolSize);
+
+    static int codec = int(recorder->getCodec());
+    static const char* codecNames[] = { "None", "Shuffle + LZ", "Wavelet (lossy)" };
+    static WaveletSettings recordingWavelet = recorder->getWaveletSettings();
+    ImGui::Combo("Codec", &codec, codecNames, IM_ARRAYSIZE(codecNames));
+    if (CFD::RecordingCodec(codec) == CFD::RecordingCodec::Wavelet)
+    {
+        ImGui::InputFloat("Max Error", &recordingWavelet.maxError, 0.0001f, 0.001f, "%.5f");
+        ImGui::InputFloat("Bits Per Value (0 uses the error)", &recordingWavelet.bitsPerValue, 0.25f, 1.0f, "%.2f");
+    }
+
+    static int keyframeInterval = recorder->getKeyframeInterval();
+    static int brickSize = recorder->getBrickSize();
+    ImGui::InputInt("Keyframe Interval", &keyframeInterval);
+    ImGui::InputInt("Brick Size", &brickSize);
+
+    recorder->setBackPressure(CFD::RecorderBackPressure(backPressure));
+
+    if (!recorder->isRecording())
+    {
+        if (ImGui::Button("Start Recording"))
+        {
+            recorder->setRecordVelocity(recordVelocity);
+            recorder->setPoolSize(poolSize);
+            recorder->setKeyframeInterval(keyframeInterval);
+            recorder->setCodec(CFD::RecordingCodec(codec));
+            recorder->setWaveletSettings(recordingWavelet);
+            recorder->setBrickSize(brickSize);
+            recorder->start(cfd, recordingPath);
+        }
+    }
+    else if (ImGui::Button("Stop Recording"))
+    {
+        recorder->stop();
+    }
+
+    CFD::RecorderStats recorderStats = recorder->getStats();
+    ImGui::Text("Frames: %llu written, %llu dropped, %llu skipped, %d queued (max %d)", (unsigned long long)recorderStats.framesWritten,
+        (unsigned long long)recorderStats.framesDropped, (unsigned long long)recorderStats.framesSkipped, recorderStats.queueDepth, recorderStats.maxQueueDepth);
+    ImGui::Text("Compression: %.2fx, writer %.1f MB/s, recorded %.1f MB/s", recorderStats.getCompressionRatio(), recorderStats.getWriterMBps(), recorderStats.getRecordedMBps());
+    ImGui::Text("Keyframes: %llu, unchanged bricks skipped %.1f%%", (unsigned long long)recorderStats.keyframesWritten, recorderStats.getBrickSkipRatio() * 100.0);
+    ImGui::Text("Solver cost: %.3f ms copying, %.3f ms blocked", recorderStats.copyMs, recorderStats.blockedMs);
+
+    if (recorderStats.downsampleStride > 1)
+        ImGui::Text("Downsampling, recording every %d frames", recorderStats.downsampleStride);
+
+    ImGui::End();
+
+    ImGui::Begin("Playback");
+
+    static char playbackPath[256] = "smoke.cfdrec";
+    static std::string playbackStatus;
+    ImGui::InputText("Recording", playbackPath, IM_ARRAYSIZE(playbackPath));
+
+    if (!playback->isOpen())
+    {
+        static int prefetchCount = playback->getPrefetchCount();
+        ImGui::InputInt("Prefetch Frames", &prefetchCount);
+
+        if (ImGui::Button("Open"))
+        {
+            playback->setPrefetchCount(prefetchCount);
+            if (playback->open(playbackPath))
+            {
+                // The grid is resized to the recording on the next present, keep the line grid in step.
+                const CFD::RecordingHeader& header = playback->getHeader();
+                domainSize = header.N;
+                dimensions = header.dimensions;
+                gridComponent->GenerateGrid(domainSize, domainSize, (dimensions == 3) ? domainSize : 1);
+                playbackStatus = "Playing " + std::string(playbackPath);
+            }
+            else
+            {
+                playbackStatus = "Could not open " + std::string(playbackPath);
+            }
+        }
+    }
+    else
+    {
+        bool playing = playback->getPlaying();
+        bool looping = playback->getLooping();
+        bool blocking = playback->getBlocking();
+
+        if (ImGui::Button(playing ? "Pause" : "Play"))
+            playback->setPlaying(!playing);
+
+        ImGui::SameLine();
+        if (ImGui::Button("Close"))
+        {
+            // The solver carries on from the last frame shown.
+            playback->close();
+            playbackStatus.clear();
+        }
+
+        if (ImGui::Checkbox("Loop", &looping))
+            playback->setLooping(looping);
+
+        ImGui::SameLine();
+        if (ImGui::Checkbox("Show Every Frame", &blocking))
+            playback->setBlocking(blocking);
+
+        if (playback->isOpen())
+        {
+            int scrubFrame = playback->getFrame();
+            if (ImGui::SliderInt("Frame", &scrubFrame, 0, playback->getFrameCount() - 1))
+                playback->seek(scrubFrame);
+
+            CFD::PlaybackStats playbackStats = playback->getStats();
+            ImGui::Text("Presented %llu, late %llu, %d frames prefetched", (unsigned long long)playbackStats.framesPresented,
+                (unsigned long long)playbackStats.framesLate, playbackStats.framesCached);
+            ImGui::Text("Decode %.1f MB/s, %.3f ms waiting", playbackStats.getDecodeMBps(), playbackStats.waitMs);
+
+            if (playback->hasFailed())
+                ImGui::TextColored(ImVec4(1, 0.3f, 0.3f, 1), "Playback stopped on a corrupt frame.");
+        }
+    }
+
+    if (!playbackStatus.empty())
+        ImGui::TextUnformatted(playbackStatus.c_str());
+
+    ImGui::End();
+
+    ImGui::Begin("Export");
+
+    static std::string exportStatus;
+    static bool exportStarted = false;
+    ImGui::InputText("VTK File", exportPath, IM_ARRAYSIZE(exportPath));
+    ImGui::Checkbox("Compress", &exportSettings.compress);
+    ImGui::Checkbox("Export Velocity", &exportSettings.exportVelocity);
+    ImGui::InputFloat("Cell Spacing", &exportSettings.spacing, 0.1f, 1.0f);
+
+    if (vtkExporter.isExporting())
+    {
+        ImGui::Text("Writing %s...", vtkExporter.getPath().c_str());
+    }
+    else if (ImGui::Button("Export Frame"))
+    {
+        // The grid is drawn from the position of its game object, so the export lines up with it in ParaView.
+        DirectX::XMFLOAT3* position = grid->getTransform()->getPosition();
+        exportSettings.origin[0] = position->x;
+        exportSettings.origin[1] = position->y;
+        exportSettings.origin[2] = position->z;
+
+        exportStarted = vtkExporter.start(cfd, exportPath, exportSettings);
+        exportStatus = exportStarted ? "" : "Could not export to " + std::string(exportPath);
+    }
+
+    // Picks up the result once the background write has finished.
+    if (exportStarted && !vtkExporter.isExporting())
+    {
+        exportStarted = false;
+        exportStatus = vtkExporter.finish() ? "Exported " + vtkExporter.getPath() : "Could not write " + vtkExporter.getPath();
+    }
+
+    CFD::VtkExportStats exportStats = vtkExporter.getStats();
+    if (!vtkExporter.isExporting() && exportStats.writtenBytes > 0)
+    {
+        ImGui::Text("Copied in %.2f ms, written at %.1f MB/s", exportStats.snapshotMs, exportStats.getWriterMBps());
+        ImGui::Text("%.2f MB on disk, %.2fx compression", double(exportStats.writtenBytes) / (1024.0 * 1024.0), exportStats.getCompressionRatio());
+    }
+
+    if (!exportStatus.empty())
+        ImGui::TextUnformatted(exportStatus.c_str());
+
     ImGui::End();
 
     ImGui::Render();
@@ -330,6 +972,15 @@ void RenderUI()
 //--------------------------------------------------------------------------------------
 void CleanupDevice()
 {
+    // Finish writing any recording in progress so it isnt left as a temporary file.
+    if (recorder != nullptr)
+        recorder->stop();
+
+    if (playback != nullptr)
+        playback->close();
+
+    vtkExporter.finish();
+
     gameObject->cleanup();
 
     // Remove any bound render target or depth/stencil buffer